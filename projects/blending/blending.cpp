@@ -5,6 +5,7 @@
 #include "windows.h"
 #include "BaseApp.h"
 #include "../common/BaseUtil.h"
+#include "../common/Heightfield.h"
 #include "../common/MathHelper.h"
 #include "../common/UploadBuffer.h"
 
@@ -197,9 +198,6 @@ private:
   void DrawRenderObjects();
   void UpdateObjectConstants();
 
-  float GetHillsHeight(float x, float z) const;
-  XMFLOAT3 GetHillsNormal(float x, float z) const;
-
   std::vector<D3D12_INPUT_ELEMENT_DESC>                          inputLayout_;
   std::unordered_map<std::string, ComPtr<ID3DBlob>>              shaders_;
   ComPtr<ID3D12RootSignature>                                    rootSign_ = nullptr;
@@ -480,12 +478,6 @@ void BlendApp::DrawRenderObjects()
   }
 }
 
-// Applies y=f(x,z) to the values provided.
-float BlendApp::GetHillsHeight(float x, float z) const
-{
-  return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
 // Builds all materials used in this demo.
 void BlendApp::BuildMaterials()
 {
@@ -517,13 +509,21 @@ void BlendApp::BuildTerrainGeometry()
 
   size_t i = 0;
   for (; i < grid.vertices_.size(); i++) {
-    auto& p = grid.vertices_[i].position_;
-    vertices[i].pos_ = p;
-    vertices[i].pos_.y = GetHillsHeight(p.x, p.z);
-    vertices[i].nor_ = GetHillsNormal(p.x, p.z);
+    vertices[i].pos_ = grid.vertices_[i].position_;
     vertices[i].tex_ = grid.vertices_[i].texC_;
   }
 
+  // Heights and normals for the whole grid in one batch, written straight into the shader vertices.
+  HeightfieldStreams streams;
+  streams.pX           = &vertices[0].pos_.x;
+  streams.pZ           = &vertices[0].pos_.z;
+  streams.inputStride  = sizeof(ShaderVertex);
+  streams.pHeights     = &vertices[0].pos_.y;
+  streams.heightStride = sizeof(ShaderVertex);
+  streams.pNormals     = &vertices[0].nor_;
+  streams.normalStride = sizeof(ShaderVertex);
+  Heightfield::EvaluateHills(streams, static_cast<uint32_t>(vertices.size()));
+
   const UINT vbByteSize = static_cast<UINT>(vertices.size() * sizeof(ShaderVertex));
 
   std::vector<std::uint16_t> indices = grid.GetIndices16();
@@ -974,19 +974,6 @@ void BlendApp::LoadTextures()
   textures_[water_tex->name_] = std::move(water_tex);
 }
 
-// Calculates the updated normals for the generated hill terrain.
-XMFLOAT3 BlendApp::GetHillsNormal(float x, float z) const
-{
-  XMFLOAT3 n( -0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-              1.0f,
-              -0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-  XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-  XMStoreFloat3(&n, unitNormal);
-
-  return n;
-}
-
 /**
 
 Blending demo agenda:
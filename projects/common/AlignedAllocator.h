@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <malloc.h>
+#include <new>
+
+// ====================================================================================================================
+// Std allocator that hands out memory aligned to Alignment bytes, so that the vertex streams stored in std::vector can
+// be read with aligned SSE/AVX loads.
+template<typename T, size_t Alignment>
+class AlignedAllocator
+{
+public:
+    using value_type = T;
+
+    template<typename U>
+    struct rebind
+    {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() {}
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t count)
+    {
+        void* pMem = _aligned_malloc(count * sizeof(T), Alignment);
+        if (pMem == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T*>(pMem);
+    }
+
+    void deallocate(T* pMem, size_t)
+    {
+        _aligned_free(pMem);
+    }
+};
+
+template<typename T, typename U, size_t Alignment>
+bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return true; }
+
+template<typename T, typename U, size_t Alignment>
+bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&) { return false; }
@@ -14,6 +14,7 @@
 #include <array>
 #include <unordered_map>
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <cassert>
@@ -199,6 +200,56 @@ public:
 
         return defaultBuffer;
     }
+
+    // Same as above, but instead of copying initData the caller fills the mapped upload buffer, e.g. by generating
+    // geometry straight into it. fill is called with a pointer to byteSize bytes of write-combined memory, so it
+    // should only write, never read.
+    template<typename FillFunc>
+    static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+        ID3D12Device*                           device,
+        ID3D12GraphicsCommandList*              cmdList,
+        UINT64                                  byteSize,
+        Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer,
+        FillFunc                                fill)
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> defaultBuffer;
+
+        ThrowIfFailed(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+                                                      D3D12_HEAP_FLAG_NONE,
+                                                      &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+                                                      D3D12_RESOURCE_STATE_COMMON,
+                                                      nullptr,
+                                                      IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
+
+        ThrowIfFailed(device->CreateCommittedResource(&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+                                                      D3D12_HEAP_FLAG_NONE,
+                                                      &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+                                                      D3D12_RESOURCE_STATE_GENERIC_READ,
+                                                      nullptr,
+                                                      IID_PPV_ARGS(uploadBuffer.GetAddressOf())));
+
+        // The CPU does not read the upload buffer, so pass an empty read range.
+        void*         pMapped = nullptr;
+        CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(uploadBuffer->Map(0, &readRange, &pMapped));
+        fill(pMapped);
+        uploadBuffer->Unmap(0, nullptr);
+
+        cmdList->ResourceBarrier(1,
+                                 &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+                                 D3D12_RESOURCE_STATE_COMMON,
+                                 D3D12_RESOURCE_STATE_COPY_DEST));
+
+        cmdList->CopyBufferRegion(defaultBuffer.Get(), 0, uploadBuffer.Get(), 0, byteSize);
+
+        cmdList->ResourceBarrier(1,
+                                 &CD3DX12_RESOURCE_BARRIER::Transition(defaultBuffer.Get(),
+                                 D3D12_RESOURCE_STATE_COPY_DEST,
+                                 D3D12_RESOURCE_STATE_GENERIC_READ));
+
+        // As above, uploadBuffer has to stay alive until the copy has executed.
+        return defaultBuffer;
+    }
 };
 
 // ====================================================================================================================
@@ -208,7 +259,9 @@ struct SubmeshGeometry
     UINT startIndexLocation = 0;
     UINT baseVertexLocation = 0;
 
-    DirectX::BoundingBox Bounds;
+    DirectX::BoundingBox         Bounds;
+    DirectX::BoundingSphere      SphereBounds;
+    DirectX::BoundingOrientedBox OrientedBounds;
 };
 
 // ====================================================================================================================
@@ -254,6 +307,78 @@ struct MeshGeometry
         vertexBufferUploader = nullptr;
         indexBufferUploader = nullptr;
     }
+
+    // Creates the vertex and index buffers for a MeshBatcher (see MeshBatcher.h) and adds one drawArgs entry per
+    // submesh, including the bounds Write() computed; the index format is the batcher's choice. write(pVertices,
+    // pIndices) is called once with the mapped upload buffers and should call one of the batcher's Write() overloads,
+    // so the geometry is written exactly once.
+    template<typename BatcherT, typename WriteFunc>
+    void CreateBuffers(ID3D12Device*              device,
+                       ID3D12GraphicsCommandList* cmdList,
+                       const BatcherT&            batcher,
+                       UINT                       vertexStride,
+                       WriteFunc                  write)
+    {
+        vertexByteStride     = vertexStride;
+        vertexBufferByteSize = batcher.VertexCount() * vertexStride;
+        indexFormat          = (batcher.IndexSize() == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        indexBufferByteSize  = batcher.IndexCount() * batcher.IndexSize();
+
+        vertexBufferGPU = BaseUtil::CreateDefaultBuffer(device, cmdList, vertexBufferByteSize, vertexBufferUploader, [&](void* pVertices)
+        {
+            indexBufferGPU = BaseUtil::CreateDefaultBuffer(device, cmdList, indexBufferByteSize, indexBufferUploader, [&](void* pIndices)
+            {
+                write(pVertices, pIndices);
+            });
+        });
+
+        for (const auto& batchSubmesh : batcher.Submeshes())
+        {
+            SubmeshGeometry submesh     = {};
+            submesh.indexCount          = batchSubmesh.indexCount;
+            submesh.startIndexLocation  = batchSubmesh.startIndexLocation;
+            submesh.baseVertexLocation  = batchSubmesh.baseVertexLocation;
+            submesh.Bounds              = batchSubmesh.bounds.aabb;
+            submesh.SphereBounds        = batchSubmesh.bounds.sphere;
+            submesh.OrientedBounds      = batchSubmesh.bounds.obb;
+            drawArgs[batchSubmesh.name] = submesh;
+        }
+    }
+
+    // Creates the vertex and index buffers from a MeshFile (see MeshFile.h), copying its first vertex stream and its
+    // indices straight to the upload buffers, and adds one drawArgs entry per submesh, including its bounds.
+    template<typename MeshFileT>
+    void CreateBuffers(ID3D12Device*              device,
+                       ID3D12GraphicsCommandList* cmdList,
+                       const MeshFileT&           file)
+    {
+        vertexByteStride     = file.VertexStride();
+        vertexBufferByteSize = file.VertexCount() * file.VertexStride();
+        indexFormat          = (file.IndexSize() == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+        indexBufferByteSize  = file.IndexCount() * file.IndexSize();
+
+        vertexBufferGPU = BaseUtil::CreateDefaultBuffer(device, cmdList, vertexBufferByteSize, vertexBufferUploader, [&](void* pVertices)
+        {
+            memcpy(pVertices, file.Vertices(), vertexBufferByteSize);
+        });
+        indexBufferGPU = BaseUtil::CreateDefaultBuffer(device, cmdList, indexBufferByteSize, indexBufferUploader, [&](void* pIndices)
+        {
+            memcpy(pIndices, file.Indices(), indexBufferByteSize);
+        });
+
+        for (uint32_t i = 0; i < file.SubmeshCount(); ++i)
+        {
+            const auto&     fileSubmesh = file.Submesh(i);
+            SubmeshGeometry submesh     = {};
+            submesh.indexCount          = fileSubmesh.indexCount;
+            submesh.startIndexLocation  = fileSubmesh.startIndexLocation;
+            submesh.baseVertexLocation  = fileSubmesh.baseVertexLocation;
+            submesh.Bounds              = DirectX::BoundingBox(fileSubmesh.aabbCenter, fileSubmesh.aabbExtents);
+            submesh.SphereBounds        = DirectX::BoundingSphere(fileSubmesh.sphereCenter, fileSubmesh.sphereRadius);
+            submesh.OrientedBounds      = DirectX::BoundingOrientedBox(fileSubmesh.obbCenter, fileSubmesh.obbExtents, fileSubmesh.obbOrientation);
+            drawArgs[fileSubmesh.name] = submesh;
+        }
+    }
 };
 
 // ====================================================================================================================
@@ -0,0 +1,641 @@
+#include "BoundingVolumes.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+// Shrink and regrow passes of ComputeSphere().
+static const uint32 SphereRefinePasses = 8;
+
+// ====================================================================================================================
+static XMVECTOR LoadPosition(
+    const uint8_t* pPositions,
+    uint32         stride,
+    uint32         index)
+{
+    XMFLOAT3 p;
+    memcpy(&p, pPositions + size_t(index) * stride, sizeof(p));
+    return XMLoadFloat3(&p);
+}
+
+// ====================================================================================================================
+BoundingBox BoundingVolumes::ComputeAabb(
+    const void* pPositions,
+    uint32      stride,
+    uint32      count)
+{
+    BoundingBox aabb(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+    if (count == 0)
+    {
+        return aabb;
+    }
+
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pPositions);
+
+    // Two independent accumulators hide the latency of the min / max chains.
+    XMVECTOR min0 = LoadPosition(pBytes, stride, 0);
+    XMVECTOR max0 = min0;
+    XMVECTOR min1 = min0;
+    XMVECTOR max1 = min0;
+
+    uint32 i = 1;
+    for (; i + 1 < count; i += 2)
+    {
+        const XMVECTOR p0 = LoadPosition(pBytes, stride, i);
+        const XMVECTOR p1 = LoadPosition(pBytes, stride, i + 1);
+        min0 = XMVectorMin(min0, p0);
+        max0 = XMVectorMax(max0, p0);
+        min1 = XMVectorMin(min1, p1);
+        max1 = XMVectorMax(max1, p1);
+    }
+    if (i < count)
+    {
+        const XMVECTOR p = LoadPosition(pBytes, stride, i);
+        min0 = XMVectorMin(min0, p);
+        max0 = XMVectorMax(max0, p);
+    }
+
+    const XMVECTOR boundsMin = XMVectorMin(min0, min1);
+    const XMVECTOR boundsMax = XMVectorMax(max0, max1);
+    XMStoreFloat3(&aabb.Center, XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f));
+    XMStoreFloat3(&aabb.Extents, XMVectorScale(XMVectorSubtract(boundsMax, boundsMin), 0.5f));
+    return aabb;
+}
+
+// ====================================================================================================================
+// Grows the sphere just enough to hold p.
+static void GrowSphere(
+    XMVECTOR& center,
+    float&    radius,
+    FXMVECTOR p)
+{
+    const XMVECTOR offset     = XMVectorSubtract(p, center);
+    const float    distanceSq = XMVectorGetX(XMVector3LengthSq(offset));
+    if (distanceSq > radius * radius)
+    {
+        const float distance  = sqrtf(distanceSq);
+        const float newRadius = 0.5f * (radius + distance);
+        center = XMVectorAdd(center, XMVectorScale(offset, (newRadius - radius) / distance));
+        radius = newRadius;
+    }
+}
+
+// ====================================================================================================================
+BoundingSphere BoundingVolumes::ComputeSphere(
+    const void* pPositions,
+    uint32      stride,
+    uint32      count)
+{
+    if (count == 0)
+    {
+        return BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+    }
+
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pPositions);
+
+    // Ritter: start with the most distant pair of the six axis extremes.
+    uint32 extremes[6] = {};
+    {
+        XMFLOAT3 lo;
+        XMFLOAT3 hi;
+        XMStoreFloat3(&lo, LoadPosition(pBytes, stride, 0));
+        hi = lo;
+        for (uint32 i = 1; i < count; ++i)
+        {
+            XMFLOAT3 p;
+            XMStoreFloat3(&p, LoadPosition(pBytes, stride, i));
+            if (p.x < lo.x) { lo.x = p.x; extremes[0] = i; }
+            if (p.x > hi.x) { hi.x = p.x; extremes[1] = i; }
+            if (p.y < lo.y) { lo.y = p.y; extremes[2] = i; }
+            if (p.y > hi.y) { hi.y = p.y; extremes[3] = i; }
+            if (p.z < lo.z) { lo.z = p.z; extremes[4] = i; }
+            if (p.z > hi.z) { hi.z = p.z; extremes[5] = i; }
+        }
+    }
+
+    float    bestDistanceSq = -1.0f;
+    XMVECTOR center         = XMVectorZero();
+    float    radius         = 0.0f;
+    for (uint32 axis = 0; axis < 3; ++axis)
+    {
+        const XMVECTOR a          = LoadPosition(pBytes, stride, extremes[2 * axis]);
+        const XMVECTOR b          = LoadPosition(pBytes, stride, extremes[2 * axis + 1]);
+        const float    distanceSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(b, a)));
+        if (distanceSq > bestDistanceSq)
+        {
+            bestDistanceSq = distanceSq;
+            center         = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+            radius         = 0.5f * sqrtf(distanceSq);
+        }
+    }
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        GrowSphere(center, radius, LoadPosition(pBytes, stride, i));
+    }
+
+    // Shrink the sphere and let the points push it back out, starting at a different point and alternating the
+    // direction each pass, and keep the smallest sphere found.
+    XMVECTOR bestCenter = center;
+    float    bestRadius = radius;
+    for (uint32 pass = 0; pass < SphereRefinePasses; ++pass)
+    {
+        XMVECTOR c = bestCenter;
+        float    r = 0.95f * bestRadius;
+
+        const uint32 start = static_cast<uint32>(uint64_t(count) * pass / SphereRefinePasses);
+        for (uint32 i = 0; i < count; ++i)
+        {
+            const uint32 k     = (pass & 1) ? (count - 1 - i) : i;
+            const uint32 index = (start + k < count) ? (start + k) : (start + k - count);
+            GrowSphere(c, r, LoadPosition(pBytes, stride, index));
+        }
+
+        if (r < bestRadius)
+        {
+            bestCenter = c;
+            bestRadius = r;
+        }
+    }
+
+    // The incremental updates round; take the radius from the final center so every point is inside.
+    float maxDistanceSq = 0.0f;
+    for (uint32 i = 0; i < count; ++i)
+    {
+        const float distanceSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(LoadPosition(pBytes, stride, i), bestCenter)));
+        maxDistanceSq = std::max<float>(maxDistanceSq, distanceSq);
+    }
+
+    BoundingSphere sphere;
+    XMStoreFloat3(&sphere.Center, bestCenter);
+    sphere.Radius = sqrtf(maxDistanceSq);
+    return sphere;
+}
+
+// ====================================================================================================================
+// Minimal sphere support: double precision balls through up to four points.
+struct Ball
+{
+    double center[3] = { 0.0, 0.0, 0.0 };
+    double radiusSq  = -1.0; // Negative for the empty ball
+
+    bool Contains(const double* p) const
+    {
+        const double dx = p[0] - center[0];
+        const double dy = p[1] - center[1];
+        const double dz = p[2] - center[2];
+        return dx * dx + dy * dy + dz * dz <= radiusSq * (1.0 + 1e-9) + 1e-18;
+    }
+};
+
+// ====================================================================================================================
+static double DistanceSq(
+    const double* a,
+    const double* b)
+{
+    return (a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]);
+}
+
+// ====================================================================================================================
+static Ball BallThrough2(
+    const double* a,
+    const double* b)
+{
+    Ball ball;
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        ball.center[i] = 0.5 * (a[i] + b[i]);
+    }
+    ball.radiusSq = 0.25 * DistanceSq(a, b);
+    return ball;
+}
+
+// ====================================================================================================================
+// Circumsphere of a triangle, centered in its plane. Returns false for collinear points.
+static bool BallThrough3(
+    const double* p0,
+    const double* p1,
+    const double* p2,
+    Ball&         ball)
+{
+    const double a[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    const double b[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    const double n[3] = { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+
+    const double nLengthSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+    const double aLengthSq = a[0] * a[0] + a[1] * a[1] + a[2] * a[2];
+    const double bLengthSq = b[0] * b[0] + b[1] * b[1] + b[2] * b[2];
+    if (nLengthSq <= 1e-24 * aLengthSq * bLengthSq)
+    {
+        return false;
+    }
+
+    // center = p0 + ((|a|^2 b - |b|^2 a) x n) / (2 |n|^2)
+    const double d[3] = { aLengthSq * b[0] - bLengthSq * a[0], aLengthSq * b[1] - bLengthSq * a[1], aLengthSq * b[2] - bLengthSq * a[2] };
+    const double scale = 1.0 / (2.0 * nLengthSq);
+    ball.center[0] = p0[0] + (d[1] * n[2] - d[2] * n[1]) * scale;
+    ball.center[1] = p0[1] + (d[2] * n[0] - d[0] * n[2]) * scale;
+    ball.center[2] = p0[2] + (d[0] * n[1] - d[1] * n[0]) * scale;
+    ball.radiusSq  = DistanceSq(ball.center, p0);
+    return true;
+}
+
+// ====================================================================================================================
+// Circumsphere of a tetrahedron. Returns false for coplanar points.
+static bool BallThrough4(
+    const double* p0,
+    const double* p1,
+    const double* p2,
+    const double* p3,
+    Ball&         ball)
+{
+    // Solve 2 (pi - p0) . x = |pi - p0|^2 for the center offset x.
+    double m[3][3];
+    double rhs[3];
+    const double* p[3] = { p1, p2, p3 };
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        for (uint32 j = 0; j < 3; ++j)
+        {
+            m[i][j] = p[i][j] - p0[j];
+        }
+        rhs[i] = 0.5 * (m[i][0] * m[i][0] + m[i][1] * m[i][1] + m[i][2] * m[i][2]);
+    }
+
+    const double c0  = m[1][1] * m[2][2] - m[1][2] * m[2][1];
+    const double c1  = m[1][2] * m[2][0] - m[1][0] * m[2][2];
+    const double c2  = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+    const double det = m[0][0] * c0 + m[0][1] * c1 + m[0][2] * c2;
+
+    const double scale = std::max<double>(std::max<double>(rhs[0], rhs[1]), rhs[2]);
+    if (fabs(det) <= 1e-12 * scale * sqrt(scale))
+    {
+        return false;
+    }
+
+    // Cramer's rule.
+    double x[3];
+    for (uint32 k = 0; k < 3; ++k)
+    {
+        double mk[3][3];
+        memcpy(mk, m, sizeof(m));
+        for (uint32 i = 0; i < 3; ++i)
+        {
+            mk[i][k] = rhs[i];
+        }
+        x[k] = (mk[0][0] * (mk[1][1] * mk[2][2] - mk[1][2] * mk[2][1]) -
+                mk[0][1] * (mk[1][0] * mk[2][2] - mk[1][2] * mk[2][0]) +
+                mk[0][2] * (mk[1][0] * mk[2][1] - mk[1][1] * mk[2][0])) / det;
+    }
+
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        ball.center[i] = p0[i] + x[i];
+    }
+    ball.radiusSq = x[0] * x[0] + x[1] * x[1] + x[2] * x[2];
+    return true;
+}
+
+// ====================================================================================================================
+// Smallest ball with all support points on its boundary, or for degenerate (collinear, coplanar) support the
+// smallest ball through a subset that still holds all of them.
+static Ball BallFromSupport(
+    const double* const* support,
+    uint32               supportCount)
+{
+    Ball ball;
+    switch (supportCount)
+    {
+    case 0:
+        return ball;
+    case 1:
+        memcpy(ball.center, support[0], sizeof(ball.center));
+        ball.radiusSq = 0.0;
+        return ball;
+    case 2:
+        return BallThrough2(support[0], support[1]);
+    case 3:
+        if (BallThrough3(support[0], support[1], support[2], ball))
+        {
+            return ball;
+        }
+        break;
+    default:
+        if (BallThrough4(support[0], support[1], support[2], support[3], ball))
+        {
+            return ball;
+        }
+        break;
+    }
+
+    Ball best;
+    best.radiusSq = DBL_MAX;
+
+    auto Consider = [&](const Ball& candidate)
+    {
+        if (candidate.radiusSq >= best.radiusSq)
+        {
+            return;
+        }
+        for (uint32 i = 0; i < supportCount; ++i)
+        {
+            if (candidate.Contains(support[i]) == false)
+            {
+                return;
+            }
+        }
+        best = candidate;
+    };
+
+    for (uint32 i = 0; i < supportCount; ++i)
+    {
+        for (uint32 j = i + 1; j < supportCount; ++j)
+        {
+            Consider(BallThrough2(support[i], support[j]));
+            for (uint32 k = j + 1; (supportCount == 4) && (k < supportCount); ++k)
+            {
+                Ball candidate;
+                if (BallThrough3(support[i], support[j], support[k], candidate))
+                {
+                    Consider(candidate);
+                }
+            }
+        }
+    }
+    return best;
+}
+
+// ====================================================================================================================
+// Move-to-front Welzl: the ball of points[0, end) with the given support points on its boundary. Points found outside
+// move to the front of the list, so later calls see the likely support points first. Recursion depth is at most 4.
+static Ball MoveToFrontBall(
+    std::vector<const double*>& points,
+    size_t                      end,
+    const double**              support,
+    uint32                      supportCount)
+{
+    Ball ball = BallFromSupport(support, supportCount);
+    if (supportCount == 4)
+    {
+        return ball;
+    }
+
+    for (size_t i = 0; i < end; ++i)
+    {
+        const double* p = points[i];
+        if (ball.Contains(p))
+        {
+            continue;
+        }
+
+        support[supportCount] = p;
+        ball = MoveToFrontBall(points, i, support, supportCount + 1);
+
+        std::rotate(points.begin(), points.begin() + i, points.begin() + i + 1);
+    }
+    return ball;
+}
+
+// ====================================================================================================================
+BoundingSphere BoundingVolumes::ComputeMinimalSphere(
+    const void* pPositions,
+    uint32      stride,
+    uint32      count)
+{
+    if (count == 0)
+    {
+        return BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+    }
+
+    const uint8_t*      pBytes = static_cast<const uint8_t*>(pPositions);
+    std::vector<double> coords(size_t(count) * 3);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        XMFLOAT3 p;
+        memcpy(&p, pBytes + size_t(i) * stride, sizeof(p));
+        coords[3 * i]     = p.x;
+        coords[3 * i + 1] = p.y;
+        coords[3 * i + 2] = p.z;
+    }
+
+    // A fixed shuffle gives the expected linear run time on sorted input (grids, scanned meshes) too.
+    std::vector<const double*> points(count);
+    uint32                     seed = 0x9e3779b9;
+    for (uint32 i = 0; i < count; ++i)
+    {
+        points[i] = &coords[3 * size_t(i)];
+    }
+    for (uint32 i = count - 1; i > 0; --i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        std::swap(points[i], points[(seed >> 8) % (i + 1)]);
+    }
+
+    const double* support[4] = {};
+    const Ball    ball       = MoveToFrontBall(points, points.size(), support, 0);
+
+    BoundingSphere sphere;
+    sphere.Center = XMFLOAT3(float(ball.center[0]), float(ball.center[1]), float(ball.center[2]));
+
+    // Rounding the center to float can leave a point just outside; take the radius in float as well.
+    float maxDistanceSq = 0.0f;
+    const XMVECTOR center = XMLoadFloat3(&sphere.Center);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        const float distanceSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(LoadPosition(pBytes, stride, i), center)));
+        maxDistanceSq = std::max<float>(maxDistanceSq, distanceSq);
+    }
+    sphere.Radius = sqrtf(maxDistanceSq);
+    return sphere;
+}
+
+// ====================================================================================================================
+// Eigenvectors of a symmetric 3x3 matrix (cyclic Jacobi), as the columns of vectors.
+static void SymmetricEigenvectors(
+    double matrix[3][3],
+    double vectors[3][3])
+{
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        for (uint32 j = 0; j < 3; ++j)
+        {
+            vectors[i][j] = (i == j) ? 1.0 : 0.0;
+        }
+    }
+
+    for (uint32 sweep = 0; sweep < 32; ++sweep)
+    {
+        const double offDiagonal = fabs(matrix[0][1]) + fabs(matrix[0][2]) + fabs(matrix[1][2]);
+        if (offDiagonal <= 1e-15 * (fabs(matrix[0][0]) + fabs(matrix[1][1]) + fabs(matrix[2][2])))
+        {
+            break;
+        }
+
+        for (uint32 p = 0; p < 2; ++p)
+        {
+            for (uint32 q = p + 1; q < 3; ++q)
+            {
+                if (matrix[p][q] == 0.0)
+                {
+                    continue;
+                }
+
+                // Rotation that zeroes matrix[p][q].
+                const double theta = (matrix[q][q] - matrix[p][p]) / (2.0 * matrix[p][q]);
+                const double t     = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+                const double c     = 1.0 / sqrt(t * t + 1.0);
+                const double s     = t * c;
+
+                for (uint32 k = 0; k < 3; ++k)
+                {
+                    const double kp = matrix[k][p];
+                    const double kq = matrix[k][q];
+                    matrix[k][p] = c * kp - s * kq;
+                    matrix[k][q] = s * kp + c * kq;
+                }
+                for (uint32 k = 0; k < 3; ++k)
+                {
+                    const double pk = matrix[p][k];
+                    const double qk = matrix[q][k];
+                    matrix[p][k] = c * pk - s * qk;
+                    matrix[q][k] = s * pk + c * qk;
+                }
+                for (uint32 k = 0; k < 3; ++k)
+                {
+                    const double kp = vectors[k][p];
+                    const double kq = vectors[k][q];
+                    vectors[k][p] = c * kp - s * kq;
+                    vectors[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+}
+
+// ====================================================================================================================
+BoundingOrientedBox BoundingVolumes::ComputeObb(
+    const void* pPositions,
+    uint32      stride,
+    uint32      count)
+{
+    const BoundingBox aabb = ComputeAabb(pPositions, stride, count);
+
+    BoundingOrientedBox obb;
+    obb.Center      = aabb.Center;
+    obb.Extents     = aabb.Extents;
+    obb.Orientation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+    if (count < 2)
+    {
+        return obb;
+    }
+
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pPositions);
+
+    // Covariance around the AABB center, which keeps the sums small.
+    double covariance[3][3] = {};
+    double mean[3]          = {};
+    for (uint32 i = 0; i < count; ++i)
+    {
+        XMFLOAT3 p;
+        XMStoreFloat3(&p, XMVectorSubtract(LoadPosition(pBytes, stride, i), XMLoadFloat3(&aabb.Center)));
+        const double d[3] = { p.x, p.y, p.z };
+        for (uint32 r = 0; r < 3; ++r)
+        {
+            mean[r] += d[r];
+            for (uint32 c = r; c < 3; ++c)
+            {
+                covariance[r][c] += d[r] * d[c];
+            }
+        }
+    }
+    for (uint32 r = 0; r < 3; ++r)
+    {
+        mean[r] /= count;
+    }
+    for (uint32 r = 0; r < 3; ++r)
+    {
+        for (uint32 c = r; c < 3; ++c)
+        {
+            covariance[r][c] = covariance[r][c] / count - mean[r] * mean[c];
+            covariance[c][r] = covariance[r][c];
+        }
+    }
+
+    double eigenvectors[3][3];
+    SymmetricEigenvectors(covariance, eigenvectors);
+
+    // Rows of the rotation are the axes; the third is rebuilt so the frame is right handed.
+    XMVECTOR axis0 = XMVector3Normalize(XMVectorSet(float(eigenvectors[0][0]), float(eigenvectors[1][0]), float(eigenvectors[2][0]), 0.0f));
+    XMVECTOR axis1 = XMVectorSet(float(eigenvectors[0][1]), float(eigenvectors[1][1]), float(eigenvectors[2][1]), 0.0f);
+    axis1          = XMVector3Normalize(XMVectorSubtract(axis1, XMVectorMultiply(axis0, XMVector3Dot(axis0, axis1))));
+    XMVECTOR axis2 = XMVector3Cross(axis0, axis1);
+
+    XMVECTOR localMin = XMVectorReplicate(FLT_MAX);
+    XMVECTOR localMax = XMVectorReplicate(-FLT_MAX);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        const XMVECTOR p     = LoadPosition(pBytes, stride, i);
+        const XMVECTOR local = XMVectorSet(XMVectorGetX(XMVector3Dot(p, axis0)),
+                                           XMVectorGetX(XMVector3Dot(p, axis1)),
+                                           XMVectorGetX(XMVector3Dot(p, axis2)),
+                                           0.0f);
+        localMin = XMVectorMin(localMin, local);
+        localMax = XMVectorMax(localMax, local);
+    }
+
+    XMFLOAT3 extents;
+    XMFLOAT3 localCenter;
+    XMStoreFloat3(&extents, XMVectorScale(XMVectorSubtract(localMax, localMin), 0.5f));
+    XMStoreFloat3(&localCenter, XMVectorScale(XMVectorAdd(localMax, localMin), 0.5f));
+
+    const double obbVolume  = double(extents.x) * extents.y * extents.z;
+    const double aabbVolume = double(aabb.Extents.x) * aabb.Extents.y * aabb.Extents.z;
+    if (obbVolume >= aabbVolume)
+    {
+        return obb;
+    }
+
+    const XMVECTOR center = XMVectorAdd(XMVectorAdd(XMVectorScale(axis0, localCenter.x), XMVectorScale(axis1, localCenter.y)),
+                                        XMVectorScale(axis2, localCenter.z));
+
+    XMMATRIX rotation;
+    rotation.r[0] = axis0;
+    rotation.r[1] = axis1;
+    rotation.r[2] = axis2;
+    rotation.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+    XMStoreFloat3(&obb.Center, center);
+    obb.Extents = extents;
+    XMStoreFloat4(&obb.Orientation, XMQuaternionNormalize(XMQuaternionRotationMatrix(rotation)));
+    return obb;
+}
+
+// ====================================================================================================================
+MeshBounds BoundingVolumes::Compute(
+    const void* pPositions,
+    uint32      stride,
+    uint32      count)
+{
+    MeshBounds bounds;
+    bounds.aabb   = ComputeAabb(pPositions, stride, count);
+    bounds.sphere = ComputeMinimalSphere(pPositions, stride, count);
+    bounds.obb    = ComputeObb(pPositions, stride, count);
+    return bounds;
+}
+
+// ====================================================================================================================
+MeshBounds BoundingVolumes::Compute(
+    const MeshData& meshData)
+{
+    return Compute(meshData.m_vertices.data(), sizeof(Vertex), meshData.VertexCount());
+}
+
+// ====================================================================================================================
+MeshBounds BoundingVolumes::Compute(
+    const MeshDataSoA& meshData)
+{
+    return Compute(meshData.m_positions.data(), sizeof(DirectX::XMFLOAT3), meshData.VertexCount());
+}
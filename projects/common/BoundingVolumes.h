@@ -0,0 +1,39 @@
+#pragma once
+
+#include <DirectXCollision.h>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// All bounding volumes of one mesh or submesh.
+struct MeshBounds
+{
+    DirectX::BoundingBox         aabb;
+    DirectX::BoundingSphere      sphere;
+    DirectX::BoundingOrientedBox obb;
+};
+
+// ====================================================================================================================
+// Bounding volumes of a vertex range. Positions are float3 values stride bytes apart, so vertex buffers, MeshData and
+// MeshDataSoA can all be passed without a copy. Empty ranges give zero sized volumes at the origin.
+// - ComputeAabb() is a single SIMD min / max pass.
+// - ComputeSphere() starts from Ritter's sphere and then repeatedly shrinks and regrows it over the points in a
+//   different order (Ericson, Real-Time Collision Detection, 4.3.4), which usually ends within a few percent of the
+//   minimal sphere. It needs no memory, but reads the points about ten times.
+// - ComputeMinimalSphere() is the exact minimal sphere (Welzl 1991 with Gaertner's move-to-front heuristic) in double
+//   precision. It copies the points once and is expected O(n); on meshes it is usually faster than ComputeSphere().
+// - ComputeObb() uses the principal axes of the points and falls back to the AABB when that is smaller, so it is never
+//   looser than the AABB.
+class BoundingVolumes
+{
+public:
+    static DirectX::BoundingBox         ComputeAabb(const void* pPositions, uint32 stride, uint32 count);
+    static DirectX::BoundingSphere      ComputeSphere(const void* pPositions, uint32 stride, uint32 count);
+    static DirectX::BoundingSphere      ComputeMinimalSphere(const void* pPositions, uint32 stride, uint32 count);
+    static DirectX::BoundingOrientedBox ComputeObb(const void* pPositions, uint32 stride, uint32 count);
+
+    // AABB, ComputeMinimalSphere() and ComputeObb().
+    static MeshBounds Compute(const void* pPositions, uint32 stride, uint32 count);
+    static MeshBounds Compute(const MeshData& meshData);
+    static MeshBounds Compute(const MeshDataSoA& meshData);
+};
@@ -0,0 +1,284 @@
+#include "CdlodTerrain.h"
+#include "MathHelper.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+// The ranges of neighbouring LODs have to be at least this many node sizes apart, so a node's morph area never
+// reaches a node two LODs away.
+static const float MinRangeInNodeSizes = 3.0f;
+
+// ====================================================================================================================
+static bool IsBoxOutsideFrustum(
+    const XMFLOAT3& boxMin,
+    const XMFLOAT3& boxMax,
+    const XMFLOAT4* planes)
+{
+    for (uint32 i = 0; i < 6; ++i)
+    {
+        // Corner furthest along the plane normal.
+        const XMFLOAT4& p = planes[i];
+        const float     x = (p.x >= 0.0f) ? boxMax.x : boxMin.x;
+        const float     y = (p.y >= 0.0f) ? boxMax.y : boxMin.y;
+        const float     z = (p.z >= 0.0f) ? boxMax.z : boxMin.z;
+
+        if (p.x * x + p.y * y + p.z * z + p.w < 0.0f)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ====================================================================================================================
+static bool SphereIntersectsBox(
+    const XMFLOAT3& center,
+    float           radius,
+    const XMFLOAT3& boxMin,
+    const XMFLOAT3& boxMax)
+{
+    const float dx = std::max(std::max(boxMin.x - center.x, 0.0f), center.x - boxMax.x);
+    const float dy = std::max(std::max(boxMin.y - center.y, 0.0f), center.y - boxMax.y);
+    const float dz = std::max(std::max(boxMin.z - center.z, 0.0f), center.z - boxMax.z);
+
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+// ====================================================================================================================
+void CdlodTerrain::Build(
+    const CdlodSettings&                       settings,
+    const std::function<float(float, float)>& heightAt,
+    uint32                                     maxThreads)
+{
+    assert((settings.lodCount > 0) && (settings.patchResolution >= 3) && ((settings.patchResolution - 1) % 2 == 0));
+
+    m_settings = settings;
+    m_leafSize = settings.terrainSize / static_cast<float>(1u << (settings.lodCount - 1));
+
+    const uint32 res       = settings.patchResolution;
+    const uint32 leafCount = 1u << (settings.lodCount - 1);
+    const float  half      = 0.5f * settings.terrainSize;
+
+    m_minMaxHeights.assign(settings.lodCount, std::vector<XMFLOAT2>());
+    m_minMaxHeights[0].resize(leafCount * leafCount);
+
+    // Leaves sample the heights at their own patch vertices, which are the finest vertices ever drawn.
+    ParallelFor(leafCount * leafCount, std::max<uint32>(1, 16 * 1024 / (res * res)), maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 leaf = begin; leaf < end; ++leaf)
+        {
+            const float x0 = -half + (leaf % leafCount) * m_leafSize;
+            const float z0 = -half + (leaf / leafCount) * m_leafSize;
+
+            XMFLOAT2 minMax(FLT_MAX, -FLT_MAX);
+            for (uint32 i = 0; i < res; ++i)
+            {
+                for (uint32 j = 0; j < res; ++j)
+                {
+                    const float h = heightAt(x0 + j * m_leafSize / (res - 1), z0 + i * m_leafSize / (res - 1));
+                    minMax.x = std::min(minMax.x, h);
+                    minMax.y = std::max(minMax.y, h);
+                }
+            }
+            m_minMaxHeights[0][leaf] = minMax;
+        }
+    });
+
+    for (uint32 lod = 1; lod < settings.lodCount; ++lod)
+    {
+        const uint32                 count    = leafCount >> lod;
+        const std::vector<XMFLOAT2>& children = m_minMaxHeights[lod - 1];
+        std::vector<XMFLOAT2>&       parents  = m_minMaxHeights[lod];
+        parents.resize(count * count);
+
+        for (uint32 z = 0; z < count; ++z)
+        {
+            for (uint32 x = 0; x < count; ++x)
+            {
+                XMFLOAT2 minMax(FLT_MAX, -FLT_MAX);
+                for (uint32 c = 0; c < 4; ++c)
+                {
+                    const XMFLOAT2& child = children[(2 * z + (c >> 1)) * count * 2 + 2 * x + (c & 1)];
+                    minMax.x = std::min(minMax.x, child.x);
+                    minMax.y = std::max(minMax.y, child.y);
+                }
+                parents[z * count + x] = minMax;
+            }
+        }
+    }
+
+    SetLodRanges(XM_PIDIV4, 1080.0f, 2.0f);
+}
+
+// ====================================================================================================================
+void CdlodTerrain::SetLodRanges(
+    float fovY,
+    float viewportHeight,
+    float maxPixelError)
+{
+    // A length s at distance d covers s * viewportHeight / (2 * d * tan(fovY / 2)) pixels. LOD l + 1 has twice the
+    // vertex spacing of LOD l, so LOD l is needed up to where LOD l + 1 spacing drops to maxPixelError.
+    const float pixelsPerUnit = viewportHeight / (2.0f * tanf(0.5f * fovY) * maxPixelError);
+
+    m_lodRanges.resize(m_settings.lodCount);
+
+    float previousRange = 0.0f;
+    for (uint32 lod = 0; lod < m_settings.lodCount; ++lod)
+    {
+        const float nextSpacing = 2.0f * NodeSize(lod) / (m_settings.patchResolution - 1);
+        const float range       = std::max(nextSpacing * pixelsPerUnit, previousRange + MinRangeInNodeSizes * NodeSize(lod));
+
+        m_lodRanges[lod].range      = range;
+        m_lodRanges[lod].morphEnd   = range;
+        m_lodRanges[lod].morphStart = previousRange + (range - previousRange) * m_settings.morphStartRatio;
+
+        previousRange = range;
+    }
+}
+
+// ====================================================================================================================
+MeshData CdlodTerrain::BuildPatchMesh() const
+{
+    const uint32 res  = m_settings.patchResolution;
+    const uint32 half = (res - 1) / 2;
+
+    GeometryGenerator geoGen;
+    MeshData          patch = geoGen.CreateGrid(1.0f, 1.0f, res, res);
+
+    // CreateGrid() is centered on the origin with row 0 at +z; move it to [0, 1]^2.
+    for (Vertex& v : patch.m_vertices)
+    {
+        v.m_position.x += 0.5f;
+        v.m_position.z += 0.5f;
+    }
+
+    // Regroup the quads (6 indices each, row major) by quadrant.
+    std::vector<uint32> indices;
+    indices.reserve(patch.m_indices32.size());
+
+    for (uint32 quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        const uint32 columnBegin = (quadrant & 1) ? half : 0;
+        const uint32 rowBegin    = (quadrant & 2) ? 0 : half; // Low rows are at high z
+
+        for (uint32 i = rowBegin; i < rowBegin + half; ++i)
+        {
+            for (uint32 j = columnBegin; j < columnBegin + half; ++j)
+            {
+                const uint32* pQuad = &patch.m_indices32[(i * (res - 1) + j) * 6];
+                indices.insert(indices.end(), pQuad, pQuad + 6);
+            }
+        }
+    }
+
+    patch.m_indices32.swap(indices);
+    return patch;
+}
+
+// ====================================================================================================================
+uint32 CdlodTerrain::PatchQuadrantIndexCount() const
+{
+    const uint32 half = (m_settings.patchResolution - 1) / 2;
+    return half * half * 6;
+}
+
+// ====================================================================================================================
+CdlodSelectionStats CdlodTerrain::Select(
+    const XMFLOAT3&         cameraPos,
+    const XMFLOAT4          planes[6],
+    std::vector<CdlodNode>& nodes) const
+{
+    CdlodSelectionStats stats;
+    SelectNode(m_settings.lodCount - 1, 0, 0, cameraPos, planes, nodes, stats);
+    return stats;
+}
+
+// ====================================================================================================================
+// Returns false if the node is out of range for its LOD, so the parent has to cover its area.
+bool CdlodTerrain::SelectNode(
+    uint32                  lod,
+    uint32                  x,
+    uint32                  z,
+    const XMFLOAT3&         cameraPos,
+    const XMFLOAT4*         planes,
+    std::vector<CdlodNode>& nodes,
+    CdlodSelectionStats&    stats) const
+{
+    const uint32    count  = 1u << (m_settings.lodCount - 1 - lod);
+    const float     size   = NodeSize(lod);
+    const XMFLOAT2& minMax = m_minMaxHeights[lod][z * count + x];
+
+    const XMFLOAT3 boxMin(-0.5f * m_settings.terrainSize + x * size, minMax.x, -0.5f * m_settings.terrainSize + z * size);
+    const XMFLOAT3 boxMax(boxMin.x + size, minMax.y, boxMin.z + size);
+
+    if ((planes != nullptr) && IsBoxOutsideFrustum(boxMin, boxMax, planes))
+    {
+        return true;
+    }
+
+    if (SphereIntersectsBox(cameraPos, m_lodRanges[lod].range, boxMin, boxMax) == false)
+    {
+        return false;
+    }
+
+    // Children in range of the finer LOD draw themselves, the parent fills in the quadrants they leave out.
+    uint32 quadrantMask = 0xf;
+    if ((lod > 0) && SphereIntersectsBox(cameraPos, m_lodRanges[lod - 1].range, boxMin, boxMax))
+    {
+        quadrantMask = 0;
+        for (uint32 c = 0; c < 4; ++c)
+        {
+            if (SelectNode(lod - 1, 2 * x + (c & 1), 2 * z + (c >> 1), cameraPos, planes, nodes, stats) == false)
+            {
+                quadrantMask |= 1u << c;
+            }
+        }
+    }
+
+    if (quadrantMask != 0)
+    {
+        CdlodNode node;
+        node.offset       = XMFLOAT2(boxMin.x, boxMin.z);
+        node.size         = size;
+        node.minHeight    = minMax.x;
+        node.maxHeight    = minMax.y;
+        node.lod          = lod;
+        node.quadrantMask = quadrantMask;
+        nodes.push_back(node);
+
+        uint32 quadrantCount = 0;
+        for (uint32 c = 0; c < 4; ++c)
+        {
+            quadrantCount += (quadrantMask >> c) & 1;
+        }
+
+        // Whole nodes take one draw of the full patch.
+        stats.nodeCount++;
+        stats.drawCount     += (quadrantMask == 0xf) ? 1 : quadrantCount;
+        stats.triangleCount += quadrantCount * PatchQuadrantIndexCount() / 3;
+    }
+
+    return true;
+}
+
+// ====================================================================================================================
+XMFLOAT2 CdlodTerrain::MorphVertex(
+    const CdlodNode& node,
+    const XMFLOAT2&  gridPos,
+    float            distance) const
+{
+    const CdlodLodRange& range = m_lodRanges[node.lod];
+    const float          k     = MathHelper::Clamp((distance - range.morphStart) / (range.morphEnd - range.morphStart), 0.0f, 1.0f);
+    const float          cells = static_cast<float>(m_settings.patchResolution - 1);
+
+    const float fx = gridPos.x * cells * 0.5f;
+    const float fz = gridPos.y * cells * 0.5f;
+
+    return XMFLOAT2(node.offset.x + (gridPos.x - (fx - floorf(fx)) * 2.0f / cells * k) * node.size,
+                    node.offset.y + (gridPos.y - (fz - floorf(fz)) * 2.0f / cells * k) * node.size);
+}
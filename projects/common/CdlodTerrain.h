@@ -0,0 +1,97 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <functional>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+struct CdlodSettings
+{
+    float  terrainSize     = 4096.0f; // World extent in x and z, the terrain covers [-size / 2, size / 2]
+    uint32 lodCount        = 8;       // Leaves are terrainSize / 2^(lodCount - 1) wide
+    uint32 patchResolution = 33;      // Vertices per patch side, 2^k + 1
+    float  morphStartRatio = 0.7f;    // Morphing to the next LOD starts this far into a LOD range
+};
+
+// Distance range in which nodes of one LOD are drawn. Vertices morph into the next LOD over [morphStart, morphEnd].
+struct CdlodLodRange
+{
+    float range      = 0.0f;
+    float morphStart = 0.0f;
+    float morphEnd   = 0.0f;
+};
+
+// A selected node, i.e. the per instance data of one patch draw. Nodes only partially covered by their LOD range
+// draw just the quadrants in quadrantMask (bit 0: -x -z, 1: +x -z, 2: -x +z, 3: +x +z); see PatchQuadrantIndexCount().
+struct CdlodNode
+{
+    DirectX::XMFLOAT2 offset;       // Minimum x and z corner
+    float             size;
+    float             minHeight;
+    float             maxHeight;
+    uint32            lod;
+    uint32            quadrantMask;
+};
+
+struct CdlodSelectionStats
+{
+    uint32 nodeCount     = 0;
+    uint32 drawCount     = 0; // Patch draws, partially selected nodes take one per quadrant
+    uint32 triangleCount = 0;
+};
+
+// ====================================================================================================================
+// Quadtree terrain with continuous distance based LOD (Strugar, "Continuous Distance-Dependent Level of Detail for
+// Rendering Heightmaps", 2010). Every node is drawn with the same grid patch, scaled and offset by its CdlodNode.
+// LOD ranges follow from a screen space error, and vertices morph towards the next coarser grid near the end of their
+// range so neighbouring LODs meet without cracks or popping. In the vertex shader, with gridPos in [0, 1]^2:
+//     worldXZ = node.offset + gridPos * node.size;
+//     k       = saturate((distance(camera, float3(worldXZ.x, height, worldXZ.y)) - morphStart) / (morphEnd - morphStart));
+//     worldXZ -= frac(gridPos * (res - 1) * 0.5) * 2 / (res - 1) * node.size * k;
+// then sample the height at worldXZ. MorphVertex() is the same on the CPU.
+// No sample draws with it yet; the hills of the blending and compute shader demos are still one fixed grid. Doing so
+// needs the patch mesh, a per instance buffer of the selected nodes and a vertex shader with the morph above.
+class CdlodTerrain
+{
+public:
+    // Samples heightAt on the patch vertices of every leaf to build the min / max height tree used for the bounds.
+    // Starts with the LOD ranges of a 45 degree field of view, 1080 pixels and 2 pixels of error.
+    void Build(const CdlodSettings& settings, const std::function<float(float x, float z)>& heightAt, uint32 maxThreads = 0);
+
+    // Ranges for a vertex spacing of at most maxPixelError pixels on a viewport viewportHeight pixels high.
+    void SetLodRanges(float fovY, float viewportHeight, float maxPixelError);
+
+    const CdlodSettings&              Settings() const  { return m_settings; }
+    const std::vector<CdlodLodRange>& LodRanges() const { return m_lodRanges; }
+
+    // Unit patch on [0, 1]^2 in x and z, built with GeometryGenerator::CreateGrid(). Indices are sorted by quadrant,
+    // quadrant q uses PatchQuadrantIndexCount() indices starting at q * PatchQuadrantIndexCount().
+    MeshData BuildPatchMesh() const;
+    uint32   PatchQuadrantIndexCount() const;
+
+    // Appends the nodes to draw this frame. planes (see MathHelper::ExtractFrustumPlanes) may be null to skip culling.
+    CdlodSelectionStats Select(const DirectX::XMFLOAT3& cameraPos,
+                               const DirectX::XMFLOAT4  planes[6],
+                               std::vector<CdlodNode>&  nodes) const;
+
+    // Morphed world x and z of the patch vertex at gridPos, for a vertex at the given distance from the camera.
+    DirectX::XMFLOAT2 MorphVertex(const CdlodNode& node, const DirectX::XMFLOAT2& gridPos, float distance) const;
+
+private:
+    bool SelectNode(uint32                   lod,
+                    uint32                   x,
+                    uint32                   z,
+                    const DirectX::XMFLOAT3& cameraPos,
+                    const DirectX::XMFLOAT4* planes,
+                    std::vector<CdlodNode>&  nodes,
+                    CdlodSelectionStats&     stats) const;
+
+    float NodeSize(uint32 lod) const { return m_leafSize * static_cast<float>(1u << lod); }
+
+    CdlodSettings                               m_settings;
+    float                                       m_leafSize = 0.0f;
+    std::vector<CdlodLodRange>                  m_lodRanges;
+    std::vector<std::vector<DirectX::XMFLOAT2>> m_minMaxHeights; // Per LOD, (2^(lodCount - 1 - lod))^2 nodes, rows along z
+};
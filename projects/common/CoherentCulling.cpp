@@ -0,0 +1,664 @@
+#include "CoherentCulling.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+static const uint32 AllPlanes = (1 << Frustum::PlaneCount) - 1;
+
+// ====================================================================================================================
+static float HorizontalMin(
+    __m128 v)
+{
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+    v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtss_f32(v);
+}
+
+// ====================================================================================================================
+void CoherentCuller::Reset(
+    const InstanceBvh& bvh)
+{
+    m_pBvh = &bvh;
+    m_frontier[0].clear();
+    m_frontier[1].clear();
+    m_samples.clear();
+    m_ranges.clear();
+
+    // Between two refreshes at most InstanceCount() instances are appended per frame to at most InstanceCount().
+    m_leafVisible.assign(2 * size_t(bvh.InstanceCount()), 0);
+    m_fallbackVisible.assign(bvh.InstanceCount(), 0);
+
+    const InstanceBvhNode* pNodes = bvh.Nodes();
+    m_parents.assign(bvh.NodeCount(), static_cast<uint32>(NoParent));
+    for (uint32 node = 0; node < bvh.NodeCount(); ++node)
+    {
+        if (pNodes[node].rightChild != 0)
+        {
+            m_parents[node + 1]                      = node;
+            m_parents[node + pNodes[node].rightChild] = node;
+        }
+    }
+    m_leafVisibleCount = 0;
+    m_current          = 0;
+    m_count            = 0;
+    m_framesToRefresh  = 0;
+    m_fallback         = false;
+}
+
+// ====================================================================================================================
+uint32 CoherentCuller::Cull(
+    FXMMATRIX viewProj)
+{
+    const Frustum                    frustum = Frustum::FromMatrix(viewProj);
+    const std::vector<FrontierNode>& last    = m_frontier[m_current];
+
+    m_current = 1 - m_current;
+    m_count   = 0;
+    m_stats   = CoherenceStats();
+    m_frontier[m_current].clear();
+    m_ranges.clear();
+    if ((m_pBvh == nullptr) || (m_pBvh->NodeCount() == 0))
+    {
+        return 0;
+    }
+
+    const bool refresh = (m_fallback == false) &&
+                         (last.empty() || (m_framesToRefresh == 0) || (last.size() > 2 * m_refreshFrontier + 64) ||
+                          (m_leafVisibleCount > m_pBvh->InstanceCount()));
+    if (refresh == false)
+    {
+        float scale[Frustum::PlaneCount];
+        float maxScale  = 0.0f;
+        float maxOffset = 0.0f;
+        for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+        {
+            const XMFLOAT4& plane    = frustum.planes[p];
+            const XMFLOAT4& previous = m_frustum.planes[p];
+            const XMFLOAT3  dn(plane.x - previous.x, plane.y - previous.y, plane.z - previous.z);
+
+            scale[p]  = sqrtf(dn.x * dn.x + dn.y * dn.y + dn.z * dn.z);
+            maxScale  = std::max<float>(maxScale, scale[p]);
+            maxOffset = std::max<float>(maxOffset, fabsf(dn.x * m_anchor.x + dn.y * m_anchor.y + dn.z * m_anchor.z +
+                                                         plane.w - previous.w));
+        }
+
+        if (m_fallback)
+        {
+            // The limits the last frontier had left tell how slow the camera has to be for a new one to last.
+            m_fallback = 2 * CountShortLived(frustum, scale, maxScale, maxOffset) > m_samples.size();
+        }
+        else
+        {
+            m_samples.clear();
+            for (uint32 i = 0; i < SampleCount; ++i)
+            {
+                m_samples.push_back(last[(i * last.size()) / SampleCount]);
+            }
+
+            for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+            {
+                m_scale[p] += scale[p];
+            }
+            m_maxScale  += maxScale;
+            m_maxOffset += maxOffset;
+
+            // Walking a frontier that has mostly expired costs more than culling from the root.
+            m_fallback = 4 * CountExpired(frustum) > 3 * SampleCount;
+            if (m_fallback)
+            {
+                // What was left of each limit in the last frame, symmetric for the deciding plane.
+                for (FrontierNode& sample : m_samples)
+                {
+                    const uint32    p      = sample.plane;
+                    const XMFLOAT4& plane  = m_frustum.planes[p];
+                    const float     d      = plane.x * sample.center.x + plane.y * sample.center.y + plane.z * sample.center.z + plane.w;
+                    const float     spread = (m_scale[p] - scale[p]) * sample.extent;
+                    sample.lower        = std::min<float>(d - spread - sample.lower, sample.upper - d - spread);
+                    sample.othersLimit -= (m_maxScale - maxScale) * sample.reach + m_maxOffset - maxOffset;
+                }
+            }
+        }
+
+        if (m_fallback)
+        {
+            // The anchor follows the camera, so the offsets are measured as a new frontier would see them.
+            m_frustum = frustum;
+            MoveAnchor(viewProj);
+
+            m_stats.fallback = true;
+            AddRange(m_fallbackVisible.data(), m_pBvh->Cull(frustum, m_fallbackVisible.data()));
+            m_stats.ranges = static_cast<uint32>(m_ranges.size());
+            return m_count;
+        }
+    }
+
+    // Also after a fallback, whose frontier is empty.
+    const bool rebuild = refresh || last.empty();
+    if (rebuild)
+    {
+        MoveAnchor(viewProj);
+        std::fill(m_scale, m_scale + Frustum::PlaneCount, 0.0f);
+        m_maxScale         = 0.0f;
+        m_maxOffset        = 0.0f;
+        m_framesToRefresh  = RefreshInterval;
+        m_leafVisibleCount = 0;
+    }
+    --m_framesToRefresh;
+    m_stats.fullRefresh = rebuild;
+
+    m_frustum = frustum;
+    for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+    {
+        m_planeX[p] = frustum.planes[p].x;
+        m_planeY[p] = frustum.planes[p].y;
+        m_planeZ[p] = frustum.planes[p].z;
+        m_planeW[p] = frustum.planes[p].w;
+        m_absX[p]   = fabsf(frustum.planes[p].x);
+        m_absY[p]   = fabsf(frustum.planes[p].y);
+        m_absZ[p]   = fabsf(frustum.planes[p].z);
+    }
+
+    std::vector<FrontierNode>& frontier = m_frontier[m_current];
+    if (rebuild)
+    {
+        Expand(0, NoParent, 0, AllPlanes, FLT_MAX);
+        m_refreshFrontier = static_cast<uint32>(frontier.size());
+    }
+    else
+    {
+        const uint32* pInstances = m_pBvh->Instances().data();
+        const uint32* pLeaves    = m_leafVisible.data();
+
+        for (const FrontierNode& node : last)
+        {
+            const XMFLOAT4& plane     = frustum.planes[node.plane];
+            const float     d         = plane.x * node.center.x + plane.y * node.center.y + plane.z * node.center.z + plane.w;
+            const float     spread    = m_scale[node.plane] * node.extent;
+            const float     maxMotion = m_maxScale * node.reach + m_maxOffset;
+            const bool      passed    = (node.crossing == (1u << node.plane)) && (node.extent < fabsf(d));
+            if ((node.lower < d - spread) && (d + spread < node.upper) && (maxMotion < node.othersLimit) && (passed == false))
+            {
+                if (node.outcome == Outcome::Inside)
+                {
+                    AddRange(pInstances + node.firstInstance, node.count);
+                }
+                else if (node.outcome == Outcome::Crossing)
+                {
+                    AddRange(pLeaves + node.firstVisible, node.count);
+                }
+                ++m_stats.reusedNodes;
+                AddFrontierNode(node, true);
+            }
+            else if (passed && (maxMotion < node.othersLimit))
+            {
+                // The deciding plane has left a leaf that only it crossed, which is now inside or outside as a whole.
+                FrontierNode entry = node;
+                entry.crossing     = 0;
+                if (d > 0.0f)
+                {
+                    entry.outcome = Outcome::Inside;
+                    entry.count   = node.leafSize;
+                    entry.lower   = node.extent - spread;
+                    entry.upper   = FLT_MAX;
+                    AddRange(pInstances + node.firstInstance, entry.count);
+                }
+                else
+                {
+                    entry.outcome     = Outcome::Outside;
+                    entry.count       = 0;
+                    entry.lower       = -FLT_MAX;
+                    entry.upper       = spread - node.extent;
+                    entry.othersLimit = FLT_MAX;
+                }
+                ++m_stats.reusedNodes;
+                AddFrontierNode(entry, false);
+            }
+            else if (((node.crossing & (1 << node.plane)) != 0) && (maxMotion < node.othersLimit))
+            {
+                // A crossing leaf whose spheres can only have moved across the deciding plane.
+                Retest(node, node.othersLimit - maxMotion);
+            }
+            else if (maxMotion < node.planesLimit)
+            {
+                Expand(node.node, node.parent, node.firstInstance, node.planes, node.planesLimit - maxMotion);
+            }
+            else
+            {
+                Expand(node.node, node.parent, node.firstInstance, AllPlanes, FLT_MAX);
+            }
+        }
+    }
+
+    m_stats.frontierNodes = static_cast<uint32>(frontier.size());
+    m_stats.ranges        = static_cast<uint32>(m_ranges.size());
+    return m_count;
+}
+
+// ====================================================================================================================
+void CoherentCuller::CopyVisible(
+    uint32* pVisible) const
+{
+    for (const VisibleRange& range : m_ranges)
+    {
+        memcpy(pVisible, range.pIndices, range.count * sizeof(uint32));
+        pVisible += range.count;
+    }
+}
+
+// ====================================================================================================================
+// The center of the near plane, which follows the camera.
+void CoherentCuller::MoveAnchor(
+    FXMMATRIX viewProj)
+{
+    XMStoreFloat3(&m_anchor, XMVector3TransformCoord(XMVectorZero(), XMMatrixInverse(nullptr, viewProj)));
+}
+
+// ====================================================================================================================
+// Samples whose outcome would not hold with frustum and the current sums.
+uint32 CoherentCuller::CountExpired(
+    const Frustum& frustum) const
+{
+    uint32 expired = 0;
+    for (const FrontierNode& sample : m_samples)
+    {
+        const XMFLOAT4& plane     = frustum.planes[sample.plane];
+        const float     d         = plane.x * sample.center.x + plane.y * sample.center.y + plane.z * sample.center.z + plane.w;
+        const float     spread    = m_scale[sample.plane] * sample.extent;
+        const float     maxMotion = m_maxScale * sample.reach + m_maxOffset;
+        expired += ((sample.lower < d - spread) && (d + spread < sample.upper) && (maxMotion < sample.othersLimit)) ? 0 : 1;
+    }
+    return expired;
+}
+
+// ====================================================================================================================
+// Samples whose limits left would not last MinFrontierFrames frames of the motion from m_frustum to frustum.
+uint32 CoherentCuller::CountShortLived(
+    const Frustum& frustum,
+    const float*   pScale,
+    float          maxScale,
+    float          maxOffset) const
+{
+    uint32 expired = 0;
+    for (const FrontierNode& sample : m_samples)
+    {
+        const XMFLOAT4& plane     = frustum.planes[sample.plane];
+        const XMFLOAT4& previous  = m_frustum.planes[sample.plane];
+        const float     d         = plane.x * sample.center.x + plane.y * sample.center.y + plane.z * sample.center.z + plane.w;
+        const float     dPrevious = previous.x * sample.center.x + previous.y * sample.center.y + previous.z * sample.center.z + previous.w;
+        const float     motion    = fabsf(d - dPrevious) + pScale[sample.plane] * sample.extent;
+        const float     maxMotion = maxScale * sample.reach + maxOffset;
+        expired += ((MinFrontierFrames * motion < sample.lower) && (MinFrontierFrames * maxMotion < sample.othersLimit)) ? 0 : 1;
+    }
+    return expired;
+}
+
+// ====================================================================================================================
+void CoherentCuller::AddRange(
+    const uint32* pIndices,
+    uint32        count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    m_count += count;
+    if ((m_ranges.empty() == false) && (m_ranges.back().pIndices + m_ranges.back().count == pIndices))
+    {
+        m_ranges.back().count += count;
+        return;
+    }
+    m_ranges.push_back({ pIndices, count });
+}
+
+// ====================================================================================================================
+// Appends to the new frontier, replacing two siblings that are both inside or both outside with their parent if its
+// own box is, so that the frontier shrinks back behind a plane that has passed. Two reused siblings were already
+// tried.
+void CoherentCuller::AddFrontierNode(
+    const FrontierNode& entry,
+    bool                reused)
+{
+    std::vector<FrontierNode>& frontier = m_frontier[m_current];
+    frontier.push_back(entry);
+
+    const bool pairReused = reused && m_lastReused;
+    m_lastReused = reused;
+    if ((entry.outcome != Outcome::Crossing) && (pairReused == false) && (frontier.size() >= 2) && (entry.parent != NoParent) &&
+        (frontier[frontier.size() - 2].parent == entry.parent) && (frontier[frontier.size() - 2].outcome == entry.outcome))
+    {
+        MergeSiblings();
+    }
+}
+
+// ====================================================================================================================
+// Replaces the last two entries of the new frontier, siblings with the same outcome, with their parent.
+void CoherentCuller::MergeSiblings()
+{
+    std::vector<FrontierNode>& frontier = m_frontier[m_current];
+    const FrontierNode&        left     = frontier[frontier.size() - 2];
+    const FrontierNode&        right    = frontier.back();
+
+    const uint32           node    = left.parent;
+    const InstanceBvhNode& bvhNode = m_pBvh->Nodes()[node];
+    float                  lower[Frustum::PlaneCount];
+    float                  upper[Frustum::PlaneCount];
+    uint32                 planes       = AllPlanes;
+    float                  insideMargin = FLT_MAX;
+    ++m_stats.testedNodes;
+    if (TestBox(bvhNode, planes, insideMargin, lower, upper) != left.outcome)
+    {
+        return;
+    }
+
+    FrontierNode parent;
+    parent.node          = node;
+    parent.parent        = m_parents[node];
+    parent.firstInstance = left.firstInstance;
+    parent.firstVisible  = 0;
+    parent.count         = left.count + right.count;
+    parent.planes        = AllPlanes;
+    parent.outcome       = left.outcome;
+    parent.crossing      = 0;
+    parent.leafSize      = 0;
+    ++m_stats.mergedNodes;
+
+    frontier.pop_back();
+    frontier.pop_back();
+    AddTestedNode(parent, bvhNode, lower, upper, FLT_MAX, FLT_MAX);
+}
+
+// ====================================================================================================================
+// Tests a box against the planes in the mask, the others being known to contain it by at least insideMargin. Fills
+// how far the distance of each plane to the center may fall and rise before the outcome could change: outside the
+// plane farthest from the box, or inside every plane. Leaves the planes the box crosses in the mask.
+CoherentCuller::Outcome CoherentCuller::TestBox(
+    const InstanceBvhNode& bvhNode,
+    uint32&                planes,
+    float&                 insideMargin,
+    float*                 pLower,
+    float*                 pUpper) const
+{
+    // Four planes at a time in the same operation order as InstanceBvh::Cull(), without branches, which the walk along
+    // a turning plane would mispredict.
+    const __m128 cx      = _mm_set1_ps(bvhNode.center.x);
+    const __m128 cy      = _mm_set1_ps(bvhNode.center.y);
+    const __m128 cz      = _mm_set1_ps(bvhNode.center.z);
+    const __m128 ex      = _mm_set1_ps(bvhNode.extents.x);
+    const __m128 ey      = _mm_set1_ps(bvhNode.extents.y);
+    const __m128 ez      = _mm_set1_ps(bvhNode.extents.z);
+    const __m128 zero    = _mm_setzero_ps();
+    const __m128 maximum = _mm_set1_ps(FLT_MAX);
+    const __m128i tested = _mm_set1_epi32(static_cast<int>(planes));
+
+    alignas(16) float lower[PaddedPlaneCount];
+    alignas(16) float outside[PaddedPlaneCount];
+    __m128 margin      = maximum;
+    uint32 insideMask  = 0;
+    uint32 outsideMask = 0;
+    for (uint32 p = 0; p < PaddedPlaneCount; p += 4)
+    {
+        const __m128  d        = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(m_planeX + p), cx),
+                                                                  _mm_mul_ps(_mm_load_ps(m_planeY + p), cy)),
+                                                       _mm_mul_ps(_mm_load_ps(m_planeZ + p), cz)),
+                                            _mm_load_ps(m_planeW + p));
+        const __m128  radius   = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(m_absX + p), ex), _mm_mul_ps(_mm_load_ps(m_absY + p), ey)),
+                                            _mm_mul_ps(_mm_load_ps(m_absZ + p), ez));
+        const __m128i bits     = _mm_set_epi32(8 << p, 4 << p, 2 << p, 1 << p);
+        const __m128  isTested = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(tested, bits), bits));
+        const __m128  isInside = _mm_and_ps(isTested, _mm_cmpge_ps(_mm_sub_ps(d, radius), zero));
+        const __m128  isOutside = _mm_and_ps(isTested, _mm_cmplt_ps(_mm_add_ps(d, radius), zero));
+        const __m128  inside   = _mm_or_ps(_mm_and_ps(isInside, _mm_sub_ps(d, radius)), _mm_andnot_ps(isInside, maximum));
+
+        _mm_store_ps(lower + p, inside);
+        _mm_store_ps(outside + p, _mm_and_ps(isOutside, _mm_sub_ps(zero, _mm_add_ps(d, radius))));
+        margin       = _mm_min_ps(margin, inside);
+        insideMask  |= static_cast<uint32>(_mm_movemask_ps(isInside)) << p;
+        outsideMask |= static_cast<uint32>(_mm_movemask_ps(isOutside)) << p;
+    }
+
+    std::fill(pUpper, pUpper + Frustum::PlaneCount, FLT_MAX);
+    if (outsideMask != 0)
+    {
+        // One plane is enough, the one farthest from the box.
+        uint32 outsidePlane = 0;
+        for (uint32 p = 1; p < Frustum::PlaneCount; ++p)
+        {
+            outsidePlane = (outside[p] > outside[outsidePlane]) ? p : outsidePlane;
+        }
+
+        std::fill(pLower, pLower + Frustum::PlaneCount, FLT_MAX);
+        pUpper[outsidePlane] = outside[outsidePlane];
+        return Outcome::Outside;
+    }
+
+    std::copy(lower, lower + Frustum::PlaneCount, pLower);
+    planes       &= ~insideMask;
+    insideMargin  = std::min<float>(insideMargin, HorizontalMin(margin));
+    return (planes == 0) ? Outcome::Inside : Outcome::Crossing;
+}
+
+// ====================================================================================================================
+// Tests the subtree of node down to the new frontier, with the planes not in the mask known to contain the box by at
+// least insideMargin.
+void CoherentCuller::Expand(
+    uint32 node,
+    uint32 parent,
+    uint32 firstInstance,
+    uint32 planes,
+    float  insideMargin)
+{
+    const InstanceBvhNode& bvhNode = m_pBvh->Nodes()[node];
+    ++m_stats.testedNodes;
+
+    const uint32 inheritedPlanes = planes;
+    const float  inheritedMargin = insideMargin;
+    float        lower[Frustum::PlaneCount];
+    float        upper[Frustum::PlaneCount];
+
+    FrontierNode entry;
+    entry.node          = node;
+    entry.parent        = parent;
+    entry.firstInstance = firstInstance;
+    entry.firstVisible  = 0;
+    entry.planes        = static_cast<uint8_t>(inheritedPlanes);
+    entry.outcome       = TestBox(bvhNode, planes, insideMargin, lower, upper);
+    entry.crossing      = 0;
+    entry.leafSize      = 0;
+
+    float others = inheritedMargin;
+    if (entry.outcome == Outcome::Outside)
+    {
+        entry.count = 0;
+        others      = FLT_MAX;
+    }
+    else if (entry.outcome == Outcome::Inside)
+    {
+        entry.count = bvhNode.instanceCount;
+        AddRange(m_pBvh->Instances().data() + firstInstance, entry.count);
+    }
+    else if (bvhNode.rightChild == 0)
+    {
+        entry.crossing     = static_cast<uint8_t>(planes);
+        entry.leafSize     = static_cast<uint8_t>(bvhNode.instanceCount);
+        entry.firstVisible = m_leafVisibleCount;
+        entry.count        = TestSpheres(firstInstance, bvhNode.instanceCount, planes, lower, upper);
+    }
+    else
+    {
+        const uint32 leftCount = m_pBvh->Nodes()[node + 1].instanceCount;
+        Expand(node + 1, node, firstInstance, planes, insideMargin);
+        Expand(node + bvhNode.rightChild, node, firstInstance + leftCount, planes, insideMargin);
+        return;
+    }
+
+    AddTestedNode(entry, bvhNode, lower, upper, others, inheritedMargin);
+}
+
+// ====================================================================================================================
+// Completes an entry whose box was just tested and appends it to the new frontier.
+void CoherentCuller::AddTestedNode(
+    FrontierNode&          entry,
+    const InstanceBvhNode& bvhNode,
+    const float*           pLower,
+    const float*           pUpper,
+    float                  others,
+    float                  inheritedMargin)
+{
+    const XMFLOAT3& e  = bvhNode.extents;
+    const float     dx = fabsf(bvhNode.center.x - m_anchor.x) + e.x;
+    const float     dy = fabsf(bvhNode.center.y - m_anchor.y) + e.y;
+    const float     dz = fabsf(bvhNode.center.z - m_anchor.z) + e.z;
+    entry.center      = bvhNode.center;
+    entry.extent      = sqrtf(e.x * e.x + e.y * e.y + e.z * e.z);
+    entry.reach       = sqrtf(dx * dx + dy * dy + dz * dz);
+    entry.planesLimit = inheritedMargin + m_maxScale * entry.reach + m_maxOffset;
+    SetLimits(entry, pLower, pUpper, others);
+    AddFrontierNode(entry, false);
+}
+
+// ====================================================================================================================
+// Tests the spheres of a crossing leaf again whose other planes are known to keep their results by othersMargin.
+void CoherentCuller::Retest(
+    const FrontierNode& node,
+    float               othersMargin)
+{
+    float lower[Frustum::PlaneCount];
+    float upper[Frustum::PlaneCount];
+    std::fill(lower, lower + Frustum::PlaneCount, FLT_MAX);
+    std::fill(upper, upper + Frustum::PlaneCount, FLT_MAX);
+
+    ++m_stats.testedNodes;
+    m_frontier[m_current].push_back(node);
+    FrontierNode& entry = m_frontier[m_current].back();
+    entry.firstVisible  = m_leafVisibleCount;
+    entry.count         = TestSpheres(entry.firstInstance, entry.leafSize, entry.crossing, lower, upper);
+    SetLimits(entry, lower, upper, othersMargin);
+}
+
+// ====================================================================================================================
+// Tests the spheres of a leaf against the crossing planes and appends the visible ones to m_leafVisible. A visible
+// sphere holds until a plane falls to it, a hidden one until the plane it is farthest behind has risen past it, which
+// lowers pLower and pUpper. Returns the visible count.
+uint32 CoherentCuller::TestSpheres(
+    uint32 firstInstance,
+    uint32 count,
+    uint32 crossing,
+    float* pLower,
+    float* pUpper)
+{
+    __m128 planeX[Frustum::PlaneCount];
+    __m128 planeY[Frustum::PlaneCount];
+    __m128 planeZ[Frustum::PlaneCount];
+    __m128 planeW[Frustum::PlaneCount];
+    __m128 lower[Frustum::PlaneCount];
+    __m128 upper[Frustum::PlaneCount];
+    uint32 planes[Frustum::PlaneCount];
+    uint32 planeCount = 0;
+    for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+    {
+        if ((crossing & (1 << p)) != 0)
+        {
+            planeX[planeCount] = _mm_set1_ps(m_frustum.planes[p].x);
+            planeY[planeCount] = _mm_set1_ps(m_frustum.planes[p].y);
+            planeZ[planeCount] = _mm_set1_ps(m_frustum.planes[p].z);
+            planeW[planeCount] = _mm_set1_ps(m_frustum.planes[p].w);
+            lower[planeCount]  = _mm_set1_ps(pLower[p]);
+            upper[planeCount]  = _mm_set1_ps(pUpper[p]);
+            planes[planeCount] = p;
+            ++planeCount;
+        }
+    }
+
+    // Four spheres at a time, in the same operation order as InstanceBvh::Cull() and without branches as about half of
+    // them are visible. A shorter last group repeats its last sphere, which leaves the minimums as they are.
+    const XMFLOAT4* pSpheres = m_pBvh->Spheres().data() + firstInstance;
+    const uint32*   pIndices = m_pBvh->Instances().data() + firstInstance;
+    uint32*         pOutput  = m_leafVisible.data() + m_leafVisibleCount;
+    uint32          visible  = 0;
+    const __m128    zero     = _mm_setzero_ps();
+    const __m128    maximum  = _mm_set1_ps(FLT_MAX);
+    const __m128    signBit  = _mm_set1_ps(-0.0f);
+    for (uint32 i = 0; i < count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(&pSpheres[i].x);
+        __m128 y = _mm_loadu_ps(&pSpheres[std::min<uint32>(i + 1, count - 1)].x);
+        __m128 z = _mm_loadu_ps(&pSpheres[std::min<uint32>(i + 2, count - 1)].x);
+        __m128 r = _mm_loadu_ps(&pSpheres[std::min<uint32>(i + 3, count - 1)].x);
+        _MM_TRANSPOSE4_PS(x, y, z, r);
+
+        __m128 d[Frustum::PlaneCount];
+        __m128 nearest = maximum;
+        for (uint32 k = 0; k < planeCount; ++k)
+        {
+            d[k]    = _mm_add_ps(planeW[k], r);
+            d[k]    = _mm_add_ps(d[k], _mm_mul_ps(planeX[k], x));
+            d[k]    = _mm_add_ps(d[k], _mm_mul_ps(planeY[k], y));
+            d[k]    = _mm_add_ps(d[k], _mm_mul_ps(planeZ[k], z));
+            nearest = _mm_min_ps(nearest, d[k]);
+        }
+
+        const __m128 isVisible = _mm_cmpge_ps(nearest, zero);
+        for (uint32 k = 0; k < planeCount; ++k)
+        {
+            const __m128 isNearest = _mm_andnot_ps(isVisible, _mm_cmpeq_ps(d[k], nearest));
+            lower[k] = _mm_min_ps(lower[k], _mm_or_ps(_mm_and_ps(isVisible, d[k]), _mm_andnot_ps(isVisible, maximum)));
+            upper[k] = _mm_min_ps(upper[k], _mm_or_ps(_mm_and_ps(isNearest, _mm_xor_ps(d[k], signBit)),
+                                                      _mm_andnot_ps(isNearest, maximum)));
+        }
+
+        const uint32 mask  = static_cast<uint32>(_mm_movemask_ps(isVisible));
+        const uint32 lanes = std::min<uint32>(count - i, 4);
+        for (uint32 lane = 0; lane < lanes; ++lane)
+        {
+            pOutput[visible] = pIndices[i + lane];
+            visible         += (mask >> lane) & 1;
+        }
+    }
+
+    for (uint32 k = 0; k < planeCount; ++k)
+    {
+        pLower[planes[k]] = HorizontalMin(lower[k]);
+        pUpper[planes[k]] = HorizontalMin(upper[k]);
+    }
+    m_stats.testedSpheres += count;
+
+    AddRange(pOutput, visible);
+    m_leafVisibleCount += visible;
+    return visible;
+}
+
+// ====================================================================================================================
+// The plane with the least margin decides, and keeps its margins on either side around the center's distance. The
+// others are checked together against the largest motion.
+void CoherentCuller::SetLimits(
+    FrontierNode& entry,
+    const float*  pLower,
+    const float*  pUpper,
+    float         others)
+{
+    uint32 nearest = 0;
+    float  lowest  = std::min<float>(pLower[0], pUpper[0]);
+    float  second  = FLT_MAX;
+    for (uint32 p = 1; p < Frustum::PlaneCount; ++p)
+    {
+        const float margin = std::min<float>(pLower[p], pUpper[p]);
+        const bool  lower  = (margin < lowest);
+        second  = lower ? lowest : std::min<float>(second, margin);
+        nearest = lower ? p : nearest;
+        lowest  = lower ? margin : lowest;
+    }
+    others = std::min<float>(others, second);
+
+    const XMFLOAT4& plane  = m_frustum.planes[nearest];
+    const float     d      = plane.x * entry.center.x + plane.y * entry.center.y + plane.z * entry.center.z + plane.w;
+    const float     spread = m_scale[nearest] * entry.extent;
+    entry.plane       = static_cast<uint8_t>(nearest);
+    entry.lower       = d - spread - pLower[nearest];
+    entry.upper       = d + spread + pUpper[nearest];
+    entry.othersLimit = others + m_maxScale * entry.reach + m_maxOffset;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "FrustumCulling.h"
+#include "InstanceBvh.h"
+
+// ====================================================================================================================
+// Work done by the last CoherentCuller::Cull() call.
+struct CoherenceStats
+{
+    uint32 frontierNodes = 0; // Where the traversal stopped: outside or inside nodes, and leaves crossing a plane
+    uint32 reusedNodes   = 0; // Frontier nodes that kept the last frame's result without a test
+    uint32 testedNodes   = 0;
+    uint32 testedSpheres = 0;
+    uint32 mergedNodes   = 0; // Pairs of inside or outside siblings replaced with their parent, also counted as tested
+    uint32 ranges        = 0;
+    bool   fullRefresh   = false; // The frontier was built again from the root
+    bool   fallback      = false; // Culled with InstanceBvh::Cull(), most of the frontier having expired
+};
+
+// ====================================================================================================================
+// Frustum culling of an InstanceBvh that reuses the last frame's results where the camera cannot have changed them.
+// The culler keeps the frontier the last traversal stopped at, in tree order: nodes outside a plane, nodes inside all
+// of them and leaves that cross a plane, each with how far the planes may move before its result could change.
+//
+// Between two frames the distance of a point x to plane p changes by at most a_p * |x - o| + b_p, where a_p is the
+// change of the plane's normal, b_p the change of its distance to a fixed anchor o, and |x - o| is at most the node's
+// reach, the distance from o to the farthest corner of its box. The a_p and b_p are summed per plane over the frames
+// since the last refresh. Each frontier node keeps the plane that decides its result, the one it is outside of or the
+// nearest one, as the range its center's distance to that plane may take, widened by a_p times the node's extent;
+// the distance is computed exactly each frame, so only the spread of the box is bounded. The other planes are
+// bounded with the largest a_p and b_p. When the camera walks, the near and far planes move faster than the side
+// planes, and nodes along a side plane last as long as that side plane allows.
+//
+// Only the nodes whose limits expired are tested again: a leaf crossing only its deciding plane that now lies wholly
+// on one side of it becomes an inside or outside node, other crossing leaves get their spheres tested again, and
+// other nodes are tested from their own box down. Two adjacent siblings with the same inside or outside result are
+// replaced with their parent where the parent's box has that result too, so the frontier shrinks back where the
+// camera left. The visible set is that of InstanceBvh::Cull(), in the same order, up to rounding for spheres touching
+// a plane, and the bound holds for any change of the view or the projection.
+//
+// The result is a list of ranges rather than one array, so a reused node costs the same however many instances it
+// holds: an inside node's instances are one range of InstanceBvh::Instances(), and the visible instances of a crossing
+// leaf stay where they were written, in a buffer that is only appended to until the next refresh. Adjacent ranges are
+// merged.
+//
+// The frontier is rebuilt from the root around a new anchor near the camera every RefreshInterval frames, which also
+// bounds the rounding of the sums, and once it has doubled. Before the frontier is walked, a sample of it tells
+// whether most of it has expired, as after a cut or a teleport; the culler then uses plain InstanceBvh::Cull(), and
+// builds a new frontier once the sample says the camera has slowed down enough for one to last MinFrontierFrames
+// frames.
+class CoherentCuller
+{
+public:
+    static const uint32 RefreshInterval   = 64;
+    static const uint32 MinFrontierFrames = 4;
+    static const uint32 SampleCount       = 64;
+
+    // Starts over with the tree; bvh has to outlive the culler, and a new Build() needs a new Reset().
+    void Reset(const InstanceBvh& bvh);
+
+    // Culls with the planes of viewProj (as Frustum::FromMatrix()). Returns the visible count.
+    uint32 Cull(DirectX::FXMMATRIX viewProj);
+
+    // Makes the next Cull() a full refresh.
+    void Invalidate() { m_framesToRefresh = 0; m_fallback = false; }
+
+    // The visible instances in tree order, valid until the next Cull().
+    const std::vector<VisibleRange>& VisibleRanges() const { return m_ranges; }
+
+    // Copies the visible instances to pVisible, which needs room for the count Cull() returned.
+    void CopyVisible(uint32* pVisible) const;
+
+    const CoherenceStats& Stats() const { return m_stats; }
+
+private:
+    enum class Outcome : uint8_t { Outside, Inside, Crossing };
+
+    static const uint32 NoParent = ~0u;
+    static const uint32 PaddedPlaneCount = 8;
+
+    struct FrontierNode
+    {
+        uint32            node;
+        uint32            parent;       // NoParent for the root
+        uint32            firstInstance;
+        uint32            firstVisible; // Of a crossing leaf, in m_leafVisible
+        uint32            count;        // Visible instances
+        DirectX::XMFLOAT3 center;       // Of the node's box
+        float             extent;       // Half the diagonal of the box
+        float             lower;        // The outcome holds while the center's distance to the deciding plane, less
+        float             upper;        // and plus m_scale[plane] * extent, stays between lower and upper,
+        float             othersLimit;  // while m_maxScale * reach + m_maxOffset < othersLimit,
+        float             planesLimit;  // and likewise for the node being inside the planes not in planes
+        float             reach;
+        uint8_t           planes;       // Planes the node was tested against, its parent being inside the others
+        uint8_t           plane;        // The plane that decides the outcome
+        Outcome           outcome;
+        uint8_t           crossing;     // Of a crossing leaf, the planes its spheres are tested against, and its size
+        uint8_t           leafSize;
+    };
+
+    void   Expand(uint32 node, uint32 parent, uint32 firstInstance, uint32 planes, float insideMargin);
+    void   AddTestedNode(FrontierNode& entry, const InstanceBvhNode& bvhNode, const float* pLower, const float* pUpper,
+                         float others, float inheritedMargin);
+    void   Retest(const FrontierNode& node, float othersMargin);
+    uint32 TestSpheres(uint32 firstInstance, uint32 count, uint32 crossing, float* pLower, float* pUpper);
+    void   SetLimits(FrontierNode& entry, const float* pLower, const float* pUpper, float others);
+    void   AddRange(const uint32* pIndices, uint32 count);
+    void   AddFrontierNode(const FrontierNode& entry, bool reused);
+    void   MergeSiblings();
+    Outcome TestBox(const InstanceBvhNode& bvhNode, uint32& planes, float& insideMargin, float* pLower, float* pUpper) const;
+    void   MoveAnchor(DirectX::FXMMATRIX viewProj);
+    uint32 CountExpired(const Frustum& frustum) const;
+    uint32 CountShortLived(const Frustum& frustum, const float* pScale, float maxScale, float maxOffset) const;
+
+    const InstanceBvh*        m_pBvh = nullptr;
+    std::vector<FrontierNode> m_frontier[2]; // This and the last frame's
+    std::vector<uint32>       m_parents;     // Of each node, for the parents of merged siblings
+    std::vector<FrontierNode> m_samples;     // Of the last frontier; during a fallback with the limits left then
+    std::vector<VisibleRange> m_ranges;
+    std::vector<uint32>       m_leafVisible;     // Visible instances of crossing leaves since the last refresh
+    std::vector<uint32>       m_fallbackVisible; // Output of InstanceBvh::Cull()
+    uint32                    m_leafVisibleCount = 0;
+    uint32                    m_current          = 0;
+    uint32                    m_count            = 0;
+    uint32                    m_framesToRefresh  = 0;
+    uint32                    m_refreshFrontier  = 0; // Frontier size after the last refresh
+    bool                      m_fallback         = false;
+    bool                      m_lastReused       = false; // The last entry added to the frontier was reused
+    Frustum                   m_frustum;
+    alignas(16) float         m_planeX[PaddedPlaneCount] = {}; // m_frustum and the absolute plane normals as separate
+    alignas(16) float         m_planeY[PaddedPlaneCount] = {}; // components, padded with planes that contain every box
+    alignas(16) float         m_planeZ[PaddedPlaneCount] = {};
+    alignas(16) float         m_planeW[PaddedPlaneCount] = {};
+    alignas(16) float         m_absX[PaddedPlaneCount] = {};
+    alignas(16) float         m_absY[PaddedPlaneCount] = {};
+    alignas(16) float         m_absZ[PaddedPlaneCount] = {};
+    DirectX::XMFLOAT3         m_anchor;
+    float                     m_scale[Frustum::PlaneCount]; // Sums of a_p since the last refresh
+    float                     m_maxScale  = 0.0f;           // Sums of the largest a_p and b_p of each frame
+    float                     m_maxOffset = 0.0f;
+    CoherenceStats            m_stats;
+};
@@ -0,0 +1,315 @@
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <cfloat>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+using namespace DirectX;
+
+// ====================================================================================================================
+// For every 8 bit lane mask, the indices of its set lanes packed into 4 bit fields (lowest first) and their count, to
+// compact the visible lanes of an AVX2 block with one permute.
+struct CompactTable
+{
+    uint32  lanes[256];
+    uint8_t counts[256];
+
+    CompactTable()
+    {
+        for (uint32 mask = 0; mask < 256; ++mask)
+        {
+            uint32 count = 0;
+            lanes[mask]  = 0;
+            for (uint32 lane = 0; lane < 8; ++lane)
+            {
+                if ((mask & (1 << lane)) != 0)
+                {
+                    lanes[mask] |= lane << (4 * count++);
+                }
+            }
+            counts[mask] = static_cast<uint8_t>(count);
+        }
+    }
+};
+
+// ====================================================================================================================
+// Planes as x, y, z and w components, so each of them can be broadcast once per call.
+struct FrustumComponents
+{
+    float x[Frustum::PlaneCount];
+    float y[Frustum::PlaneCount];
+    float z[Frustum::PlaneCount];
+    float w[Frustum::PlaneCount];
+
+    explicit FrustumComponents(const Frustum& frustum)
+    {
+        for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+        {
+            x[p] = frustum.planes[p].x;
+            y[p] = frustum.planes[p].y;
+            z[p] = frustum.planes[p].z;
+            w[p] = frustum.planes[p].w;
+        }
+    }
+};
+
+// ====================================================================================================================
+AVX2_TARGET static uint32 CullAvx2(
+    const Frustum&        frustum,
+    const InstanceBounds& bounds,
+    uint32                begin,
+    uint32                end,
+    uint32*               pVisible)
+{
+    static const CompactTable table;
+
+    const FrustumComponents f(frustum);
+    __m256 px[Frustum::PlaneCount];
+    __m256 py[Frustum::PlaneCount];
+    __m256 pz[Frustum::PlaneCount];
+    __m256 pw[Frustum::PlaneCount];
+    for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+    {
+        px[p] = _mm256_set1_ps(f.x[p]);
+        py[p] = _mm256_set1_ps(f.y[p]);
+        pz[p] = _mm256_set1_ps(f.z[p]);
+        pw[p] = _mm256_set1_ps(f.w[p]);
+    }
+
+    const __m256i shifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+    const __m256i nibble = _mm256_set1_epi32(0xF);
+    const __m256  zero   = _mm256_setzero_ps();
+    uint32        count  = 0;
+
+    for (uint32 first = begin; first < end; first += 8)
+    {
+        const __m256 cx = _mm256_load_ps(bounds.m_centerX.data() + first);
+        const __m256 cy = _mm256_load_ps(bounds.m_centerY.data() + first);
+        const __m256 cz = _mm256_load_ps(bounds.m_centerZ.data() + first);
+        const __m256 r  = _mm256_load_ps(bounds.m_radius.data() + first);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+        {
+            const __m256 d = _mm256_fmadd_ps(pz[p], cz, _mm256_fmadd_ps(py[p], cy, _mm256_fmadd_ps(px[p], cx, _mm256_add_ps(pw[p], r))));
+            inside         = _mm256_and_ps(inside, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+        }
+
+        // All 8 slots are stored, the ones past the visible lanes are overwritten by the next block.
+        const uint32  mask  = static_cast<uint32>(_mm256_movemask_ps(inside));
+        const __m256i lanes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(table.lanes[mask])), shifts), nibble);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pVisible + count), _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(first)), lanes));
+        count += table.counts[mask];
+    }
+
+    return count;
+}
+
+// ====================================================================================================================
+static uint32 CullSse(
+    const Frustum&        frustum,
+    const InstanceBounds& bounds,
+    uint32                begin,
+    uint32                end,
+    uint32*               pVisible)
+{
+    const FrustumComponents f(frustum);
+    __m128 px[Frustum::PlaneCount];
+    __m128 py[Frustum::PlaneCount];
+    __m128 pz[Frustum::PlaneCount];
+    __m128 pw[Frustum::PlaneCount];
+    for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+    {
+        px[p] = _mm_set1_ps(f.x[p]);
+        py[p] = _mm_set1_ps(f.y[p]);
+        pz[p] = _mm_set1_ps(f.z[p]);
+        pw[p] = _mm_set1_ps(f.w[p]);
+    }
+
+    const __m128 zero  = _mm_setzero_ps();
+    uint32       count = 0;
+
+    for (uint32 first = begin; first < end; first += 4)
+    {
+        const __m128 cx = _mm_load_ps(bounds.m_centerX.data() + first);
+        const __m128 cy = _mm_load_ps(bounds.m_centerY.data() + first);
+        const __m128 cz = _mm_load_ps(bounds.m_centerZ.data() + first);
+        const __m128 r  = _mm_load_ps(bounds.m_radius.data() + first);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+        {
+            __m128 d = _mm_add_ps(pw[p], r);
+            d        = _mm_add_ps(d, _mm_mul_ps(px[p], cx));
+            d        = _mm_add_ps(d, _mm_mul_ps(py[p], cy));
+            d        = _mm_add_ps(d, _mm_mul_ps(pz[p], cz));
+            inside   = _mm_and_ps(inside, _mm_cmpge_ps(d, zero));
+        }
+
+        // Branch free compaction: every slot is written, the count only advances past the visible ones.
+        const uint32 mask = static_cast<uint32>(_mm_movemask_ps(inside));
+        pVisible[count] = first;
+        count += mask & 1;
+        pVisible[count] = first + 1;
+        count += (mask >> 1) & 1;
+        pVisible[count] = first + 2;
+        count += (mask >> 2) & 1;
+        pVisible[count] = first + 3;
+        count += mask >> 3;
+    }
+
+    return count;
+}
+
+// ====================================================================================================================
+static bool DetectAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // FMA and OSXSAVE, then the OS has to save the YMM registers.
+    __cpuid(info, 1);
+    if (((info[2] & (1 << 12)) == 0) || ((info[2] & (1 << 27)) == 0) || ((_xgetbv(0) & 6) != 6))
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+// ====================================================================================================================
+Frustum Frustum::FromMatrix(
+    FXMMATRIX viewProj)
+{
+    // Rows of the transpose are the columns of the matrix: clip = (p, 1) * viewProj, and a point is inside if
+    // -w <= x <= w, -w <= y <= w and 0 <= z <= w.
+    const XMMATRIX m = XMMatrixTranspose(viewProj);
+
+    Frustum frustum;
+    XMStoreFloat4(&frustum.planes[Left],   XMPlaneNormalize(XMVectorAdd(m.r[3], m.r[0])));
+    XMStoreFloat4(&frustum.planes[Right],  XMPlaneNormalize(XMVectorSubtract(m.r[3], m.r[0])));
+    XMStoreFloat4(&frustum.planes[Bottom], XMPlaneNormalize(XMVectorAdd(m.r[3], m.r[1])));
+    XMStoreFloat4(&frustum.planes[Top],    XMPlaneNormalize(XMVectorSubtract(m.r[3], m.r[1])));
+    XMStoreFloat4(&frustum.planes[Near],   XMPlaneNormalize(m.r[2]));
+    XMStoreFloat4(&frustum.planes[Far],    XMPlaneNormalize(XMVectorSubtract(m.r[3], m.r[2])));
+    return frustum;
+}
+
+// ====================================================================================================================
+void InstanceBounds::Resize(
+    uint32 count)
+{
+    const uint32 padded = (count + BlockSize - 1) & ~(BlockSize - 1);
+
+    m_count = count;
+    m_centerX.resize(padded);
+    m_centerY.resize(padded);
+    m_centerZ.resize(padded);
+    m_radius.resize(padded);
+
+    for (uint32 i = count; i < padded; ++i)
+    {
+        Set(i, XMFLOAT3(0.0f, 0.0f, 0.0f), -FLT_MAX);
+    }
+}
+
+// ====================================================================================================================
+void InstanceBounds::Set(
+    uint32          index,
+    const XMFLOAT3& center,
+    float           radius)
+{
+    m_centerX[index] = center.x;
+    m_centerY[index] = center.y;
+    m_centerZ[index] = center.z;
+    m_radius[index]  = radius;
+}
+
+// ====================================================================================================================
+void InstanceBounds::Set(
+    uint32                index,
+    const BoundingSphere& localSphere,
+    FXMMATRIX             world)
+{
+    const XMVECTOR scaleSq = XMVectorMax(XMVector3LengthSq(world.r[0]),
+                                         XMVectorMax(XMVector3LengthSq(world.r[1]), XMVector3LengthSq(world.r[2])));
+
+    XMFLOAT3 center;
+    XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&localSphere.Center), world));
+    Set(index, center, localSphere.Radius * sqrtf(XMVectorGetX(scaleSq)));
+}
+
+// ====================================================================================================================
+bool FrustumCuller::UsesAvx2()
+{
+    static const bool avx2 = DetectAvx2();
+    return avx2;
+}
+
+// ====================================================================================================================
+bool FrustumCuller::IsVisible(
+    const Frustum&  frustum,
+    const XMFLOAT3& center,
+    float           radius)
+{
+    // Same operation order as the SSE2 path, so both agree exactly.
+    for (const XMFLOAT4& plane : frustum.planes)
+    {
+        float d = plane.w + radius;
+        d += plane.x * center.x;
+        d += plane.y * center.y;
+        d += plane.z * center.z;
+        if ((d >= 0.0f) == false)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// ====================================================================================================================
+uint32 FrustumCuller::Cull(
+    const Frustum&        frustum,
+    const InstanceBounds& bounds,
+    uint32*               pVisible)
+{
+    return Cull(frustum, bounds, 0, bounds.Count(), pVisible, UsesAvx2());
+}
+
+// ====================================================================================================================
+uint32 FrustumCuller::Cull(
+    const Frustum&        frustum,
+    const InstanceBounds& bounds,
+    uint32                begin,
+    uint32                end,
+    uint32*               pVisible,
+    bool                  useAvx2)
+{
+    // Whole blocks; the padding past Count() is never visible.
+    end = std::min<uint32>((end + InstanceBounds::BlockSize - 1) & ~(InstanceBounds::BlockSize - 1), bounds.PaddedCount());
+    if (begin >= end)
+    {
+        return 0;
+    }
+
+    if (useAvx2 && UsesAvx2())
+    {
+        return CullAvx2(frustum, bounds, begin, end, pVisible);
+    }
+    return CullSse(frustum, bounds, begin, end, pVisible);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include "AlignedAllocator.h"
+#include "WorkerPool.h"
+
+using uint32 = std::uint32_t;
+
+// ====================================================================================================================
+// The six planes of a view frustum, normalized and pointing inwards (Gribb and Hartmann), so a point p is inside if
+// dot(plane.xyz, p) + plane.w >= 0 for every plane. Built from a DirectXMath (row vector, z in [0, 1]) matrix: the
+// view projection gives world space planes, a world view projection object space ones.
+struct Frustum
+{
+    enum Plane { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    DirectX::XMFLOAT4 planes[PlaneCount];
+
+    static Frustum FromMatrix(DirectX::FXMMATRIX viewProj);
+};
+
+// ====================================================================================================================
+// A run of visible instance indices.
+struct VisibleRange
+{
+    const uint32* pIndices;
+    uint32        count;
+};
+
+// ====================================================================================================================
+// World space bounding spheres of instances as separate x, y, z and radius streams, padded to a multiple of 8 with
+// spheres of radius -FLT_MAX that no frustum contains, so the culling loops never need a scalar tail.
+class InstanceBounds
+{
+public:
+    static const uint32 BlockSize = 8;
+
+    template<typename T>
+    using Stream = std::vector<T, AlignedAllocator<T, 32>>;
+
+    uint32 Count() const { return m_count; }
+    uint32 PaddedCount() const { return static_cast<uint32>(m_radius.size()); }
+    void   Resize(uint32 count);
+
+    void Set(uint32 index, const DirectX::XMFLOAT3& center, float radius);
+
+    // The local sphere of the instance's mesh, transformed by its world matrix; non uniform scale grows the radius by
+    // the largest axis scale.
+    void Set(uint32 index, const DirectX::BoundingSphere& localSphere, DirectX::FXMMATRIX world);
+
+    DirectX::XMFLOAT3 Center(uint32 index) const { return DirectX::XMFLOAT3(m_centerX[index], m_centerY[index], m_centerZ[index]); }
+    float             Radius(uint32 index) const { return m_radius[index]; }
+
+    Stream<float> m_centerX;
+    Stream<float> m_centerY;
+    Stream<float> m_centerZ;
+    Stream<float> m_radius;
+
+private:
+    uint32 m_count = 0;
+};
+
+// ====================================================================================================================
+// Sphere against frustum culling of instances with a compacted output: the indices of the visible instances are
+// written in increasing order, ready to gather their instance data into the buffer the draw reads, and the draw's
+// instance count is the returned visible count. Spheres touching a plane count as visible.
+//
+// Eight instances per step with AVX2 + FMA (the visible lanes are packed with one permute), four with SSE2 on older
+// CPUs, picked at runtime like Heightfield::EvaluateHills().
+class FrustumCuller
+{
+public:
+    static bool UsesAvx2();
+
+    static bool IsVisible(const Frustum& frustum, const DirectX::XMFLOAT3& center, float radius);
+
+    // pVisible needs room for bounds.PaddedCount() indices, whole blocks are stored. Returns the visible count.
+    static uint32 Cull(const Frustum& frustum, const InstanceBounds& bounds, uint32* pVisible);
+
+    // Instances [begin, end) only, both multiples of InstanceBounds::BlockSize or end = bounds.Count(); pVisible needs
+    // room for the range rounded up to whole blocks. useAvx2 = false forces the SSE2 path (for comparisons).
+    static uint32 Cull(const Frustum&        frustum,
+                       const InstanceBounds& bounds,
+                       uint32                begin,
+                       uint32                end,
+                       uint32*               pVisible,
+                       bool                  useAvx2);
+};
+
+// ====================================================================================================================
+// FrustumCuller on the threads of a WorkerPool. The instances are split into chunks of ChunkSize, whose bounds (128 KB)
+// stay in L2 while they are tested, and the threads claim chunks one at a time. Every chunk compacts its visible
+// indices into its own range of the scratch list, so the threads never write to the same place; a prefix sum over the
+// chunk counts then gives each chunk its place in the final list, and a second pass over the threads calls
+// write(pIndices, count, offset) for every chunk with visible instances to copy them to [offset, offset + count) of
+// the output, e.g. a mapped upload buffer. No locks besides starting and finishing the two passes.
+class PartitionedCuller
+{
+public:
+    static const uint32 ChunkSize = 8 * 1024;
+
+    // write may be called from any thread of the pool. threadCount 0 uses all of them. Returns the visible count.
+    template<typename WriteFunc>
+    uint32 Cull(const Frustum&        frustum,
+                const InstanceBounds& bounds,
+                WorkerPool&           pool,
+                uint32                threadCount,
+                const WriteFunc&      write)
+    {
+        const uint32 chunkCount = (bounds.Count() + ChunkSize - 1) / ChunkSize;
+        m_visible.resize(bounds.PaddedCount());
+        m_chunkCounts.resize(chunkCount);
+        m_chunkOffsets.resize(chunkCount);
+
+        std::atomic<uint32> next(0);
+        pool.Run(threadCount, [&](uint32)
+        {
+            for (uint32 chunk = next++; chunk < chunkCount; chunk = next++)
+            {
+                const uint32 begin = chunk * ChunkSize;
+                const uint32 end   = std::min<uint32>(begin + ChunkSize, bounds.Count());
+
+                m_chunkCounts[chunk] = FrustumCuller::Cull(frustum, bounds, begin, end, m_visible.data() + begin, true);
+            }
+        });
+
+        uint32 visibleCount = 0;
+        for (uint32 chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            m_chunkOffsets[chunk] = visibleCount;
+            visibleCount         += m_chunkCounts[chunk];
+        }
+
+        next = 0;
+        pool.Run(threadCount, [&](uint32)
+        {
+            for (uint32 chunk = next++; chunk < chunkCount; chunk = next++)
+            {
+                if (m_chunkCounts[chunk] > 0)
+                {
+                    write(m_visible.data() + chunk * ChunkSize, m_chunkCounts[chunk], m_chunkOffsets[chunk]);
+                }
+            }
+        });
+
+        return visibleCount;
+    }
+
+private:
+    std::vector<uint32> m_visible; // Compacted indices of chunk c start at c * ChunkSize
+    std::vector<uint32> m_chunkCounts;
+    std::vector<uint32> m_chunkOffsets;
+};
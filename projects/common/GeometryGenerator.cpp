@@ -1,8 +1,273 @@
 #include "GeometryGenerator.h"
+#include "MathHelper.h"
 #include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <unordered_map>
 #include <Windows.h>
+#include "ParallelFor.h"
 using namespace DirectX;
 
+// Below this many vertices per thread the generators stay on the calling thread; spawning workers costs more than the
+// work they would take over.
+static const uint32 MinVerticesPerThread = 16 * 1024;
+
+// ====================================================================================================================
+// Output mesh type for MeshWriteTarget. Vertices and indices go straight to the caller's memory; the counts are only
+// tracked so the cylinder caps can append.
+class MeshWriter
+{
+public:
+    explicit MeshWriter(const MeshWriteTarget& target) : m_target(target) {}
+
+    uint32 VertexCount() const
+    {
+        return m_vertexCount;
+    }
+
+    void ResizeVertices(uint32 count)
+    {
+        assert(count <= m_target.vertexCapacity);
+        m_vertexCount = count;
+    }
+
+    void PushVertex(const Vertex& v)
+    {
+        ResizeVertices(m_vertexCount + 1);
+        SetVertex(m_vertexCount - 1, v);
+    }
+
+    void SetVertex(uint32 index, const Vertex& v)
+    {
+        const InterleavedLayout& layout = m_target.layout;
+        uint8_t*                 pOut   = static_cast<uint8_t*>(m_target.pVertices) + size_t(index) * layout.stride;
+
+        if (layout.positionOffset >= 0)
+        {
+            memcpy(pOut + layout.positionOffset, &v.m_position, sizeof(XMFLOAT3));
+        }
+        if (layout.normalOffset >= 0)
+        {
+            memcpy(pOut + layout.normalOffset, &v.m_normal, sizeof(XMFLOAT3));
+        }
+        if (layout.tangentOffset >= 0)
+        {
+            memcpy(pOut + layout.tangentOffset, &v.m_tangentU, sizeof(XMFLOAT3));
+        }
+        if (layout.texCOffset >= 0)
+        {
+            memcpy(pOut + layout.texCOffset, &v.m_texC, sizeof(XMFLOAT2));
+        }
+        if (m_target.pPositions != nullptr)
+        {
+            m_target.pPositions[index] = v.m_position;
+        }
+    }
+
+    uint32 IndexCount() const
+    {
+        return m_indexCount;
+    }
+
+    void ResizeIndices(uint32 count)
+    {
+        assert(count <= m_target.indexCapacity);
+        m_indexCount = count;
+    }
+
+    void PushIndex(uint32 value)
+    {
+        ResizeIndices(m_indexCount + 1);
+        SetIndex(m_indexCount - 1, value);
+    }
+
+    void SetIndex(uint32 index, uint32 value)
+    {
+        if (m_target.indexSize == 2)
+        {
+            static_cast<uint16*>(m_target.pIndices)[index] = static_cast<uint16>(value);
+        }
+        else
+        {
+            static_cast<uint32*>(m_target.pIndices)[index] = value;
+        }
+    }
+
+private:
+    const MeshWriteTarget& m_target;
+    uint32                 m_vertexCount = 0;
+    uint32                 m_indexCount  = 0;
+};
+
+// ====================================================================================================================
+static bool Fits(
+    const MeshWriteTarget& target,
+    const MeshSize&        size)
+{
+    assert((target.indexSize == 2) || (target.indexSize == 4));
+
+    return (size.vertexCount <= target.vertexCapacity) &&
+           (size.indexCount <= target.indexCapacity) &&
+           ((target.indexSize == 4) || (size.vertexCount <= 0x10000));
+}
+
+// ====================================================================================================================
+// Box and GeoSphere read vertices back while they subdivide, which is slow on write-combined memory, so they are built
+// in a scratch mesh and copied out once.
+static MeshSize CopyMesh(
+    const MeshData&        meshData,
+    const MeshWriteTarget& target,
+    uint32                 maxThreads)
+{
+    const MeshSize size = { meshData.VertexCount(), meshData.IndexCount() };
+    MeshWriter     writer(target);
+
+    writer.ResizeVertices(size.vertexCount);
+    writer.ResizeIndices(size.indexCount);
+
+    ParallelFor(size.vertexCount, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            writer.SetVertex(i, meshData.m_vertices[i]);
+        }
+    });
+
+    if (target.indexSize == 4)
+    {
+        memcpy(target.pIndices, meshData.m_indices32.data(), size_t(size.indexCount) * sizeof(uint32));
+    }
+    else
+    {
+        for (uint32 i = 0; i < size.indexCount; ++i)
+        {
+            writer.SetIndex(i, meshData.m_indices32[i]);
+        }
+    }
+
+    return size;
+}
+
+// ====================================================================================================================
+MeshDataSoA MeshDataSoA::FromAoS(
+    const MeshData& meshData)
+{
+    MeshDataSoA soa;
+    soa.ResizeVertices(meshData.VertexCount());
+
+    for (uint32 i = 0; i < meshData.VertexCount(); ++i)
+    {
+        soa.SetVertex(i, meshData.m_vertices[i]);
+    }
+
+    soa.m_indices32 = meshData.m_indices32;
+
+    return soa;
+}
+
+// ====================================================================================================================
+MeshData MeshDataSoA::ToAoS() const
+{
+    MeshData meshData;
+    meshData.ResizeVertices(VertexCount());
+
+    for (uint32 i = 0; i < VertexCount(); ++i)
+    {
+        meshData.m_vertices[i] = GetVertex(i);
+    }
+
+    meshData.m_indices32 = m_indices32;
+
+    return meshData;
+}
+
+// ====================================================================================================================
+void MeshDataSoA::WriteInterleaved(
+    void*                    pDst,
+    const InterleavedLayout& layout,
+    uint32                   firstVertex,
+    uint32                   vertexCount) const
+{
+    assert(firstVertex + vertexCount <= VertexCount());
+
+    // Walk one stream at a time so each pass reads a single contiguous source array.
+    uint8_t* pBase = static_cast<uint8_t*>(pDst);
+
+    if (layout.positionOffset >= 0)
+    {
+        uint8_t* pOut = pBase + layout.positionOffset;
+        for (uint32 i = 0; i < vertexCount; ++i, pOut += layout.stride)
+        {
+            memcpy(pOut, &m_positions[firstVertex + i], sizeof(XMFLOAT3));
+        }
+    }
+
+    if (layout.normalOffset >= 0)
+    {
+        uint8_t* pOut = pBase + layout.normalOffset;
+        for (uint32 i = 0; i < vertexCount; ++i, pOut += layout.stride)
+        {
+            memcpy(pOut, &m_normals[firstVertex + i], sizeof(XMFLOAT3));
+        }
+    }
+
+    if (layout.tangentOffset >= 0)
+    {
+        uint8_t* pOut = pBase + layout.tangentOffset;
+        for (uint32 i = 0; i < vertexCount; ++i, pOut += layout.stride)
+        {
+            memcpy(pOut, &m_tangentUs[firstVertex + i], sizeof(XMFLOAT3));
+        }
+    }
+
+    if (layout.texCOffset >= 0)
+    {
+        uint8_t* pOut = pBase + layout.texCOffset;
+        for (uint32 i = 0; i < vertexCount; ++i, pOut += layout.stride)
+        {
+            memcpy(pOut, &m_texCs[firstVertex + i], sizeof(XMFLOAT2));
+        }
+    }
+}
+
+// ====================================================================================================================
+void MeshDataSoA::ResizeVertices(
+    uint32 count)
+{
+    m_positions.resize(count);
+    m_normals.resize(count);
+    m_tangentUs.resize(count);
+    m_texCs.resize(count);
+}
+
+// ====================================================================================================================
+void MeshDataSoA::PushVertex(
+    const Vertex& v)
+{
+    m_positions.push_back(v.m_position);
+    m_normals.push_back(v.m_normal);
+    m_tangentUs.push_back(v.m_tangentU);
+    m_texCs.push_back(v.m_texC);
+}
+
+// ====================================================================================================================
+void MeshDataSoA::SetVertex(
+    uint32        index,
+    const Vertex& v)
+{
+    m_positions[index] = v.m_position;
+    m_normals[index]   = v.m_normal;
+    m_tangentUs[index] = v.m_tangentU;
+    m_texCs[index]     = v.m_texC;
+}
+
+// ====================================================================================================================
+Vertex MeshDataSoA::GetVertex(
+    uint32 index) const
+{
+    return Vertex(m_positions[index], m_normals[index], m_tangentUs[index], m_texCs[index]);
+}
+
 // ====================================================================================================================
 Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
 {
@@ -35,16 +300,10 @@ Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
 }
 
 // ====================================================================================================================
+template<typename MeshT>
 void GeometryGenerator::SubDivide(
-    MeshData& meshData)
+    MeshT& meshData)
 {
-    // Save a copy of the input geometry.
-    MeshData inputCopy = meshData;
-
-
-    meshData.m_vertices.resize(0);
-    meshData.m_indices32.resize(0);
-
     //       v1
     //       *
     //      / \
@@ -54,58 +313,74 @@ void GeometryGenerator::SubDivide(
     //  /   \ /   \
     // *-----*-----*
     // v0    m2     v2
-    
-    uint32 numTris = (uint32)inputCopy.m_indices32.size()/3;
-    for(uint32 i = 0; i < numTris; ++i)
-    {
-        Vertex v0 = inputCopy.m_vertices[ inputCopy.m_indices32[i*3+0] ];
-        Vertex v1 = inputCopy.m_vertices[ inputCopy.m_indices32[i*3+1] ];
-        Vertex v2 = inputCopy.m_vertices[ inputCopy.m_indices32[i*3+2] ];
-        //
-        // Generate the midpoints.
-        //
 
-        Vertex m0 = MidPoint(v0, v1);
-        Vertex m1 = MidPoint(v1, v2);
-        Vertex m2 = MidPoint(v0, v2);
+    const uint32 numTris        = (uint32)meshData.m_indices32.size() / 3;
+    const uint32 numOldVertices = meshData.VertexCount();
 
-        //
-        // Add new geometry.
-        //
+    std::vector<uint32> inputIndices;
+    inputIndices.swap(meshData.m_indices32);
+    meshData.m_indices32.resize(numTris * 12);
 
-        meshData.m_vertices.push_back(v0); // 0
-        meshData.m_vertices.push_back(v1); // 1
-        meshData.m_vertices.push_back(v2); // 2
-        meshData.m_vertices.push_back(m0); // 3
-        meshData.m_vertices.push_back(m1); // 4
-        meshData.m_vertices.push_back(m2); // 5
+    // Every interior edge is shared by two triangles. Key each midpoint on the sorted vertex pair so both triangles
+    // reference one new vertex, instead of every triangle re-emitting all six of its vertices.
+    std::unordered_map<uint64_t, uint32> edgeMidPoints;
+    edgeMidPoints.reserve(numTris * 3 / 2 + 1);
 
-        meshData.m_indices32.push_back(i*6+0);
-        meshData.m_indices32.push_back(i*6+3);
-        meshData.m_indices32.push_back(i*6+5);
+    std::vector<std::pair<uint32, uint32>> newEdges;
+    newEdges.reserve(numTris * 3 / 2 + 1);
 
-        meshData.m_indices32.push_back(i*6+3);
-        meshData.m_indices32.push_back(i*6+4);
-        meshData.m_indices32.push_back(i*6+5);
+    auto GetMidPointIndex = [&](uint32 a, uint32 b)
+    {
+        const uint64_t key    = (static_cast<uint64_t>(std::min<uint32>(a, b)) << 32) | std::max<uint32>(a, b);
+        const auto     result = edgeMidPoints.emplace(key, numOldVertices + static_cast<uint32>(newEdges.size()));
+        if (result.second)
+        {
+            newEdges.emplace_back(a, b);
+        }
+        return result.first->second;
+    };
+
+    for (uint32 i = 0; i < numTris; ++i)
+    {
+        const uint32 v0 = inputIndices[i * 3 + 0];
+        const uint32 v1 = inputIndices[i * 3 + 1];
+        const uint32 v2 = inputIndices[i * 3 + 2];
+
+        const uint32 m0 = GetMidPointIndex(v0, v1);
+        const uint32 m1 = GetMidPointIndex(v1, v2);
+        const uint32 m2 = GetMidPointIndex(v0, v2);
 
-        meshData.m_indices32.push_back(i*6+5);
-        meshData.m_indices32.push_back(i*6+4);
-        meshData.m_indices32.push_back(i*6+2);
+        uint32* pOut = &meshData.m_indices32[i * 12];
 
-        meshData.m_indices32.push_back(i*6+3);
-        meshData.m_indices32.push_back(i*6+1);
-        meshData.m_indices32.push_back(i*6+4);
+        pOut[0]  = v0; pOut[1]  = m0; pOut[2]  = m2;
+        pOut[3]  = m0; pOut[4]  = m1; pOut[5]  = m2;
+        pOut[6]  = m2; pOut[7]  = m1; pOut[8]  = v2;
+        pOut[9]  = m0; pOut[10] = v1; pOut[11] = m1;
     }
+
+    // Interpolating the attributes only reads the old vertices and writes one new vertex per edge, so it can be split
+    // across threads without synchronization.
+    meshData.ResizeVertices(numOldVertices + static_cast<uint32>(newEdges.size()));
+
+    ParallelFor(static_cast<uint32>(newEdges.size()), MinVerticesPerThread, m_maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 e = begin; e < end; ++e)
+        {
+            meshData.SetVertex(numOldVertices + e,
+                               MidPoint(meshData.GetVertex(newEdges[e].first), meshData.GetVertex(newEdges[e].second)));
+        }
+    });
 }
 
 // ====================================================================================================================
-MeshData GeometryGenerator::CreateBox(
+template<typename MeshT>
+void GeometryGenerator::BuildBox(
     float  width,
     float  height,
     float  depth,
-    uint32 numSubdivisions)
+    uint32 numSubdivisions,
+    MeshT& meshData)
 {
-    MeshData     meshData;
     const uint32 NumTotalCoords = 3 * 8;
     Vertex       v[NumTotalCoords];
 
@@ -149,7 +424,11 @@ MeshData GeometryGenerator::CreateBox(
     v[22] = Vertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
     v[23] = Vertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
 
-    meshData.m_vertices.assign(&v[0], &v[24]);
+    meshData.ResizeVertices(NumTotalCoords);
+    for (uint32 j = 0; j < NumTotalCoords; ++j)
+    {
+        meshData.SetVertex(j, v[j]);
+    }
 
     uint32 i[36];
     // Fill in the front face index data
@@ -183,22 +462,34 @@ MeshData GeometryGenerator::CreateBox(
 
     for(uint32 i = 0; i < numSubdivisions; ++i)
         SubDivide(meshData);
-
-    return meshData;
 }
 
 
 // ====================================================================================================================
-MeshData GeometryGenerator::CreateGrid(
+template<typename MeshT>
+void GeometryGenerator::BuildGrid(
     float  width,
     float  depth,
     uint32 m,
-    uint32 n)
+    uint32 n,
+    MeshT& meshData)
 {
-    MeshData meshData;
+    BuildGridRows(width, depth, m, n, 0, m - 1, meshData);
+}
 
-    uint32 vertexCount = m * n;
-    uint32 faceCount = (m - 1) * (n - 1) * 2;
+// ====================================================================================================================
+// Quad rows [firstRow, firstRow + rowCount) of an m x n grid, with chunk local indices.
+template<typename MeshT>
+void GeometryGenerator::BuildGridRows(
+    float  width,
+    float  depth,
+    uint32 m,
+    uint32 n,
+    uint32 firstRow,
+    uint32 rowCount,
+    MeshT& meshData)
+{
+    const MeshSize size = GridChunkSize(n, rowCount);
 
     // Create the vertices.
     float halfWidth = 0.5f * width;
@@ -210,56 +501,63 @@ MeshData GeometryGenerator::CreateGrid(
     float du = 1.0f / (n - 1);
     float dv = 1.0f / (m - 1);
 
-    meshData.m_vertices.resize(vertexCount);
-    for (uint32 i = 0; i < m; ++i)
+    // Rows are independent, so large grids are split into row ranges across threads.
+    const uint32 minRowsPerThread = std::max<uint32>(1, MinVerticesPerThread / n);
+
+    meshData.ResizeVertices(size.vertexCount);
+    ParallelFor(rowCount + 1, minRowsPerThread, m_maxThreads, [&](uint32 rowBegin, uint32 rowEnd)
     {
-        float z = halfDepth - i * dz;
-        for (uint32 j = 0; j < n; ++j)
+        for (uint32 r = rowBegin; r < rowEnd; ++r)
         {
-            float x = -halfWidth + j * dx;
-
-            meshData.m_vertices[i * n + j].m_position = XMFLOAT3(x, 0.0f, z);
-            meshData.m_vertices[i * n + j].m_normal   = XMFLOAT3(0.0f, 1.0f, 0.0f);
-            meshData.m_vertices[i * n + j].m_tangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-            // Stretch texture over grid.
-            meshData.m_vertices[i * n + j].m_texC.x = j * du;
-            meshData.m_vertices[i * n + j].m_texC.y = i * dv;
+            const uint32 i = firstRow + r;
+
+            float z = halfDepth - i * dz;
+            for (uint32 j = 0; j < n; ++j)
+            {
+                float x = -halfWidth + j * dx;
+
+                // Stretch texture over grid.
+                meshData.SetVertex(r * n + j, Vertex(XMFLOAT3(x, 0.0f, z),
+                                                     XMFLOAT3(0.0f, 1.0f, 0.0f),
+                                                     XMFLOAT3(1.0f, 0.0f, 0.0f),
+                                                     XMFLOAT2(j * du, i * dv)));
+            }
         }
-    }
+    });
 
     // Create the indices.
-    meshData.m_indices32.resize(faceCount * 3); // 3 indices per face
+    meshData.ResizeIndices(size.indexCount);
 
     // Iterate over each quad and compute indices.
-    uint32 k = 0;
-    for (uint32 i = 0; i < m - 1; ++i)
+    ParallelFor(rowCount, minRowsPerThread, m_maxThreads, [&](uint32 rowBegin, uint32 rowEnd)
     {
-        for (uint32 j = 0; j < n - 1; ++j)
+        uint32 k = rowBegin * (n - 1) * 6;
+        for (uint32 i = rowBegin; i < rowEnd; ++i)
         {
-            meshData.m_indices32[k] = i * n + j;
-            meshData.m_indices32[k + 1] = i * n + j + 1;
-            meshData.m_indices32[k + 2] = (i + 1) * n + j;
-
-            meshData.m_indices32[k + 3] = (i + 1) * n + j;
-            meshData.m_indices32[k + 4] = i * n + j + 1;
-            meshData.m_indices32[k + 5] = (i + 1) * n + j + 1;
-
-            k += 6; // next quad
+            for (uint32 j = 0; j < n - 1; ++j)
+            {
+                meshData.SetIndex(k, i * n + j);
+                meshData.SetIndex(k + 1, i * n + j + 1);
+                meshData.SetIndex(k + 2, (i + 1) * n + j);
+
+                meshData.SetIndex(k + 3, (i + 1) * n + j);
+                meshData.SetIndex(k + 4, i * n + j + 1);
+                meshData.SetIndex(k + 5, (i + 1) * n + j + 1);
+
+                k += 6; // next quad
+            }
         }
-    }
-
-    return meshData;
+    });
 }
 
 // ====================================================================================================================
-MeshData GeometryGenerator::CreateSphere(
-    float radius,
+template<typename MeshT>
+void GeometryGenerator::BuildSphere(
+    float  radius,
     uint32 sliceCount,
-    uint32 stackCount)
+    uint32 stackCount,
+    MeshT& meshData)
 {
-    MeshData meshData;
-
     //
     // Compute the vertices stating at the top pole and moving down the stacks.
     //
@@ -270,58 +568,78 @@ MeshData GeometryGenerator::CreateSphere(
     Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
     Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 
-    meshData.m_vertices.push_back(topVertex);
-
     float phiStep = XM_PI / stackCount;
     float thetaStep = 2.0f * XM_PI / sliceCount;
 
-    // Compute vertices for each stack ring (do not count the poles as rings).
-    for (uint32 i = 1; i <= stackCount - 1; ++i)
-    {
-        float phi = i * phiStep;
+    uint32 ringVertexCount = sliceCount + 1;
+    uint32 innerRingCount  = stackCount - 1;
+    uint32 southPoleIndex  = 1 + innerRingCount * ringVertexCount;
 
-        // Vertices of ring.
-        for (uint32 j = 0; j <= sliceCount; ++j)
+    const uint32 minRingsPerThread = std::max<uint32>(1, MinVerticesPerThread / ringVertexCount);
+
+    meshData.ResizeVertices(southPoleIndex + 1);
+    meshData.SetVertex(0, topVertex);
+    meshData.SetVertex(southPoleIndex, bottomVertex);
+
+    // Compute vertices for each stack ring (do not count the poles as rings). Each ring has a fixed slot in the
+    // vertex buffer, so rings are split across threads.
+    ParallelFor(innerRingCount, minRingsPerThread, m_maxThreads, [&](uint32 ringBegin, uint32 ringEnd)
+    {
+        for (uint32 i = ringBegin + 1; i <= ringEnd; ++i)
         {
-            float theta = j * thetaStep;
+            float phi = i * phiStep;
+            float sinPhi = sinf(phi);
+            float cosPhi = cosf(phi);
 
-            Vertex v;
+            // Vertices of ring.
+            for (uint32 j = 0; j <= sliceCount; ++j)
+            {
+                float theta = j * thetaStep;
+                float sinTheta = sinf(theta);
+                float cosTheta = cosf(theta);
 
-            // spherical to cartesian
-            v.m_position.x = radius * sinf(phi) * cosf(theta);
-            v.m_position.y = radius * cosf(phi);
-            v.m_position.z = radius * sinf(phi) * sinf(theta);
+                Vertex v;
 
-            // Partial derivative of P with respect to theta
-            v.m_tangentU.x = -radius * sinf(phi) * sinf(theta);
-            v.m_tangentU.y = 0.0f;
-            v.m_tangentU.z = +radius * sinf(phi) * cosf(theta);
+                // spherical to cartesian
+                v.m_position.x = radius * sinPhi * cosTheta;
+                v.m_position.y = radius * cosPhi;
+                v.m_position.z = radius * sinPhi * sinTheta;
 
-            XMVECTOR T = XMLoadFloat3(&v.m_tangentU);
-            XMStoreFloat3(&v.m_tangentU, XMVector3Normalize(T));
+                // Partial derivative of P with respect to theta
+                v.m_tangentU.x = -radius * sinPhi * sinTheta;
+                v.m_tangentU.y = 0.0f;
+                v.m_tangentU.z = +radius * sinPhi * cosTheta;
 
-            XMVECTOR p = XMLoadFloat3(&v.m_position);
-            XMStoreFloat3(&v.m_normal, XMVector3Normalize(p));
+                XMVECTOR T = XMLoadFloat3(&v.m_tangentU);
+                XMStoreFloat3(&v.m_tangentU, XMVector3Normalize(T));
 
-            v.m_texC.x = theta / XM_2PI;
-            v.m_texC.y = phi / XM_PI;
+                XMVECTOR p = XMLoadFloat3(&v.m_position);
+                XMStoreFloat3(&v.m_normal, XMVector3Normalize(p));
+
+                v.m_texC.x = theta / XM_2PI;
+                v.m_texC.y = phi / XM_PI;
 
-            meshData.m_vertices.push_back(v);
+                meshData.SetVertex(1 + (i - 1) * ringVertexCount + j, v);
+            }
         }
-    }
+    });
 
-    meshData.m_vertices.push_back(bottomVertex);
+    // Top fan, inner stacks and bottom fan.
+    const uint32 topIndexCount   = sliceCount * 3;
+    const uint32 innerIndexCount = (stackCount - 2) * sliceCount * 6;
+    meshData.ResizeIndices(topIndexCount + innerIndexCount + sliceCount * 3);
 
     //
     // Compute indices for top stack.  The top stack was written first to the vertex buffer
     // and connects the top pole to the first ring.
     //
 
+    uint32 k = 0;
     for (uint32 i = 1; i <= sliceCount; ++i)
     {
-        meshData.m_indices32.push_back(0);
-        meshData.m_indices32.push_back(i + 1);
-        meshData.m_indices32.push_back(i);
+        meshData.SetIndex(k++, 0);
+        meshData.SetIndex(k++, i + 1);
+        meshData.SetIndex(k++, i);
     }
 
     //
@@ -331,52 +649,163 @@ MeshData GeometryGenerator::CreateSphere(
     // Offset the indices to the index of the first vertex in the first ring.
     // This is just skipping the top pole vertex.
     uint32 baseIndex = 1;
-    uint32 ringVertexCount = sliceCount + 1;
-    for (uint32 i = 0; i < stackCount - 2; ++i)
+    ParallelFor(stackCount - 2, minRingsPerThread, m_maxThreads, [&](uint32 stackBegin, uint32 stackEnd)
     {
-        for (uint32 j = 0; j < sliceCount; ++j)
+        uint32 k = topIndexCount + stackBegin * sliceCount * 6;
+        for (uint32 i = stackBegin; i < stackEnd; ++i)
         {
-            meshData.m_indices32.push_back(baseIndex + i * ringVertexCount + j);
-            meshData.m_indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-            meshData.m_indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-
-            meshData.m_indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j);
-            meshData.m_indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-            meshData.m_indices32.push_back(baseIndex + (i + 1) * ringVertexCount + j + 1);
+            for (uint32 j = 0; j < sliceCount; ++j)
+            {
+                meshData.SetIndex(k++, baseIndex + i * ringVertexCount + j);
+                meshData.SetIndex(k++, baseIndex + i * ringVertexCount + j + 1);
+                meshData.SetIndex(k++, baseIndex + (i + 1) * ringVertexCount + j);
+
+                meshData.SetIndex(k++, baseIndex + (i + 1) * ringVertexCount + j);
+                meshData.SetIndex(k++, baseIndex + i * ringVertexCount + j + 1);
+                meshData.SetIndex(k++, baseIndex + (i + 1) * ringVertexCount + j + 1);
+            }
         }
-    }
+    });
 
     //
     // Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
     // and connects the bottom pole to the bottom ring.
     //
 
-    // South pole vertex was added last.
-    uint32 southPoleIndex = (uint32)meshData.m_vertices.size() - 1;
-
     // Offset the indices to the index of the first vertex in the last ring.
     baseIndex = southPoleIndex - ringVertexCount;
 
+    k = topIndexCount + innerIndexCount;
     for (uint32 i = 0; i < sliceCount; ++i)
     {
-        meshData.m_indices32.push_back(southPoleIndex);
-        meshData.m_indices32.push_back(baseIndex + i);
-        meshData.m_indices32.push_back(baseIndex + i + 1);
+        meshData.SetIndex(k++, southPoleIndex);
+        meshData.SetIndex(k++, baseIndex + i);
+        meshData.SetIndex(k++, baseIndex + i + 1);
     }
+}
 
-    return meshData;
+// ====================================================================================================================
+template<typename MeshT>
+void GeometryGenerator::BuildGeoSphere(
+    float  radius,
+    uint32 numSubdivisions,
+    MeshT& meshData)
+{
+    // Put a cap on the number of subdivisions. Midpoints are shared, so level 8 is ~655k vertices.
+    numSubdivisions = std::min<uint32>(numSubdivisions, 8u);
+
+    // Approximate a sphere by tessellating an icosahedron.
+    const float X = 0.525731f;
+    const float Z = 0.850651f;
+
+    XMFLOAT3 pos[12] =
+    {
+        XMFLOAT3(-X, 0.0f, Z),  XMFLOAT3(X, 0.0f, Z),
+        XMFLOAT3(-X, 0.0f, -Z), XMFLOAT3(X, 0.0f, -Z),
+        XMFLOAT3(0.0f, Z, X),   XMFLOAT3(0.0f, Z, -X),
+        XMFLOAT3(0.0f, -Z, X),  XMFLOAT3(0.0f, -Z, -X),
+        XMFLOAT3(Z, X, 0.0f),   XMFLOAT3(-Z, X, 0.0f),
+        XMFLOAT3(Z, -X, 0.0f),  XMFLOAT3(-Z, -X, 0.0f)
+    };
+
+    uint32 k[60] =
+    {
+        1,4,0,  4,9,0,  4,5,9,  8,5,4,  1,8,4,
+        1,10,8, 10,3,8, 8,3,5,  3,2,5,  3,7,2,
+        3,10,7, 10,6,7, 6,11,7, 6,0,11, 6,1,0,
+        10,1,6, 11,0,9, 2,11,9, 5,2,9,  11,2,7
+    };
+
+    meshData.ResizeVertices(12);
+    for (uint32 i = 0; i < 12; ++i)
+    {
+        Vertex v;
+        v.m_position = pos[i];
+        meshData.SetVertex(i, v);
+    }
+
+    meshData.m_indices32.assign(&k[0], &k[60]);
+
+    for (uint32 i = 0; i < numSubdivisions; ++i)
+        SubDivide(meshData);
+
+    // Project vertices onto sphere and scale.
+    ParallelFor(meshData.VertexCount(), MinVerticesPerThread, m_maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            Vertex v = meshData.GetVertex(i);
+
+            // Project onto unit sphere.
+            XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&v.m_position));
+
+            // Project onto sphere.
+            XMVECTOR p = radius * n;
+
+            XMStoreFloat3(&v.m_position, p);
+            XMStoreFloat3(&v.m_normal, n);
+
+            // Derive texture coordinates from spherical coordinates.
+            float theta = atan2f(v.m_position.z, v.m_position.x);
+            if (theta < 0.0f)
+            {
+                theta += XM_2PI;
+            }
+
+            float phi = acosf(MathHelper::Clamp(v.m_position.y / radius, -1.0f, 1.0f));
+
+            v.m_texC.x = theta / XM_2PI;
+            v.m_texC.y = phi / XM_PI;
+
+            // Partial derivative of P with respect to theta
+            v.m_tangentU.x = -radius * sinf(phi) * sinf(theta);
+            v.m_tangentU.y = 0.0f;
+            v.m_tangentU.z = +radius * sinf(phi) * cosf(theta);
+
+            XMVECTOR T = XMLoadFloat3(&v.m_tangentU);
+            XMStoreFloat3(&v.m_tangentU, XMVector3Normalize(T));
+
+            meshData.SetVertex(i, v);
+        }
+    });
 }
 
 // ====================================================================================================================
-MeshData GeometryGenerator::CreateCylinder(
-    float bottomRadius,
-    float topRadius,
-    float height,
-    uint32 sliceCount,
-    uint32 stackCount)
+template<typename MeshT>
+void GeometryGenerator::BuildQuad(
+    float  x,
+    float  y,
+    float  w,
+    float  h,
+    float  depth,
+    MeshT& meshData)
 {
-    MeshData meshData;
+    meshData.ResizeVertices(4);
+
+    // Position coordinates specified in NDC space.
+    meshData.SetVertex(0, Vertex(x, y - h, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+    meshData.SetVertex(1, Vertex(x, y, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+    meshData.SetVertex(2, Vertex(x + w, y, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f));
+    meshData.SetVertex(3, Vertex(x + w, y - h, depth, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f));
 
+    const uint32 i[6] = { 0, 1, 2, 0, 2, 3 };
+    meshData.ResizeIndices(6);
+    for (uint32 k = 0; k < 6; ++k)
+    {
+        meshData.SetIndex(k, i[k]);
+    }
+}
+
+// ====================================================================================================================
+template<typename MeshT>
+void GeometryGenerator::BuildCylinder(
+    float  bottomRadius,
+    float  topRadius,
+    float  height,
+    uint32 sliceCount,
+    uint32 stackCount,
+    MeshT& meshData)
+{
     // Build Stacks.
     float stackHeight = height / stackCount;
 
@@ -385,95 +814,106 @@ MeshData GeometryGenerator::CreateCylinder(
 
     uint32 ringCount = stackCount + 1;
 
-    // Compute vertices for each stack ring starting at the bottom and moving up.
-    for (uint32 i = 0; i < ringCount; ++i)
-    {
-        float y = -0.5f * height + i * stackHeight;
-        float r = bottomRadius + i * radiusStep;
-
-        // vertices of ring
-        float dTheta = 2.0f * XM_PI / sliceCount;
-        for (uint32 j = 0; j <= sliceCount; ++j)
-        {
-            Vertex vertex;
-
-            float c = cosf(j * dTheta);
-            float s = sinf(j * dTheta);
-
-            vertex.m_position = XMFLOAT3(r * c, y, r * s);
-
-            vertex.m_texC.x = (float)j / sliceCount;
-            vertex.m_texC.y = 1.0f - (float)i / stackCount;
-
-            // Cylinder can be parameterized as follows, where we introduce v
-            // parameter that goes in the same direction as the v tex-coord
-            // so that the bitangent goes in the same direction as the v tex-coord.
-            //   Let r0 be the bottom radius and let r1 be the top radius.
-            //   y(v) = h - hv for v in [0,1].
-            //   r(v) = r1 + (r0-r1)v
-            //
-            //   x(t, v) = r(v)*cos(t)
-            //   y(t, v) = h - hv
-            //   z(t, v) = r(v)*sin(t)
-            // 
-            //  dx/dt = -r(v)*sin(t)
-            //  dy/dt = 0
-            //  dz/dt = +r(v)*cos(t)
-            //
-            //  dx/dv = (r0-r1)*cos(t)
-            //  dy/dv = -h
-            //  dz/dv = (r0-r1)*sin(t)
-
-            // This is unit length.
-            vertex.m_tangentU = XMFLOAT3(-s, 0.0f, c);
-
-            float dr = bottomRadius - topRadius;
-            XMFLOAT3 bitangent(dr * c, -height, dr * s);
-
-            XMVECTOR T = XMLoadFloat3(&vertex.m_tangentU);
-            XMVECTOR B = XMLoadFloat3(&bitangent);
-            XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-            XMStoreFloat3(&vertex.m_normal, N);
-
-            meshData.m_vertices.push_back(vertex);
-        }
-    }
-
     // Add one because we duplicate the first and last vertex per ring
     // since the texture coordinates are different.
     uint32 ringVertexCount = sliceCount + 1;
 
-    // Compute indices for each stack.
-    for (uint32 i = 0; i < stackCount; ++i)
+    const uint32 minRingsPerThread = std::max<uint32>(1, MinVerticesPerThread / ringVertexCount);
+
+    // Compute vertices for each stack ring starting at the bottom and moving up. Each ring has a fixed slot in the
+    // vertex buffer, so rings are split across threads.
+    meshData.ResizeVertices(ringCount * ringVertexCount);
+    ParallelFor(ringCount, minRingsPerThread, m_maxThreads, [&](uint32 ringBegin, uint32 ringEnd)
     {
-        for (uint32 j = 0; j < sliceCount; ++j)
+        for (uint32 i = ringBegin; i < ringEnd; ++i)
         {
-            meshData.m_indices32.push_back(i * ringVertexCount + j);
-            meshData.m_indices32.push_back((i + 1) * ringVertexCount + j);
-            meshData.m_indices32.push_back((i + 1) * ringVertexCount + j + 1);
+            float y = -0.5f * height + i * stackHeight;
+            float r = bottomRadius + i * radiusStep;
+
+            // vertices of ring
+            float dTheta = 2.0f * XM_PI / sliceCount;
+            for (uint32 j = 0; j <= sliceCount; ++j)
+            {
+                Vertex vertex;
+
+                float c = cosf(j * dTheta);
+                float s = sinf(j * dTheta);
+
+                vertex.m_position = XMFLOAT3(r * c, y, r * s);
+
+                vertex.m_texC.x = (float)j / sliceCount;
+                vertex.m_texC.y = 1.0f - (float)i / stackCount;
+
+                // Cylinder can be parameterized as follows, where we introduce v
+                // parameter that goes in the same direction as the v tex-coord
+                // so that the bitangent goes in the same direction as the v tex-coord.
+                //   Let r0 be the bottom radius and let r1 be the top radius.
+                //   y(v) = h - hv for v in [0,1].
+                //   r(v) = r1 + (r0-r1)v
+                //
+                //   x(t, v) = r(v)*cos(t)
+                //   y(t, v) = h - hv
+                //   z(t, v) = r(v)*sin(t)
+                // 
+                //  dx/dt = -r(v)*sin(t)
+                //  dy/dt = 0
+                //  dz/dt = +r(v)*cos(t)
+                //
+                //  dx/dv = (r0-r1)*cos(t)
+                //  dy/dv = -h
+                //  dz/dv = (r0-r1)*sin(t)
+
+                // This is unit length.
+                vertex.m_tangentU = XMFLOAT3(-s, 0.0f, c);
+
+                float dr = bottomRadius - topRadius;
+                XMFLOAT3 bitangent(dr * c, -height, dr * s);
+
+                XMVECTOR T = XMLoadFloat3(&vertex.m_tangentU);
+                XMVECTOR B = XMLoadFloat3(&bitangent);
+                XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
+                XMStoreFloat3(&vertex.m_normal, N);
+
+                meshData.SetVertex(i * ringVertexCount + j, vertex);
+            }
+        }
+    });
 
-            meshData.m_indices32.push_back(i * ringVertexCount + j);
-            meshData.m_indices32.push_back((i + 1) * ringVertexCount + j + 1);
-            meshData.m_indices32.push_back(i * ringVertexCount + j + 1);
+    // Compute indices for each stack.
+    meshData.ResizeIndices(stackCount * sliceCount * 6);
+    ParallelFor(stackCount, minRingsPerThread, m_maxThreads, [&](uint32 stackBegin, uint32 stackEnd)
+    {
+        uint32 k = stackBegin * sliceCount * 6;
+        for (uint32 i = stackBegin; i < stackEnd; ++i)
+        {
+            for (uint32 j = 0; j < sliceCount; ++j)
+            {
+                meshData.SetIndex(k++, i * ringVertexCount + j);
+                meshData.SetIndex(k++, (i + 1) * ringVertexCount + j);
+                meshData.SetIndex(k++, (i + 1) * ringVertexCount + j + 1);
+
+                meshData.SetIndex(k++, i * ringVertexCount + j);
+                meshData.SetIndex(k++, (i + 1) * ringVertexCount + j + 1);
+                meshData.SetIndex(k++, i * ringVertexCount + j + 1);
+            }
         }
-    }
+    });
 
     BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
     BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-
-    return meshData;
 }
 
 // ====================================================================================================================
+template<typename MeshT>
 void GeometryGenerator::BuildCylinderTopCap(
     float bottomRadius,
     float topRadius,
     float height,
     uint32 sliceCount,
     uint32 stackCount,
-    MeshData& meshData)
+    MeshT& meshData)
 {
-    uint32 baseIndex = (uint32)meshData.m_vertices.size();
+    uint32 baseIndex = meshData.VertexCount();
 
     float y = 0.5f * height;
     float dTheta = 2.0f * XM_PI / sliceCount;
@@ -489,32 +929,33 @@ void GeometryGenerator::BuildCylinderTopCap(
         float u = x / height + 0.5f;
         float v = z / height + 0.5f;
 
-        meshData.m_vertices.push_back(Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+        meshData.PushVertex(Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
     }
 
     // Cap center vertex.
-    meshData.m_vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+    meshData.PushVertex(Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
     // Index of center vertex.
-    uint32 centerIndex = (uint32)meshData.m_vertices.size() - 1;
+    uint32 centerIndex = meshData.VertexCount() - 1;
 
     for (uint32 i = 0; i < sliceCount; ++i)
     {
-        meshData.m_indices32.push_back(centerIndex);
-        meshData.m_indices32.push_back(baseIndex + i + 1);
-        meshData.m_indices32.push_back(baseIndex + i);
+        meshData.PushIndex(centerIndex);
+        meshData.PushIndex(baseIndex + i + 1);
+        meshData.PushIndex(baseIndex + i);
     }
 }
 
 // ====================================================================================================================
+template<typename MeshT>
 void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-    uint32 sliceCount, uint32 stackCount, MeshData& meshData)
+    uint32 sliceCount, uint32 stackCount, MeshT& meshData)
 {
     // 
     // Build bottom cap.
     //
 
-    uint32 baseIndex = (uint32)meshData.m_vertices.size();
+    uint32 baseIndex = meshData.VertexCount();
     float y = -0.5f * height;
 
     // vertices of ring
@@ -529,20 +970,295 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
         float u = x / height + 0.5f;
         float v = z / height + 0.5f;
 
-        meshData.m_vertices.push_back(Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+        meshData.PushVertex(Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
     }
 
     // Cap center vertex.
-    meshData.m_vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+    meshData.PushVertex(Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
 
     // Cache the index of center vertex.
-    uint32 centerIndex = (uint32)meshData.m_vertices.size() - 1;
+    uint32 centerIndex = meshData.VertexCount() - 1;
 
     for (uint32 i = 0; i < sliceCount; ++i)
     {
-        meshData.m_indices32.push_back(centerIndex);
-        meshData.m_indices32.push_back(baseIndex + i);
-        meshData.m_indices32.push_back(baseIndex + i + 1);
+        meshData.PushIndex(centerIndex);
+        meshData.PushIndex(baseIndex + i);
+        meshData.PushIndex(baseIndex + i + 1);
     }
 }
 
+
+// ====================================================================================================================
+MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
+{
+    MeshData meshData;
+    BuildBox(width, height, depth, numSubdivisions, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+{
+    MeshData meshData;
+    BuildSphere(radius, sliceCount, stackCount, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshData GeometryGenerator::CreateGeoSphere(float radius, uint32 numSubdivisions)
+{
+    MeshData meshData;
+    BuildGeoSphere(radius, numSubdivisions, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshData GeometryGenerator::CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+{
+    MeshData meshData;
+    BuildCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
+{
+    MeshData meshData;
+    BuildGrid(width, depth, m, n, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshData GeometryGenerator::CreateQuad(float x, float y, float w, float h, float depth)
+{
+    MeshData meshData;
+    BuildQuad(x, y, w, h, depth, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshDataSoA GeometryGenerator::CreateBoxSoA(float width, float height, float depth, uint32 numSubdivisions)
+{
+    MeshDataSoA meshData;
+    BuildBox(width, height, depth, numSubdivisions, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshDataSoA GeometryGenerator::CreateSphereSoA(float radius, uint32 sliceCount, uint32 stackCount)
+{
+    MeshDataSoA meshData;
+    BuildSphere(radius, sliceCount, stackCount, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshDataSoA GeometryGenerator::CreateGeoSphereSoA(float radius, uint32 numSubdivisions)
+{
+    MeshDataSoA meshData;
+    BuildGeoSphere(radius, numSubdivisions, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshDataSoA GeometryGenerator::CreateCylinderSoA(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount)
+{
+    MeshDataSoA meshData;
+    BuildCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshDataSoA GeometryGenerator::CreateGridSoA(float width, float depth, uint32 m, uint32 n)
+{
+    MeshDataSoA meshData;
+    BuildGrid(width, depth, m, n, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshDataSoA GeometryGenerator::CreateQuadSoA(float x, float y, float w, float h, float depth)
+{
+    MeshDataSoA meshData;
+    BuildQuad(x, y, w, h, depth, meshData);
+    return meshData;
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::BoxSize(uint32 numSubdivisions)
+{
+    // Each face is a quad of two triangles; every subdivision doubles the vertices along its edges.
+    const uint32 faceEdge = (1u << numSubdivisions) + 1;
+    return { 6 * faceEdge * faceEdge, 36u << (2 * numSubdivisions) };
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::SphereSize(uint32 sliceCount, uint32 stackCount)
+{
+    return { (stackCount - 1) * (sliceCount + 1) + 2, sliceCount * 6 + (stackCount - 2) * sliceCount * 6 };
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::GeoSphereSize(uint32 numSubdivisions)
+{
+    numSubdivisions = std::min<uint32>(numSubdivisions, 8u);
+    return { (10u << (2 * numSubdivisions)) + 2, 60u << (2 * numSubdivisions) };
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CylinderSize(uint32 sliceCount, uint32 stackCount)
+{
+    // Side rings, then two caps of a ring plus a center vertex each.
+    return { (stackCount + 1) * (sliceCount + 1) + 2 * (sliceCount + 2), stackCount * sliceCount * 6 + sliceCount * 6 };
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::GridSize(uint32 m, uint32 n)
+{
+    return GridChunkSize(n, m - 1);
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::GridChunkSize(uint32 n, uint32 rowCount)
+{
+    return { (rowCount + 1) * n, rowCount * (n - 1) * 6 };
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateBox(
+    float                  width,
+    float                  height,
+    float                  depth,
+    uint32                 numSubdivisions,
+    const MeshWriteTarget& target)
+{
+    if (Fits(target, BoxSize(numSubdivisions)) == false)
+    {
+        return MeshSize();
+    }
+
+    MeshData meshData;
+    BuildBox(width, height, depth, numSubdivisions, meshData);
+    return CopyMesh(meshData, target, m_maxThreads);
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::WriteMesh(
+    const MeshData&        meshData,
+    const MeshWriteTarget& target)
+{
+    if (Fits(target, { meshData.VertexCount(), meshData.IndexCount() }) == false)
+    {
+        return MeshSize();
+    }
+
+    return CopyMesh(meshData, target, m_maxThreads);
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateSphere(
+    float                  radius,
+    uint32                 sliceCount,
+    uint32                 stackCount,
+    const MeshWriteTarget& target)
+{
+    const MeshSize size = SphereSize(sliceCount, stackCount);
+    if (Fits(target, size) == false)
+    {
+        return MeshSize();
+    }
+
+    MeshWriter writer(target);
+    BuildSphere(radius, sliceCount, stackCount, writer);
+    return size;
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateGeoSphere(
+    float                  radius,
+    uint32                 numSubdivisions,
+    const MeshWriteTarget& target)
+{
+    if (Fits(target, GeoSphereSize(numSubdivisions)) == false)
+    {
+        return MeshSize();
+    }
+
+    MeshData meshData;
+    BuildGeoSphere(radius, numSubdivisions, meshData);
+    return CopyMesh(meshData, target, m_maxThreads);
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateCylinder(
+    float                  bottomRadius,
+    float                  topRadius,
+    float                  height,
+    uint32                 sliceCount,
+    uint32                 stackCount,
+    const MeshWriteTarget& target)
+{
+    const MeshSize size = CylinderSize(sliceCount, stackCount);
+    if (Fits(target, size) == false)
+    {
+        return MeshSize();
+    }
+
+    MeshWriter writer(target);
+    BuildCylinder(bottomRadius, topRadius, height, sliceCount, stackCount, writer);
+    return size;
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateGrid(
+    float                  width,
+    float                  depth,
+    uint32                 m,
+    uint32                 n,
+    const MeshWriteTarget& target)
+{
+    return CreateGridChunk(width, depth, m, n, 0, m - 1, target);
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateGridChunk(
+    float                  width,
+    float                  depth,
+    uint32                 m,
+    uint32                 n,
+    uint32                 firstRow,
+    uint32                 rowCount,
+    const MeshWriteTarget& target)
+{
+    assert(firstRow + rowCount < m);
+
+    const MeshSize size = GridChunkSize(n, rowCount);
+    if (Fits(target, size) == false)
+    {
+        return MeshSize();
+    }
+
+    MeshWriter writer(target);
+    BuildGridRows(width, depth, m, n, firstRow, rowCount, writer);
+    return size;
+}
+
+// ====================================================================================================================
+MeshSize GeometryGenerator::CreateQuad(
+    float                  x,
+    float                  y,
+    float                  w,
+    float                  h,
+    float                  depth,
+    const MeshWriteTarget& target)
+{
+    const MeshSize size = QuadSize();
+    if (Fits(target, size) == false)
+    {
+        return MeshSize();
+    }
+
+    MeshWriter writer(target);
+    BuildQuad(x, y, w, h, depth, writer);
+    return size;
+}
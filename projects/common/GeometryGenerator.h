@@ -4,6 +4,8 @@
 #include <DirectXMath.h>
 #include <vector>
 
+#include "AlignedAllocator.h"
+
 using uint16 = std::uint16_t;
 using uint32 = std::uint32_t;
 
@@ -48,17 +50,17 @@ class MeshData
 public:
 
     MeshData() {}
-    MeshData(const MeshData& other)
-    {
-        m_vertices.resize(other.m_vertices.size());
-        m_indices32.resize(other.m_indices32.size());
-
-        m_vertices.assign(other.m_vertices.cbegin(), other.m_vertices.cend());
-        m_indices32.assign(other.m_indices32.cbegin(), other.m_indices32.cend());
-    }
 
-    std::vector<uint16>& GetIndices16()
+    // Copies the indices as 16 bits to indices. Fails, leaving indices empty, for meshes with more than 65536 vertices,
+    // whose indices do not fit in 16 bits; draw those with m_indices32 or split them with MeshPartitioner.
+    bool GetIndices16(std::vector<uint16>& indices)
     {
+        if (VertexCount() > 0x10000)
+        {
+            indices.clear();
+            return false;
+        }
+
         if (m_indices16.empty())
         {
             m_indices16.resize(m_indices32.size());
@@ -69,9 +71,21 @@ public:
 
         }
 
-        return m_indices16;
+        indices = m_indices16;
+        return true;
     }
-    
+
+    uint32 VertexCount() const                       { return static_cast<uint32>(m_vertices.size()); }
+    void   ResizeVertices(uint32 count)              { m_vertices.resize(count); }
+    void   PushVertex(const Vertex& v)               { m_vertices.push_back(v); }
+    void   SetVertex(uint32 index, const Vertex& v)  { m_vertices[index] = v; }
+    Vertex GetVertex(uint32 index) const             { return m_vertices[index]; }
+
+    uint32 IndexCount() const                        { return static_cast<uint32>(m_indices32.size()); }
+    void   ResizeIndices(uint32 count)               { m_indices32.resize(count); }
+    void   PushIndex(uint32 value)                   { m_indices32.push_back(value); }
+    void   SetIndex(uint32 index, uint32 value)      { m_indices32[index] = value; }
+
     std::vector<Vertex> m_vertices;
     std::vector<uint32> m_indices32;
 
@@ -79,10 +93,88 @@ private:
     std::vector<uint16> m_indices16;
 };
 
+// Describes where each attribute goes in an interleaved vertex. Attributes with a negative offset are not written, so
+// the caller can fill sample specific attributes (e.g. color) itself.
+struct InterleavedLayout
+{
+    uint32 stride         = 0;
+    int    positionOffset = -1;
+    int    normalOffset   = -1;
+    int    tangentOffset  = -1;
+    int    texCOffset     = -1;
+};
+
+// Structure-of-arrays variant of MeshData. Every attribute lives in its own aligned stream, so passes that only need
+// positions (bounds, transforms, picking, culling) touch 12 bytes per vertex instead of the whole interleaved Vertex.
+class MeshDataSoA
+{
+public:
+    static const size_t StreamAlignment = 32;
+
+    template<typename T>
+    using Stream = std::vector<T, AlignedAllocator<T, StreamAlignment>>;
+
+    MeshDataSoA() {}
+
+    static MeshDataSoA FromAoS(const MeshData& meshData);
+    MeshData           ToAoS() const;
+
+    // Writes vertices [firstVertex, firstVertex + vertexCount) into pDst using the given interleaved layout.
+    void WriteInterleaved(void* pDst, const InterleavedLayout& layout, uint32 firstVertex, uint32 vertexCount) const;
+    void WriteInterleaved(void* pDst, const InterleavedLayout& layout) const
+    {
+        WriteInterleaved(pDst, layout, 0, VertexCount());
+    }
+
+    uint32 VertexCount() const { return static_cast<uint32>(m_positions.size()); }
+    void   ResizeVertices(uint32 count);
+    void   PushVertex(const Vertex& v);
+    void   SetVertex(uint32 index, const Vertex& v);
+    Vertex GetVertex(uint32 index) const;
+
+    uint32 IndexCount() const                   { return static_cast<uint32>(m_indices32.size()); }
+    void   ResizeIndices(uint32 count)          { m_indices32.resize(count); }
+    void   PushIndex(uint32 value)              { m_indices32.push_back(value); }
+    void   SetIndex(uint32 index, uint32 value) { m_indices32[index] = value; }
+
+    Stream<DirectX::XMFLOAT3> m_positions;
+    Stream<DirectX::XMFLOAT3> m_normals;
+    Stream<DirectX::XMFLOAT3> m_tangentUs;
+    Stream<DirectX::XMFLOAT2> m_texCs;
+    std::vector<uint32>       m_indices32;
+};
+
+// Vertex and index counts of a generated mesh.
+struct MeshSize
+{
+    uint32 vertexCount = 0;
+    uint32 indexCount  = 0;
+};
+
+// Caller owned memory the generators write into directly, e.g. a mapped upload buffer. Vertices are written through
+// the layout, indices as 16 or 32 bit values. The memory is only written, never read back, so write-combined memory
+// is fine. If pPositions is set, every position is also stored there, packed, for work such as bounds that would
+// otherwise have to read the vertices back.
+struct MeshWriteTarget
+{
+    void*              pVertices      = nullptr;
+    InterleavedLayout  layout;
+    uint32             vertexCapacity = 0;
+    void*              pIndices       = nullptr;
+    uint32             indexSize      = 4; // 2 or 4 bytes
+    uint32             indexCapacity  = 0;
+    DirectX::XMFLOAT3* pPositions     = nullptr; // Optional, vertexCapacity entries
+};
+
 // Generates simple geometry
 class GeometryGenerator
 {
 public:
+    GeometryGenerator() {}
+
+    // Limits the number of threads used for large meshes. 0 uses one thread per hardware thread.
+    explicit GeometryGenerator(uint32 maxThreads) : m_maxThreads(maxThreads) {}
+
     MeshData CreateBox(float width, float height, float depth, uint32 numSubdivisions);
     MeshData CreateSphere(float radius, uint32 sliceCount, uint32 stackCount);
     MeshData CreateGeoSphere(float radius, uint32 numSubdivisions);
@@ -90,22 +182,78 @@ public:
     MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
     MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
+    // Same shapes, emitted directly into separate attribute streams.
+    MeshDataSoA CreateBoxSoA(float width, float height, float depth, uint32 numSubdivisions);
+    MeshDataSoA CreateSphereSoA(float radius, uint32 sliceCount, uint32 stackCount);
+    MeshDataSoA CreateGeoSphereSoA(float radius, uint32 numSubdivisions);
+    MeshDataSoA CreateCylinderSoA(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount);
+    MeshDataSoA CreateGridSoA(float width, float depth, uint32 m, uint32 n);
+    MeshDataSoA CreateQuadSoA(float x, float y, float w, float h, float depth);
+
+    // Sizes of the shapes above, so buffers can be allocated before anything is generated.
+    static MeshSize BoxSize(uint32 numSubdivisions);
+    static MeshSize SphereSize(uint32 sliceCount, uint32 stackCount);
+    static MeshSize GeoSphereSize(uint32 numSubdivisions);
+    static MeshSize CylinderSize(uint32 sliceCount, uint32 stackCount);
+    static MeshSize GridSize(uint32 m, uint32 n);
+    static MeshSize QuadSize() { return { 4, 6 }; }
+
+    // Same shapes, written straight into the target. Returns what was written, or zero counts (and writes nothing) if
+    // the target is too small or 16 bit indices can not address all vertices.
+    MeshSize CreateBox(float width, float height, float depth, uint32 numSubdivisions, const MeshWriteTarget& target);
+    MeshSize CreateSphere(float radius, uint32 sliceCount, uint32 stackCount, const MeshWriteTarget& target);
+    MeshSize CreateGeoSphere(float radius, uint32 numSubdivisions, const MeshWriteTarget& target);
+    MeshSize CreateCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, const MeshWriteTarget& target);
+    MeshSize CreateGrid(float width, float depth, uint32 m, uint32 n, const MeshWriteTarget& target);
+    MeshSize CreateQuad(float x, float y, float w, float h, float depth, const MeshWriteTarget& target);
+
+    // Copies an existing mesh into the target, with the same checks as the generators above.
+    MeshSize WriteMesh(const MeshData& meshData, const MeshWriteTarget& target);
+
+    // Streams an m x n grid in pieces of at most rowCount quad rows, so very large grids never need the whole mesh in
+    // memory. The chunk starting at quad row firstRow holds vertex rows [firstRow, firstRow + rowCount]; neighbouring
+    // chunks share their boundary vertex row. Positions and texture coordinates are those of the full grid, indices
+    // are local to the chunk.
+    static MeshSize GridChunkSize(uint32 n, uint32 rowCount);
+    MeshSize CreateGridChunk(float                  width,
+                             float                  depth,
+                             uint32                 m,
+                             uint32                 n,
+                             uint32                 firstRow,
+                             uint32                 rowCount,
+                             const MeshWriteTarget& target);
+
 private:
-    void SubDivide(MeshData& meshData);
+    // The builders are templated on the output mesh type (MeshData, MeshDataSoA or the writer behind MeshWriteTarget)
+    // and only use the vertex and index accessors all of them provide. Box and GeoSphere subdivide in place and take
+    // MeshData or MeshDataSoA only. They are instantiated in GeometryGenerator.cpp.
+    template<typename MeshT> void BuildBox(float width, float height, float depth, uint32 numSubdivisions, MeshT& meshData);
+    template<typename MeshT> void BuildSphere(float radius, uint32 sliceCount, uint32 stackCount, MeshT& meshData);
+    template<typename MeshT> void BuildGeoSphere(float radius, uint32 numSubdivisions, MeshT& meshData);
+    template<typename MeshT> void BuildCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshT& meshData);
+    template<typename MeshT> void BuildGrid(float width, float depth, uint32 m, uint32 n, MeshT& meshData);
+    template<typename MeshT> void BuildGridRows(float width, float depth, uint32 m, uint32 n, uint32 firstRow, uint32 rowCount, MeshT& meshData);
+    template<typename MeshT> void BuildQuad(float x, float y, float w, float h, float depth, MeshT& meshData);
+
+    template<typename MeshT> void SubDivide(MeshT& meshData);
 
     Vertex MidPoint(const Vertex& v0, const Vertex& v1);
 
+    template<typename MeshT>
     void BuildCylinderTopCap(float bottomRadius,
                              float topRadius,
                              float height,
                              uint32 sliceCount,
                              uint32 stackCount,
-                             MeshData& meshData);
+                             MeshT& meshData);
 
+    template<typename MeshT>
     void BuildCylinderBottomCap(float bottomRadius,
                                 float topRadius,
                                 float height,
                                 uint32 sliceCount,
                                 uint32 stackCount,
-                                MeshData& meshData);
+                                MeshT& meshData);
+
+    uint32 m_maxThreads = 0;
 };
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "Heightfield.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define AVX2_TARGET
+#else
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+using namespace DirectX;
+
+static const uint32 MinVerticesPerThread = 16 * 1024;
+
+// Range reduction to [-pi, pi] with 2 pi split in two parts, so large coordinates keep their precision, followed by
+// the 11th and 10th degree minimax polynomials DirectXMath uses for XMVectorSinCos() on [-pi/2, pi/2].
+static const float TwoPiHi    = 6.28318548f;
+static const float TwoPiLo    = -1.74845553e-7f;
+static const float InvTwoPi   = 0.159154943f;
+static const float HalfPi     = 1.57079633f;
+static const float Pi         = 3.14159265f;
+static const float SinCoefficients[5] = { -2.3889859e-08f, 2.7525562e-06f, -0.00019840874f, 0.0083333310f, -0.16666667f };
+static const float CosCoefficients[5] = { -2.6051615e-07f, 2.4760495e-05f, -0.0013888378f, 0.041666638f, -0.5f };
+
+// ====================================================================================================================
+// Vertices are gathered into blocks so strided interleaved layouts and the tail of the batch take the same path.
+template<uint32 Width>
+struct HillsBlock
+{
+    alignas(32) float x[Width];
+    alignas(32) float z[Width];
+    alignas(32) float height[Width];
+    alignas(32) float nx[Width];
+    alignas(32) float ny[Width];
+    alignas(32) float nz[Width];
+
+    void Gather(
+        const HeightfieldStreams& streams,
+        uint32                    first,
+        uint32                    count)
+    {
+        const uint8_t* pX = reinterpret_cast<const uint8_t*>(streams.pX) + size_t(first) * streams.inputStride;
+        const uint8_t* pZ = reinterpret_cast<const uint8_t*>(streams.pZ) + size_t(first) * streams.inputStride;
+
+        for (uint32 i = 0; i < Width; ++i)
+        {
+            const uint32 k = (i < count) ? i : 0;
+            x[i] = *reinterpret_cast<const float*>(pX + size_t(k) * streams.inputStride);
+            z[i] = *reinterpret_cast<const float*>(pZ + size_t(k) * streams.inputStride);
+        }
+    }
+
+    void Scatter(
+        const HeightfieldStreams& streams,
+        uint32                    first,
+        uint32                    count) const
+    {
+        if (streams.pHeights != nullptr)
+        {
+            uint8_t* pOut = reinterpret_cast<uint8_t*>(streams.pHeights) + size_t(first) * streams.heightStride;
+            for (uint32 i = 0; i < count; ++i, pOut += streams.heightStride)
+            {
+                *reinterpret_cast<float*>(pOut) = height[i];
+            }
+        }
+
+        if (streams.pNormals != nullptr)
+        {
+            uint8_t* pOut = reinterpret_cast<uint8_t*>(streams.pNormals) + size_t(first) * streams.normalStride;
+            for (uint32 i = 0; i < count; ++i, pOut += streams.normalStride)
+            {
+                const XMFLOAT3 n(nx[i], ny[i], nz[i]);
+                memcpy(pOut, &n, sizeof(XMFLOAT3));
+            }
+        }
+    }
+};
+
+// ====================================================================================================================
+static void SinCosSse(
+    __m128  a,
+    __m128& s,
+    __m128& c)
+{
+    // a -= 2 pi * round(a / 2 pi), then reflect |a| > pi / 2 around +-pi, which flips the sign of the cosine.
+    const __m128 q = _mm_cvtepi32_ps(_mm_cvtps_epi32(_mm_mul_ps(a, _mm_set1_ps(InvTwoPi))));
+    a = _mm_sub_ps(a, _mm_mul_ps(q, _mm_set1_ps(TwoPiHi)));
+    a = _mm_sub_ps(a, _mm_mul_ps(q, _mm_set1_ps(TwoPiLo)));
+
+    const __m128 signMask  = _mm_set1_ps(-0.0f);
+    const __m128 sign      = _mm_and_ps(a, signMask);
+    const __m128 reflected = _mm_sub_ps(_mm_or_ps(sign, _mm_set1_ps(Pi)), a);
+    const __m128 inRange   = _mm_cmple_ps(_mm_andnot_ps(signMask, a), _mm_set1_ps(HalfPi));
+
+    a = _mm_or_ps(_mm_and_ps(inRange, a), _mm_andnot_ps(inRange, reflected));
+    const __m128 cosSign = _mm_andnot_ps(inRange, signMask);
+
+    const __m128 a2 = _mm_mul_ps(a, a);
+
+    __m128 ps = _mm_set1_ps(SinCoefficients[0]);
+    __m128 pc = _mm_set1_ps(CosCoefficients[0]);
+    for (uint32 i = 1; i < 5; ++i)
+    {
+        ps = _mm_add_ps(_mm_mul_ps(ps, a2), _mm_set1_ps(SinCoefficients[i]));
+        pc = _mm_add_ps(_mm_mul_ps(pc, a2), _mm_set1_ps(CosCoefficients[i]));
+    }
+
+    s = _mm_mul_ps(a, _mm_add_ps(_mm_mul_ps(ps, a2), _mm_set1_ps(1.0f)));
+    c = _mm_xor_ps(_mm_add_ps(_mm_mul_ps(pc, a2), _mm_set1_ps(1.0f)), cosSign);
+}
+
+// ====================================================================================================================
+AVX2_TARGET static void SinCosAvx2(
+    __m256  a,
+    __m256& s,
+    __m256& c)
+{
+    const __m256 q = _mm256_round_ps(_mm256_mul_ps(a, _mm256_set1_ps(InvTwoPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    a = _mm256_fnmadd_ps(q, _mm256_set1_ps(TwoPiHi), a);
+    a = _mm256_fnmadd_ps(q, _mm256_set1_ps(TwoPiLo), a);
+
+    const __m256 signMask  = _mm256_set1_ps(-0.0f);
+    const __m256 sign      = _mm256_and_ps(a, signMask);
+    const __m256 reflected = _mm256_sub_ps(_mm256_or_ps(sign, _mm256_set1_ps(Pi)), a);
+    const __m256 inRange   = _mm256_cmp_ps(_mm256_andnot_ps(signMask, a), _mm256_set1_ps(HalfPi), _CMP_LE_OQ);
+
+    a = _mm256_blendv_ps(reflected, a, inRange);
+    const __m256 cosSign = _mm256_andnot_ps(inRange, signMask);
+
+    const __m256 a2 = _mm256_mul_ps(a, a);
+
+    __m256 ps = _mm256_set1_ps(SinCoefficients[0]);
+    __m256 pc = _mm256_set1_ps(CosCoefficients[0]);
+    for (uint32 i = 1; i < 5; ++i)
+    {
+        ps = _mm256_fmadd_ps(ps, a2, _mm256_set1_ps(SinCoefficients[i]));
+        pc = _mm256_fmadd_ps(pc, a2, _mm256_set1_ps(CosCoefficients[i]));
+    }
+
+    s = _mm256_mul_ps(a, _mm256_fmadd_ps(ps, a2, _mm256_set1_ps(1.0f)));
+    c = _mm256_xor_ps(_mm256_fmadd_ps(pc, a2, _mm256_set1_ps(1.0f)), cosSign);
+}
+
+// ====================================================================================================================
+static void EvaluateHillsSse(
+    const HeightfieldStreams& streams,
+    uint32                    begin,
+    uint32                    end)
+{
+    HillsBlock<4> block;
+
+    for (uint32 first = begin; first < end; first += 4)
+    {
+        const uint32 count = std::min<uint32>(4, end - first);
+        block.Gather(streams, first, count);
+
+        const __m128 x = _mm_load_ps(block.x);
+        const __m128 z = _mm_load_ps(block.z);
+
+        __m128 sinX;
+        __m128 cosX;
+        __m128 sinZ;
+        __m128 cosZ;
+        SinCosSse(_mm_mul_ps(x, _mm_set1_ps(0.1f)), sinX, cosX);
+        SinCosSse(_mm_mul_ps(z, _mm_set1_ps(0.1f)), sinZ, cosZ);
+
+        // y = 0.3 * (z * sin(0.1 x) + x * cos(0.1 z)), n = normalize(-dy/dx, 1, -dy/dz).
+        const __m128 height = _mm_mul_ps(_mm_set1_ps(0.3f), _mm_add_ps(_mm_mul_ps(z, sinX), _mm_mul_ps(x, cosZ)));
+        const __m128 nx     = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(-0.03f), _mm_mul_ps(z, cosX)), _mm_mul_ps(_mm_set1_ps(0.3f), cosZ));
+        const __m128 nz     = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.3f), sinX), _mm_mul_ps(_mm_set1_ps(0.03f), _mm_mul_ps(x, sinZ)));
+
+        const __m128 lengthSq  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(nz, nz)), _mm_set1_ps(1.0f));
+        const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSq));
+
+        _mm_store_ps(block.height, height);
+        _mm_store_ps(block.nx, _mm_mul_ps(nx, invLength));
+        _mm_store_ps(block.ny, invLength);
+        _mm_store_ps(block.nz, _mm_mul_ps(nz, invLength));
+
+        block.Scatter(streams, first, count);
+    }
+}
+
+// ====================================================================================================================
+AVX2_TARGET static void EvaluateHillsAvx2(
+    const HeightfieldStreams& streams,
+    uint32                    begin,
+    uint32                    end)
+{
+    HillsBlock<8> block;
+
+    for (uint32 first = begin; first < end; first += 8)
+    {
+        const uint32 count = std::min<uint32>(8, end - first);
+        block.Gather(streams, first, count);
+
+        const __m256 x = _mm256_load_ps(block.x);
+        const __m256 z = _mm256_load_ps(block.z);
+
+        __m256 sinX;
+        __m256 cosX;
+        __m256 sinZ;
+        __m256 cosZ;
+        SinCosAvx2(_mm256_mul_ps(x, _mm256_set1_ps(0.1f)), sinX, cosX);
+        SinCosAvx2(_mm256_mul_ps(z, _mm256_set1_ps(0.1f)), sinZ, cosZ);
+
+        const __m256 height = _mm256_mul_ps(_mm256_set1_ps(0.3f), _mm256_fmadd_ps(z, sinX, _mm256_mul_ps(x, cosZ)));
+        const __m256 nx     = _mm256_fmadd_ps(_mm256_set1_ps(-0.03f), _mm256_mul_ps(z, cosX), _mm256_mul_ps(_mm256_set1_ps(-0.3f), cosZ));
+        const __m256 nz     = _mm256_fmadd_ps(_mm256_set1_ps(0.03f), _mm256_mul_ps(x, sinZ), _mm256_mul_ps(_mm256_set1_ps(-0.3f), sinX));
+
+        const __m256 lengthSq  = _mm256_fmadd_ps(nx, nx, _mm256_fmadd_ps(nz, nz, _mm256_set1_ps(1.0f)));
+        const __m256 invLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(lengthSq));
+
+        _mm256_store_ps(block.height, height);
+        _mm256_store_ps(block.nx, _mm256_mul_ps(nx, invLength));
+        _mm256_store_ps(block.ny, invLength);
+        _mm256_store_ps(block.nz, _mm256_mul_ps(nz, invLength));
+
+        block.Scatter(streams, first, count);
+    }
+}
+
+// ====================================================================================================================
+static bool DetectAvx2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    // FMA and OSXSAVE, then the OS has to save the YMM registers.
+    __cpuid(info, 1);
+    if (((info[2] & (1 << 12)) == 0) || ((info[2] & (1 << 27)) == 0) || ((_xgetbv(0) & 6) != 6))
+    {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+
+// ====================================================================================================================
+float Heightfield::HillsHeight(
+    float x,
+    float z)
+{
+    return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+}
+
+// ====================================================================================================================
+XMFLOAT3 Heightfield::HillsNormal(
+    float x,
+    float z)
+{
+    XMFLOAT3 n(-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
+               1.0f,
+               -0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
+
+    XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+    return n;
+}
+
+// ====================================================================================================================
+bool Heightfield::UsesAvx2()
+{
+    static const bool avx2 = DetectAvx2();
+    return avx2;
+}
+
+// ====================================================================================================================
+void Heightfield::EvaluateHills(
+    const HeightfieldStreams& streams,
+    uint32                    count,
+    uint32                    maxThreads)
+{
+    EvaluateHills(streams, count, maxThreads, UsesAvx2());
+}
+
+// ====================================================================================================================
+void Heightfield::EvaluateHills(
+    const HeightfieldStreams& streams,
+    uint32                    count,
+    uint32                    maxThreads,
+    bool                      useAvx2)
+{
+    useAvx2 = useAvx2 && UsesAvx2();
+
+    ParallelFor(count, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        if (useAvx2)
+        {
+            EvaluateHillsAvx2(streams, begin, end);
+        }
+        else
+        {
+            EvaluateHillsSse(streams, begin, end);
+        }
+    });
+}
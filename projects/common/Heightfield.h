@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <DirectXMath.h>
+
+using uint32 = std::uint32_t;
+
+// ====================================================================================================================
+// Strided streams for Heightfield::EvaluateHills(). Point them into an interleaved vertex array, e.g.
+//     pX = &v[0].pos.x, pZ = &v[0].pos.z, pHeights = &v[0].pos.y, pNormals = &v[0].normal, all strides sizeof(v[0]),
+// or at separate arrays. Heights or normals may be left null if they are not needed.
+struct HeightfieldStreams
+{
+    const float*       pX           = nullptr;
+    const float*       pZ           = nullptr;
+    uint32             inputStride  = sizeof(float);
+    float*             pHeights     = nullptr;
+    uint32             heightStride = sizeof(float);
+    DirectX::XMFLOAT3* pNormals     = nullptr;
+    uint32             normalStride = sizeof(DirectX::XMFLOAT3);
+};
+
+// ====================================================================================================================
+// The "hills" terrain of the blending and compute shader demos, y = 0.3 * (z * sin(0.1 * x) + x * cos(0.1 * z)).
+// The batch version evaluates 8 (AVX2 + FMA) or 4 (SSE2) vertices at a time with a polynomial sine and cosine, picked
+// at runtime by the CPU, and splits large batches across threads. Results match the scalar functions to about 1e-6
+// relative to the magnitude of the terms.
+class Heightfield
+{
+public:
+    static float             HillsHeight(float x, float z);
+    static DirectX::XMFLOAT3 HillsNormal(float x, float z);
+
+    static void EvaluateHills(const HeightfieldStreams& streams, uint32 count, uint32 maxThreads = 0);
+
+    // Which batch path EvaluateHills() takes on this CPU. useAvx2 = false forces the SSE2 path (for comparisons).
+    static bool UsesAvx2();
+    static void EvaluateHills(const HeightfieldStreams& streams, uint32 count, uint32 maxThreads, bool useAvx2);
+};
@@ -0,0 +1,459 @@
+#include "HeightmapStreamer.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+static const uint32 MinVerticesPerThread = 4 * 1024;
+
+// ====================================================================================================================
+HeightmapStreamer::~HeightmapStreamer()
+{
+    Close();
+}
+
+// ====================================================================================================================
+bool HeightmapStreamer::Open(
+    const std::string& path,
+    uint64             memoryBudget,
+    float              detailRadius)
+{
+    Close();
+
+    if (m_map.Open(path) == false)
+    {
+        return false;
+    }
+
+    const TiledHeightmapHeader& header    = m_map.Header();
+    const uint64                tileBytes = uint64(m_map.TileSampleCount()) * sizeof(uint16);
+    const TiledHeightmapMip&    lastMip   = m_map.Mip(header.mipCount - 1);
+
+    m_tileCount = lastMip.firstTile + 1;
+    m_slotCount = static_cast<uint32>(std::min<uint64>(memoryBudget / tileBytes, m_tileCount));
+    if (m_slotCount < std::min<uint32>(2, m_tileCount))
+    {
+        m_map.Close();
+        return false;
+    }
+
+    m_detailRadius = detailRadius;
+    m_slotSamples.resize(size_t(m_slotCount) * m_map.TileSampleCount());
+    m_tileSlots.reset(new std::atomic<int32>[m_tileCount]);
+    for (uint32 i = 0; i < m_tileCount; ++i)
+    {
+        m_tileSlots[i].store(-1);
+    }
+
+    m_slotTiles.assign(m_slotCount, -1);
+    m_freeSlots.clear();
+    for (uint32 slot = m_slotCount - 1; slot > 0; --slot)
+    {
+        m_freeSlots.push_back(static_cast<int32>(slot));
+    }
+    m_retiredSlots.clear();
+
+    // The coarsest mip is a single tile and stays in slot 0, so every query has something to sample.
+    LoadTile(lastMip.firstTile, header.mipCount - 1, 0);
+
+    m_focus          = XMFLOAT3(0.0f, 0.0f, 0.0f);
+    m_refreshedFrame = 0;
+    m_stop           = false;
+    m_frame.store(0);
+    m_thread = std::thread([this]() { StreamingThread(); });
+
+    return true;
+}
+
+// ====================================================================================================================
+void HeightmapStreamer::Close()
+{
+    if (m_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_one();
+        m_thread.join();
+    }
+
+    m_map.Close();
+    m_slotSamples.clear();
+    m_tileSlots.reset();
+    m_slotTiles.clear();
+    m_freeSlots.clear();
+    m_retiredSlots.clear();
+    m_tileCount = 0;
+    m_slotCount = 0;
+
+    m_residentTiles.store(0);
+    m_pendingTiles.store(0);
+    m_loadCount.store(0);
+    m_evictionCount.store(0);
+}
+
+// ====================================================================================================================
+void HeightmapStreamer::Update(
+    const XMFLOAT3& cameraPos)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_focus = cameraPos;
+        m_frame.fetch_add(1);
+    }
+    m_wake.notify_one();
+}
+
+// ====================================================================================================================
+void HeightmapStreamer::WaitIdle()
+{
+    for (;;)
+    {
+        XMFLOAT3 focus;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            focus = m_focus;
+        }
+
+        // Each frame frees the slots evicted in the previous one, so this may take a few.
+        Update(focus);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        const uint64 frame = m_frame.load();
+        m_idle.wait(lock, [&]() { return m_refreshedFrame >= frame; });
+
+        if (m_pendingTiles.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+// ====================================================================================================================
+HeightmapStreamerStats HeightmapStreamer::Stats() const
+{
+    HeightmapStreamerStats stats;
+    stats.residentTiles = m_residentTiles.load();
+    stats.residentBytes = uint64(stats.residentTiles) * m_map.TileSampleCount() * sizeof(uint16);
+    stats.pendingTiles  = m_pendingTiles.load();
+    stats.loadCount     = m_loadCount.load();
+    stats.evictionCount = m_evictionCount.load();
+    return stats;
+}
+
+// ====================================================================================================================
+void HeightmapStreamer::StreamingThread()
+{
+    for (;;)
+    {
+        XMFLOAT3 focus;
+        uint64   frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_stop || (m_frame.load() != m_refreshedFrame); });
+            if (m_stop)
+            {
+                return;
+            }
+            focus = m_focus;
+            frame = m_frame.load();
+        }
+
+        Refresh(focus, frame);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_refreshedFrame = frame;
+        }
+        m_idle.notify_all();
+    }
+}
+
+// ====================================================================================================================
+// One pass of the streaming thread: rank the resident and the wanted tiles, evict the resident ones that no longer fit
+// in the budget and load the best of the rest into the free slots.
+void HeightmapStreamer::Refresh(
+    const XMFLOAT3& focus,
+    uint64          frame)
+{
+    const TiledHeightmapHeader& header = m_map.Header();
+
+    // Readers that found an evicted slot are done with it once the frame has moved on.
+    for (size_t i = 0; i < m_retiredSlots.size(); )
+    {
+        if (m_frame.load() > m_retiredSlots[i].second)
+        {
+            m_freeSlots.push_back(m_retiredSlots[i].first);
+            m_retiredSlots[i] = m_retiredSlots.back();
+            m_retiredSlots.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    m_candidates.clear();
+
+    for (uint32 slot = 1; slot < m_slotCount; ++slot)
+    {
+        const int32 tile = m_slotTiles[slot];
+        if (tile >= 0)
+        {
+            uint32 mip = 0;
+            while (m_map.Mip(mip + 1).firstTile <= static_cast<uint32>(tile))
+            {
+                ++mip;
+            }
+
+            const TiledHeightmapMip& m     = m_map.Mip(mip);
+            const uint32             index = tile - m.firstTile;
+            m_candidates.push_back({ TilePriority(focus, mip, index % m.tilesX, index / m.tilesX), static_cast<uint32>(tile), mip, true });
+        }
+    }
+
+    // Tiles of every mip are wanted out to the same distance in tiles, so priorities compare across mips.
+    const float maxPriority = m_detailRadius / (header.tileSize * header.sampleSpacing);
+
+    for (uint32 mip = 0; mip + 1 < header.mipCount; ++mip)
+    {
+        const TiledHeightmapMip& m         = m_map.Mip(mip);
+        const float              tileWidth = header.tileSize * m_map.MipSpacing(mip);
+        const float              radius    = maxPriority * tileWidth;
+
+        const int32 x0 = std::max<int32>(0, static_cast<int32>(floorf((focus.x - radius - m_map.MinX()) / tileWidth)));
+        const int32 z0 = std::max<int32>(0, static_cast<int32>(floorf((focus.z - radius - m_map.MinZ()) / tileWidth)));
+        const int32 x1 = std::min<int32>(m.tilesX - 1, static_cast<int32>(floorf((focus.x + radius - m_map.MinX()) / tileWidth)));
+        const int32 z1 = std::min<int32>(m.tilesZ - 1, static_cast<int32>(floorf((focus.z + radius - m_map.MinZ()) / tileWidth)));
+
+        for (int32 tileZ = z0; tileZ <= z1; ++tileZ)
+        {
+            for (int32 tileX = x0; tileX <= x1; ++tileX)
+            {
+                const uint32 tile = m.firstTile + tileZ * m.tilesX + tileX;
+                if (m_tileSlots[tile].load(std::memory_order_relaxed) >= 0)
+                {
+                    continue;
+                }
+
+                const float priority = TilePriority(focus, mip, tileX, tileZ);
+                if (priority <= maxPriority)
+                {
+                    m_candidates.push_back({ priority, tile, mip, false });
+                }
+            }
+        }
+    }
+
+    // Nearest first; on a tie the coarser tile, which covers for the finer ones while they load.
+    std::sort(m_candidates.begin(), m_candidates.end(), [](const Candidate& a, const Candidate& b)
+    {
+        return (a.priority != b.priority) ? (a.priority < b.priority) : (a.mip > b.mip);
+    });
+
+    const size_t keepCount = std::min<size_t>(m_candidates.size(), m_slotCount - 1);
+
+    for (size_t i = keepCount; i < m_candidates.size(); ++i)
+    {
+        const Candidate& c = m_candidates[i];
+        if (c.resident)
+        {
+            const int32 slot = m_tileSlots[c.tile].load(std::memory_order_relaxed);
+            m_tileSlots[c.tile].store(-1);
+            m_slotTiles[slot] = -1;
+            m_retiredSlots.push_back(std::make_pair(slot, m_frame.load()));
+
+            m_residentTiles.fetch_sub(1);
+            m_evictionCount.fetch_add(1);
+        }
+    }
+
+    uint32 pending = 0;
+    for (size_t i = 0; i < keepCount; ++i)
+    {
+        pending += m_candidates[i].resident ? 0 : 1;
+    }
+
+    for (size_t i = 0; (i < keepCount) && (m_freeSlots.empty() == false); ++i)
+    {
+        const Candidate& c = m_candidates[i];
+        if (c.resident == false)
+        {
+            const int32 slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+
+            LoadTile(c.tile, c.mip, slot);
+            m_pendingTiles.store(--pending);
+
+            // Start over with the new position rather than finish loading around the old one.
+            if (m_frame.load() != frame)
+            {
+                break;
+            }
+        }
+    }
+
+    m_pendingTiles.store(pending);
+}
+
+// ====================================================================================================================
+void HeightmapStreamer::LoadTile(
+    uint32 tile,
+    uint32 mip,
+    int32  slot)
+{
+    const TiledHeightmapMip& m     = m_map.Mip(mip);
+    const uint32             index = tile - m.firstTile;
+    const uint32             count = m_map.TileSampleCount();
+
+    // The copy is where the pages of the mapping are actually read.
+    memcpy(&m_slotSamples[size_t(slot) * count], m_map.TileSamples(mip, index % m.tilesX, index / m.tilesX), count * sizeof(uint16));
+
+    m_slotTiles[slot] = static_cast<int32>(tile);
+    m_tileSlots[tile].store(slot, std::memory_order_release);
+
+    m_residentTiles.fetch_add(1);
+    m_loadCount.fetch_add(1);
+}
+
+// ====================================================================================================================
+// Distance from the focus to the tile's bounding box, in tile widths of the tile's mip.
+float HeightmapStreamer::TilePriority(
+    const XMFLOAT3& focus,
+    uint32          mip,
+    uint32          tileX,
+    uint32          tileZ) const
+{
+    const TiledHeightmapTile& tile      = m_map.Tile(mip, tileX, tileZ);
+    const float               tileWidth = m_map.Header().tileSize * m_map.MipSpacing(mip);
+    const float               x0        = m_map.MinX() + tileX * tileWidth;
+    const float               z0        = m_map.MinZ() + tileZ * tileWidth;
+
+    const float dx = std::max<float>(std::max<float>(x0 - focus.x, 0.0f), focus.x - (x0 + tileWidth));
+    const float dy = std::max<float>(std::max<float>(tile.minHeight - focus.y, 0.0f), focus.y - tile.maxHeight);
+    const float dz = std::max<float>(std::max<float>(z0 - focus.z, 0.0f), focus.z - (z0 + tileWidth));
+
+    return sqrtf(dx * dx + dy * dy + dz * dz) / tileWidth;
+}
+
+// ====================================================================================================================
+// Bilinear height in the given mip, false if the tile under the point is not resident.
+bool HeightmapStreamer::SampleMip(
+    uint32 mip,
+    float  x,
+    float  z,
+    float& height) const
+{
+    const TiledHeightmapHeader& header   = m_map.Header();
+    const TiledHeightmapMip&    m        = m_map.Mip(mip);
+    const uint32                tileSize = header.tileSize;
+    const float                 spacing  = m_map.MipSpacing(mip);
+
+    // Points off the map clamp to its edge.
+    const float u = std::min<float>(std::max<float>((x - m_map.MinX()) / spacing, 0.0f), static_cast<float>(m.width - 1));
+    const float v = std::min<float>(std::max<float>((z - m_map.MinZ()) / spacing, 0.0f), static_cast<float>(m.height - 1));
+
+    const uint32 tileX = std::min<uint32>(static_cast<uint32>(u) / tileSize, m.tilesX - 1);
+    const uint32 tileZ = std::min<uint32>(static_cast<uint32>(v) / tileSize, m.tilesZ - 1);
+    const int32  slot  = m_tileSlots[m.firstTile + tileZ * m.tilesX + tileX].load(std::memory_order_acquire);
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    const float  localU = u - static_cast<float>(tileX * tileSize);
+    const float  localV = v - static_cast<float>(tileZ * tileSize);
+    const uint32 j      = std::min<uint32>(static_cast<uint32>(localU), tileSize - 1);
+    const uint32 i      = std::min<uint32>(static_cast<uint32>(localV), tileSize - 1);
+    const float  s      = localU - j;
+    const float  t      = localV - i;
+
+    const uint16* pSamples = &m_slotSamples[size_t(slot) * m_map.TileSampleCount() + i * (tileSize + 1) + j];
+    const float   h0       = pSamples[0] + (pSamples[1] - pSamples[0]) * s;
+    const float   h1       = pSamples[tileSize + 1] + (pSamples[tileSize + 2] - pSamples[tileSize + 1]) * s;
+
+    height = header.heightOffset + header.heightScale * (h0 + (h1 - h0) * t);
+    return true;
+}
+
+// ====================================================================================================================
+float HeightmapStreamer::SampleFrom(
+    uint32 mip,
+    float  x,
+    float  z) const
+{
+    float height = 0.0f;
+    while (SampleMip(mip, x, z, height) == false)
+    {
+        ++mip;
+    }
+    return height;
+}
+
+// ====================================================================================================================
+uint32 HeightmapStreamer::ResidentMip(
+    float x,
+    float z) const
+{
+    float  height = 0.0f;
+    uint32 mip    = 0;
+    while (SampleMip(mip, x, z, height) == false)
+    {
+        ++mip;
+    }
+    return mip;
+}
+
+// ====================================================================================================================
+float HeightmapStreamer::Height(
+    float x,
+    float z) const
+{
+    return SampleFrom(0, x, z);
+}
+
+// ====================================================================================================================
+XMFLOAT3 HeightmapStreamer::Normal(
+    float x,
+    float z) const
+{
+    const uint32 mip     = ResidentMip(x, z);
+    const float  spacing = m_map.MipSpacing(mip);
+
+    const float left  = SampleFrom(mip, x - spacing, z);
+    const float right = SampleFrom(mip, x + spacing, z);
+    const float back  = SampleFrom(mip, x, z - spacing);
+    const float front = SampleFrom(mip, x, z + spacing);
+
+    XMFLOAT3 n(left - right, 2.0f * spacing, back - front);
+    XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+    return n;
+}
+
+// ====================================================================================================================
+void HeightmapStreamer::Evaluate(
+    const HeightfieldStreams& streams,
+    uint32                    count,
+    uint32                    maxThreads) const
+{
+    ParallelFor(count, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 k = begin; k < end; ++k)
+        {
+            const float x = *reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(streams.pX) + size_t(k) * streams.inputStride);
+            const float z = *reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(streams.pZ) + size_t(k) * streams.inputStride);
+
+            if (streams.pHeights != nullptr)
+            {
+                *reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(streams.pHeights) + size_t(k) * streams.heightStride) = Height(x, z);
+            }
+            if (streams.pNormals != nullptr)
+            {
+                *reinterpret_cast<XMFLOAT3*>(reinterpret_cast<uint8_t*>(streams.pNormals) + size_t(k) * streams.normalStride) = Normal(x, z);
+            }
+        }
+    });
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <DirectXMath.h>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "Heightfield.h"
+#include "TiledHeightmap.h"
+
+using int32 = std::int32_t;
+
+// ====================================================================================================================
+struct HeightmapStreamerStats
+{
+    uint32 residentTiles = 0; // Including the pinned coarsest mip
+    uint64 residentBytes = 0;
+    uint32 pendingTiles  = 0; // Wanted around the last focus but not loaded yet
+    uint64 loadCount     = 0;
+    uint64 evictionCount = 0;
+};
+
+// ====================================================================================================================
+// Pages the tiles of a TiledHeightmap in and out around the camera on a background thread, within a fixed budget of
+// tile memory allocated at Open(). Tiles of mip m are wanted within detailRadius * 2^m of the camera, nearest (in
+// tile sizes) first; tiles that are no longer wanted stay resident until their slot is needed for a better one.
+//
+// Queries never block and never touch the file: they sample the finest resident mip at the point, and the coarsest
+// mip is pinned so there is always one. They are lock free and may run on the thread that calls Update() and on
+// threads it joins before the next Update() (e.g. inside ParallelFor()); an evicted slot is only reused once Update()
+// has moved on to the next frame.
+class HeightmapStreamer
+{
+public:
+    HeightmapStreamer() {}
+    ~HeightmapStreamer();
+
+    HeightmapStreamer(const HeightmapStreamer&) = delete;
+    HeightmapStreamer& operator=(const HeightmapStreamer&) = delete;
+
+    // Returns false if the file is not a valid heightmap or the budget does not hold the pinned tile and one more.
+    bool Open(const std::string& path, uint64 memoryBudget, float detailRadius);
+    void Close();
+
+    // Once per frame, before the frame's queries. Only hands the position to the streaming thread.
+    void Update(const DirectX::XMFLOAT3& cameraPos);
+
+    // Blocks until every tile wanted around the last camera position is resident, for loading screens and tests.
+    // Advances frames itself, so it must be called from the thread that calls Update().
+    void WaitIdle();
+
+    // Same queries as the procedural terrains (see Heightfield), bilinear in the finest resident mip. Normals use
+    // central differences at that mip's sample spacing.
+    float             Height(float x, float z) const;
+    DirectX::XMFLOAT3 Normal(float x, float z) const;
+    void              Evaluate(const HeightfieldStreams& streams, uint32 count, uint32 maxThreads = 0) const;
+
+    // Finest mip resident at the point.
+    uint32 ResidentMip(float x, float z) const;
+
+    const TiledHeightmap&  Map() const { return m_map; }
+    HeightmapStreamerStats Stats() const;
+
+private:
+    struct Candidate
+    {
+        float  priority;
+        uint32 tile;
+        uint32 mip;
+        bool   resident;
+    };
+
+    void  StreamingThread();
+    void  Refresh(const DirectX::XMFLOAT3& focus, uint64 frame);
+    void  LoadTile(uint32 tile, uint32 mip, int32 slot);
+    float TilePriority(const DirectX::XMFLOAT3& focus, uint32 mip, uint32 tileX, uint32 tileZ) const;
+    bool  SampleMip(uint32 mip, float x, float z, float& height) const;
+    float SampleFrom(uint32 mip, float x, float z) const;
+
+    TiledHeightmap m_map;
+    float          m_detailRadius = 0.0f;
+    uint32         m_tileCount    = 0;
+    uint32         m_slotCount    = 0;
+
+    // Tile data, one TileSampleCount() sized slot per resident tile. Slot 0 holds the coarsest mip.
+    std::vector<uint16>                   m_slotSamples;
+    std::unique_ptr<std::atomic<int32>[]> m_tileSlots; // Per tile (TiledHeightmapTile order), -1 if not resident
+
+    // Owned by the streaming thread.
+    std::vector<int32>                    m_slotTiles; // Per slot, -1 if free or retired
+    std::vector<int32>                    m_freeSlots;
+    std::vector<std::pair<int32, uint64>> m_retiredSlots; // Slot and the frame it was evicted in
+    std::vector<Candidate>                m_candidates;
+
+    std::thread             m_thread;
+    std::mutex              m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+    DirectX::XMFLOAT3       m_focus;
+    uint64                  m_refreshedFrame = 0;
+    bool                    m_stop           = false;
+
+    std::atomic<uint64> m_frame{ 0 };
+    std::atomic<uint32> m_residentTiles{ 0 };
+    std::atomic<uint32> m_pendingTiles{ 0 };
+    std::atomic<uint64> m_loadCount{ 0 };
+    std::atomic<uint64> m_evictionCount{ 0 };
+};
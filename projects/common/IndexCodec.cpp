@@ -0,0 +1,340 @@
+#include "IndexCodec.h"
+#include <cassert>
+
+static const uint32  InvalidIndex  = 0xffffffff;
+static const uint8_t FormatVersion = 0xe1;
+
+static const uint32 FifoSize       = 16;  // Power of two
+static const uint32 NoEdgeCode     = 15;  // High nibble: no recent edge matched
+static const uint32 NextVertexCode = 0;   // Low nibble / vertex code: the next unused vertex
+static const uint32 ExplicitCode   = 15;  // Vertex code: zigzag varint delta follows
+static const uint32 VertexFifoHits = 14;  // Vertex codes 1..14 address the vertex FIFO
+
+// ====================================================================================================================
+// Coding state. Encoder and decoder run the same updates in the same order, so both sides always agree on it.
+struct CodecState
+{
+    uint32 edgeA[FifoSize];
+    uint32 edgeB[FifoSize];
+    uint32 vertices[FifoSize];
+    uint32 edgeHead   = 0;
+    uint32 vertexHead = 0;
+    uint32 next       = 0; // Lowest vertex not referenced yet, assuming vertices appear in first-use order
+    uint32 last       = 0; // Base for explicit deltas
+
+    CodecState()
+    {
+        for (uint32 i = 0; i < FifoSize; ++i)
+        {
+            edgeA[i]    = InvalidIndex;
+            edgeB[i]    = InvalidIndex;
+            vertices[i] = InvalidIndex;
+        }
+    }
+
+    void PushEdge(uint32 a, uint32 b)
+    {
+        edgeA[edgeHead & (FifoSize - 1)] = a;
+        edgeB[edgeHead & (FifoSize - 1)] = b;
+        edgeHead++;
+    }
+
+    void PushVertex(uint32 v)
+    {
+        vertices[vertexHead & (FifoSize - 1)] = v;
+        vertexHead++;
+    }
+
+    // 0 is the most recently pushed entry.
+    uint32 EdgeA(uint32 i) const  { return edgeA[(edgeHead - 1 - i) & (FifoSize - 1)]; }
+    uint32 EdgeB(uint32 i) const  { return edgeB[(edgeHead - 1 - i) & (FifoSize - 1)]; }
+    uint32 Vertex(uint32 i) const { return vertices[(vertexHead - 1 - i) & (FifoSize - 1)]; }
+
+    // Edges a neighbouring triangle would walk in the opposite direction. The shared edge of an edge coded triangle
+    // has been used up and is not pushed again.
+    void PushTriangle(uint32 a, uint32 b, uint32 c, bool sharedEdge)
+    {
+        if (sharedEdge == false)
+        {
+            PushEdge(b, a);
+        }
+        PushEdge(c, b);
+        PushEdge(a, c);
+    }
+};
+
+// ====================================================================================================================
+static void WriteVarint(
+    std::vector<uint8_t>& out,
+    uint32                value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// ====================================================================================================================
+static bool ReadVarint(
+    const uint8_t*& p,
+    const uint8_t*  end,
+    uint32&         value)
+{
+    value = 0;
+    for (uint32 shift = 0; shift < 35; shift += 7)
+    {
+        if (p == end)
+        {
+            return false;
+        }
+
+        const uint8_t byte = *p++;
+        value |= static_cast<uint32>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ====================================================================================================================
+// Returns the vertex code of v and updates the state. Explicit vertices leave their zigzag delta in pDelta.
+static uint32 EncodeVertex(
+    CodecState& state,
+    uint32      v,
+    uint32*     pDelta)
+{
+    if (v == state.next)
+    {
+        state.next++;
+        state.PushVertex(v);
+        return NextVertexCode;
+    }
+
+    for (uint32 i = 0; i < VertexFifoHits; ++i)
+    {
+        if (state.Vertex(i) == v)
+        {
+            return i + 1;
+        }
+    }
+
+    const int32_t delta = static_cast<int32_t>(v - state.last);
+    *pDelta    = (static_cast<uint32>(delta) << 1) ^ static_cast<uint32>(delta >> 31);
+    state.last = v;
+    state.PushVertex(v);
+    return ExplicitCode;
+}
+
+// ====================================================================================================================
+static bool DecodeVertex(
+    CodecState&     state,
+    uint32          code,
+    const uint8_t*& p,
+    const uint8_t*  end,
+    uint32&         v)
+{
+    if (code == NextVertexCode)
+    {
+        v = state.next++;
+        state.PushVertex(v);
+        return true;
+    }
+
+    if (code != ExplicitCode)
+    {
+        v = state.Vertex(code - 1);
+        return v != InvalidIndex;
+    }
+
+    uint32 zigzag;
+    if (ReadVarint(p, end, zigzag) == false)
+    {
+        return false;
+    }
+
+    v          = state.last + ((zigzag >> 1) ^ (0u - (zigzag & 1)));
+    state.last = v;
+    state.PushVertex(v);
+    return true;
+}
+
+// ====================================================================================================================
+template<typename IndexT>
+static bool DecodeIndices(
+    IndexT*        pDst,
+    size_t         indexCount,
+    const uint8_t* pSrc,
+    size_t         srcSize)
+{
+    if ((indexCount % 3 != 0) || (srcSize < 1) || (pSrc[0] != FormatVersion))
+    {
+        return false;
+    }
+
+    CodecState     state;
+    const uint8_t* p        = pSrc + 1;
+    const uint8_t* end      = pSrc + srcSize;
+    const uint32   maxIndex = static_cast<IndexT>(~0u); // Larger indices do not fit the destination
+
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        if (p == end)
+        {
+            return false;
+        }
+
+        const uint32 code = *p++;
+        const uint32 edge = code >> 4;
+
+        uint32 a;
+        uint32 b;
+        uint32 c;
+
+        if (edge != NoEdgeCode)
+        {
+            a = state.EdgeA(edge);
+            b = state.EdgeB(edge);
+            if ((a == InvalidIndex) || (DecodeVertex(state, code & 15, p, end, c) == false))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            if (end - p < 2)
+            {
+                return false;
+            }
+
+            const uint32 codesAB = *p++;
+            const uint32 codesC  = *p++;
+
+            if ((DecodeVertex(state, codesAB >> 4, p, end, a) == false) ||
+                (DecodeVertex(state, codesAB & 15, p, end, b) == false) ||
+                (DecodeVertex(state, codesC >> 4, p, end, c) == false))
+            {
+                return false;
+            }
+        }
+
+        if ((a > maxIndex) || (b > maxIndex) || (c > maxIndex))
+        {
+            return false;
+        }
+
+        pDst[i + 0] = static_cast<IndexT>(a);
+        pDst[i + 1] = static_cast<IndexT>(b);
+        pDst[i + 2] = static_cast<IndexT>(c);
+
+        state.PushTriangle(a, b, c, edge != NoEdgeCode);
+    }
+
+    return p == end;
+}
+
+// ====================================================================================================================
+std::vector<uint8_t> IndexCodec::Encode(
+    const uint32* pIndices,
+    size_t        indexCount)
+{
+    assert(indexCount % 3 == 0);
+
+    std::vector<uint8_t> out;
+    out.reserve(1 + indexCount / 2);
+    out.push_back(FormatVersion);
+
+    CodecState state;
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        const uint32* pTri = &pIndices[i];
+
+        // Most recent matching edge over the three rotations of the triangle.
+        uint32 edge     = NoEdgeCode;
+        uint32 rotation = 0;
+        for (uint32 e = 0; (e < NoEdgeCode) && (edge == NoEdgeCode); ++e)
+        {
+            for (uint32 r = 0; r < 3; ++r)
+            {
+                if ((state.EdgeA(e) == pTri[r]) && (state.EdgeB(e) == pTri[(r + 1) % 3]))
+                {
+                    edge     = e;
+                    rotation = r;
+                    break;
+                }
+            }
+        }
+
+        const uint32 a = pTri[rotation];
+        const uint32 b = pTri[(rotation + 1) % 3];
+        const uint32 c = pTri[(rotation + 2) % 3];
+
+        if (edge != NoEdgeCode)
+        {
+            uint32       delta = 0;
+            const uint32 code  = EncodeVertex(state, c, &delta);
+
+            out.push_back(static_cast<uint8_t>((edge << 4) | code));
+            if (code == ExplicitCode)
+            {
+                WriteVarint(out, delta);
+            }
+        }
+        else
+        {
+            uint32       deltas[3] = {};
+            const uint32 codeA     = EncodeVertex(state, a, &deltas[0]);
+            const uint32 codeB     = EncodeVertex(state, b, &deltas[1]);
+            const uint32 codeC     = EncodeVertex(state, c, &deltas[2]);
+            const uint32 codes[3]  = { codeA, codeB, codeC };
+
+            out.push_back(static_cast<uint8_t>(NoEdgeCode << 4));
+            out.push_back(static_cast<uint8_t>((codeA << 4) | codeB));
+            out.push_back(static_cast<uint8_t>(codeC << 4));
+
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                if (codes[k] == ExplicitCode)
+                {
+                    WriteVarint(out, deltas[k]);
+                }
+            }
+        }
+
+        state.PushTriangle(a, b, c, edge != NoEdgeCode);
+    }
+
+    return out;
+}
+
+// ====================================================================================================================
+std::vector<uint8_t> IndexCodec::Encode(
+    const MeshData& meshData)
+{
+    return Encode(meshData.m_indices32.data(), meshData.m_indices32.size());
+}
+
+// ====================================================================================================================
+bool IndexCodec::Decode(
+    uint32*        pDst,
+    size_t         indexCount,
+    const uint8_t* pSrc,
+    size_t         srcSize)
+{
+    return DecodeIndices(pDst, indexCount, pSrc, srcSize);
+}
+
+// ====================================================================================================================
+bool IndexCodec::Decode(
+    uint16*        pDst,
+    size_t         indexCount,
+    const uint8_t* pSrc,
+    size_t         srcSize)
+{
+    return DecodeIndices(pDst, indexCount, pSrc, srcSize);
+}
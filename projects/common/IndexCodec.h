@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Lossless compression of triangle list index buffers.
+// Every triangle is coded against two small FIFOs of recently seen edges and vertices, so a mesh that went through
+// MeshOptimizer::Optimize() (cache order, then vertex fetch order) mostly takes a single byte per triangle:
+//  - high nibble 0..14: the triangle shares that recent edge, the low nibble says where the third vertex comes from:
+//    0 = the next unused vertex, 1..14 = a recent vertex, 15 = an explicit zigzag varint delta that follows.
+//  - high nibble 15: no shared edge, two bytes with a 4 bit code per vertex follow (same meaning as above).
+// Triangles may come back rotated (a, b, c) -> (b, c, a), which keeps their winding.
+class IndexCodec
+{
+public:
+    static std::vector<uint8_t> Encode(const uint32* pIndices, size_t indexCount);
+    static std::vector<uint8_t> Encode(const MeshData& meshData);
+
+    // Decode straight into the destination, e.g. a mapped upload buffer. Returns false if the data is malformed or
+    // does not hold indexCount indices. The 16 bit variant also returns false if an index is above 0xFFFF.
+    static bool Decode(uint32* pDst, size_t indexCount, const uint8_t* pSrc, size_t srcSize);
+    static bool Decode(uint16* pDst, size_t indexCount, const uint8_t* pSrc, size_t srcSize);
+};
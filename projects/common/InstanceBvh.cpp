@@ -0,0 +1,363 @@
+#include "InstanceBvh.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+using NodeVector = std::vector<InstanceBvhNode, AlignedAllocator<InstanceBvhNode, 32>>;
+
+static const uint32 BinCount             = 16;
+static const float  TraversalCost        = 4.0f;      // A node test and its stack work, relative to one sphere test
+static const uint32 MaxSahDepth          = 64;        // Deeper nodes are split at the median, which bounds the depth
+static const uint32 StackSize            = 128;       // MaxSahDepth plus median splits of 2^32 instances, plus 1
+static const uint32 MinParallelInstances = 16 * 1024; // Smaller subtrees are built on the thread that reached them
+static const uint32 AllPlanes            = (1 << Frustum::PlaneCount) - 1;
+
+// ====================================================================================================================
+// Axis aligned box in SSE registers, w ignored.
+struct BvhBox
+{
+    __m128 minimum = _mm_set1_ps(FLT_MAX);
+    __m128 maximum = _mm_set1_ps(-FLT_MAX);
+
+    void Grow(
+        __m128 pointMin,
+        __m128 pointMax)
+    {
+        minimum = _mm_min_ps(minimum, pointMin);
+        maximum = _mm_max_ps(maximum, pointMax);
+    }
+
+    void Grow(const BvhBox& box) { Grow(box.minimum, box.maximum); }
+
+    // Center and radius in x, y, z and w.
+    void GrowSphere(
+        __m128 sphere)
+    {
+        const __m128 radius = _mm_shuffle_ps(sphere, sphere, _MM_SHUFFLE(3, 3, 3, 3));
+        Grow(_mm_sub_ps(sphere, radius), _mm_add_ps(sphere, radius));
+    }
+
+    void Store(
+        float* pMin,
+        float* pMax) const
+    {
+        alignas(16) float values[8];
+        _mm_store_ps(values, minimum);
+        _mm_store_ps(values + 4, maximum);
+        memcpy(pMin, values, 3 * sizeof(float));
+        memcpy(pMax, values + 4, 3 * sizeof(float));
+    }
+
+    // Half the surface area, which is all the SAH needs.
+    float HalfArea() const
+    {
+        alignas(16) float size[4];
+        _mm_store_ps(size, _mm_sub_ps(maximum, minimum));
+        return (size[0] >= 0.0f) ? size[0] * size[1] + size[1] * size[2] + size[2] * size[0] : 0.0f;
+    }
+};
+
+// ====================================================================================================================
+// Instances are partitioned together with their spheres, so the build reads them in order at every level.
+struct BvhPrimitive
+{
+    XMFLOAT4 sphere; // Center and radius
+    uint32   instance;
+};
+
+// ====================================================================================================================
+struct BvhBuilder
+{
+    BvhPrimitive* pPrimitives;
+    uint32        parallelDepth;
+
+    // Returns the split position in [begin, end), or begin if the node should be a leaf.
+    uint32 Split(
+        uint32        begin,
+        uint32        end,
+        uint32        depth,
+        const BvhBox& box,
+        const BvhBox& centers) const
+    {
+        const uint32 count = end - begin;
+        if (count <= 1)
+        {
+            return begin;
+        }
+
+        float centerMin[3];
+        float centerMax[3];
+        centers.Store(centerMin, centerMax);
+
+        uint32 axis = 0;
+        for (uint32 a = 1; a < 3; ++a)
+        {
+            if (centerMax[a] - centerMin[a] > centerMax[axis] - centerMin[axis])
+            {
+                axis = a;
+            }
+        }
+
+        const float extent = centerMax[axis] - centerMin[axis];
+        if ((extent > 0.0f) && (depth < MaxSahDepth))
+        {
+            BvhBox bins[BinCount];
+            uint32 binCounts[BinCount] = {};
+            const float scale = BinCount * 0.9999f / extent;
+            auto Bin = [&](const BvhPrimitive& primitive)
+            {
+                return std::min<uint32>(BinCount - 1, static_cast<uint32>(((&primitive.sphere.x)[axis] - centerMin[axis]) * scale));
+            };
+
+            for (uint32 i = begin; i < end; ++i)
+            {
+                const uint32 bin = Bin(pPrimitives[i]);
+                bins[bin].GrowSphere(_mm_loadu_ps(&pPrimitives[i].sphere.x));
+                ++binCounts[bin];
+            }
+
+            // Cost of splitting after bin b: the areas and counts of both sides, right sides swept first.
+            float  rightCosts[BinCount];
+            BvhBox right;
+            uint32 rightCount = 0;
+            for (uint32 b = BinCount - 1; b > 0; --b)
+            {
+                right.Grow(bins[b]);
+                rightCount       += binCounts[b];
+                rightCosts[b - 1] = right.HalfArea() * rightCount;
+            }
+
+            float  bestCost = FLT_MAX;
+            uint32 bestBin  = 0;
+            BvhBox left;
+            uint32 leftCount = 0;
+            for (uint32 b = 0; b + 1 < BinCount; ++b)
+            {
+                left.Grow(bins[b]);
+                leftCount += binCounts[b];
+
+                const float cost = left.HalfArea() * leftCount + rightCosts[b];
+                if ((leftCount > 0) && (leftCount < count) && (cost < bestCost))
+                {
+                    bestCost = cost;
+                    bestBin  = b;
+                }
+            }
+
+            if (bestCost < FLT_MAX)
+            {
+                const float splitCost = TraversalCost + bestCost / std::max<float>(box.HalfArea(), FLT_MIN);
+                if ((count <= InstanceBvh::MaxLeafSize) && (splitCost >= float(count)))
+                {
+                    return begin;
+                }
+                return static_cast<uint32>(std::partition(pPrimitives + begin, pPrimitives + end,
+                                                          [&](const BvhPrimitive& primitive) { return Bin(primitive) <= bestBin; }) - pPrimitives);
+            }
+        }
+
+        // All centers in one bin, or too deep: halve by count.
+        if (count <= InstanceBvh::MaxLeafSize)
+        {
+            return begin;
+        }
+        const uint32 mid = begin + count / 2;
+        std::nth_element(pPrimitives + begin, pPrimitives + mid, pPrimitives + end, [&](const BvhPrimitive& a, const BvhPrimitive& b)
+        {
+            return (&a.sphere.x)[axis] < (&b.sphere.x)[axis];
+        });
+        return mid;
+    }
+
+    void Build(
+        uint32      begin,
+        uint32      end,
+        uint32      depth,
+        NodeVector& nodes) const
+    {
+        BvhBox box;
+        BvhBox centers;
+        for (uint32 i = begin; i < end; ++i)
+        {
+            const __m128 sphere = _mm_loadu_ps(&pPrimitives[i].sphere.x);
+            box.GrowSphere(sphere);
+            centers.Grow(sphere, sphere);
+        }
+
+        float boxMin[3];
+        float boxMax[3];
+        box.Store(boxMin, boxMax);
+
+        const uint32 nodeIndex = static_cast<uint32>(nodes.size());
+        InstanceBvhNode node;
+        node.center        = XMFLOAT3(0.5f * (boxMin[0] + boxMax[0]), 0.5f * (boxMin[1] + boxMax[1]), 0.5f * (boxMin[2] + boxMax[2]));
+        node.extents       = XMFLOAT3(0.5f * (boxMax[0] - boxMin[0]), 0.5f * (boxMax[1] - boxMin[1]), 0.5f * (boxMax[2] - boxMin[2]));
+        node.rightChild    = 0;
+        node.instanceCount = end - begin;
+        nodes.push_back(node);
+
+        const uint32 mid = Split(begin, end, depth, box, centers);
+        if (mid == begin)
+        {
+            return;
+        }
+
+        if ((depth < parallelDepth) && (end - begin >= MinParallelInstances))
+        {
+            NodeVector children[2];
+            ParallelFor(2, 1, 2, [&](uint32 first, uint32 last)
+            {
+                for (uint32 c = first; c < last; ++c)
+                {
+                    Build((c == 0) ? begin : mid, (c == 0) ? mid : end, depth + 1, children[c]);
+                }
+            });
+
+            nodes.insert(nodes.end(), children[0].begin(), children[0].end());
+            nodes[nodeIndex].rightChild = 1 + static_cast<uint32>(children[0].size());
+            nodes.insert(nodes.end(), children[1].begin(), children[1].end());
+        }
+        else
+        {
+            Build(begin, mid, depth + 1, nodes);
+            nodes[nodeIndex].rightChild = static_cast<uint32>(nodes.size()) - nodeIndex;
+            Build(mid, end, depth + 1, nodes);
+        }
+    }
+};
+
+// ====================================================================================================================
+void InstanceBvh::Build(
+    const InstanceBounds& bounds,
+    uint32                maxThreads)
+{
+    const uint32 count = bounds.Count();
+
+    std::vector<BvhPrimitive> primitives(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        primitives[i].sphere   = XMFLOAT4(bounds.m_centerX[i], bounds.m_centerY[i], bounds.m_centerZ[i], bounds.m_radius[i]);
+        primitives[i].instance = i;
+    }
+
+    // Each level below the root doubles the threads, up to maxThreads.
+    if (maxThreads == 0)
+    {
+        maxThreads = DefaultThreadCount();
+    }
+    uint32 parallelDepth = 0;
+    while ((1u << parallelDepth) < maxThreads)
+    {
+        ++parallelDepth;
+    }
+
+    m_nodes.clear();
+    if (count > 0)
+    {
+        const BvhBuilder builder = { primitives.data(), parallelDepth };
+        builder.Build(0, count, 0, m_nodes);
+    }
+
+    m_instances.resize(count);
+    m_spheres.resize(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        m_instances[i] = primitives[i].instance;
+        m_spheres[i]   = primitives[i].sphere;
+    }
+}
+
+// ====================================================================================================================
+uint32 InstanceBvh::Cull(
+    const Frustum& frustum,
+    uint32*        pVisible) const
+{
+    struct Entry
+    {
+        uint32 node;
+        uint32 firstInstance;
+        uint32 planes; // Bit p set while the node may still cross plane p
+    };
+
+    if (m_nodes.empty())
+    {
+        return 0;
+    }
+
+    // |normal| turns the box extents into its projected radius on the plane normal.
+    XMFLOAT3 absNormals[Frustum::PlaneCount];
+    for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+    {
+        absNormals[p] = XMFLOAT3(fabsf(frustum.planes[p].x), fabsf(frustum.planes[p].y), fabsf(frustum.planes[p].z));
+    }
+
+    Entry  stack[StackSize];
+    uint32 stackSize = 0;
+    uint32 count     = 0;
+    stack[stackSize++] = { 0, 0, AllPlanes };
+
+    while (stackSize > 0)
+    {
+        const Entry            entry   = stack[--stackSize];
+        const InstanceBvhNode& node    = m_nodes[entry.node];
+        uint32                 planes  = entry.planes;
+        bool                   outside = false;
+
+        for (uint32 p = 0; (p < Frustum::PlaneCount) && (outside == false); ++p)
+        {
+            if ((planes & (1 << p)) != 0)
+            {
+                const XMFLOAT4& plane  = frustum.planes[p];
+                const float     d      = plane.x * node.center.x + plane.y * node.center.y + plane.z * node.center.z + plane.w;
+                const float     radius = absNormals[p].x * node.extents.x + absNormals[p].y * node.extents.y + absNormals[p].z * node.extents.z;
+
+                outside = (d + radius < 0.0f);
+                planes  = (d - radius >= 0.0f) ? (planes & ~(1u << p)) : planes;
+            }
+        }
+
+        if (outside)
+        {
+            continue;
+        }
+
+        if (planes == 0)
+        {
+            memcpy(pVisible + count, m_instances.data() + entry.firstInstance, node.instanceCount * sizeof(uint32));
+            count += node.instanceCount;
+        }
+        else if (node.rightChild == 0)
+        {
+            // Same operation order as FrustumCuller::IsVisible(), every slot written, the count advanced if visible.
+            for (uint32 i = entry.firstInstance; i < entry.firstInstance + node.instanceCount; ++i)
+            {
+                const XMFLOAT4& s       = m_spheres[i];
+                uint32          visible = 1;
+                for (uint32 p = 0; p < Frustum::PlaneCount; ++p)
+                {
+                    const XMFLOAT4& plane = frustum.planes[p];
+                    float           d     = plane.w + s.w;
+                    d += plane.x * s.x;
+                    d += plane.y * s.y;
+                    d += plane.z * s.z;
+                    visible &= (((planes & (1 << p)) == 0) || (d >= 0.0f)) ? 1 : 0;
+                }
+                pVisible[count] = m_instances[i];
+                count += visible;
+            }
+        }
+        else
+        {
+            const uint32 leftCount = m_nodes[entry.node + 1].instanceCount;
+            stack[stackSize++] = { entry.node + node.rightChild, entry.firstInstance + leftCount, planes };
+            stack[stackSize++] = { entry.node + 1, entry.firstInstance, planes };
+        }
+    }
+
+    return count;
+}
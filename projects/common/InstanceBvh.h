@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "AlignedAllocator.h"
+#include "FrustumCulling.h"
+
+// ====================================================================================================================
+// One node of an InstanceBvh, 32 bytes. Nodes are stored depth first, so the left child of node i is node i + 1, and
+// the instances below a node are one contiguous range of InstanceBvh::Instances(): the left child's range starts where
+// the parent's does, the right child's follows it.
+struct InstanceBvhNode
+{
+    DirectX::XMFLOAT3 center;        // Axis aligned box of all instance spheres below the node
+    uint32            rightChild;    // Offset from this node to its right child, 0 for leaves
+    DirectX::XMFLOAT3 extents;
+    uint32            instanceCount; // Instances below the node
+};
+
+// ====================================================================================================================
+// Bounding volume hierarchy over the spheres of a static set of instances for hierarchical frustum culling.
+//
+// Build() splits nodes with the binned surface area heuristic (16 bins on the axis along which the sphere centers
+// spread most, Wald 2007) and builds the two halves of large nodes on separate threads. Cull() walks the tree with the
+// planes a node still straddles: subtrees outside one plane are skipped, subtrees inside all of them are accepted with
+// one copy of their instance range and no further tests, and only the spheres of leaves that cross the frustum are
+// tested. The visible set is that of FrustumCuller::Cull() (up to rounding for spheres touching a plane), but in tree
+// order rather than sorted.
+class InstanceBvh
+{
+public:
+    static const uint32 MaxLeafSize = 8;
+
+    // The bounds are copied, in tree order; changing them afterwards needs a new Build().
+    void Build(const InstanceBounds& bounds, uint32 maxThreads = 0);
+
+    uint32 InstanceCount() const { return static_cast<uint32>(m_instances.size()); }
+    uint32 NodeCount() const { return static_cast<uint32>(m_nodes.size()); }
+
+    const InstanceBvhNode* Nodes() const { return m_nodes.data(); }
+
+    // Instance indices in tree order.
+    const std::vector<uint32>& Instances() const { return m_instances; }
+
+    // Instance spheres (center, radius) in tree order.
+    const std::vector<DirectX::XMFLOAT4>& Spheres() const { return m_spheres; }
+
+    // pVisible needs room for InstanceCount() indices. Returns the visible count.
+    uint32 Cull(const Frustum& frustum, uint32* pVisible) const;
+
+private:
+    std::vector<InstanceBvhNode, AlignedAllocator<InstanceBvhNode, 32>> m_nodes;
+    std::vector<uint32>                                                   m_instances;
+    std::vector<DirectX::XMFLOAT4>                                        m_spheres; // Center and radius, in tree order
+};
@@ -0,0 +1,113 @@
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// ====================================================================================================================
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+// ====================================================================================================================
+bool MappedFile::Open(
+    const std::string& path,
+    Access             access)
+{
+    Close();
+
+#if defined(_WIN32)
+    const DWORD accessFlag = (access == Access::Sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS;
+
+    HANDLE file = CreateFileA(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | accessFlag,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    // An empty file can not be mapped.
+    LARGE_INTEGER fileSize = {};
+    HANDLE        mapping  = nullptr;
+    if ((GetFileSizeEx(file, &fileSize) == FALSE) || (fileSize.QuadPart == 0) ||
+        ((mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_file    = file;
+    m_mapping = mapping;
+    m_size    = static_cast<uint64>(fileSize.QuadPart);
+    m_pData   = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    struct stat fileStat;
+    if ((fd < 0) || (fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0))
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return false;
+    }
+
+    m_size = static_cast<uint64>(fileStat.st_size);
+    void* pData = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (pData != MAP_FAILED)
+    {
+        madvise(pData, m_size, (access == Access::Sequential) ? MADV_WILLNEED : MADV_RANDOM);
+        m_pData = static_cast<const uint8_t*>(pData);
+    }
+#endif
+
+    if (m_pData == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+// ====================================================================================================================
+void MappedFile::Close()
+{
+#if defined(_WIN32)
+    if (m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+    }
+    if (m_mapping != nullptr)
+    {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != nullptr)
+    {
+        CloseHandle(m_file);
+    }
+#else
+    if (m_pData != nullptr)
+    {
+        munmap(const_cast<uint8_t*>(m_pData), m_size);
+    }
+#endif
+
+    m_pData   = nullptr;
+    m_size    = 0;
+    m_file    = nullptr;
+    m_mapping = nullptr;
+}
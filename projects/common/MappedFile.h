@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+using uint64 = std::uint64_t;
+
+// ====================================================================================================================
+// Read only memory mapping of a whole file, shared by the file formats that are used in place (MeshFile,
+// TiledHeightmap). The access hint tells the OS how the pages will be touched.
+class MappedFile
+{
+public:
+    enum class Access
+    {
+        Sequential, // Read front to back soon after opening
+        Random,     // Read in any order, possibly only in parts
+    };
+
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file does not exist, is empty or can not be mapped.
+    bool Open(const std::string& path, Access access);
+    void Close();
+
+    bool           IsOpen() const { return m_pData != nullptr; }
+    const uint8_t* Data() const { return m_pData; }
+    uint64         Size() const { return m_size; }
+
+private:
+    const uint8_t* m_pData   = nullptr;
+    uint64         m_size    = 0;
+    void*          m_file    = nullptr;
+    void*          m_mapping = nullptr;
+};
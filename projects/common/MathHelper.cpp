@@ -1,8 +1,31 @@
 #include "MathHelper.h"
 #include <float.h>
 #include <cmath>
+#include <cstdint>
 
 using namespace DirectX;
 
 const float MathHelper::Infinity = FLT_MAX;
-const float MathHelper::Pi = 3.1415926535f;
\ No newline at end of file
+const float MathHelper::Pi = 3.1415926535f;
+
+// ====================================================================================================================
+void MathHelper::ExtractFrustumPlanes(
+    CXMMATRIX viewProj,
+    XMFLOAT4  planes[6])
+{
+    XMFLOAT4X4 m;
+    XMStoreFloat4x4(&m, viewProj);
+
+    // clip = (x, y, z, w) with -w <= x <= w, -w <= y <= w, 0 <= z <= w. Each plane is a sum/difference of columns.
+    planes[0] = XMFLOAT4(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41); // left
+    planes[1] = XMFLOAT4(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41); // right
+    planes[2] = XMFLOAT4(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42); // bottom
+    planes[3] = XMFLOAT4(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42); // top
+    planes[4] = XMFLOAT4(m._13, m._23, m._33, m._43);                                 // near
+    planes[5] = XMFLOAT4(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43); // far
+
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        XMStoreFloat4(&planes[i], XMPlaneNormalize(XMLoadFloat4(&planes[i])));
+    }
+}
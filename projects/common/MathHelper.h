@@ -29,6 +29,11 @@ public:
     {
         return x < low ? low : (x > high ? high : x);
     }
+
+    // Extracts the left, right, bottom, top, near and far planes from a view-projection matrix (row vector
+    // convention, D3D clip space). Normals point into the frustum and are unit length, so dot(plane, (p, 1)) is the
+    // signed distance of p to the plane.
+    static void ExtractFrustumPlanes(DirectX::CXMMATRIX viewProj, DirectX::XMFLOAT4 planes[6]);
 };
 
 #endif MATH_HELPER_H
@@ -0,0 +1,268 @@
+#include "MeshBatcher.h"
+#include "MeshPartitioner.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+using namespace DirectX;
+
+// Below this many vertices per thread the batch is written on the calling thread.
+static const uint32 MinVerticesPerThread = 16 * 1024;
+
+// ====================================================================================================================
+static void WriteIndices(
+    const uint32*          pSource,
+    const MeshWriteTarget& target)
+{
+    if (target.indexSize == 4)
+    {
+        memcpy(target.pIndices, pSource, size_t(target.indexCapacity) * sizeof(uint32));
+        return;
+    }
+
+    uint16* pOut = static_cast<uint16*>(target.pIndices);
+    for (uint32 i = 0; i < target.indexCapacity; ++i)
+    {
+        pOut[i] = static_cast<uint16>(pSource[i]);
+    }
+}
+
+// ====================================================================================================================
+uint32 MeshBatcher::Add(
+    const std::string& name,
+    const MeshData&    meshData)
+{
+    const uint32 submesh = Add(name, { meshData.VertexCount(), meshData.IndexCount() }, BuildFunc());
+    m_sources[submesh].pMeshData = &meshData;
+    return submesh;
+}
+
+// ====================================================================================================================
+uint32 MeshBatcher::Add(
+    const std::string& name,
+    const MeshSize&    size,
+    BuildFunc          build)
+{
+    assert(uint64_t(m_vertexCount) + size.vertexCount <= UINT32_MAX);
+    assert(uint64_t(m_indexCount) + size.indexCount <= UINT32_MAX);
+
+    MeshBatchSubmesh submesh;
+    submesh.name               = name;
+    submesh.vertexCount        = size.vertexCount;
+    submesh.indexCount         = size.indexCount;
+    submesh.startIndexLocation = m_indexCount;
+    submesh.baseVertexLocation = m_vertexCount;
+    m_submeshes.push_back(submesh);
+
+    Source source;
+    source.build = std::move(build);
+    m_sources.push_back(std::move(source));
+
+    m_vertexCount           += size.vertexCount;
+    m_indexCount            += size.indexCount;
+    m_maxSubmeshVertexCount  = std::max<uint32>(m_maxSubmeshVertexCount, size.vertexCount);
+
+    return SubmeshCount() - 1;
+}
+
+// ====================================================================================================================
+uint32 MeshBatcher::AddSplit(
+    const std::string& name,
+    const MeshData&    meshData)
+{
+    std::vector<MeshData> parts = MeshPartitioner::Split(meshData);
+    for (uint32 i = 0; i < parts.size(); ++i)
+    {
+        m_parts.push_back(std::move(parts[i]));
+        Add(PartName(name, i), m_parts.back());
+    }
+    return static_cast<uint32>(parts.size());
+}
+
+// ====================================================================================================================
+void MeshBatcher::Clear()
+{
+    m_submeshes.clear();
+    m_sources.clear();
+    m_parts.clear();
+    m_vertexCount           = 0;
+    m_indexCount            = 0;
+    m_maxSubmeshVertexCount = 0;
+}
+
+// ====================================================================================================================
+void MeshBatcher::Write(
+    void*                    pVertices,
+    const InterleavedLayout& layout,
+    void*                    pIndices,
+    uint32                   maxThreads)
+{
+    WriteAll(pVertices, layout, nullptr, pIndices, maxThreads);
+}
+
+// ====================================================================================================================
+void MeshBatcher::Write(
+    void*             pVertices,
+    uint32            vertexStride,
+    const VertexFunc& writeVertex,
+    void*             pIndices,
+    uint32            maxThreads)
+{
+    const ConvertFunc convert = [&](uint32 submesh, const Vertex* pSource, uint32 count, void* pOut)
+    {
+        for (uint32 i = 0; i < count; ++i)
+        {
+            writeVertex(submesh, pSource[i], static_cast<uint8_t*>(pOut) + size_t(i) * vertexStride);
+        }
+    };
+
+    Write(pVertices, vertexStride, convert, pIndices, maxThreads);
+}
+
+// ====================================================================================================================
+void MeshBatcher::Write(
+    void*              pVertices,
+    uint32             vertexStride,
+    const ConvertFunc& convert,
+    void*              pIndices,
+    uint32             maxThreads)
+{
+    InterleavedLayout layout;
+    layout.stride = vertexStride;
+
+    WriteAll(pVertices, layout, &convert, pIndices, maxThreads);
+}
+
+// ====================================================================================================================
+void MeshBatcher::WriteAll(
+    void*                    pVertices,
+    const InterleavedLayout& layout,
+    const ConvertFunc*       pConvert,
+    void*                    pIndices,
+    uint32                   maxThreads)
+{
+    if (maxThreads == 0)
+    {
+        maxThreads = DefaultThreadCount();
+    }
+
+    const uint32 workerCount = std::min<uint32>(std::min<uint32>(maxThreads, SubmeshCount()),
+                                                std::max<uint32>(1, m_vertexCount / MinVerticesPerThread));
+
+    // Largest submeshes first, each to the worker with the least work so far, so the small ones fill in at the end
+    // instead of one big mesh finishing last.
+    std::vector<uint32> order(SubmeshCount());
+    for (uint32 i = 0; i < SubmeshCount(); ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b)
+    {
+        return m_submeshes[a].vertexCount + m_submeshes[a].indexCount > m_submeshes[b].vertexCount + m_submeshes[b].indexCount;
+    });
+
+    std::vector<uint64_t>            work(workerCount, 0);
+    std::vector<std::vector<uint32>> schedule(workerCount);
+    for (uint32 submesh : order)
+    {
+        const size_t w = std::min_element(work.begin(), work.end()) - work.begin();
+        work[w] += uint64_t(m_submeshes[submesh].vertexCount) + m_submeshes[submesh].indexCount;
+        schedule[w].push_back(submesh);
+    }
+
+    ParallelFor(workerCount, 1, workerCount, [&](uint32 begin, uint32 end)
+    {
+        Scratch scratch;
+        for (uint32 w = begin; w < end; ++w)
+        {
+            for (uint32 submesh : schedule[w])
+            {
+                WriteSubmesh(submesh, pVertices, layout, pConvert, pIndices, scratch);
+            }
+        }
+    });
+}
+
+// ====================================================================================================================
+void MeshBatcher::WriteSubmesh(
+    uint32                   submesh,
+    void*                    pVertices,
+    const InterleavedLayout& layout,
+    const ConvertFunc*       pConvert,
+    void*                    pIndices,
+    Scratch&                 scratch)
+{
+    MeshBatchSubmesh&       s      = m_submeshes[submesh];
+    const Source&           source = m_sources[submesh];
+    uint8_t*                pOut   = static_cast<uint8_t*>(pVertices) + size_t(s.baseVertexLocation) * layout.stride;
+    const void*             pPositions;
+    uint32                  positionStride;
+
+    MeshWriteTarget target;
+    target.pVertices      = pOut;
+    target.layout         = layout;
+    target.vertexCapacity = s.vertexCount;
+    target.pIndices       = static_cast<uint8_t*>(pIndices) + size_t(s.startIndexLocation) * IndexSize();
+    target.indexSize      = IndexSize();
+    target.indexCapacity  = s.indexCount;
+
+    if (source.pMeshData != nullptr)
+    {
+        const MeshData& meshData = *source.pMeshData;
+
+        if (pConvert == nullptr)
+        {
+            // Single threaded, the batch is already spread over the workers.
+            GeometryGenerator(1).WriteMesh(meshData, target);
+        }
+        else
+        {
+            (*pConvert)(submesh, meshData.m_vertices.data(), s.vertexCount, pOut);
+            WriteIndices(meshData.m_indices32.data(), target);
+        }
+
+        pPositions     = meshData.m_vertices.data();
+        positionStride = sizeof(Vertex);
+    }
+    else if (pConvert == nullptr)
+    {
+        // Generated straight into the destination, with the positions kept aside for the bounds.
+        scratch.positions.resize(s.vertexCount);
+        target.pPositions = scratch.positions.data();
+        source.build(target);
+
+        pPositions     = scratch.positions.data();
+        positionStride = sizeof(XMFLOAT3);
+    }
+    else
+    {
+        // Custom vertex formats are generated into plain vertices first and converted from there. The indices are
+        // written in place.
+        scratch.vertices.resize(s.vertexCount);
+
+        target.pVertices             = scratch.vertices.data();
+        target.layout.stride         = sizeof(Vertex);
+        target.layout.positionOffset = offsetof(Vertex, m_position);
+        target.layout.normalOffset   = offsetof(Vertex, m_normal);
+        target.layout.tangentOffset  = offsetof(Vertex, m_tangentU);
+        target.layout.texCOffset     = offsetof(Vertex, m_texC);
+        source.build(target);
+
+        (*pConvert)(submesh, scratch.vertices.data(), s.vertexCount, pOut);
+
+        pPositions     = scratch.vertices.data();
+        positionStride = sizeof(Vertex);
+    }
+
+    if (m_fullBounds)
+    {
+        s.bounds = BoundingVolumes::Compute(pPositions, positionStride, s.vertexCount);
+        return;
+    }
+
+    s.bounds.aabb = BoundingVolumes::ComputeAabb(pPositions, positionStride, s.vertexCount);
+    BoundingSphere::CreateFromBoundingBox(s.bounds.sphere, s.bounds.aabb);
+    BoundingOrientedBox::CreateFromBoundingBox(s.bounds.obb, s.bounds.aabb);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "BoundingVolumes.h"
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Where one mesh ended up in the packed buffers, i.e. the arguments of its DrawIndexedInstanced() call.
+struct MeshBatchSubmesh
+{
+    std::string name;
+    uint32      vertexCount        = 0;
+    uint32      indexCount         = 0;
+    uint32      startIndexLocation = 0;
+    uint32      baseVertexLocation = 0;
+    MeshBounds  bounds; // Of the submesh's positions, filled in by Write(), see SetFullBounds()
+};
+
+// ====================================================================================================================
+// Packs many meshes into one vertex buffer and one index buffer. Meshes are added with their sizes, which fixes every
+// submesh's location up front; Write() then puts each mesh straight into the caller's memory (usually the mapped
+// upload buffers, see MeshGeometry::CreateBuffers()) in a single pass, with independent meshes written in parallel.
+//
+// Indices stay relative to each submesh's baseVertexLocation, so 16 bit indices only need every submesh, not the whole
+// batch, to have at most 65536 vertices. IndexSize() picks 16 bit indices whenever that holds, and AddSplit() makes it
+// hold for larger meshes too.
+//
+// Write() also computes each submesh's AABB on the worker that writes it, from the source or generated positions while
+// they are still in cache, so the destination never has to be read back. The sphere and OBB are the ones around that
+// box unless SetFullBounds() asks for the tight volumes of BoundingVolumes::Compute().
+class MeshBatcher
+{
+public:
+    // Builds a mesh of the size given to Add() into target. Called from worker threads, so it should use its own
+    // single threaded generator, e.g. GeometryGenerator(1). A function that writes the vertices itself also has to
+    // store their positions in target.pPositions, as the generators do.
+    using BuildFunc = std::function<void(const MeshWriteTarget& target)>;
+
+    // Converts one vertex of the given submesh to the caller's vertex format, for formats InterleavedLayout can not
+    // describe (packed attributes, per submesh colors). pOut points at the destination vertex.
+    using VertexFunc = std::function<void(uint32 submesh, const Vertex& v, void* pOut)>;
+
+    // Converts count consecutive vertices of the given submesh at once, e.g. with VertexLayout::Convert(); one call per
+    // submesh instead of one per vertex.
+    using ConvertFunc = std::function<void(uint32 submesh, const Vertex* pVertices, uint32 count, void* pOut)>;
+
+    // Both return the submesh index. meshData is referenced, not copied, and has to stay alive until Write().
+    uint32 Add(const std::string& name, const MeshData& meshData);
+    uint32 Add(const std::string& name, const MeshSize& size, BuildFunc build);
+
+    // Adds meshData as one submesh per MeshPartitioner part, named PartName(name, part), and returns the number of
+    // parts. The parts are copies owned by the batcher, so meshData can go away right after.
+    uint32 AddSplit(const std::string& name, const MeshData& meshData);
+
+    static std::string PartName(const std::string& name, uint32 part) { return name + "#" + std::to_string(part); }
+
+    uint32                               SubmeshCount() const { return static_cast<uint32>(m_submeshes.size()); }
+    const std::vector<MeshBatchSubmesh>& Submeshes() const { return m_submeshes; }
+    uint32                               VertexCount() const { return m_vertexCount; }
+    uint32                               IndexCount() const { return m_indexCount; }
+    uint32                               IndexSize() const { return (m_maxSubmeshVertexCount <= 0x10000) ? 2 : 4; }
+
+    // pVertices holds VertexCount() vertices of layout.stride bytes, pIndices IndexCount() indices of IndexSize()
+    // bytes. Both are only written, so write-combined memory is fine.
+    void Write(void* pVertices, const InterleavedLayout& layout, void* pIndices, uint32 maxThreads = 0);
+    void Write(void* pVertices, uint32 vertexStride, const VertexFunc& writeVertex, void* pIndices, uint32 maxThreads = 0);
+    void Write(void* pVertices, uint32 vertexStride, const ConvertFunc& convert, void* pIndices, uint32 maxThreads = 0);
+
+    // The minimal sphere and the PCA OBB cost about a hundred times as much as writing the batch, so by default
+    // Write() only computes the AABB. Worth it for a batch built once, e.g. into a MeshFile cache.
+    void SetFullBounds(bool fullBounds) { m_fullBounds = fullBounds; }
+
+    void Clear();
+
+private:
+    struct Source
+    {
+        const MeshData* pMeshData = nullptr;
+        BuildFunc       build;
+    };
+
+    // Per worker, reused between submeshes.
+    struct Scratch
+    {
+        std::vector<Vertex>            vertices;
+        std::vector<DirectX::XMFLOAT3> positions;
+    };
+
+    void WriteSubmesh(uint32                   submesh,
+                      void*                    pVertices,
+                      const InterleavedLayout& layout,
+                      const ConvertFunc*       pConvert,
+                      void*                    pIndices,
+                      Scratch&                 scratch);
+
+    void WriteAll(void*                    pVertices,
+                  const InterleavedLayout& layout,
+                  const ConvertFunc*       pConvert,
+                  void*                    pIndices,
+                  uint32                   maxThreads);
+
+    std::vector<MeshBatchSubmesh> m_submeshes;
+    std::vector<Source>           m_sources;
+    std::deque<MeshData>          m_parts; // Of AddSplit(), deque for stable addresses
+    uint32                        m_vertexCount           = 0;
+    uint32                        m_indexCount            = 0;
+    uint32                        m_maxSubmeshVertexCount = 0;
+    bool                          m_fullBounds            = false;
+};
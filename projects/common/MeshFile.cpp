@@ -0,0 +1,251 @@
+#include "MeshFile.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+// ====================================================================================================================
+static uint64 AlignSection(
+    uint64 offset)
+{
+    const uint64 alignment = MeshFileHeader::SectionAlignment;
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// ====================================================================================================================
+MeshFileKey& MeshFileKey::Add(
+    const char* pString)
+{
+    // The terminator separates consecutive strings.
+    return AddBytes(pString, strlen(pString) + 1);
+}
+
+// ====================================================================================================================
+MeshFileKey& MeshFileKey::AddBytes(
+    const void* pData,
+    size_t      size)
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+    for (size_t i = 0; i < size; ++i)
+    {
+        m_hash = (m_hash ^ pBytes[i]) * 1099511628211ull;
+    }
+    return *this;
+}
+
+// ====================================================================================================================
+MeshFile::~MeshFile()
+{
+    Close();
+}
+
+// ====================================================================================================================
+bool MeshFile::Open(
+    const std::string& path,
+    uint64             key)
+{
+    Close();
+
+    // The whole file is copied to the upload buffers right away.
+    if (m_file.Open(path, MappedFile::Access::Sequential) == false)
+    {
+        return false;
+    }
+
+    m_pData = m_file.Data();
+    m_size  = m_file.Size();
+
+    if (Validate(key) == false)
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+// ====================================================================================================================
+// Checks everything the accessors rely on, so a truncated, foreign or outdated file is rejected here.
+bool MeshFile::Validate(
+    uint64 key)
+{
+    if (m_size < sizeof(MeshFileHeader))
+    {
+        return false;
+    }
+
+    const MeshFileHeader& header = Header();
+    if ((header.magic != MeshFileHeader::Magic) || (header.version != MeshFileHeader::Version) ||
+        (header.key != key) || (header.streamCount == 0) || (header.streamCount > MeshFileHeader::MaxStreams) ||
+        ((header.indexSize != 2) && (header.indexSize != 4)))
+    {
+        return false;
+    }
+
+    const uint64 streamsOffset   = AlignSection(sizeof(MeshFileHeader));
+    const uint64 submeshesOffset = AlignSection(streamsOffset + header.streamCount * sizeof(MeshFileStream));
+    const uint64 tableEnd        = submeshesOffset + uint64(header.submeshCount) * sizeof(MeshFileSubmesh);
+    if ((tableEnd > m_size) ||
+        (header.indexOffset % MeshFileHeader::SectionAlignment != 0) ||
+        (header.indexOffset + uint64(header.indexCount) * header.indexSize > m_size))
+    {
+        return false;
+    }
+
+    m_pStreams   = reinterpret_cast<const MeshFileStream*>(m_pData + streamsOffset);
+    m_pSubmeshes = reinterpret_cast<const MeshFileSubmesh*>(m_pData + submeshesOffset);
+
+    for (uint32 i = 0; i < header.streamCount; ++i)
+    {
+        const MeshFileStream& stream = m_pStreams[i];
+        if ((stream.stride == 0) || (stream.offset % MeshFileHeader::SectionAlignment != 0) ||
+            (stream.offset + uint64(header.vertexCount) * stream.stride > m_size))
+        {
+            return false;
+        }
+    }
+
+    for (uint32 i = 0; i < header.submeshCount; ++i)
+    {
+        const MeshFileSubmesh& submesh = m_pSubmeshes[i];
+        if ((submesh.name[MeshFileSubmesh::MaxNameLength] != '\0') ||
+            (uint64(submesh.baseVertexLocation) + submesh.vertexCount > header.vertexCount) ||
+            (uint64(submesh.startIndexLocation) + submesh.indexCount > header.indexCount))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ====================================================================================================================
+void MeshFile::Close()
+{
+    m_file.Close();
+
+    m_image.clear();
+    m_image.shrink_to_fit();
+
+    m_pData      = nullptr;
+    m_pStreams   = nullptr;
+    m_pSubmeshes = nullptr;
+    m_size       = 0;
+}
+
+// ====================================================================================================================
+void MeshFile::Build(
+    uint64             key,
+    const MeshBatcher& batcher,
+    uint32             vertexStride,
+    const WriteFunc&   write)
+{
+    Close();
+
+    const uint64 streamsOffset   = AlignSection(sizeof(MeshFileHeader));
+    const uint64 submeshesOffset = AlignSection(streamsOffset + sizeof(MeshFileStream));
+    const uint64 verticesOffset  = AlignSection(submeshesOffset + uint64(batcher.SubmeshCount()) * sizeof(MeshFileSubmesh));
+    const uint64 indexOffset     = AlignSection(verticesOffset + uint64(batcher.VertexCount()) * vertexStride);
+    const uint64 size            = AlignSection(indexOffset + uint64(batcher.IndexCount()) * batcher.IndexSize());
+
+    m_image.resize(static_cast<size_t>(size));
+    uint8_t* pImage = m_image.data();
+
+    MeshFileHeader header;
+    header.key          = key;
+    header.streamCount  = 1;
+    header.submeshCount = batcher.SubmeshCount();
+    header.vertexCount  = batcher.VertexCount();
+    header.indexCount   = batcher.IndexCount();
+    header.indexSize    = batcher.IndexSize();
+    header.indexOffset  = indexOffset;
+
+    MeshFileStream stream;
+    stream.offset = verticesOffset;
+    stream.stride = vertexStride;
+    memcpy(pImage + streamsOffset, &stream, sizeof(stream));
+
+    write(pImage + verticesOffset, pImage + indexOffset);
+
+    MeshFileSubmesh* pSubmeshes = reinterpret_cast<MeshFileSubmesh*>(pImage + submeshesOffset);
+    XMVECTOR         boundsMin  = XMVectorReplicate(FLT_MAX);
+    XMVECTOR         boundsMax  = XMVectorReplicate(-FLT_MAX);
+
+    for (uint32 i = 0; i < batcher.SubmeshCount(); ++i)
+    {
+        const MeshBatchSubmesh& source  = batcher.Submeshes()[i];
+        const MeshBounds&       bounds  = source.bounds;
+        MeshFileSubmesh&        submesh = pSubmeshes[i];
+
+        // Longer names are cut off.
+        submesh = MeshFileSubmesh();
+        strncpy(submesh.name, source.name.c_str(), MeshFileSubmesh::MaxNameLength);
+        submesh.vertexCount        = source.vertexCount;
+        submesh.indexCount         = source.indexCount;
+        submesh.startIndexLocation = source.startIndexLocation;
+        submesh.baseVertexLocation = source.baseVertexLocation;
+        submesh.aabbCenter         = bounds.aabb.Center;
+        submesh.aabbExtents        = bounds.aabb.Extents;
+        submesh.sphereCenter       = bounds.sphere.Center;
+        submesh.sphereRadius       = bounds.sphere.Radius;
+        submesh.obbCenter          = bounds.obb.Center;
+        submesh.obbExtents         = bounds.obb.Extents;
+        submesh.obbOrientation     = bounds.obb.Orientation;
+
+        if (source.vertexCount > 0)
+        {
+            const XMVECTOR center  = XMLoadFloat3(&bounds.aabb.Center);
+            const XMVECTOR extents = XMLoadFloat3(&bounds.aabb.Extents);
+            boundsMin = XMVectorMin(boundsMin, XMVectorSubtract(center, extents));
+            boundsMax = XMVectorMax(boundsMax, XMVectorAdd(center, extents));
+        }
+    }
+
+    if (header.vertexCount > 0)
+    {
+        XMStoreFloat3(&header.boundsMin, boundsMin);
+        XMStoreFloat3(&header.boundsMax, boundsMax);
+    }
+
+    memcpy(pImage, &header, sizeof(header));
+
+    m_pData      = pImage;
+    m_pStreams   = reinterpret_cast<const MeshFileStream*>(pImage + streamsOffset);
+    m_pSubmeshes = pSubmeshes;
+    m_size       = size;
+}
+
+// ====================================================================================================================
+bool MeshFile::Save(
+    const std::string& path) const
+{
+    if (IsOpen() == false)
+    {
+        return false;
+    }
+
+    // Written next to the destination and renamed once complete, so an interrupted save never leaves a file behind
+    // that Open() would accept.
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (file.is_open() == false)
+        {
+            return false;
+        }
+
+        file.write(reinterpret_cast<const char*>(m_pData), static_cast<std::streamsize>(m_size));
+        if (file.good() == false)
+        {
+            file.close();
+            remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    remove(path.c_str());
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "MappedFile.h"
+#include "MeshBatcher.h"
+
+using uint64 = std::uint64_t;
+
+// ====================================================================================================================
+// Layout of a mesh file, every section starting at a multiple of MeshFileHeader::SectionAlignment bytes:
+//     MeshFileHeader
+//     MeshFileStream[streamCount]
+//     MeshFileSubmesh[submeshCount]
+//     vertex data of each stream, vertexCount * stride bytes
+//     indices, indexCount * indexSize bytes
+// Everything is stored the way it goes to the GPU, so a mapped file is uploaded without any parsing.
+struct MeshFileHeader
+{
+    static const uint32 Magic            = 0x3148534d; // "MSH1"
+    static const uint32 Version          = 2;
+    static const uint32 SectionAlignment = 64;
+    static const uint32 MaxStreams       = 4;
+
+    uint32            magic        = Magic;
+    uint32            version      = Version;
+    uint64            key          = 0; // See MeshFileKey
+    uint32            streamCount  = 0;
+    uint32            submeshCount = 0;
+    uint32            vertexCount  = 0;
+    uint32            indexCount   = 0;
+    uint32            indexSize    = 0; // 2 or 4
+    uint32            reserved     = 0;
+    uint64            indexOffset  = 0;
+    DirectX::XMFLOAT3 boundsMin    = { 0.0f, 0.0f, 0.0f }; // Of all submeshes
+    DirectX::XMFLOAT3 boundsMax    = { 0.0f, 0.0f, 0.0f };
+};
+
+struct MeshFileStream
+{
+    uint64 offset   = 0;
+    uint32 stride   = 0;
+    uint32 reserved = 0;
+};
+
+struct MeshFileSubmesh
+{
+    static const uint32 MaxNameLength = 47;
+
+    char              name[MaxNameLength + 1] = {};
+    uint32            vertexCount             = 0;
+    uint32            indexCount              = 0;
+    uint32            startIndexLocation      = 0;
+    uint32            baseVertexLocation      = 0;
+    DirectX::XMFLOAT3 aabbCenter              = { 0.0f, 0.0f, 0.0f }; // See MeshBounds
+    DirectX::XMFLOAT3 aabbExtents             = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 sphereCenter            = { 0.0f, 0.0f, 0.0f };
+    float             sphereRadius            = 0.0f;
+    DirectX::XMFLOAT3 obbCenter               = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 obbExtents              = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT4 obbOrientation          = { 0.0f, 0.0f, 0.0f, 1.0f };
+};
+
+// ====================================================================================================================
+// FNV-1a hash of everything a cached mesh was generated from: generator parameters, processing settings and the
+// vertex format. A file is only used if it was written with the same key, so changing any of them rebuilds it.
+class MeshFileKey
+{
+public:
+    explicit MeshFileKey(const char* pName) { Add(pName); }
+
+    // Plain values without padding (numbers, XMFLOAT3, ...).
+    template<typename T>
+    MeshFileKey& Add(const T& value) { return AddBytes(&value, sizeof(T)); }
+
+    MeshFileKey& Add(const char* pString);
+    MeshFileKey& AddBytes(const void* pData, size_t size);
+
+    uint64 Value() const { return m_hash; }
+
+private:
+    uint64 m_hash = 14695981039346656037ull;
+};
+
+// ====================================================================================================================
+// A packed mesh (see MeshBatcher) in the mesh file format, either memory mapped from a file or built in memory. The
+// samples use it as a startup cache: Open() the file written on a previous run and hand it to
+// MeshGeometry::CreateBuffers(), which copies the mapped vertices and indices straight to the upload buffers; only if
+// that fails the geometry is generated, Build() and Save().
+class MeshFile
+{
+public:
+    // Called with the vertex and index sections of the file image; should call one of the batcher's Write() overloads.
+    using WriteFunc = std::function<void(void* pVertices, void* pIndices)>;
+
+    MeshFile() {}
+    ~MeshFile();
+
+    MeshFile(const MeshFile&) = delete;
+    MeshFile& operator=(const MeshFile&) = delete;
+
+    // Returns false if the file does not exist, is not a valid mesh file or was written with another key.
+    bool Open(const std::string& path, uint64 key);
+    void Close();
+
+    // Builds the file image in memory; write() puts the batch straight into it. The submesh bounds are the ones the
+    // batcher computed during the write, see MeshBatcher::SetFullBounds().
+    void Build(uint64 key, const MeshBatcher& batcher, uint32 vertexStride, const WriteFunc& write);
+
+    // Writes the open or built image to path. Returns false if the file can not be written.
+    bool Save(const std::string& path) const;
+
+    bool                   IsOpen() const { return m_pData != nullptr; }
+    const MeshFileHeader&  Header() const { return *reinterpret_cast<const MeshFileHeader*>(m_pData); }
+    const uint8_t*         Data() const { return m_pData; }
+    uint64                 Size() const { return m_size; }
+    bool                   IsMapped() const { return m_file.IsOpen(); }
+
+    uint32                 StreamCount() const { return Header().streamCount; }
+    const MeshFileStream&  Stream(uint32 stream) const { return m_pStreams[stream]; }
+    const void*            Vertices(uint32 stream = 0) const { return m_pData + m_pStreams[stream].offset; }
+    uint32                 VertexStride(uint32 stream = 0) const { return m_pStreams[stream].stride; }
+    uint32                 VertexCount() const { return Header().vertexCount; }
+
+    const void*            Indices() const { return m_pData + Header().indexOffset; }
+    uint32                 IndexCount() const { return Header().indexCount; }
+    uint32                 IndexSize() const { return Header().indexSize; }
+
+    uint32                 SubmeshCount() const { return Header().submeshCount; }
+    const MeshFileSubmesh& Submesh(uint32 submesh) const { return m_pSubmeshes[submesh]; }
+
+private:
+    bool Validate(uint64 key);
+
+    const uint8_t*         m_pData      = nullptr;
+    const MeshFileStream*  m_pStreams   = nullptr;
+    const MeshFileSubmesh* m_pSubmeshes = nullptr;
+    uint64                 m_size       = 0;
+    MappedFile             m_file;
+
+    std::vector<uint8_t, AlignedAllocator<uint8_t, MeshFileHeader::SectionAlignment>> m_image; // Built in memory
+};
@@ -0,0 +1,669 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+static const uint32 InvalidIndex = 0xffffffff;
+
+// Clusters smaller than this are not split any further by the overdraw pass.
+static const uint32 MinOverdrawClusterSize = 8;
+
+const float MeshOptimizer::DefaultOverdrawThreshold = 1.05f;
+
+// ====================================================================================================================
+static XMFLOAT3 LoadPosition(
+    const float* pPositions,
+    size_t       positionStride,
+    uint32       index)
+{
+    const float* pPos = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + index * positionStride);
+    return XMFLOAT3(pPos[0], pPos[1], pPos[2]);
+}
+
+// ====================================================================================================================
+// Picks the next fanning vertex once the current one ran out of triangles: the most recently referenced vertex that
+// still has live triangles, or failing that the next live vertex in input order.
+static uint32 SkipDeadEnd(
+    const std::vector<uint32>& liveTriangles,
+    std::vector<uint32>&       deadEndStack,
+    uint32&                    cursor,
+    uint32                     vertexCount)
+{
+    while (deadEndStack.empty() == false)
+    {
+        const uint32 v = deadEndStack.back();
+        deadEndStack.pop_back();
+
+        if (liveTriangles[v] > 0)
+        {
+            return v;
+        }
+    }
+
+    for (; cursor < vertexCount; ++cursor)
+    {
+        if (liveTriangles[cursor] > 0)
+        {
+            return cursor;
+        }
+    }
+
+    return InvalidIndex;
+}
+
+// ====================================================================================================================
+void MeshOptimizer::OptimizeVertexCache(
+    uint32* pIndices,
+    size_t  indexCount,
+    uint32  vertexCount,
+    uint32  cacheSize)
+{
+    assert((indexCount % 3) == 0);
+
+    const uint32 triangleCount = static_cast<uint32>(indexCount / 3);
+
+    // Vertex -> triangle adjacency in compressed row form.
+    std::vector<uint32> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        assert(pIndices[i] < vertexCount);
+        liveTriangles[pIndices[i]]++;
+    }
+
+    std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+    }
+
+    std::vector<uint32> adjacency(indexCount);
+    std::vector<uint32> fillCursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        adjacency[fillCursor[pIndices[i]]++] = static_cast<uint32>(i / 3);
+    }
+
+    std::vector<uint32>  cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32>  deadEndStack;
+    std::vector<uint32>  candidates;
+    std::vector<uint32>  output(indexCount);
+
+    deadEndStack.reserve(indexCount);
+
+    size_t outputPos = 0;
+    uint32 timeStamp = cacheSize + 1;
+    uint32 cursor    = 0;
+    uint32 fanning   = (vertexCount > 0) ? SkipDeadEnd(liveTriangles, deadEndStack, cursor, vertexCount) : InvalidIndex;
+
+    while (fanning != InvalidIndex)
+    {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex.
+        for (uint32 a = adjacencyOffsets[fanning]; a < adjacencyOffsets[fanning + 1]; ++a)
+        {
+            const uint32 t = adjacency[a];
+            if (emitted[t] != 0)
+            {
+                continue;
+            }
+
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                const uint32 v = pIndices[t * 3 + k];
+
+                output[outputPos++] = v;
+                deadEndStack.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+
+                if (timeStamp - cacheTime[v] > cacheSize)
+                {
+                    cacheTime[v] = timeStamp++;
+                }
+            }
+
+            emitted[t] = 1;
+        }
+
+        // Prefer the candidate that has been in the cache the longest, as long as fanning around it would not push it
+        // out of the cache.
+        uint32 next         = InvalidIndex;
+        int    bestPriority = -1;
+
+        for (uint32 v : candidates)
+        {
+            if (liveTriangles[v] > 0)
+            {
+                int priority = 0;
+                if (timeStamp - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize)
+                {
+                    priority = static_cast<int>(timeStamp - cacheTime[v]);
+                }
+
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next         = v;
+                }
+            }
+        }
+
+        if (next == InvalidIndex)
+        {
+            next = SkipDeadEnd(liveTriangles, deadEndStack, cursor, vertexCount);
+        }
+
+        fanning = next;
+    }
+
+    assert(outputPos == indexCount);
+    std::copy(output.begin(), output.end(), pIndices);
+}
+
+// ====================================================================================================================
+std::vector<uint32> MeshOptimizer::OptimizeVertexFetchRemap(
+    uint32* pIndices,
+    size_t  indexCount,
+    uint32  vertexCount)
+{
+    std::vector<uint32> remap(vertexCount, InvalidIndex);
+    uint32 nextVertex = 0;
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const uint32 v = pIndices[i];
+        if (remap[v] == InvalidIndex)
+        {
+            remap[v] = nextVertex++;
+        }
+
+        pIndices[i] = remap[v];
+    }
+
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        if (remap[v] == InvalidIndex)
+        {
+            remap[v] = nextVertex++;
+        }
+    }
+
+    return remap;
+}
+
+// ====================================================================================================================
+template<typename StreamT>
+static void RemapStream(
+    StreamT&                   stream,
+    const std::vector<uint32>& remap)
+{
+    StreamT remapped(stream.size());
+    for (size_t v = 0; v < stream.size(); ++v)
+    {
+        remapped[remap[v]] = stream[v];
+    }
+
+    stream.swap(remapped);
+}
+
+// ====================================================================================================================
+void MeshOptimizer::OptimizeVertexFetch(
+    MeshData& meshData)
+{
+    const std::vector<uint32> remap = OptimizeVertexFetchRemap(meshData.m_indices32.data(),
+                                                               meshData.m_indices32.size(),
+                                                               meshData.VertexCount());
+    RemapStream(meshData.m_vertices, remap);
+}
+
+// ====================================================================================================================
+void MeshOptimizer::OptimizeVertexFetch(
+    MeshDataSoA& meshData)
+{
+    const std::vector<uint32> remap = OptimizeVertexFetchRemap(meshData.m_indices32.data(),
+                                                               meshData.m_indices32.size(),
+                                                               meshData.VertexCount());
+    RemapStream(meshData.m_positions, remap);
+    RemapStream(meshData.m_normals, remap);
+    RemapStream(meshData.m_tangentUs, remap);
+    RemapStream(meshData.m_texCs, remap);
+}
+
+// ====================================================================================================================
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(
+    const uint32* pIndices,
+    size_t        indexCount,
+    uint32        vertexCount,
+    uint32        cacheSize)
+{
+    VertexCacheStats stats = {};
+    stats.triangleCount    = static_cast<uint32>(indexCount / 3);
+
+    // FIFO cache: a vertex is a hit if fewer than cacheSize misses happened since it was last inserted.
+    std::vector<uint32> insertTime(vertexCount, InvalidIndex);
+
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const uint32 v = pIndices[i];
+
+        if (insertTime[v] == InvalidIndex)
+        {
+            stats.vertexCount++;
+        }
+
+        if ((insertTime[v] == InvalidIndex) || (stats.transformedVertices - insertTime[v] >= cacheSize))
+        {
+            insertTime[v] = stats.transformedVertices++;
+        }
+    }
+
+    stats.acmr = (stats.triangleCount > 0) ? float(stats.transformedVertices) / stats.triangleCount : 0.0f;
+    stats.atvr = (stats.vertexCount > 0)   ? float(stats.transformedVertices) / stats.vertexCount   : 0.0f;
+
+    return stats;
+}
+
+// ====================================================================================================================
+// Counts the post-transform cache misses of triangles [firstTri, firstTri + triCount), starting from an empty cache.
+// Optionally marks triangles whose three vertices all missed, i.e. where the cache was effectively flushed.
+static uint32 CountCacheMisses(
+    const uint32*         pIndices,
+    uint32                firstTri,
+    uint32                triCount,
+    std::vector<uint32>&  insertTime,
+    uint32&               timeStamp,
+    uint32                cacheSize,
+    std::vector<uint8_t>* pHardBoundaries)
+{
+    uint32 misses = 0;
+
+    for (uint32 t = firstTri; t < firstTri + triCount; ++t)
+    {
+        uint32 triMisses = 0;
+
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            const uint32 v = pIndices[t * 3 + k];
+            if (timeStamp - insertTime[v] > cacheSize)
+            {
+                insertTime[v] = timeStamp++;
+                triMisses++;
+            }
+        }
+
+        if ((pHardBoundaries != nullptr) && (triMisses == 3))
+        {
+            (*pHardBoundaries)[t] = 1;
+        }
+
+        misses += triMisses;
+    }
+
+    return misses;
+}
+
+// ====================================================================================================================
+void MeshOptimizer::OptimizeOverdraw(
+    uint32*      pIndices,
+    size_t       indexCount,
+    const float* pPositions,
+    size_t       positionStride,
+    uint32       vertexCount,
+    float        threshold)
+{
+    const uint32 triangleCount = static_cast<uint32>(indexCount / 3);
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Cache timestamps start far enough in the past that every first reference is a miss.
+    const uint32 cacheSize = DefaultCacheSize;
+
+    std::vector<uint32> insertTime(vertexCount, 0);
+    uint32              timeStamp = cacheSize + 1;
+
+    // Hard boundaries: triangles where the cache order already restarts (all three vertices miss). Reordering whole
+    // clusters between these points costs no cache efficiency at all.
+    std::vector<uint8_t> hardBoundaries(triangleCount, 0);
+    CountCacheMisses(pIndices, 0, triangleCount, insertTime, timeStamp, cacheSize, &hardBoundaries);
+    hardBoundaries[0] = 1;
+
+    // Soft boundaries: split hard clusters further wherever the miss ratio of the piece so far is within threshold
+    // of the whole cluster's miss ratio, so each piece keeps roughly the cluster's cache efficiency.
+    std::vector<uint32> clusterStarts;
+    uint32 hardStart = 0;
+    while (hardStart < triangleCount)
+    {
+        uint32 hardEnd = hardStart + 1;
+        while ((hardEnd < triangleCount) && (hardBoundaries[hardEnd] == 0))
+        {
+            hardEnd++;
+        }
+
+        timeStamp += cacheSize + 1;
+        const uint32 clusterMisses = CountCacheMisses(pIndices, hardStart, hardEnd - hardStart, insertTime, timeStamp, cacheSize, nullptr);
+        const float  clusterAcmr   = float(clusterMisses) / (hardEnd - hardStart);
+
+        uint32 pieceStart  = hardStart;
+        uint32 pieceMisses = 0;
+        timeStamp += cacheSize + 1;
+
+        clusterStarts.push_back(hardStart);
+
+        for (uint32 t = hardStart; t < hardEnd; ++t)
+        {
+            pieceMisses += CountCacheMisses(pIndices, t, 1, insertTime, timeStamp, cacheSize, nullptr);
+
+            const uint32 pieceSize = t + 1 - pieceStart;
+            if ((t + 1 < hardEnd) &&
+                (pieceSize >= MinOverdrawClusterSize) &&
+                (float(pieceMisses) / pieceSize <= clusterAcmr * threshold))
+            {
+                pieceStart  = t + 1;
+                pieceMisses = 0;
+                timeStamp  += cacheSize + 1;
+                clusterStarts.push_back(pieceStart);
+            }
+        }
+
+        hardStart = hardEnd;
+    }
+
+    clusterStarts.push_back(triangleCount);
+    const uint32 clusterCount = static_cast<uint32>(clusterStarts.size() - 1);
+
+    // Area weighted centroid of the whole mesh.
+    XMVECTOR meshCentroid = XMVectorZero();
+    float    meshArea     = 0.0f;
+
+    std::vector<XMFLOAT3> clusterCentroid(clusterCount);
+    std::vector<XMFLOAT3> clusterNormal(clusterCount);
+
+    for (uint32 c = 0; c < clusterCount; ++c)
+    {
+        XMVECTOR centroid = XMVectorZero();
+        XMVECTOR normal   = XMVectorZero();
+        float    area     = 0.0f;
+
+        for (uint32 t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+        {
+            const XMFLOAT3 p0 = LoadPosition(pPositions, positionStride, pIndices[t * 3 + 0]);
+            const XMFLOAT3 p1 = LoadPosition(pPositions, positionStride, pIndices[t * 3 + 1]);
+            const XMFLOAT3 p2 = LoadPosition(pPositions, positionStride, pIndices[t * 3 + 2]);
+
+            const XMVECTOR v0 = XMLoadFloat3(&p0);
+            const XMVECTOR v1 = XMLoadFloat3(&p1);
+            const XMVECTOR v2 = XMLoadFloat3(&p2);
+
+            // Cross product length is twice the triangle area, so it doubles as the area weighted normal.
+            const XMVECTOR n       = XMVector3Cross(v1 - v0, v2 - v0);
+            const float    triArea = XMVectorGetX(XMVector3Length(n));
+
+            centroid += (v0 + v1 + v2) * (triArea / 3.0f);
+            normal   += n;
+            area     += triArea;
+        }
+
+        meshCentroid += centroid;
+        meshArea     += area;
+
+        XMStoreFloat3(&clusterCentroid[c], (area > 0.0f) ? (centroid / area) : centroid);
+        XMStoreFloat3(&clusterNormal[c], XMVector3Normalize(normal));
+    }
+
+    meshCentroid = (meshArea > 0.0f) ? (meshCentroid / meshArea) : meshCentroid;
+
+    // Clusters far out along their own normal are likely to occlude the rest of the mesh, so they are drawn first.
+    std::vector<float>  sortKey(clusterCount);
+    std::vector<uint32> clusterOrder(clusterCount);
+
+    for (uint32 c = 0; c < clusterCount; ++c)
+    {
+        const XMVECTOR toCluster = XMLoadFloat3(&clusterCentroid[c]) - meshCentroid;
+        sortKey[c]      = XMVectorGetX(XMVector3Dot(toCluster, XMLoadFloat3(&clusterNormal[c])));
+        clusterOrder[c] = c;
+    }
+
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&](uint32 a, uint32 b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32> output;
+    output.reserve(indexCount);
+
+    for (uint32 c : clusterOrder)
+    {
+        output.insert(output.end(), pIndices + clusterStarts[c] * 3, pIndices + clusterStarts[c + 1] * 3);
+    }
+
+    std::copy(output.begin(), output.end(), pIndices);
+}
+
+// ====================================================================================================================
+// Rasterizes one triangle (already in pixel space) into the depth buffer with a LESS depth test and counts the
+// fragments that passed.
+static void RasterizeTriangle(
+    XMFLOAT3 v0,
+    XMFLOAT3 v1,
+    XMFLOAT3 v2,
+    uint32   resolution,
+    float*   pDepth,
+    uint64_t& pixelsShaded)
+{
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+    if (area == 0.0f)
+    {
+        return;
+    }
+
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    const int minX = std::max(0, static_cast<int>(floorf(std::min(v0.x, std::min(v1.x, v2.x)))));
+    const int minY = std::max(0, static_cast<int>(floorf(std::min(v0.y, std::min(v1.y, v2.y)))));
+    const int maxX = std::min(static_cast<int>(resolution) - 1, static_cast<int>(ceilf(std::max(v0.x, std::max(v1.x, v2.x)))));
+    const int maxY = std::min(static_cast<int>(resolution) - 1, static_cast<int>(ceilf(std::max(v0.y, std::max(v1.y, v2.y)))));
+
+    for (int y = minY; y <= maxY; ++y)
+    {
+        const float py = y + 0.5f;
+        for (int x = minX; x <= maxX; ++x)
+        {
+            const float px = x + 0.5f;
+
+            const float w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+            const float w1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+            const float w2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+
+            if ((w0 >= 0.0f) && (w1 >= 0.0f) && (w2 >= 0.0f))
+            {
+                const float z = (w0 * v0.z + w1 * v1.z + w2 * v2.z) / area;
+
+                float& depth = pDepth[y * resolution + x];
+                if (z < depth)
+                {
+                    depth = z;
+                    pixelsShaded++;
+                }
+            }
+        }
+    }
+}
+
+// ====================================================================================================================
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(
+    const uint32* pIndices,
+    size_t        indexCount,
+    const float*  pPositions,
+    size_t        positionStride,
+    uint32        vertexCount,
+    uint32        viewCount,
+    uint32        resolution)
+{
+    OverdrawStats stats = {};
+
+    if (vertexCount == 0)
+    {
+        return stats;
+    }
+
+    // Fit an orthographic view volume around the bounding sphere of the mesh.
+    XMVECTOR minP = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR maxP = XMVectorReplicate(-FLT_MAX);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        const XMFLOAT3 p = LoadPosition(pPositions, positionStride, v);
+        minP = XMVectorMin(minP, XMLoadFloat3(&p));
+        maxP = XMVectorMax(maxP, XMLoadFloat3(&p));
+    }
+
+    const XMVECTOR center = 0.5f * (minP + maxP);
+    const float    radius = std::max(XMVectorGetX(XMVector3Length(maxP - center)), 1e-6f);
+    const float    scale  = 0.5f * resolution / radius;
+
+    std::vector<float>    depth(resolution * resolution);
+    std::vector<XMFLOAT3> projected(vertexCount);
+
+    for (uint32 view = 0; view < viewCount; ++view)
+    {
+        // View directions spread evenly over the sphere (Fibonacci lattice).
+        const float dy    = 1.0f - 2.0f * (view + 0.5f) / viewCount;
+        const float r     = sqrtf(std::max(0.0f, 1.0f - dy * dy));
+        const float phi   = view * 2.39996323f;
+        const XMVECTOR look = XMVectorSet(r * cosf(phi), dy, r * sinf(phi), 0.0f);
+
+        const XMVECTOR worldUp = (fabsf(dy) > 0.99f) ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+        const XMVECTOR right   = XMVector3Normalize(XMVector3Cross(worldUp, look));
+        const XMVECTOR up      = XMVector3Cross(look, right);
+
+        for (uint32 v = 0; v < vertexCount; ++v)
+        {
+            const XMFLOAT3 p      = LoadPosition(pPositions, positionStride, v);
+            const XMVECTOR offset = XMLoadFloat3(&p) - center;
+
+            projected[v].x = (XMVectorGetX(XMVector3Dot(offset, right)) + radius) * scale;
+            projected[v].y = (XMVectorGetX(XMVector3Dot(offset, up)) + radius) * scale;
+            projected[v].z = XMVectorGetX(XMVector3Dot(offset, look));
+        }
+
+        std::fill(depth.begin(), depth.end(), FLT_MAX);
+
+        for (size_t i = 0; i + 2 < indexCount; i += 3)
+        {
+            const XMFLOAT3& p0 = projected[pIndices[i + 0]];
+            const XMFLOAT3& p1 = projected[pIndices[i + 1]];
+            const XMFLOAT3& p2 = projected[pIndices[i + 2]];
+
+            // Cull back faces like the default D3D12 rasterizer state (clockwise is front facing; y points up here).
+            const float area = (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x);
+            if (area >= 0.0f)
+            {
+                continue;
+            }
+
+            RasterizeTriangle(p0, p1, p2, resolution, depth.data(), stats.pixelsShaded);
+        }
+
+        for (float d : depth)
+        {
+            stats.pixelsCovered += (d != FLT_MAX) ? 1 : 0;
+        }
+    }
+
+    stats.overdraw = (stats.pixelsCovered > 0) ? float(double(stats.pixelsShaded) / double(stats.pixelsCovered)) : 0.0f;
+
+    return stats;
+}
+
+// ====================================================================================================================
+// Null for an empty mesh, which every caller returns early on.
+static const float* PositionStream(const MeshData& meshData)
+{
+    return meshData.m_vertices.empty() ? nullptr : &meshData.m_vertices[0].m_position.x;
+}
+
+static const float* PositionStream(const MeshDataSoA& meshData)
+{
+    return meshData.m_positions.empty() ? nullptr : &meshData.m_positions[0].x;
+}
+
+static size_t PositionStride(const MeshData&)    { return sizeof(Vertex); }
+static size_t PositionStride(const MeshDataSoA&) { return sizeof(XMFLOAT3); }
+
+// ====================================================================================================================
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(
+    const MeshData& meshData)
+{
+    return AnalyzeOverdraw(meshData.m_indices32.data(),
+                           meshData.m_indices32.size(),
+                           PositionStream(meshData),
+                           PositionStride(meshData),
+                           meshData.VertexCount());
+}
+
+// ====================================================================================================================
+OverdrawStats MeshOptimizer::AnalyzeOverdraw(
+    const MeshDataSoA& meshData)
+{
+    return AnalyzeOverdraw(meshData.m_indices32.data(),
+                           meshData.m_indices32.size(),
+                           PositionStream(meshData),
+                           PositionStride(meshData),
+                           meshData.VertexCount());
+}
+
+// ====================================================================================================================
+template<typename MeshT>
+static void OptimizeMesh(
+    MeshT&            meshData,
+    VertexCacheStats* pBefore,
+    VertexCacheStats* pAfter)
+{
+    if (pBefore != nullptr)
+    {
+        *pBefore = MeshOptimizer::AnalyzeVertexCache(meshData.m_indices32.data(), meshData.m_indices32.size(), meshData.VertexCount());
+    }
+
+    if (meshData.VertexCount() == 0)
+    {
+        return;
+    }
+
+    MeshOptimizer::OptimizeVertexCache(meshData.m_indices32.data(), meshData.m_indices32.size(), meshData.VertexCount());
+    MeshOptimizer::OptimizeOverdraw(meshData.m_indices32.data(),
+                                    meshData.m_indices32.size(),
+                                    PositionStream(meshData),
+                                    PositionStride(meshData),
+                                    meshData.VertexCount());
+    MeshOptimizer::OptimizeVertexFetch(meshData);
+
+    if (pAfter != nullptr)
+    {
+        *pAfter = MeshOptimizer::AnalyzeVertexCache(meshData.m_indices32.data(), meshData.m_indices32.size(), meshData.VertexCount());
+    }
+}
+
+// ====================================================================================================================
+void MeshOptimizer::Optimize(
+    MeshData&         meshData,
+    VertexCacheStats* pBefore,
+    VertexCacheStats* pAfter)
+{
+    OptimizeMesh(meshData, pBefore, pAfter);
+}
+
+// ====================================================================================================================
+void MeshOptimizer::Optimize(
+    MeshDataSoA&      meshData,
+    VertexCacheStats* pBefore,
+    VertexCacheStats* pAfter)
+{
+    OptimizeMesh(meshData, pBefore, pAfter);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Post-transform vertex cache statistics for an index buffer.
+//  - ACMR: average cache miss ratio, transformed vertices per triangle (0.5 is ideal for large regular meshes, 3 is
+//    the worst case).
+//  - ATVR: average transform to vertex ratio, transformed vertices per referenced vertex (1.0 is ideal).
+struct VertexCacheStats
+{
+    uint32 triangleCount       = 0;
+    uint32 vertexCount         = 0;
+    uint32 transformedVertices = 0;
+    float  acmr                = 0.0f;
+    float  atvr                = 0.0f;
+};
+
+// ====================================================================================================================
+// Result of rasterizing a mesh from several viewpoints with a depth test.
+//  - overdraw: fragments that passed the depth test per covered pixel (1.0 means every pixel was shaded once).
+struct OverdrawStats
+{
+    uint64_t pixelsCovered = 0;
+    uint64_t pixelsShaded  = 0;
+    float    overdraw      = 0.0f;
+};
+
+// ====================================================================================================================
+// Reorders indices and vertices of triangle lists for the GPU:
+// - OptimizeVertexCache() reorders triangles for post-transform cache locality (Tipsify, Sander et al. 2007).
+// - OptimizeVertexFetch() reorders vertices into first-use order so vertex fetch walks memory linearly.
+// - OptimizeOverdraw() splits the cache optimized triangle order into clusters and draws the clusters that are most
+//   likely to occlude the rest first (Sander et al. 2007). It is view independent and keeps most of the cache locality.
+// - AnalyzeVertexCache() simulates a FIFO post-transform cache and reports ACMR/ATVR.
+// - AnalyzeOverdraw() rasterizes the mesh from several directions on the CPU and reports the overdraw.
+class MeshOptimizer
+{
+public:
+    static const uint32 DefaultCacheSize = 16;
+    static const float  DefaultOverdrawThreshold;
+
+    static void OptimizeVertexCache(uint32* pIndices, size_t indexCount, uint32 vertexCount, uint32 cacheSize = DefaultCacheSize);
+
+    // Builds a remap table old vertex -> new vertex in first-use order and rewrites pIndices with it. Vertices that are
+    // not referenced keep their relative order after the referenced ones.
+    static std::vector<uint32> OptimizeVertexFetchRemap(uint32* pIndices, size_t indexCount, uint32 vertexCount);
+
+    static void OptimizeVertexFetch(MeshData& meshData);
+    static void OptimizeVertexFetch(MeshDataSoA& meshData);
+
+    // Positions are read from pPositions with positionStride bytes between vertices. The indices should already be
+    // cache optimized; a cluster is only split where the cache miss ratio stays within threshold of the cluster's own.
+    static void OptimizeOverdraw(uint32*      pIndices,
+                                 size_t       indexCount,
+                                 const float* pPositions,
+                                 size_t       positionStride,
+                                 uint32       vertexCount,
+                                 float        threshold = DefaultOverdrawThreshold);
+
+    static VertexCacheStats AnalyzeVertexCache(const uint32* pIndices, size_t indexCount, uint32 vertexCount, uint32 cacheSize = DefaultCacheSize);
+
+    static OverdrawStats AnalyzeOverdraw(const uint32* pIndices,
+                                         size_t        indexCount,
+                                         const float*  pPositions,
+                                         size_t        positionStride,
+                                         uint32        vertexCount,
+                                         uint32        viewCount  = 16,
+                                         uint32        resolution = 256);
+
+    static OverdrawStats AnalyzeOverdraw(const MeshData& meshData);
+    static OverdrawStats AnalyzeOverdraw(const MeshDataSoA& meshData);
+
+    // Runs the cache, overdraw and fetch passes on the mesh. The optional stats are filled before and after optimization.
+    static void Optimize(MeshData& meshData, VertexCacheStats* pBefore = nullptr, VertexCacheStats* pAfter = nullptr);
+    static void Optimize(MeshDataSoA& meshData, VertexCacheStats* pBefore = nullptr, VertexCacheStats* pAfter = nullptr);
+};
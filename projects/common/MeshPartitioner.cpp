@@ -0,0 +1,109 @@
+#include "MeshPartitioner.h"
+#include <cassert>
+
+// ====================================================================================================================
+// Walks the triangles and calls onTriangle(part, triangle, pLocal) with the part each triangle goes to and the part
+// local index of each of its corners; vertices new to the part get the next local index.
+template<typename TriangleFunc>
+static uint32 WalkParts(
+    const MeshData& meshData,
+    uint32          maxVertices,
+    TriangleFunc    onTriangle)
+{
+    assert(maxVertices >= 3);
+
+    const uint32  triangleCount = meshData.IndexCount() / 3;
+    const uint32* pIndices      = meshData.m_indices32.data();
+
+    // Part that last used each vertex and its index there. Parts only move forward, so a vertex with another part
+    // number is not in the current part.
+    std::vector<uint32> vertexPart(meshData.VertexCount(), UINT32_MAX);
+    std::vector<uint32> vertexLocal(meshData.VertexCount());
+
+    uint32 part            = 0;
+    uint32 partVertexCount = 0;
+    for (uint32 t = 0; t < triangleCount; ++t)
+    {
+        const uint32* pCorners = pIndices + 3 * t;
+
+        // Degenerate triangles can name a vertex twice.
+        uint32 newVertices = 0;
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            const uint32 v    = pCorners[k];
+            const bool   seen = (vertexPart[v] == part) || ((k > 0) && (v == pCorners[0])) || ((k == 2) && (v == pCorners[1]));
+            newVertices += seen ? 0 : 1;
+        }
+
+        if (partVertexCount + newVertices > maxVertices)
+        {
+            part++;
+            partVertexCount = 0;
+        }
+
+        uint32 local[3];
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            const uint32 v = pCorners[k];
+            if (vertexPart[v] != part)
+            {
+                vertexPart[v]  = part;
+                vertexLocal[v] = partVertexCount++;
+            }
+            local[k] = vertexLocal[v];
+        }
+
+        onTriangle(part, t, local);
+    }
+
+    return (triangleCount > 0) ? part + 1 : 0;
+}
+
+// ====================================================================================================================
+uint32 MeshPartitioner::CountParts(
+    const MeshData& meshData,
+    uint32          maxVertices)
+{
+    if (meshData.VertexCount() <= maxVertices)
+    {
+        return 1;
+    }
+
+    return WalkParts(meshData, maxVertices, [](uint32, uint32, const uint32*) {});
+}
+
+// ====================================================================================================================
+std::vector<MeshData> MeshPartitioner::Split(
+    const MeshData& meshData,
+    uint32          maxVertices)
+{
+    std::vector<MeshData> parts;
+    if (meshData.VertexCount() <= maxVertices)
+    {
+        parts.push_back(meshData);
+        return parts;
+    }
+
+    const uint32* pIndices = meshData.m_indices32.data();
+
+    WalkParts(meshData, maxVertices, [&](uint32 part, uint32 triangle, const uint32* pLocal)
+    {
+        if (part == parts.size())
+        {
+            parts.emplace_back();
+        }
+
+        MeshData& target = parts[part];
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            // Local indices are handed out in order, so a new vertex is always the next one.
+            if (pLocal[k] == target.VertexCount())
+            {
+                target.PushVertex(meshData.m_vertices[pIndices[3 * triangle + k]]);
+            }
+            target.PushIndex(pLocal[k]);
+        }
+    });
+
+    return parts;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Splits meshes with more vertices than 16 bit indices can address into parts that each fit, so they can be drawn
+// with 16 bit indices and a baseVertexLocation per part instead of moving the whole batch to 32 bit indices.
+//
+// Triangles are taken in index order and go to the current part until one would push it past maxVertices; each part's
+// vertices are numbered in the order its triangles first use them. Meshes reordered by MeshOptimizer therefore keep
+// their post-transform and vertex fetch locality, and only vertices on the borders between parts are duplicated.
+class MeshPartitioner
+{
+public:
+    static const uint32 MaxVertices16 = 0x10000;
+
+    // Returns meshData itself as the only part if it already fits. maxVertices has to be at least 3.
+    static std::vector<MeshData> Split(const MeshData& meshData, uint32 maxVertices = MaxVertices16);
+
+    // Number of parts Split() returns, without building them.
+    static uint32 CountParts(const MeshData& meshData, uint32 maxVertices = MaxVertices16);
+};
@@ -0,0 +1,684 @@
+#include "MeshSimplifier.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+// Work items per thread below which a parallel loop is not worth spawning threads for.
+static const uint32 MinItemsPerThread = 16 * 1024;
+
+// A collapse is rejected if it turns a remaining triangle's normal by more than ~75 degrees.
+static const float MinNormalDot = 0.25f;
+
+const float MeshSimplifier::DefaultAttributeWeight = 0.01f;
+
+// ====================================================================================================================
+// Symmetric 4x4 plane quadric, stored as its 10 unique coefficients, plus the accumulated triangle area so the error is
+// the area weighted mean squared distance to the planes.
+struct Quadric
+{
+    float a2 = 0.0f, ab = 0.0f, ac = 0.0f, ad = 0.0f;
+    float b2 = 0.0f, bc = 0.0f, bd = 0.0f;
+    float c2 = 0.0f, cd = 0.0f;
+    float d2 = 0.0f;
+    float weight = 0.0f;
+
+    void Add(const Quadric& q)
+    {
+        a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+        b2 += q.b2; bc += q.bc; bd += q.bd;
+        c2 += q.c2; cd += q.cd;
+        d2 += q.d2;
+        weight += q.weight;
+    }
+
+    float Error(const XMFLOAT3& p) const
+    {
+        const float rx = a2 * p.x + ab * p.y + ac * p.z + ad;
+        const float ry = ab * p.x + b2 * p.y + bc * p.z + bd;
+        const float rz = ac * p.x + bc * p.y + c2 * p.z + cd;
+        const float e  = rx * p.x + ry * p.y + rz * p.z + ad * p.x + bd * p.y + cd * p.z + d2;
+
+        return (weight > 0.0f) ? std::max(0.0f, e / weight) : 0.0f;
+    }
+};
+
+struct Collapse
+{
+    float  cost;  // Geometric error plus attribute penalty, used for ordering
+    float  error; // Geometric error only
+    uint32 from;
+    uint32 to;
+};
+
+// ====================================================================================================================
+// Attribute streams of the mesh being simplified. Positions are normalized to the unit cube so the attribute weight does
+// not depend on the size of the mesh.
+struct SimplifierInput
+{
+    std::vector<XMFLOAT3> positions;
+    std::vector<XMFLOAT3> normals;
+    std::vector<XMFLOAT2> texCs;
+    float                 scale = 1.0f; // Normalized -> object space
+};
+
+// ====================================================================================================================
+static SimplifierInput GatherInput(
+    const XMFLOAT3* pPositions,
+    size_t          positionStride,
+    const XMFLOAT3* pNormals,
+    size_t          normalStride,
+    const XMFLOAT2* pTexCs,
+    size_t          texCStride,
+    uint32          vertexCount)
+{
+    SimplifierInput input;
+    input.positions.resize(vertexCount);
+    input.normals.resize(vertexCount);
+    input.texCs.resize(vertexCount);
+
+    XMVECTOR minPos = XMVectorReplicate(FLT_MAX);
+    XMVECTOR maxPos = XMVectorReplicate(-FLT_MAX);
+
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        input.positions[v] = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pPositions) + v * positionStride);
+        input.normals[v]   = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(pNormals) + v * normalStride);
+        input.texCs[v]     = *reinterpret_cast<const XMFLOAT2*>(reinterpret_cast<const uint8_t*>(pTexCs) + v * texCStride);
+
+        const XMVECTOR p = XMLoadFloat3(&input.positions[v]);
+        minPos = XMVectorMin(minPos, p);
+        maxPos = XMVectorMax(maxPos, p);
+    }
+
+    const XMVECTOR extent = maxPos - minPos;
+    input.scale = std::max(XMVectorGetX(extent), std::max(XMVectorGetY(extent), XMVectorGetZ(extent)));
+    if (input.scale <= 0.0f)
+    {
+        input.scale = 1.0f;
+    }
+
+    const XMVECTOR invScale = XMVectorReplicate(1.0f / input.scale);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        XMStoreFloat3(&input.positions[v], (XMLoadFloat3(&input.positions[v]) - minPos) * invScale);
+    }
+
+    return input;
+}
+
+// ====================================================================================================================
+// Vertex -> triangle adjacency in compressed row form.
+static void BuildTriangleAdjacency(
+    const std::vector<uint32>& indices,
+    const uint32*              pRemap,
+    uint32                     vertexCount,
+    std::vector<uint32>&       offsets,
+    std::vector<uint32>&       triangles)
+{
+    offsets.assign(vertexCount + 1, 0);
+    for (uint32 index : indices)
+    {
+        offsets[pRemap[index] + 1]++;
+    }
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        offsets[v + 1] += offsets[v];
+    }
+
+    triangles.resize(indices.size());
+    std::vector<uint32> cursor(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        triangles[cursor[pRemap[indices[i]]]++] = static_cast<uint32>(i / 3);
+    }
+}
+
+// ====================================================================================================================
+static XMVECTOR TriangleNormal(
+    const SimplifierInput& input,
+    uint32                 i0,
+    uint32                 i1,
+    uint32                 i2)
+{
+    const XMVECTOR p0 = XMLoadFloat3(&input.positions[i0]);
+    const XMVECTOR p1 = XMLoadFloat3(&input.positions[i1]);
+    const XMVECTOR p2 = XMLoadFloat3(&input.positions[i2]);
+    return XMVector3Cross(p1 - p0, p2 - p0);
+}
+
+// ====================================================================================================================
+// Simplification state that is kept across the levels of an LOD chain, so later levels continue from the quadrics of
+// the earlier ones instead of starting over from the already simplified surface.
+class Simplifier
+{
+public:
+    Simplifier(const SimplifierInput& input, const std::vector<uint32>& indices, float attributeWeight, uint32 maxThreads);
+
+    // Collapses edges until at most targetIndexCount indices are left or the next collapse would exceed maxErrorSq.
+    void Run(size_t targetIndexCount, float maxErrorSq);
+
+    const std::vector<uint32>& Indices() const { return m_indices; }
+    float                      Error() const   { return sqrtf(m_errorSq) * m_input.scale; }
+
+private:
+    void LockVertices();
+    void ComputeQuadrics();
+    bool RunPass(size_t targetIndexCount, float maxErrorSq);
+
+    const SimplifierInput& m_input;
+    std::vector<uint32>    m_indices;
+    std::vector<uint8_t>   m_locked;
+    std::vector<Quadric>   m_quadrics;
+    float                  m_attributeWeight;
+    uint32                 m_maxThreads;
+    float                  m_errorSq = 0.0f;
+};
+
+// ====================================================================================================================
+Simplifier::Simplifier(
+    const SimplifierInput&     input,
+    const std::vector<uint32>& indices,
+    float                      attributeWeight,
+    uint32                     maxThreads)
+    :
+    m_input(input),
+    m_indices(indices),
+    m_attributeWeight(attributeWeight),
+    m_maxThreads(maxThreads)
+{
+    LockVertices();
+    ComputeQuadrics();
+}
+
+// ====================================================================================================================
+// Locks seam vertices (more than one vertex at the same position) and vertices whose edges are not shared by exactly two
+// triangles in opposite directions, which covers open borders and non-manifold geometry.
+void Simplifier::LockVertices()
+{
+    const uint32 vertexCount = static_cast<uint32>(m_input.positions.size());
+
+    // Group vertices by position.
+    std::vector<uint32> order(vertexCount);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        order[v] = v;
+    }
+
+    auto Less = [&](uint32 a, uint32 b)
+    {
+        const XMFLOAT3& pa = m_input.positions[a];
+        const XMFLOAT3& pb = m_input.positions[b];
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        return pa.z < pb.z;
+    };
+    std::sort(order.begin(), order.end(), Less);
+
+    std::vector<uint32> positionId(vertexCount);
+    m_locked.assign(vertexCount, 0);
+
+    for (uint32 i = 0; i < vertexCount;)
+    {
+        uint32 end = i + 1;
+        while ((end < vertexCount) && (Less(order[i], order[end]) == false))
+        {
+            end++;
+        }
+
+        for (uint32 k = i; k < end; ++k)
+        {
+            positionId[order[k]] = order[i];
+            m_locked[order[k]]   = (end - i > 1) ? 1 : 0;
+        }
+
+        i = end;
+    }
+
+    // Every edge around an interior vertex appears once leaving and once entering the vertex.
+    std::vector<uint32> offsets;
+    std::vector<uint32> triangles;
+    BuildTriangleAdjacency(m_indices, positionId.data(), vertexCount, offsets, triangles);
+
+    ParallelFor(vertexCount, MinItemsPerThread, m_maxThreads, [&](uint32 begin, uint32 end)
+    {
+        std::vector<uint32> outgoing;
+        std::vector<uint32> incoming;
+
+        for (uint32 v = begin; v < end; ++v)
+        {
+            if ((m_locked[v] != 0) || (positionId[v] != v))
+            {
+                continue;
+            }
+
+            outgoing.clear();
+            incoming.clear();
+
+            for (uint32 a = offsets[v]; a < offsets[v + 1]; ++a)
+            {
+                const uint32* pTri = &m_indices[triangles[a] * 3];
+                for (uint32 k = 0; k < 3; ++k)
+                {
+                    if (positionId[pTri[k]] == v)
+                    {
+                        outgoing.push_back(positionId[pTri[(k + 1) % 3]]);
+                        incoming.push_back(positionId[pTri[(k + 2) % 3]]);
+                    }
+                }
+            }
+
+            std::sort(outgoing.begin(), outgoing.end());
+            std::sort(incoming.begin(), incoming.end());
+
+            const bool manifold = (outgoing == incoming) &&
+                                  (std::adjacent_find(outgoing.begin(), outgoing.end()) == outgoing.end());
+            if (manifold == false)
+            {
+                m_locked[v] = 1;
+            }
+        }
+    });
+}
+
+// ====================================================================================================================
+void Simplifier::ComputeQuadrics()
+{
+    const uint32 vertexCount   = static_cast<uint32>(m_input.positions.size());
+    const uint32 triangleCount = static_cast<uint32>(m_indices.size() / 3);
+
+    std::vector<Quadric> triangleQuadrics(triangleCount);
+
+    ParallelFor(triangleCount, MinItemsPerThread, m_maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 t = begin; t < end; ++t)
+        {
+            const uint32* pTri   = &m_indices[t * 3];
+            const XMVECTOR n     = TriangleNormal(m_input, pTri[0], pTri[1], pTri[2]);
+            const float    len   = XMVectorGetX(XMVector3Length(n));
+            if (len <= 0.0f)
+            {
+                continue;
+            }
+
+            XMFLOAT3 unit;
+            XMStoreFloat3(&unit, n / len);
+
+            const XMFLOAT3& p0     = m_input.positions[pTri[0]];
+            const float     d      = -(unit.x * p0.x + unit.y * p0.y + unit.z * p0.z);
+            const float     weight = 0.5f * len;
+
+            Quadric& q = triangleQuadrics[t];
+            q.a2 = weight * unit.x * unit.x; q.ab = weight * unit.x * unit.y; q.ac = weight * unit.x * unit.z; q.ad = weight * unit.x * d;
+            q.b2 = weight * unit.y * unit.y; q.bc = weight * unit.y * unit.z; q.bd = weight * unit.y * d;
+            q.c2 = weight * unit.z * unit.z; q.cd = weight * unit.z * d;
+            q.d2 = weight * d * d;
+            q.weight = weight;
+        }
+    });
+
+    std::vector<uint32> identity(vertexCount);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        identity[v] = v;
+    }
+
+    std::vector<uint32> offsets;
+    std::vector<uint32> triangles;
+    BuildTriangleAdjacency(m_indices, identity.data(), vertexCount, offsets, triangles);
+
+    m_quadrics.assign(vertexCount, Quadric());
+
+    ParallelFor(vertexCount, MinItemsPerThread, m_maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 v = begin; v < end; ++v)
+        {
+            for (uint32 a = offsets[v]; a < offsets[v + 1]; ++a)
+            {
+                m_quadrics[v].Add(triangleQuadrics[triangles[a]]);
+            }
+        }
+    });
+}
+
+// ====================================================================================================================
+// One pass: evaluates every collapsible edge, then applies the cheapest ones greedily. A vertex takes part in at most one
+// collapse per pass, which keeps the costs computed at the start of the pass valid.
+bool Simplifier::RunPass(
+    size_t targetIndexCount,
+    float  maxErrorSq)
+{
+    const uint32 vertexCount   = static_cast<uint32>(m_input.positions.size());
+    const uint32 triangleCount = static_cast<uint32>(m_indices.size() / 3);
+
+    std::vector<uint32> identity(vertexCount);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        identity[v] = v;
+    }
+
+    std::vector<uint32> offsets;
+    std::vector<uint32> triangles;
+    BuildTriangleAdjacency(m_indices, identity.data(), vertexCount, offsets, triangles);
+
+    // Each interior edge is seen from both of its triangles; only the one that walks it from the lower index keeps it.
+    std::vector<Collapse> candidates(m_indices.size());
+    std::vector<uint8_t>  valid(m_indices.size(), 0);
+
+    ParallelFor(triangleCount, MinItemsPerThread, m_maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 t = begin; t < end; ++t)
+        {
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                const uint32 a = m_indices[t * 3 + k];
+                const uint32 b = m_indices[t * 3 + (k + 1) % 3];
+                if ((a >= b) || ((m_locked[a] != 0) && (m_locked[b] != 0)))
+                {
+                    continue;
+                }
+
+                const XMFLOAT3& na = m_input.normals[a];
+                const XMFLOAT3& nb = m_input.normals[b];
+                const XMFLOAT2& ta = m_input.texCs[a];
+                const XMFLOAT2& tb = m_input.texCs[b];
+
+                const float attributeError = (na.x - nb.x) * (na.x - nb.x) + (na.y - nb.y) * (na.y - nb.y) +
+                                             (na.z - nb.z) * (na.z - nb.z) + (ta.x - tb.x) * (ta.x - tb.x) +
+                                             (ta.y - tb.y) * (ta.y - tb.y);
+                const float penalty = m_attributeWeight * attributeError;
+
+                const float errorAB = (m_locked[a] == 0) ? m_quadrics[a].Error(m_input.positions[b]) : FLT_MAX;
+                const float errorBA = (m_locked[b] == 0) ? m_quadrics[b].Error(m_input.positions[a]) : FLT_MAX;
+
+                Collapse& c = candidates[t * 3 + k];
+                c.from  = (errorAB <= errorBA) ? a : b;
+                c.to    = (errorAB <= errorBA) ? b : a;
+                c.error = std::min(errorAB, errorBA);
+                c.cost  = c.error + penalty;
+
+                valid[t * 3 + k] = 1;
+            }
+        }
+    });
+
+    size_t candidateCount = 0;
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (valid[i] != 0)
+        {
+            candidates[candidateCount++] = candidates[i];
+        }
+    }
+    candidates.resize(candidateCount);
+
+    std::sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+    std::vector<uint8_t> touched(vertexCount, 0);
+    const uint32         targetTriangles  = static_cast<uint32>(targetIndexCount / 3);
+    uint32               removedTriangles = 0;
+    bool                 collapsed        = false;
+
+    for (const Collapse& c : candidates)
+    {
+        if ((triangleCount - removedTriangles <= targetTriangles) || (c.error > maxErrorSq))
+        {
+            break;
+        }
+
+        if ((touched[c.from] != 0) || (touched[c.to] != 0))
+        {
+            continue;
+        }
+
+        // The triangles around c.from are exactly its triangles at the start of the pass, since nothing has collapsed
+        // into it. Reject the collapse if one of the remaining ones would flip or become a sliver.
+        bool   flips   = false;
+        uint32 removes = 0;
+        for (uint32 a = offsets[c.from]; (a < offsets[c.from + 1]) && (flips == false); ++a)
+        {
+            const uint32* pTri = &m_indices[triangles[a] * 3];
+            if ((pTri[0] == pTri[1]) || (pTri[1] == pTri[2]) || (pTri[0] == pTri[2]))
+            {
+                continue; // Already removed by an earlier collapse of this pass
+            }
+
+            if ((pTri[0] == c.to) || (pTri[1] == c.to) || (pTri[2] == c.to))
+            {
+                removes++;
+                continue;
+            }
+
+            const uint32   i0     = (pTri[0] == c.from) ? c.to : pTri[0];
+            const uint32   i1     = (pTri[1] == c.from) ? c.to : pTri[1];
+            const uint32   i2     = (pTri[2] == c.from) ? c.to : pTri[2];
+            const XMVECTOR before = TriangleNormal(m_input, pTri[0], pTri[1], pTri[2]);
+            const XMVECTOR after  = TriangleNormal(m_input, i0, i1, i2);
+
+            const float dot = XMVectorGetX(XMVector3Dot(before, after));
+            flips = dot <= MinNormalDot * XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+        }
+
+        if (flips || (removes == 0))
+        {
+            continue;
+        }
+
+        for (uint32 a = offsets[c.from]; a < offsets[c.from + 1]; ++a)
+        {
+            uint32* pTri = &m_indices[triangles[a] * 3];
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                pTri[k] = (pTri[k] == c.from) ? c.to : pTri[k];
+            }
+        }
+
+        m_quadrics[c.to].Add(m_quadrics[c.from]);
+        m_errorSq = std::max(m_errorSq, c.error);
+
+        touched[c.from]   = 1;
+        touched[c.to]     = 1;
+        removedTriangles += removes;
+        collapsed         = true;
+    }
+
+    // Drop the triangles that collapsed to a line.
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < m_indices.size(); i += 3)
+    {
+        const uint32 i0 = m_indices[i + 0];
+        const uint32 i1 = m_indices[i + 1];
+        const uint32 i2 = m_indices[i + 2];
+        if ((i0 != i1) && (i1 != i2) && (i0 != i2))
+        {
+            m_indices[writeIndex++] = i0;
+            m_indices[writeIndex++] = i1;
+            m_indices[writeIndex++] = i2;
+        }
+    }
+    m_indices.resize(writeIndex);
+
+    return collapsed;
+}
+
+// ====================================================================================================================
+void Simplifier::Run(
+    size_t targetIndexCount,
+    float  maxErrorSq)
+{
+    while (m_indices.size() > targetIndexCount)
+    {
+        if (RunPass(targetIndexCount, maxErrorSq) == false)
+        {
+            break;
+        }
+    }
+}
+
+// ====================================================================================================================
+static std::vector<MeshLod> GenerateLodChain(
+    const SimplifierInput&     input,
+    const std::vector<uint32>& indices,
+    uint32                     maxLodCount,
+    float                      reduction,
+    float                      attributeWeight,
+    uint32                     maxThreads)
+{
+    std::vector<MeshLod> lods;
+    if (maxLodCount == 0)
+    {
+        return lods;
+    }
+
+    lods.emplace_back();
+    lods.back().m_indices32 = indices;
+
+    Simplifier simplifier(input, indices, attributeWeight, maxThreads);
+
+    while (lods.size() < maxLodCount)
+    {
+        const size_t previousCount = lods.back().m_indices32.size();
+        const size_t targetCount   = static_cast<size_t>(previousCount / 3 * reduction) * 3;
+
+        simplifier.Run(targetCount, FLT_MAX);
+
+        // Stop once locked vertices or flips keep the mesh from getting meaningfully smaller.
+        const size_t count = simplifier.Indices().size();
+        if ((count == 0) || (count > previousCount - (previousCount - targetCount) / 2))
+        {
+            break;
+        }
+
+        lods.emplace_back();
+        lods.back().m_indices32 = simplifier.Indices();
+        lods.back().error       = simplifier.Error();
+    }
+
+    return lods;
+}
+
+// ====================================================================================================================
+static SimplifierInput GatherInput(
+    const MeshData& meshData)
+{
+    if (meshData.VertexCount() == 0)
+    {
+        return SimplifierInput();
+    }
+
+    return GatherInput(&meshData.m_vertices[0].m_position, sizeof(Vertex),
+                       &meshData.m_vertices[0].m_normal, sizeof(Vertex),
+                       &meshData.m_vertices[0].m_texC, sizeof(Vertex),
+                       meshData.VertexCount());
+}
+
+// ====================================================================================================================
+static SimplifierInput GatherInput(
+    const MeshDataSoA& meshData)
+{
+    if (meshData.VertexCount() == 0)
+    {
+        return SimplifierInput();
+    }
+
+    return GatherInput(meshData.m_positions.data(), sizeof(XMFLOAT3),
+                       meshData.m_normals.data(), sizeof(XMFLOAT3),
+                       meshData.m_texCs.data(), sizeof(XMFLOAT2),
+                       meshData.VertexCount());
+}
+
+// ====================================================================================================================
+std::vector<uint32> MeshSimplifier::Simplify(
+    const MeshData& meshData,
+    size_t          targetIndexCount,
+    float           maxError,
+    float*          pResultError,
+    float           attributeWeight,
+    uint32          maxThreads)
+{
+    const SimplifierInput input = GatherInput(meshData);
+
+    Simplifier simplifier(input, meshData.m_indices32, attributeWeight, maxThreads);
+
+    const float normalizedError = (maxError == FLT_MAX) ? FLT_MAX : maxError / input.scale;
+    simplifier.Run(targetIndexCount, (normalizedError == FLT_MAX) ? FLT_MAX : normalizedError * normalizedError);
+
+    if (pResultError != nullptr)
+    {
+        *pResultError = simplifier.Error();
+    }
+
+    return simplifier.Indices();
+}
+
+// ====================================================================================================================
+std::vector<uint32> MeshSimplifier::Simplify(
+    const MeshDataSoA& meshData,
+    size_t             targetIndexCount,
+    float              maxError,
+    float*             pResultError,
+    float              attributeWeight,
+    uint32             maxThreads)
+{
+    const SimplifierInput input = GatherInput(meshData);
+
+    Simplifier simplifier(input, meshData.m_indices32, attributeWeight, maxThreads);
+
+    const float normalizedError = (maxError == FLT_MAX) ? FLT_MAX : maxError / input.scale;
+    simplifier.Run(targetIndexCount, (normalizedError == FLT_MAX) ? FLT_MAX : normalizedError * normalizedError);
+
+    if (pResultError != nullptr)
+    {
+        *pResultError = simplifier.Error();
+    }
+
+    return simplifier.Indices();
+}
+
+// ====================================================================================================================
+std::vector<MeshLod> MeshSimplifier::GenerateLodChain(
+    const MeshData& meshData,
+    uint32          maxLodCount,
+    float           reduction,
+    float           attributeWeight,
+    uint32          maxThreads)
+{
+    return ::GenerateLodChain(GatherInput(meshData), meshData.m_indices32, maxLodCount, reduction, attributeWeight, maxThreads);
+}
+
+// ====================================================================================================================
+std::vector<MeshLod> MeshSimplifier::GenerateLodChain(
+    const MeshDataSoA& meshData,
+    uint32             maxLodCount,
+    float              reduction,
+    float              attributeWeight,
+    uint32             maxThreads)
+{
+    return ::GenerateLodChain(GatherInput(meshData), meshData.m_indices32, maxLodCount, reduction, attributeWeight, maxThreads);
+}
+
+// ====================================================================================================================
+uint32 MeshSimplifier::SelectLod(
+    const std::vector<MeshLod>& lods,
+    float                       distance,
+    float                       fovY,
+    float                       viewportHeight,
+    float                       maxPixelError)
+{
+    // Pixels covered by one object space unit at this distance.
+    const float pixelsPerUnit = viewportHeight / (2.0f * std::max(distance, 1e-4f) * tanf(0.5f * fovY));
+
+    uint32 selected = 0;
+    for (uint32 i = 1; i < lods.size(); ++i)
+    {
+        if (lods[i].error * pixelsPerUnit > maxPixelError)
+        {
+            break;
+        }
+        selected = i;
+    }
+
+    return selected;
+}
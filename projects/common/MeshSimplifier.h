@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cfloat>
+#include <cstddef>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// One level of detail. The indices reference the vertices of the source mesh, so all levels of a chain can share a
+// single vertex buffer and only differ in the index range that is drawn.
+// The error is the root of the largest area weighted mean squared distance of a kept vertex to the planes of the
+// source triangles it stands for. It is an RMS measure, not a bound: single points of the simplified surface can be
+// farther from the source.
+struct MeshLod
+{
+    std::vector<uint32> m_indices32;
+    float               error = 0.0f; // Quadric error of the worst collapse, in object space units
+};
+
+// ====================================================================================================================
+// Quadric error metric edge collapse (Garland and Heckbert 1997).
+// - Collapses are half edge collapses, so the kept vertex keeps its own normal, tangent and texture coordinates. The
+//   difference in normal and texture coordinates is added to the collapse cost, weighted by attributeWeight.
+// - Vertices on open borders, on attribute seams (several vertices at the same position) and non-manifold vertices are
+//   locked, which keeps the outline of the mesh and hides no cracks between differently textured parts.
+// - Collapses run in passes over the cheapest independent edges; quadrics and collapse costs of a pass are evaluated on
+//   up to maxThreads threads (0 = all hardware threads).
+class MeshSimplifier
+{
+public:
+    static const float DefaultAttributeWeight;
+
+    // Simplifies to at most targetIndexCount indices, or less if maxError (object space units, as MeshLod::error)
+    // would be exceeded.
+    // The error of the result is returned in pResultError.
+    static std::vector<uint32> Simplify(const MeshData& meshData,
+                                        size_t          targetIndexCount,
+                                        float           maxError        = FLT_MAX,
+                                        float*          pResultError    = nullptr,
+                                        float           attributeWeight = DefaultAttributeWeight,
+                                        uint32          maxThreads      = 0);
+
+    static std::vector<uint32> Simplify(const MeshDataSoA& meshData,
+                                        size_t             targetIndexCount,
+                                        float              maxError        = FLT_MAX,
+                                        float*             pResultError    = nullptr,
+                                        float              attributeWeight = DefaultAttributeWeight,
+                                        uint32             maxThreads      = 0);
+
+    // LOD 0 is the source index buffer, every following LOD has about reduction times the triangles of the previous
+    // one. The chain stops early once the mesh can not be reduced any further.
+    static std::vector<MeshLod> GenerateLodChain(const MeshData& meshData,
+                                                 uint32          maxLodCount     = 5,
+                                                 float           reduction       = 0.5f,
+                                                 float           attributeWeight = DefaultAttributeWeight,
+                                                 uint32          maxThreads      = 0);
+
+    static std::vector<MeshLod> GenerateLodChain(const MeshDataSoA& meshData,
+                                                 uint32             maxLodCount     = 5,
+                                                 float              reduction       = 0.5f,
+                                                 float              attributeWeight = DefaultAttributeWeight,
+                                                 uint32             maxThreads      = 0);
+
+    // Returns the coarsest LOD whose error projects to at most maxPixelError pixels at the given view distance. As the
+    // error is an RMS distance, this bounds the typical screen space deviation rather than the largest one.
+    static uint32 SelectLod(const std::vector<MeshLod>& lods,
+                            float                       distance,
+                            float                       fovY,
+                            float                       viewportHeight,
+                            float                       maxPixelError = 1.0f);
+};
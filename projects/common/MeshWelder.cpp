@@ -0,0 +1,376 @@
+#include "MeshWelder.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+static const uint32 MinVerticesPerThread = 16 * 1024;
+
+// ====================================================================================================================
+// Attribute streams of either mesh type, read through byte strides.
+struct WeldStreams
+{
+    const uint8_t* pPositions     = nullptr;
+    size_t         positionStride = 0;
+    const uint8_t* pNormals       = nullptr;
+    size_t         normalStride   = 0;
+    const uint8_t* pTangents      = nullptr;
+    size_t         tangentStride  = 0;
+    const uint8_t* pTexCs         = nullptr;
+    size_t         texCStride     = 0;
+
+    const XMFLOAT3& Position(uint32 v) const { return *reinterpret_cast<const XMFLOAT3*>(pPositions + v * positionStride); }
+    const XMFLOAT3& Normal(uint32 v) const   { return *reinterpret_cast<const XMFLOAT3*>(pNormals + v * normalStride); }
+    const XMFLOAT3& Tangent(uint32 v) const  { return *reinterpret_cast<const XMFLOAT3*>(pTangents + v * tangentStride); }
+    const XMFLOAT2& TexC(uint32 v) const     { return *reinterpret_cast<const XMFLOAT2*>(pTexCs + v * texCStride); }
+};
+
+// ====================================================================================================================
+static WeldStreams GetStreams(
+    const MeshData& meshData)
+{
+    const Vertex* pVertices = meshData.m_vertices.data();
+
+    WeldStreams streams;
+    streams.pPositions     = reinterpret_cast<const uint8_t*>(&pVertices->m_position);
+    streams.positionStride = sizeof(Vertex);
+    streams.pNormals       = reinterpret_cast<const uint8_t*>(&pVertices->m_normal);
+    streams.normalStride   = sizeof(Vertex);
+    streams.pTangents      = reinterpret_cast<const uint8_t*>(&pVertices->m_tangentU);
+    streams.tangentStride  = sizeof(Vertex);
+    streams.pTexCs         = reinterpret_cast<const uint8_t*>(&pVertices->m_texC);
+    streams.texCStride     = sizeof(Vertex);
+    return streams;
+}
+
+// ====================================================================================================================
+static WeldStreams GetStreams(
+    const MeshDataSoA& meshData)
+{
+    WeldStreams streams;
+    streams.pPositions     = reinterpret_cast<const uint8_t*>(meshData.m_positions.data());
+    streams.positionStride = sizeof(XMFLOAT3);
+    streams.pNormals       = reinterpret_cast<const uint8_t*>(meshData.m_normals.data());
+    streams.normalStride   = sizeof(XMFLOAT3);
+    streams.pTangents      = reinterpret_cast<const uint8_t*>(meshData.m_tangentUs.data());
+    streams.tangentStride  = sizeof(XMFLOAT3);
+    streams.pTexCs         = reinterpret_cast<const uint8_t*>(meshData.m_texCs.data());
+    streams.texCStride     = sizeof(XMFLOAT2);
+    return streams;
+}
+
+// ====================================================================================================================
+static float DistanceSq(
+    const XMFLOAT3& a,
+    const XMFLOAT3& b)
+{
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    const float dz = a.z - b.z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// ====================================================================================================================
+static float DistanceSq(
+    const XMFLOAT2& a,
+    const XMFLOAT2& b)
+{
+    const float dx = a.x - b.x;
+    const float dy = a.y - b.y;
+    return dx * dx + dy * dy;
+}
+
+// ====================================================================================================================
+// Squared tolerances; FLT_MAX squares to infinity, which every distance passes.
+struct WeldLimits
+{
+    float positionSq;
+    float normalSq;
+    float tangentSq;
+    float texCSq;
+
+    explicit WeldLimits(const WeldSettings& settings)
+        :
+        positionSq(settings.positionTolerance * settings.positionTolerance),
+        normalSq(settings.normalTolerance * settings.normalTolerance),
+        tangentSq(settings.tangentTolerance * settings.tangentTolerance),
+        texCSq(settings.texCTolerance * settings.texCTolerance)
+        {}
+
+    bool Match(const WeldStreams& streams, uint32 a, uint32 b) const
+    {
+        return (DistanceSq(streams.Position(a), streams.Position(b)) <= positionSq) &&
+               (DistanceSq(streams.Normal(a), streams.Normal(b)) <= normalSq) &&
+               (DistanceSq(streams.TexC(a), streams.TexC(b)) <= texCSq) &&
+               (DistanceSq(streams.Tangent(a), streams.Tangent(b)) <= tangentSq);
+    }
+};
+
+// ====================================================================================================================
+// Spatial hash over the vertex positions. Cells are twice positionTolerance wide, so all vertices within tolerance of a
+// vertex are in its own cell or the neighbour on the side of the nearer cell border: 8 cells. With a zero tolerance the
+// cell is the position itself (-0 and 0 alike).
+class WeldGrid
+{
+public:
+    WeldGrid(float positionTolerance) : m_invCellSize((positionTolerance > 0.0f) ? 0.5f / positionTolerance : 0.0f) {}
+
+    bool Exact() const { return m_invCellSize == 0.0f; }
+
+    // side is the direction (-1 or 1) of the neighbour per axis to search as well, 0 if there is none.
+    void Cell(const XMFLOAT3& p, int64_t cell[3], int32_t side[3]) const
+    {
+        const float* pCoords = &p.x;
+        for (uint32 axis = 0; axis < 3; ++axis)
+        {
+            if (Exact())
+            {
+                const float canonical = pCoords[axis] + 0.0f;
+                uint32      bits;
+                memcpy(&bits, &canonical, sizeof(bits));
+                cell[axis] = bits;
+                side[axis] = 0;
+            }
+            else
+            {
+                const float scaled = pCoords[axis] * m_invCellSize;
+                const float base   = floorf(scaled);
+                cell[axis] = static_cast<int64_t>(base);
+                side[axis] = (scaled - base < 0.5f) ? -1 : 1;
+            }
+        }
+    }
+
+    static uint32 Bucket(int64_t x, int64_t y, int64_t z, uint32 bucketMask)
+    {
+        uint64_t h = uint64_t(x) * 0x9e3779b97f4a7c15ull ^ uint64_t(y) * 0xc2b2ae3d27d4eb4full ^ uint64_t(z) * 0x165667b19e3779f9ull;
+        h ^= h >> 29;
+        return static_cast<uint32>(h) & bucketMask;
+    }
+
+private:
+    float m_invCellSize;
+};
+
+// ====================================================================================================================
+static std::vector<uint32> BuildRemap(
+    const WeldStreams&  streams,
+    uint32              vertexCount,
+    const WeldSettings& settings,
+    uint32              maxThreads,
+    uint32*             pNewVertexCount)
+{
+    const WeldGrid   grid(settings.positionTolerance);
+    const WeldLimits limits(settings);
+
+    // Vertices sorted by bucket, in index order within a bucket (counting sort).
+    uint32 bucketCount = 16;
+    while (bucketCount < 2 * vertexCount)
+    {
+        bucketCount *= 2;
+    }
+    const uint32 bucketMask = bucketCount - 1;
+
+    std::vector<uint32> vertexBuckets(vertexCount);
+    ParallelFor(vertexCount, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 v = begin; v < end; ++v)
+        {
+            int64_t cell[3];
+            int32_t side[3];
+            grid.Cell(streams.Position(v), cell, side);
+            vertexBuckets[v] = WeldGrid::Bucket(cell[0], cell[1], cell[2], bucketMask);
+        }
+    });
+
+    std::vector<uint32> bucketStart(bucketCount + 1, 0);
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        bucketStart[vertexBuckets[v] + 1]++;
+    }
+    for (uint32 b = 0; b < bucketCount; ++b)
+    {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+
+    std::vector<uint32> sorted(vertexCount);
+    {
+        std::vector<uint32> cursor(bucketStart.begin(), bucketStart.end() - 1);
+        for (uint32 v = 0; v < vertexCount; ++v)
+        {
+            sorted[cursor[vertexBuckets[v]]++] = v;
+        }
+    }
+
+    // First (lowest index) vertex within tolerance of each vertex, possibly the vertex itself.
+    std::vector<uint32> remap(vertexCount);
+
+    ParallelFor(vertexCount, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 v = begin; v < end; ++v)
+        {
+            int64_t cell[3];
+            int32_t side[3];
+            grid.Cell(streams.Position(v), cell, side);
+
+            uint32 first = v;
+            for (uint32 neighbour = 0; neighbour < 8; ++neighbour)
+            {
+                // Skips the neighbours along axes without one.
+                if (((neighbour & 1) && !side[0]) || ((neighbour & 2) && !side[1]) || ((neighbour & 4) && !side[2]))
+                {
+                    continue;
+                }
+
+                const uint32 bucket = WeldGrid::Bucket(cell[0] + ((neighbour & 1) ? side[0] : 0),
+                                                       cell[1] + ((neighbour & 2) ? side[1] : 0),
+                                                       cell[2] + ((neighbour & 4) ? side[2] : 0),
+                                                       bucketMask);
+
+                for (uint32 k = bucketStart[bucket]; k < bucketStart[bucket + 1]; ++k)
+                {
+                    const uint32 u = sorted[k];
+                    if (u >= first)
+                    {
+                        break;
+                    }
+                    if (limits.Match(streams, u, v))
+                    {
+                        first = u;
+                        break;
+                    }
+                }
+            }
+            remap[v] = first;
+        }
+    });
+
+    // Follow each vertex to the vertex that replaces its match, unless that is out of reach, and number the vertices
+    // that are kept. A vertex's match always comes before it, so one pass in index order resolves every chain. The
+    // kept vertex is stored first and turned into its new index once nothing refers to it any more.
+    std::vector<uint32> kept(vertexCount);
+    uint32              newVertexCount = 0;
+
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        const uint32 match = remap[v];
+        uint32       keep  = v;
+        if (match != v)
+        {
+            const uint32 replacement = kept[match];
+            if ((replacement == match) || limits.Match(streams, replacement, v))
+            {
+                keep = replacement;
+            }
+        }
+
+        kept[v]  = keep;
+        remap[v] = (keep == v) ? newVertexCount++ : remap[keep];
+    }
+
+    if (pNewVertexCount != nullptr)
+    {
+        *pNewVertexCount = newVertexCount;
+    }
+    return remap;
+}
+
+// ====================================================================================================================
+// Moves the kept vertices down to their new index; a vertex is kept if it is the first one mapped to its new index.
+template<typename StreamT>
+static void CompactStream(
+    StreamT&                   stream,
+    const std::vector<uint32>& remap,
+    uint32                     newVertexCount)
+{
+    uint32 next = 0;
+    for (uint32 v = 0; v < remap.size(); ++v)
+    {
+        if (remap[v] == next)
+        {
+            stream[next++] = stream[v];
+        }
+    }
+
+    stream.resize(newVertexCount);
+}
+
+// ====================================================================================================================
+static void RemapIndices(
+    std::vector<uint32>&       indices,
+    const std::vector<uint32>& remap,
+    uint32                     maxThreads)
+{
+    ParallelFor(static_cast<uint32>(indices.size()), MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            indices[i] = remap[indices[i]];
+        }
+    });
+}
+
+// ====================================================================================================================
+std::vector<uint32> MeshWelder::BuildWeldRemap(
+    const MeshData&     meshData,
+    const WeldSettings& settings,
+    uint32              maxThreads,
+    uint32*             pNewVertexCount)
+{
+    return BuildRemap(GetStreams(meshData), meshData.VertexCount(), settings, maxThreads, pNewVertexCount);
+}
+
+// ====================================================================================================================
+std::vector<uint32> MeshWelder::BuildWeldRemap(
+    const MeshDataSoA&  meshData,
+    const WeldSettings& settings,
+    uint32              maxThreads,
+    uint32*             pNewVertexCount)
+{
+    return BuildRemap(GetStreams(meshData), meshData.VertexCount(), settings, maxThreads, pNewVertexCount);
+}
+
+// ====================================================================================================================
+uint32 MeshWelder::Weld(
+    MeshData&           meshData,
+    const WeldSettings& settings,
+    uint32              maxThreads)
+{
+    if (meshData.VertexCount() == 0)
+    {
+        return 0;
+    }
+
+    uint32                    newVertexCount = 0;
+    const std::vector<uint32> remap          = BuildWeldRemap(meshData, settings, maxThreads, &newVertexCount);
+
+    RemapIndices(meshData.m_indices32, remap, maxThreads);
+    CompactStream(meshData.m_vertices, remap, newVertexCount);
+
+    return newVertexCount;
+}
+
+// ====================================================================================================================
+uint32 MeshWelder::Weld(
+    MeshDataSoA&        meshData,
+    const WeldSettings& settings,
+    uint32              maxThreads)
+{
+    if (meshData.VertexCount() == 0)
+    {
+        return 0;
+    }
+
+    uint32                    newVertexCount = 0;
+    const std::vector<uint32> remap          = BuildWeldRemap(meshData, settings, maxThreads, &newVertexCount);
+
+    RemapIndices(meshData.m_indices32, remap, maxThreads);
+    CompactStream(meshData.m_positions, remap, newVertexCount);
+    CompactStream(meshData.m_normals, remap, newVertexCount);
+    CompactStream(meshData.m_tangentUs, remap, newVertexCount);
+    CompactStream(meshData.m_texCs, remap, newVertexCount);
+
+    return newVertexCount;
+}
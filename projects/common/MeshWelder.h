@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cfloat>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Largest difference (Euclidean distance) at which two vertices still count as the same, per attribute. All zero, the
+// default, only welds vertices whose attributes are equal. FLT_MAX ignores an attribute, e.g. to weld across texture
+// seams for a depth only stream.
+struct WeldSettings
+{
+    float positionTolerance = 0.0f;
+    float normalTolerance   = 0.0f;
+    float tangentTolerance  = 0.0f;
+    float texCTolerance     = 0.0f;
+};
+
+// ====================================================================================================================
+// Merges duplicate vertices: meshes loaded with one vertex per corner, texture seams and hard edges for streams that
+// do not need them (e.g. positions only). Vertices are put in a spatial hash with cells of twice positionTolerance
+// (the exact position with a zero tolerance), so each vertex is only compared with the vertices in the 8 cells that
+// can hold a match: O(n) for tolerances below the edge lengths of the mesh.
+//
+// A vertex is welded to the first vertex within tolerance of it, unless that one was welded to a vertex out of its
+// reach, so every vertex ends up within tolerance of the vertex that replaces it. The search runs on up to maxThreads
+// threads (0 = all hardware threads); the result does not depend on the thread count. Welded vertices keep the
+// attributes of the first vertex and their relative order, indices are rewritten in place.
+class MeshWelder
+{
+public:
+    // Returns the vertex count after welding.
+    static uint32 Weld(MeshData& meshData, const WeldSettings& settings = WeldSettings(), uint32 maxThreads = 0);
+    static uint32 Weld(MeshDataSoA& meshData, const WeldSettings& settings = WeldSettings(), uint32 maxThreads = 0);
+
+    // Old vertex -> new vertex table without changing the mesh, for callers with more vertex streams than MeshData.
+    // New vertices are numbered in the order of the old vertices they keep.
+    static std::vector<uint32> BuildWeldRemap(const MeshData&     meshData,
+                                              const WeldSettings& settings,
+                                              uint32              maxThreads,
+                                              uint32*             pNewVertexCount);
+
+    static std::vector<uint32> BuildWeldRemap(const MeshDataSoA&  meshData,
+                                              const WeldSettings& settings,
+                                              uint32              maxThreads,
+                                              uint32*             pNewVertexCount);
+};
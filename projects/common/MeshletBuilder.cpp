@@ -0,0 +1,434 @@
+#include "MeshletBuilder.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+static const uint32 InvalidIndex = 0xffffffff;
+
+// Cones whose normals spread further than this (cosine of the widest normal to the axis) are not worth testing.
+static const float MinConeSpreadDot = 0.1f;
+
+// ====================================================================================================================
+static XMVECTOR LoadPosition(
+    const float* pPositions,
+    size_t       positionStride,
+    uint32       index)
+{
+    const float* pPos = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + index * positionStride);
+    return XMVectorSet(pPos[0], pPos[1], pPos[2], 0.0f);
+}
+
+// ====================================================================================================================
+// Ritter's bounding sphere of the meshlet vertices followed by a cone that contains all triangle normals.
+static MeshletBounds ComputeBounds(
+    const MeshletData& meshlets,
+    const Meshlet&     meshlet,
+    const float*       pPositions,
+    size_t             positionStride)
+{
+    MeshletBounds bounds;
+
+    const uint32* pVerts = &meshlets.m_vertexIndices[meshlet.vertexOffset];
+
+    // Start from the two vertices farthest apart along a greedy search, then grow to include the rest.
+    XMVECTOR p0 = LoadPosition(pPositions, positionStride, pVerts[0]);
+    XMVECTOR p1 = p0;
+    float    bestDist = -1.0f;
+    for (uint32 i = 0; i < meshlet.vertexCount; ++i)
+    {
+        const XMVECTOR p = LoadPosition(pPositions, positionStride, pVerts[i]);
+        const float    d = XMVectorGetX(XMVector3LengthSq(p - p0));
+        if (d > bestDist)
+        {
+            bestDist = d;
+            p1       = p;
+        }
+    }
+
+    XMVECTOR p2 = p1;
+    bestDist    = -1.0f;
+    for (uint32 i = 0; i < meshlet.vertexCount; ++i)
+    {
+        const XMVECTOR p = LoadPosition(pPositions, positionStride, pVerts[i]);
+        const float    d = XMVectorGetX(XMVector3LengthSq(p - p1));
+        if (d > bestDist)
+        {
+            bestDist = d;
+            p2       = p;
+        }
+    }
+
+    XMVECTOR center = 0.5f * (p1 + p2);
+    float    radius = 0.5f * sqrtf(bestDist);
+
+    for (uint32 i = 0; i < meshlet.vertexCount; ++i)
+    {
+        const XMVECTOR p = LoadPosition(pPositions, positionStride, pVerts[i]);
+        const float    d = XMVectorGetX(XMVector3Length(p - center));
+        if (d > radius)
+        {
+            const float newRadius = 0.5f * (radius + d);
+            center = center + (p - center) * ((newRadius - radius) / d);
+            radius = newRadius;
+        }
+    }
+
+    XMStoreFloat3(&bounds.center, center);
+    bounds.radius = radius;
+
+    // Normal cone. Normals follow the clockwise winding of the generators: cross(p1 - p0, p2 - p0) points outwards.
+    std::vector<XMFLOAT3> normals;
+    normals.reserve(meshlet.triangleCount);
+
+    XMVECTOR axis = XMVectorZero();
+    for (uint32 t = 0; t < meshlet.triangleCount; ++t)
+    {
+        const uint8_t* pTri = &meshlets.m_primitiveIndices[(meshlet.triangleOffset + t) * 3];
+
+        const XMVECTOR a = LoadPosition(pPositions, positionStride, pVerts[pTri[0]]);
+        const XMVECTOR b = LoadPosition(pPositions, positionStride, pVerts[pTri[1]]);
+        const XMVECTOR c = LoadPosition(pPositions, positionStride, pVerts[pTri[2]]);
+
+        const XMVECTOR n      = XMVector3Cross(b - a, c - a);
+        const float    length = XMVectorGetX(XMVector3Length(n));
+        if (length > 0.0f)
+        {
+            XMFLOAT3 unitNormal;
+            XMStoreFloat3(&unitNormal, n / length);
+            normals.push_back(unitNormal);
+            axis += n / length;
+        }
+    }
+
+    const float axisLength = XMVectorGetX(XMVector3Length(axis));
+    if ((normals.empty() == false) && (axisLength > 0.0f))
+    {
+        axis = axis / axisLength;
+
+        float minDot = 1.0f;
+        for (const XMFLOAT3& n : normals)
+        {
+            minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&n))));
+        }
+
+        XMStoreFloat3(&bounds.coneAxis, axis);
+        bounds.coneCutoff = (minDot > MinConeSpreadDot) ? sqrtf(1.0f - minDot * minDot) : 1.0f;
+    }
+
+    return bounds;
+}
+
+// ====================================================================================================================
+MeshletData MeshletBuilder::Build(
+    const uint32* pIndices,
+    size_t        indexCount,
+    const float*  pPositions,
+    size_t        positionStride,
+    uint32        vertexCount,
+    uint32        maxVertices,
+    uint32        maxTriangles)
+{
+    assert((maxVertices >= 3) && (maxVertices <= 256));
+    assert(maxTriangles >= 1);
+
+    MeshletData out;
+
+    const uint32 triangleCount = static_cast<uint32>(indexCount / 3);
+    if (triangleCount == 0)
+    {
+        return out;
+    }
+
+    // Vertex -> triangle adjacency in compressed row form.
+    std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        adjacencyOffsets[pIndices[i] + 1]++;
+    }
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+
+    std::vector<uint32> adjacency(indexCount);
+    std::vector<uint32> fillCursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        adjacency[fillCursor[pIndices[i]]++] = static_cast<uint32>(i / 3);
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32>  vertexSlot(vertexCount, InvalidIndex); // Local index in the current meshlet
+
+    Meshlet current;
+    uint32  cursor       = 0;
+    uint32  lastTriangle = InvalidIndex;
+
+    auto NewVertexCount = [&](uint32 t)
+    {
+        const uint32 a = pIndices[t * 3 + 0];
+        const uint32 b = pIndices[t * 3 + 1];
+        const uint32 c = pIndices[t * 3 + 2];
+
+        uint32 count = (vertexSlot[a] == InvalidIndex) ? 1 : 0;
+        count += ((vertexSlot[b] == InvalidIndex) && (b != a)) ? 1 : 0;
+        count += ((vertexSlot[c] == InvalidIndex) && (c != a) && (c != b)) ? 1 : 0;
+        return count;
+    };
+
+    // Picks the unemitted triangle around v that adds the fewest new vertices.
+    auto ScoreNeighbors = [&](uint32 v, uint32& best, uint32& bestScore)
+    {
+        for (uint32 a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; ++a)
+        {
+            const uint32 t = adjacency[a];
+            if (emitted[t] == 0)
+            {
+                const uint32 score = NewVertexCount(t);
+                if (score < bestScore)
+                {
+                    best      = t;
+                    bestScore = score;
+                }
+            }
+        }
+    };
+
+    auto Flush = [&]()
+    {
+        if (current.triangleCount > 0)
+        {
+            for (uint32 i = 0; i < current.vertexCount; ++i)
+            {
+                vertexSlot[out.m_vertexIndices[current.vertexOffset + i]] = InvalidIndex;
+            }
+
+            out.m_meshlets.push_back(current);
+            out.m_bounds.push_back(ComputeBounds(out, current, pPositions, positionStride));
+            out.m_packedBounds.push_back(PackBounds(out.m_bounds.back()));
+        }
+
+        current                = Meshlet();
+        current.vertexOffset   = static_cast<uint32>(out.m_vertexIndices.size());
+        current.triangleOffset = static_cast<uint32>(out.m_primitiveIndices.size() / 3);
+    };
+
+    for (uint32 emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        uint32 best      = InvalidIndex;
+        uint32 bestScore = 4;
+
+        // Grow around the last triangle first, then around any vertex already in the meshlet.
+        if (lastTriangle != InvalidIndex)
+        {
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                ScoreNeighbors(pIndices[lastTriangle * 3 + k], best, bestScore);
+            }
+        }
+
+        if (best == InvalidIndex)
+        {
+            for (uint32 i = 0; i < current.vertexCount; ++i)
+            {
+                ScoreNeighbors(out.m_vertexIndices[current.vertexOffset + i], best, bestScore);
+            }
+        }
+
+        if (best == InvalidIndex)
+        {
+            // Nothing connected is left. Close a meshlet that is already half full rather than mixing in a distant
+            // piece of the mesh and inflating its bounds.
+            while (emitted[cursor] != 0)
+            {
+                cursor++;
+            }
+
+            best      = cursor;
+            bestScore = NewVertexCount(best);
+
+            if ((2 * current.vertexCount >= maxVertices) || (2 * current.triangleCount >= maxTriangles))
+            {
+                Flush();
+                bestScore = NewVertexCount(best);
+            }
+        }
+
+        if ((current.vertexCount + bestScore > maxVertices) || (current.triangleCount + 1 > maxTriangles))
+        {
+            Flush();
+        }
+
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            const uint32 v = pIndices[best * 3 + k];
+            if (vertexSlot[v] == InvalidIndex)
+            {
+                vertexSlot[v] = current.vertexCount++;
+                out.m_vertexIndices.push_back(v);
+            }
+
+            out.m_primitiveIndices.push_back(static_cast<uint8_t>(vertexSlot[v]));
+        }
+
+        current.triangleCount++;
+        emitted[best] = 1;
+        lastTriangle  = best;
+    }
+
+    Flush();
+
+    return out;
+}
+
+// ====================================================================================================================
+MeshletData MeshletBuilder::Build(
+    const MeshData& meshData,
+    uint32          maxVertices,
+    uint32          maxTriangles)
+{
+    if (meshData.VertexCount() == 0)
+    {
+        return MeshletData();
+    }
+
+    return Build(meshData.m_indices32.data(),
+                 meshData.m_indices32.size(),
+                 &meshData.m_vertices[0].m_position.x,
+                 sizeof(Vertex),
+                 meshData.VertexCount(),
+                 maxVertices,
+                 maxTriangles);
+}
+
+// ====================================================================================================================
+MeshletData MeshletBuilder::Build(
+    const MeshDataSoA& meshData,
+    uint32             maxVertices,
+    uint32             maxTriangles)
+{
+    if (meshData.VertexCount() == 0)
+    {
+        return MeshletData();
+    }
+
+    return Build(meshData.m_indices32.data(),
+                 meshData.m_indices32.size(),
+                 &meshData.m_positions[0].x,
+                 sizeof(XMFLOAT3),
+                 meshData.VertexCount(),
+                 maxVertices,
+                 maxTriangles);
+}
+
+// ====================================================================================================================
+PackedMeshletBounds MeshletBuilder::PackBounds(
+    const MeshletBounds& bounds)
+{
+    PackedMeshletBounds packed;
+    packed.center = bounds.center;
+    packed.radius = bounds.radius;
+
+    const float axis[3] = { bounds.coneAxis.x, bounds.coneAxis.y, bounds.coneAxis.z };
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        packed.coneAxis[i] = static_cast<int8_t>(MathHelper::Clamp(roundf(axis[i] * 127.0f), -127.0f, 127.0f));
+    }
+
+    if (bounds.coneCutoff >= 1.0f)
+    {
+        packed.coneCutoff = 127;
+        return packed;
+    }
+
+    // Widen the cone by the angle the axis moved during quantization, then round the cutoff up.
+    const XMVECTOR exact     = XMLoadFloat3(&bounds.coneAxis);
+    const XMVECTOR quantized = XMVector3Normalize(XMVectorSet(packed.coneAxis[0], packed.coneAxis[1], packed.coneAxis[2], 0.0f));
+    const float    axisError = acosf(MathHelper::Clamp(XMVectorGetX(XMVector3Dot(exact, quantized)), -1.0f, 1.0f));
+    const float    halfAngle = asinf(bounds.coneCutoff) + axisError;
+    const float    cutoff    = (halfAngle >= XM_PIDIV2) ? 1.0f : sinf(halfAngle);
+
+    packed.coneCutoff = static_cast<int8_t>(std::min(127.0f, ceilf(cutoff * 127.0f)));
+
+    return packed;
+}
+
+// ====================================================================================================================
+bool MeshletBuilder::IsBackFacing(
+    const PackedMeshletBounds& bounds,
+    const XMFLOAT3&            cameraPos)
+{
+    if (bounds.coneCutoff >= 127)
+    {
+        return false;
+    }
+
+    const XMVECTOR axis     = XMVector3Normalize(XMVectorSet(bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2], 0.0f));
+    const XMVECTOR toCenter = XMLoadFloat3(&bounds.center) - XMLoadFloat3(&cameraPos);
+    const float    distance = XMVectorGetX(XMVector3Length(toCenter));
+
+    return XMVectorGetX(XMVector3Dot(toCenter, axis)) >= (bounds.coneCutoff / 127.0f) * distance + bounds.radius;
+}
+
+// ====================================================================================================================
+bool MeshletBuilder::IsOutsideFrustum(
+    const PackedMeshletBounds& bounds,
+    const XMFLOAT4             planes[6])
+{
+    const XMVECTOR center = XMVectorSet(bounds.center.x, bounds.center.y, bounds.center.z, 1.0f);
+
+    for (uint32 i = 0; i < 6; ++i)
+    {
+        if (XMVectorGetX(XMVector4Dot(XMLoadFloat4(&planes[i]), center)) < -bounds.radius)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// ====================================================================================================================
+MeshletCullStats MeshletBuilder::Cull(
+    const MeshletData&   meshlets,
+    const XMFLOAT4       planes[6],
+    const XMFLOAT3&      cameraPos,
+    std::vector<uint32>* pVisible)
+{
+    MeshletCullStats stats;
+    stats.meshletCount = static_cast<uint32>(meshlets.m_meshlets.size());
+
+    if (pVisible != nullptr)
+    {
+        pVisible->clear();
+    }
+
+    for (uint32 i = 0; i < stats.meshletCount; ++i)
+    {
+        const PackedMeshletBounds& bounds = meshlets.m_packedBounds[i];
+
+        if (IsOutsideFrustum(bounds, planes))
+        {
+            stats.frustumRejected++;
+        }
+        else if (IsBackFacing(bounds, cameraPos))
+        {
+            stats.backfaceRejected++;
+        }
+        else
+        {
+            stats.visibleMeshlets++;
+            stats.visibleTriangles += meshlets.m_meshlets[i].triangleCount;
+
+            if (pVisible != nullptr)
+            {
+                pVisible->push_back(i);
+            }
+        }
+    }
+
+    return stats;
+}
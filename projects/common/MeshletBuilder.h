@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// One cluster of a meshlet mesh. Vertex and triangle data live in the shared arrays of MeshletData.
+struct Meshlet
+{
+    uint32 vertexOffset   = 0; // First entry in MeshletData::m_vertexIndices
+    uint32 triangleOffset = 0; // First triangle in MeshletData::m_primitiveIndices (3 bytes per triangle)
+    uint32 vertexCount    = 0;
+    uint32 triangleCount  = 0;
+};
+
+// Culling data of a meshlet. The cone encloses all triangle normals; coneCutoff is the sine of the cone half angle
+// widened by the spread of the normals, 1.0 means the meshlet can never be rejected as back facing.
+struct MeshletBounds
+{
+    DirectX::XMFLOAT3 center     = { 0.0f, 0.0f, 0.0f };
+    float             radius     = 0.0f;
+    DirectX::XMFLOAT3 coneAxis   = { 0.0f, 0.0f, 1.0f };
+    float             coneCutoff = 1.0f;
+};
+
+// 20 byte form of MeshletBounds for upload. Cone axis and cutoff are snorm8, rounded so the test stays conservative.
+struct PackedMeshletBounds
+{
+    DirectX::XMFLOAT3 center;
+    float             radius;
+    int8_t            coneAxis[3];
+    int8_t            coneCutoff;
+};
+
+struct MeshletCullStats
+{
+    uint32 meshletCount      = 0;
+    uint32 frustumRejected   = 0;
+    uint32 backfaceRejected  = 0;
+    uint32 visibleMeshlets   = 0;
+    uint32 visibleTriangles  = 0;
+};
+
+// ====================================================================================================================
+class MeshletData
+{
+public:
+    std::vector<Meshlet>             m_meshlets;
+    std::vector<uint32>              m_vertexIndices;    // Meshlet local vertex -> mesh vertex
+    std::vector<uint8_t>             m_primitiveIndices; // Meshlet local vertex indices, 3 per triangle
+    std::vector<MeshletBounds>       m_bounds;
+    std::vector<PackedMeshletBounds> m_packedBounds;
+};
+
+// ====================================================================================================================
+// Partitions an indexed triangle list into meshlets of at most maxVertices vertices and maxTriangles triangles, and
+// computes a bounding sphere and normal cone per meshlet for cluster culling.
+// Triangles are grown from the current meshlet's vertices first, so meshlets stay spatially compact; feeding an index
+// buffer that went through MeshOptimizer::OptimizeVertexCache() gives the best results.
+class MeshletBuilder
+{
+public:
+    static const uint32 DefaultMaxVertices  = 64;
+    static const uint32 DefaultMaxTriangles = 124;
+
+    static MeshletData Build(const uint32* pIndices,
+                             size_t        indexCount,
+                             const float*  pPositions,
+                             size_t        positionStride,
+                             uint32        vertexCount,
+                             uint32        maxVertices  = DefaultMaxVertices,
+                             uint32        maxTriangles = DefaultMaxTriangles);
+
+    static MeshletData Build(const MeshData& meshData, uint32 maxVertices = DefaultMaxVertices, uint32 maxTriangles = DefaultMaxTriangles);
+    static MeshletData Build(const MeshDataSoA& meshData, uint32 maxVertices = DefaultMaxVertices, uint32 maxTriangles = DefaultMaxTriangles);
+
+    static PackedMeshletBounds PackBounds(const MeshletBounds& bounds);
+
+    // True if every triangle of the meshlet faces away from cameraPos.
+    static bool IsBackFacing(const PackedMeshletBounds& bounds, const DirectX::XMFLOAT3& cameraPos);
+
+    // True if the bounding sphere is completely outside one of the planes (see MathHelper::ExtractFrustumPlanes).
+    static bool IsOutsideFrustum(const PackedMeshletBounds& bounds, const DirectX::XMFLOAT4 planes[6]);
+
+    // Frustum and cone tests every meshlet of the packed bounds. Indices of the surviving meshlets are written to
+    // pVisible when it is not null.
+    static MeshletCullStats Cull(const MeshletData&       meshlets,
+                                 const DirectX::XMFLOAT4  planes[6],
+                                 const DirectX::XMFLOAT3& cameraPos,
+                                 std::vector<uint32>*     pVisible = nullptr);
+};
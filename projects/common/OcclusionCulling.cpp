@@ -0,0 +1,533 @@
+#include "OcclusionCulling.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+static const uint32 TrianglesPerChunk = 1024; // Triangle setup work items
+static const uint32 BoxesPerChunk     = 256;  // Cull() work items
+static const uint32 BandsPerThread    = 2;    // Bands of tile rows per rasterizing thread, for load balance
+
+// ====================================================================================================================
+static double ElapsedMs(
+    std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// ====================================================================================================================
+// SSE2 has no floor; x has to be well inside the int range.
+static __m128i FloorToInt(
+    __m128 x)
+{
+    const __m128i i = _mm_cvttps_epi32(x);
+    return _mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(i), x)));
+}
+
+// ====================================================================================================================
+static __m128i CeilToInt(
+    __m128 x)
+{
+    return _mm_sub_epi32(_mm_setzero_si128(), FloorToInt(_mm_sub_ps(_mm_setzero_ps(), x)));
+}
+
+// ====================================================================================================================
+// Bits [first, last] of a tile row, clamped to the row.
+static uint32 RowMask(
+    int first,
+    int last)
+{
+    first = std::min<int>(std::max<int>(first, 0), 32);
+    last  = std::min<int>(std::max<int>(last, -1), 31);
+    return static_cast<uint32>(((uint64_t(1) << (last + 1)) - 1) & ~((uint64_t(1) << first) - 1));
+}
+
+// ====================================================================================================================
+void OcclusionCuller::Resize(
+    uint32 width,
+    uint32 height)
+{
+    m_width  = width;
+    m_height = height;
+    m_tilesX = (width + TileWidth - 1) / TileWidth;
+    m_tilesY = (height + TileHeight - 1) / TileHeight;
+    m_tiles.resize(m_tilesX * m_tilesY);
+    XMStoreFloat4x4(&m_viewProj, XMMatrixIdentity());
+
+    Tile empty = {};
+    empty.zMax1 = 1.0f;
+    std::fill(m_tiles.begin(), m_tiles.end(), empty);
+}
+
+// ====================================================================================================================
+void OcclusionCuller::BeginFrame()
+{
+    m_occluders.clear();
+    m_triangleCount = 0;
+    m_stats         = OcclusionStats();
+}
+
+// ====================================================================================================================
+void OcclusionCuller::AddOccluder(
+    const void*   pPositions,
+    uint32        stride,
+    const uint32* pIndices,
+    uint32        indexCount,
+    FXMMATRIX     world)
+{
+    Occluder occluder;
+    occluder.pPositions    = static_cast<const uint8_t*>(pPositions);
+    occluder.stride        = stride;
+    occluder.pIndices      = pIndices;
+    occluder.firstTriangle = m_triangleCount;
+    XMStoreFloat4x4(&occluder.world, world);
+
+    m_occluders.push_back(occluder);
+    m_triangleCount           += indexCount / 3;
+    m_stats.occluderTriangles += indexCount / 3;
+}
+
+// ====================================================================================================================
+void OcclusionCuller::SetupTriangle(
+    const XMFLOAT4* pClip,
+    Triangle&       triangle) const
+{
+    // Empty tile range until the triangle is known to be drawn.
+    triangle.tileX0 = 1;
+    triangle.tileX1 = 0;
+
+    float x[3];
+    float y[3];
+    float z[3];
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        const float invW = 1.0f / pClip[i].w;
+        x[i] = (pClip[i].x * invW * 0.5f + 0.5f) * m_width;
+        y[i] = (0.5f - pClip[i].y * invW * 0.5f) * m_height;
+        z[i] = pClip[i].z * invW;
+    }
+
+    // Clockwise on screen (y down) is front facing and has a positive area.
+    const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if ((area > 0.0f) == false)
+    {
+        return;
+    }
+
+    // Pixels whose centers lie in the bounding rectangle.
+    const float minX   = std::min<float>(x[0], std::min<float>(x[1], x[2]));
+    const float maxX   = std::max<float>(x[0], std::max<float>(x[1], x[2]));
+    const float minY   = std::min<float>(y[0], std::min<float>(y[1], y[2]));
+    const float maxY   = std::max<float>(y[0], std::max<float>(y[1], y[2]));
+    const int   pixelX0 = static_cast<int>(ceilf(std::max<float>(minX - 0.5f, 0.0f)));
+    const int   pixelX1 = static_cast<int>(floorf(std::min<float>(maxX - 0.5f, m_width - 1.0f)));
+    const int   pixelY0 = static_cast<int>(ceilf(std::max<float>(minY - 0.5f, 0.0f)));
+    const int   pixelY1 = static_cast<int>(floorf(std::min<float>(maxY - 0.5f, m_height - 1.0f)));
+    if ((pixelX0 > pixelX1) || (pixelY0 > pixelY1))
+    {
+        return;
+    }
+
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        const uint32 j = (i + 1) % 3;
+        triangle.edgeA[i] = y[i] - y[j];
+        triangle.edgeB[i] = x[j] - x[i];
+        triangle.edgeC[i] = -(triangle.edgeA[i] * x[i] + triangle.edgeB[i] * y[i]);
+    }
+
+    triangle.zA     = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    triangle.zB     = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    triangle.zC     = z[0] - triangle.zA * x[0] - triangle.zB * y[0];
+    triangle.zMax   = std::max<float>(z[0], std::max<float>(z[1], z[2]));
+    triangle.tileX0 = pixelX0 / TileWidth;
+    triangle.tileX1 = pixelX1 / TileWidth;
+    triangle.tileY0 = pixelY0 / TileHeight;
+    triangle.tileY1 = pixelY1 / TileHeight;
+}
+
+// ====================================================================================================================
+void OcclusionCuller::Rasterize(
+    FXMMATRIX   viewProj,
+    WorkerPool& pool,
+    uint32      threadCount)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    XMStoreFloat4x4(&m_viewProj, viewProj);
+    m_triangles.resize(size_t(m_triangleCount) * 2);
+
+    // Transform, near clip and set up all triangles.
+    const uint32        chunkCount = (m_triangleCount + TrianglesPerChunk - 1) / TrianglesPerChunk;
+    std::atomic<uint32> next(0);
+    std::atomic<uint32> rasterized(0);
+    pool.Run(threadCount, [&](uint32)
+    {
+        for (uint32 chunk = next++; chunk < chunkCount; chunk = next++)
+        {
+            const uint32 begin = chunk * TrianglesPerChunk;
+            const uint32 end   = std::min<uint32>(begin + TrianglesPerChunk, m_triangleCount);
+
+            uint32 o = static_cast<uint32>(std::upper_bound(m_occluders.begin(), m_occluders.end(), begin,
+                                                            [](uint32 t, const Occluder& occluder) { return t < occluder.firstTriangle; }) -
+                                            m_occluders.begin()) - 1;
+            XMMATRIX worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&m_occluders[o].world), viewProj);
+            uint32   count         = 0;
+
+            for (uint32 t = begin; t < end; ++t)
+            {
+                while ((o + 1 < m_occluders.size()) && (t >= m_occluders[o + 1].firstTriangle))
+                {
+                    ++o;
+                    worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&m_occluders[o].world), viewProj);
+                }
+
+                const Occluder& occluder = m_occluders[o];
+                const uint32*   pIndices = occluder.pIndices + size_t(t - occluder.firstTriangle) * 3;
+
+                XMFLOAT4 clip[3];
+                for (uint32 i = 0; i < 3; ++i)
+                {
+                    XMFLOAT3 position;
+                    memcpy(&position, occluder.pPositions + size_t(pIndices[i]) * occluder.stride, sizeof(XMFLOAT3));
+                    XMStoreFloat4(&clip[i], XMVector3Transform(XMLoadFloat3(&position), worldViewProj));
+                }
+
+                // Clip against the near plane (z = 0) into a triangle or a quad.
+                XMFLOAT4 polygon[4];
+                uint32   polygonSize = 0;
+                for (uint32 i = 0; i < 3; ++i)
+                {
+                    const XMFLOAT4& a = clip[i];
+                    const XMFLOAT4& b = clip[(i + 1) % 3];
+                    if (a.z >= 0.0f)
+                    {
+                        polygon[polygonSize++] = a;
+                    }
+                    if ((a.z >= 0.0f) != (b.z >= 0.0f))
+                    {
+                        const float s = a.z / (a.z - b.z);
+                        polygon[polygonSize++] = XMFLOAT4(a.x + s * (b.x - a.x), a.y + s * (b.y - a.y), 0.0f, a.w + s * (b.w - a.w));
+                    }
+                }
+
+                Triangle* pSlots = &m_triangles[size_t(t) * 2];
+                pSlots[0].tileX0 = 1;
+                pSlots[0].tileX1 = 0;
+                pSlots[1].tileX0 = 1;
+                pSlots[1].tileX1 = 0;
+                for (uint32 i = 0; i + 2 < polygonSize; ++i)
+                {
+                    const XMFLOAT4 fan[3] = { polygon[0], polygon[i + 1], polygon[i + 2] };
+                    SetupTriangle(fan, pSlots[i]);
+                    count += (pSlots[i].tileX0 <= pSlots[i].tileX1) ? 1 : 0;
+                }
+            }
+            rasterized += count;
+        }
+    });
+
+    // Rasterize by bands of tile rows.
+    const uint32 threads   = ((threadCount == 0) || (threadCount > pool.ThreadCount())) ? pool.ThreadCount() : threadCount;
+    const uint32 bandCount = std::max<uint32>(1, std::min<uint32>(m_tilesY, threads * BandsPerThread));
+    next = 0;
+    pool.Run(threadCount, [&](uint32)
+    {
+        for (uint32 band = next++; band < bandCount; band = next++)
+        {
+            RasterizeBand(band * m_tilesY / bandCount, (band + 1) * m_tilesY / bandCount);
+        }
+    });
+
+    m_stats.rasterizedTriangles = rasterized;
+    m_stats.rasterizeMs         = ElapsedMs(start);
+}
+
+// ====================================================================================================================
+void OcclusionCuller::RasterizeBand(
+    uint32 tileY0,
+    uint32 tileY1)
+{
+    for (uint32 i = tileY0 * m_tilesX; i < tileY1 * m_tilesX; ++i)
+    {
+        Tile& tile = m_tiles[i];
+        memset(tile.mask, 0, sizeof(tile.mask));
+        tile.zMax0 = 0.0f;
+        tile.zMax1 = 1.0f;
+    }
+
+    const __m128 rowOffsets[2] = { _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f), _mm_setr_ps(4.5f, 5.5f, 6.5f, 7.5f) };
+
+    for (const Triangle& triangle : m_triangles)
+    {
+        const uint32 rowBegin = std::max<uint32>(triangle.tileY0, tileY0);
+        const uint32 rowEnd   = std::min<uint32>(triangle.tileY1 + 1, tileY1);
+        if ((triangle.tileX0 > triangle.tileX1) || (rowBegin >= rowEnd))
+        {
+            continue;
+        }
+
+        // Keeps the spans well inside the int range; anything outside the tile range is clamped away anyway.
+        const __m128 spanMin = _mm_set1_ps(float(triangle.tileX0 * TileWidth) - 1.0f);
+        const __m128 spanMax = _mm_set1_ps(float((triangle.tileX1 + 1) * TileWidth) + 1.0f);
+
+        for (uint32 tileY = rowBegin; tileY < rowEnd; ++tileY)
+        {
+            // First and last covered pixel of each of the 8 rows: edges with a > 0 bound x from the left, a < 0 from
+            // the right, horizontal edges keep or drop the whole row.
+            alignas(16) int32_t first[TileHeight];
+            alignas(16) int32_t last[TileHeight];
+            for (uint32 half = 0; half < 2; ++half)
+            {
+                const __m128 y     = _mm_add_ps(_mm_set1_ps(float(tileY * TileHeight)), rowOffsets[half]);
+                __m128       left  = spanMin;
+                __m128       right = spanMax;
+                __m128       empty = _mm_setzero_ps();
+                for (uint32 e = 0; e < 3; ++e)
+                {
+                    const __m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeB[e]), y), _mm_set1_ps(triangle.edgeC[e]));
+                    if (triangle.edgeA[e] > 0.0f)
+                    {
+                        left = _mm_max_ps(left, _mm_mul_ps(value, _mm_set1_ps(-1.0f / triangle.edgeA[e])));
+                    }
+                    else if (triangle.edgeA[e] < 0.0f)
+                    {
+                        right = _mm_min_ps(right, _mm_mul_ps(value, _mm_set1_ps(-1.0f / triangle.edgeA[e])));
+                    }
+                    else
+                    {
+                        empty = _mm_or_ps(empty, _mm_cmplt_ps(value, _mm_setzero_ps()));
+                    }
+                }
+
+                // Pixel x is covered if its center x + 0.5 lies in [left, right].
+                left  = _mm_min_ps(left, spanMax);
+                right = _mm_max_ps(right, spanMin);
+                right = _mm_or_ps(_mm_and_ps(empty, spanMin), _mm_andnot_ps(empty, right));
+                _mm_store_si128(reinterpret_cast<__m128i*>(first + 4 * half), CeilToInt(_mm_sub_ps(left, _mm_set1_ps(0.5f))));
+                _mm_store_si128(reinterpret_cast<__m128i*>(last + 4 * half), FloorToInt(_mm_sub_ps(right, _mm_set1_ps(0.5f))));
+            }
+
+            for (uint32 tileX = triangle.tileX0; tileX <= triangle.tileX1; ++tileX)
+            {
+                const int x0 = static_cast<int>(tileX * TileWidth);
+
+                uint32 mask[TileHeight];
+                uint32 any = 0;
+                for (uint32 r = 0; r < TileHeight; ++r)
+                {
+                    mask[r] = RowMask(first[r] - x0, last[r] - x0);
+                    any    |= mask[r];
+                }
+                if (any == 0)
+                {
+                    continue;
+                }
+
+                // Farthest depth of the triangle's plane over the tile, but not beyond its farthest vertex.
+                const float cornerX = float(x0 + ((triangle.zA > 0.0f) ? TileWidth : 0));
+                const float cornerY = float(tileY * TileHeight + ((triangle.zB > 0.0f) ? TileHeight : 0));
+                const float z       = std::min<float>(triangle.zMax, triangle.zA * cornerX + triangle.zB * cornerY + triangle.zC);
+
+                Tile& tile = m_tiles[tileY * m_tilesX + tileX];
+                if (z >= tile.zMax1)
+                {
+                    continue;
+                }
+
+                // Restart the near layer if the triangle is further in front of it than the layer is in front of the
+                // rest of the tile; merging would throw away more.
+                bool full = true;
+                if (tile.zMax0 - z > tile.zMax1 - tile.zMax0)
+                {
+                    memset(tile.mask, 0, sizeof(tile.mask));
+                    tile.zMax0 = 0.0f;
+                }
+                tile.zMax0 = std::max<float>(tile.zMax0, z);
+                for (uint32 r = 0; r < TileHeight; ++r)
+                {
+                    tile.mask[r] |= mask[r];
+                    full          = full && (tile.mask[r] == UINT32_MAX);
+                }
+
+                if (full)
+                {
+                    tile.zMax1 = tile.zMax0;
+                    tile.zMax0 = 0.0f;
+                    memset(tile.mask, 0, sizeof(tile.mask));
+                }
+            }
+        }
+    }
+}
+
+// ====================================================================================================================
+bool OcclusionCuller::IsRectVisible(
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    float depth) const
+{
+    // Every pixel the rectangle touches.
+    if ((x1 <= 0.0f) || (y1 <= 0.0f) || (x0 >= m_width) || (y0 >= m_height))
+    {
+        return false;
+    }
+    const int pixelX0 = static_cast<int>(std::max<float>(x0, 0.0f));
+    const int pixelY0 = static_cast<int>(std::max<float>(y0, 0.0f));
+    const int pixelX1 = static_cast<int>(ceilf(std::min<float>(x1, float(m_width)))) - 1;
+    const int pixelY1 = static_cast<int>(ceilf(std::min<float>(y1, float(m_height)))) - 1;
+
+    for (int tileY = pixelY0 / int(TileHeight); tileY <= pixelY1 / int(TileHeight); ++tileY)
+    {
+        for (int tileX = pixelX0 / int(TileWidth); tileX <= pixelX1 / int(TileWidth); ++tileX)
+        {
+            const Tile& tile      = m_tiles[tileY * m_tilesX + tileX];
+            const bool  nearLayer = (depth <= tile.zMax0);
+            const bool  farLayer  = (depth <= tile.zMax1);
+            if (farLayer == false)
+            {
+                continue;
+            }
+
+            const uint32 rectMask = RowMask(pixelX0 - tileX * int(TileWidth), pixelX1 - tileX * int(TileWidth));
+            const int    rowBegin = std::max<int>(pixelY0 - tileY * int(TileHeight), 0);
+            const int    rowEnd   = std::min<int>(pixelY1 - tileY * int(TileHeight) + 1, int(TileHeight));
+            for (int r = rowBegin; r < rowEnd; ++r)
+            {
+                if (((rectMask & ~tile.mask[r]) != 0) || (nearLayer && ((rectMask & tile.mask[r]) != 0)))
+                {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+// ====================================================================================================================
+bool OcclusionCuller::IsVisible(
+    const BoundingBox& box) const
+{
+    const XMMATRIX viewProj = XMLoadFloat4x4(&m_viewProj);
+
+    float minX     = FLT_MAX;
+    float minY     = FLT_MAX;
+    float maxX     = -FLT_MAX;
+    float maxY     = -FLT_MAX;
+    float minDepth = FLT_MAX;
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        const XMFLOAT3 corner(box.Center.x + ((i & 1) ? box.Extents.x : -box.Extents.x),
+                              box.Center.y + ((i & 2) ? box.Extents.y : -box.Extents.y),
+                              box.Center.z + ((i & 4) ? box.Extents.z : -box.Extents.z));
+        XMFLOAT4 clip;
+        XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&corner), viewProj));
+        if (clip.z < 0.0f)
+        {
+            return true;
+        }
+
+        const float invW = 1.0f / clip.w;
+        minX     = std::min<float>(minX, clip.x * invW);
+        maxX     = std::max<float>(maxX, clip.x * invW);
+        minY     = std::min<float>(minY, clip.y * invW);
+        maxY     = std::max<float>(maxY, clip.y * invW);
+        minDepth = std::min<float>(minDepth, clip.z * invW);
+    }
+
+    return IsRectVisible((minX * 0.5f + 0.5f) * m_width, (0.5f - maxY * 0.5f) * m_height,
+                         (maxX * 0.5f + 0.5f) * m_width, (0.5f - minY * 0.5f) * m_height, minDepth);
+}
+
+// ====================================================================================================================
+uint32 OcclusionCuller::Cull(
+    const BoundingBox* pBoxes,
+    const uint32*      pCandidates,
+    uint32             candidateCount,
+    uint32*            pVisible,
+    WorkerPool&        pool,
+    uint32             threadCount)
+{
+    const VisibleRange range = {pCandidates, candidateCount};
+    return Cull(pBoxes, &range, 1, pVisible, pool, threadCount);
+}
+
+// ====================================================================================================================
+uint32 OcclusionCuller::Cull(
+    const BoundingBox*  pBoxes,
+    const VisibleRange* pRanges,
+    uint32              rangeCount,
+    uint32*             pVisible,
+    WorkerPool&         pool,
+    uint32              threadCount)
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    // Where each range starts among all candidates, so that a chunk can find its first range.
+    std::vector<uint32> rangeStarts(rangeCount + 1);
+    for (uint32 r = 0; r < rangeCount; ++r)
+    {
+        rangeStarts[r + 1] = rangeStarts[r] + pRanges[r].count;
+    }
+    const uint32 candidateCount = rangeStarts[rangeCount];
+
+    // Each chunk compacts into the front of its own range, then the ranges are moved together in order.
+    const uint32        chunkCount = (candidateCount + BoxesPerChunk - 1) / BoxesPerChunk;
+    std::vector<uint32> chunkCounts(chunkCount);
+    std::atomic<uint32> next(0);
+    pool.Run(threadCount, [&](uint32)
+    {
+        for (uint32 chunk = next++; chunk < chunkCount; chunk = next++)
+        {
+            const uint32 begin = chunk * BoxesPerChunk;
+            const uint32 end   = std::min<uint32>(begin + BoxesPerChunk, candidateCount);
+            uint32       range = static_cast<uint32>(std::upper_bound(rangeStarts.begin(), rangeStarts.end(), begin) -
+                                                     rangeStarts.begin()) - 1;
+            uint32       count = 0;
+            for (uint32 i = begin; i < end; ++range)
+            {
+                const uint32* pCandidates = pRanges[range].pIndices;
+                const uint32  rangeStart  = rangeStarts[range];
+                const uint32  rangeEnd    = std::min<uint32>(rangeStarts[range + 1], end);
+                for (; i < rangeEnd; ++i)
+                {
+                    const uint32 candidate = pCandidates[i - rangeStart];
+                    if (IsVisible(pBoxes[candidate]))
+                    {
+                        pVisible[begin + count++] = candidate;
+                    }
+                }
+            }
+            chunkCounts[chunk] = count;
+        }
+    });
+
+    uint32 visibleCount = 0;
+    for (uint32 chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        memmove(pVisible + visibleCount, pVisible + chunk * BoxesPerChunk, chunkCounts[chunk] * sizeof(uint32));
+        visibleCount += chunkCounts[chunk];
+    }
+
+    m_stats.testedBoxes   += candidateCount;
+    m_stats.occludedBoxes += candidateCount - visibleCount;
+    m_stats.cullMs        += ElapsedMs(start);
+    return visibleCount;
+}
+
+// ====================================================================================================================
+float OcclusionCuller::PixelDepth(
+    uint32 x,
+    uint32 y) const
+{
+    const Tile&  tile = m_tiles[(y / TileHeight) * m_tilesX + x / TileWidth];
+    const uint32 bit  = 1u << (x % TileWidth);
+    return ((tile.mask[y % TileHeight] & bit) != 0) ? tile.zMax0 : tile.zMax1;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include "FrustumCulling.h"
+#include "WorkerPool.h"
+
+using uint32 = std::uint32_t;
+
+// ====================================================================================================================
+// Work done by the last OcclusionCuller::Rasterize() and Cull() calls.
+struct OcclusionStats
+{
+    uint32 occluderTriangles   = 0; // Submitted
+    uint32 rasterizedTriangles = 0; // Left after near clipping, back face and off screen culling
+    uint32 testedBoxes         = 0;
+    uint32 occludedBoxes       = 0;
+    double rasterizeMs         = 0.0;
+    double cullMs              = 0.0;
+};
+
+// ====================================================================================================================
+// Software occlusion culling against a small masked depth buffer (Andersson et al., Masked Software Occlusion
+// Culling, 2015). The screen is split into tiles of 32 x 8 pixels; a tile stores no per pixel depths, only a coverage
+// mask of one bit per pixel and two conservative depths: the farthest depth of the pixels in the mask and the farthest
+// depth of the rest. Triangles are merged into a tile by growing the mask and its depth, or by restarting the mask
+// when the new triangle is much closer; a full mask becomes the depth of the whole tile. So a tile never claims a
+// pixel is closer than what was drawn there, and boxes are only culled when they are certainly hidden.
+//
+// Depth is z / w of a DirectX projection, 0 at the near plane. Occluders are triangles with clockwise front faces, as
+// GeometryGenerator makes them; back faces are skipped and triangles crossing the near plane are clipped. Coverage is
+// sampled at pixel centers with SSE2, 8 rows of a tile at a time.
+//
+// Rasterize() spreads the triangle setup over the threads of a pool, then the threads take horizontal bands of tiles
+// and rasterize every triangle overlapping their band in submission order, so no two threads write to the same tile
+// and the result does not depend on the thread count. Cull() tests boxes on all threads of the pool.
+class OcclusionCuller
+{
+public:
+    static const uint32 TileWidth  = 32;
+    static const uint32 TileHeight = 8;
+
+    // The buffer resolution, e.g. 320 x 192; it only has to keep the screen's aspect ratio.
+    void Resize(uint32 width, uint32 height);
+
+    // Forgets the occluders of the previous frame.
+    void BeginFrame();
+
+    // Queues an occluder for Rasterize(): object space float3 positions stride bytes apart and 32 bit indices, which
+    // have to stay valid until then.
+    void AddOccluder(const void*         pPositions,
+                     uint32              stride,
+                     const uint32*       pIndices,
+                     uint32              indexCount,
+                     DirectX::FXMMATRIX  world);
+
+    // Clears the buffer and draws the queued occluders as seen through viewProj.
+    void Rasterize(DirectX::FXMMATRIX viewProj, WorkerPool& pool, uint32 threadCount = 0);
+
+    // Whether any part of a world space box may be visible over the occluders. Boxes crossing the near plane are.
+    bool IsVisible(const DirectX::BoundingBox& box) const;
+
+    // Keeps the candidates whose box (pBoxes[candidate]) may be visible, in their order. pVisible may be pCandidates.
+    // Returns the kept count.
+    uint32 Cull(const DirectX::BoundingBox* pBoxes,
+                const uint32*               pCandidates,
+                uint32                      candidateCount,
+                uint32*                     pVisible,
+                WorkerPool&                 pool,
+                uint32                      threadCount = 0);
+
+    // As above, with the candidates in ranges as CoherentCuller::VisibleRanges() returns them, which saves copying
+    // them into one array first. pVisible needs room for all candidates and may not overlap them.
+    uint32 Cull(const DirectX::BoundingBox* pBoxes,
+                const VisibleRange*         pRanges,
+                uint32                      rangeCount,
+                uint32*                     pVisible,
+                WorkerPool&                 pool,
+                uint32                      threadCount = 0);
+
+    const OcclusionStats& Stats() const { return m_stats; }
+
+    uint32 Width() const { return m_width; }
+    uint32 Height() const { return m_height; }
+
+    // Upper bound of the occluder depth at a pixel, 1 where nothing was drawn; for tests and visualization.
+    float PixelDepth(uint32 x, uint32 y) const;
+
+private:
+    struct Occluder
+    {
+        const uint8_t*      pPositions;
+        uint32              stride;
+        const uint32*       pIndices;
+        uint32              firstTriangle; // Over all occluders of the frame
+        DirectX::XMFLOAT4X4 world;
+    };
+
+    // Screen space triangle with edge functions a * x + b * y + c >= 0 inside and depth zA * x + zB * y + zC.
+    struct Triangle
+    {
+        float  edgeA[3];
+        float  edgeB[3];
+        float  edgeC[3];
+        float  zA;
+        float  zB;
+        float  zC;
+        float  zMax;
+        uint32 tileX0; // Tile range, inclusive; tileX0 > tileX1 for slots without a triangle
+        uint32 tileX1;
+        uint32 tileY0;
+        uint32 tileY1;
+    };
+
+    struct Tile
+    {
+        uint32 mask[TileHeight]; // Bit x of row y set if the pixel is covered by the near layer
+        float  zMax0;            // Farthest depth of the pixels in the mask
+        float  zMax1;            // Farthest depth of the other pixels
+    };
+
+    void SetupTriangle(const DirectX::XMFLOAT4* pClip, Triangle& triangle) const;
+    void RasterizeBand(uint32 tileY0, uint32 tileY1);
+    bool IsRectVisible(float x0, float y0, float x1, float y1, float depth) const;
+
+    uint32                m_width      = 0;
+    uint32                m_height     = 0;
+    uint32                m_tilesX     = 0;
+    uint32                m_tilesY     = 0;
+    DirectX::XMFLOAT4X4   m_viewProj;
+    std::vector<Tile>     m_tiles;
+    std::vector<Occluder> m_occluders;
+    std::vector<Triangle> m_triangles; // Two slots per occluder triangle, for the halves of near clipped ones
+    uint32                m_triangleCount = 0;
+    OcclusionStats        m_stats;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// ====================================================================================================================
+// Number of worker threads to use when the caller does not ask for a specific count.
+inline uint32_t DefaultThreadCount()
+{
+    const uint32_t hwThreads = std::thread::hardware_concurrency();
+    return (hwThreads == 0) ? 1 : hwThreads;
+}
+
+// ====================================================================================================================
+// Splits [0, count) into one contiguous range per thread and calls func(begin, end) for each range. Small workloads
+// (fewer than 2 * minItemsPerThread items) run inline on the calling thread. The calling thread always processes the
+// last range itself, so maxThreads == 1 never spawns a thread.
+template<typename Func>
+void ParallelFor(
+    uint32_t count,
+    uint32_t minItemsPerThread,
+    uint32_t maxThreads,
+    Func     func)
+{
+    if (maxThreads == 0)
+    {
+        maxThreads = DefaultThreadCount();
+    }
+
+    const uint32_t byWork     = std::max<uint32_t>(1, count / std::max<uint32_t>(1, minItemsPerThread));
+    const uint32_t numThreads = std::min<uint32_t>(maxThreads, byWork);
+
+    if (numThreads <= 1)
+    {
+        if (count > 0)
+        {
+            func(0u, count);
+        }
+        return;
+    }
+
+    const uint32_t itemsPerThread = (count + numThreads - 1) / numThreads;
+
+    std::vector<std::thread> workers;
+    workers.reserve(numThreads - 1);
+
+    for (uint32_t t = 0; t < numThreads - 1; ++t)
+    {
+        const uint32_t begin = t * itemsPerThread;
+        const uint32_t end   = std::min<uint32_t>(count, begin + itemsPerThread);
+        if (begin < end)
+        {
+            workers.emplace_back([=]() { func(begin, end); });
+        }
+    }
+
+    const uint32_t lastBegin = (numThreads - 1) * itemsPerThread;
+    if (lastBegin < count)
+    {
+        func(lastBegin, count);
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+// ====================================================================================================================
+template<typename Func>
+void ParallelFor(
+    uint32_t count,
+    uint32_t minItemsPerThread,
+    Func     func)
+{
+    ParallelFor(count, minItemsPerThread, 0, func);
+}
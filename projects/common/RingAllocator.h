@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// ====================================================================================================================
+// Hands out per frame ranges (dynamic vertices, constants, ...) of one persistently mapped upload buffer used as a
+// ring. Everything allocated before EndFrame(fenceValue) is released together by Retire() once the GPU has reached
+// that fence value, so the CPU never overwrites data a frame in flight still reads. Allocations are contiguous; one
+// that does not fit before the end of the buffer starts over at offset 0. Not thread safe: allocate one range for a
+// whole batch and fill it from the workers.
+class RingAllocator
+{
+public:
+    static const uint64_t InvalidOffset = UINT64_MAX;
+
+    explicit RingAllocator(uint64_t size = 0) { Reset(size); }
+
+    // Forgets all allocations, e.g. after the GPU was flushed.
+    void Reset(uint64_t size)
+    {
+        m_size      = size;
+        m_head      = 0;
+        m_tail      = 0;
+        m_allocated = 0;
+        m_retired   = 0;
+        m_frames.clear();
+    }
+
+    // Returns the byte offset of the range, or InvalidOffset if the ring has no room left for it this frame.
+    uint64_t Allocate(
+        uint64_t size,
+        uint64_t alignment = 16)
+    {
+        const uint64_t used = m_allocated - m_retired;
+        if (used == 0)
+        {
+            m_head = 0;
+            m_tail = 0;
+        }
+
+        uint64_t offset = (m_head + alignment - 1) & ~(alignment - 1);
+        if ((m_head >= m_tail) && (used < m_size))
+        {
+            // Free space is [head, size) and [0, tail).
+            if (offset + size > m_size)
+            {
+                if (size > m_tail)
+                {
+                    return InvalidOffset;
+                }
+                offset = 0;
+            }
+        }
+        else if (offset + size > m_tail)
+        {
+            // Free space is [head, tail), or nothing when the ring is full.
+            return InvalidOffset;
+        }
+
+        // Bytes skipped for alignment or at the end of the buffer stay in use until the frame retires.
+        m_allocated += ((offset >= m_head) ? (offset - m_head) : (m_size - m_head + offset)) + size;
+        m_head       = offset + size;
+        return offset;
+    }
+
+    // Closes the current frame; its allocations are released by Retire(fenceValue) or any later value.
+    void EndFrame(
+        uint64_t fenceValue)
+    {
+        m_frames.push_back({ fenceValue, m_head, m_allocated });
+    }
+
+    void Retire(
+        uint64_t completedFenceValue)
+    {
+        while ((m_frames.empty() == false) && (m_frames.front().fenceValue <= completedFenceValue))
+        {
+            m_tail    = m_frames.front().head;
+            m_retired = m_frames.front().allocated;
+            m_frames.pop_front();
+        }
+    }
+
+    uint64_t Size() const { return m_size; }
+    uint64_t UsedSize() const { return m_allocated - m_retired; }
+
+private:
+    struct Frame
+    {
+        uint64_t fenceValue;
+        uint64_t head;      // m_head at the end of the frame
+        uint64_t allocated; // m_allocated at the end of the frame
+    };
+
+    uint64_t          m_size      = 0;
+    uint64_t          m_head      = 0; // End of the newest allocation
+    uint64_t          m_tail      = 0; // Start of the oldest allocation still in use
+    uint64_t          m_allocated = 0; // Bytes ever allocated, padding included
+    uint64_t          m_retired   = 0; // Bytes ever released
+    std::deque<Frame> m_frames;
+};
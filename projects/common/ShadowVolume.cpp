@@ -0,0 +1,368 @@
+#include "ShadowVolume.h"
+#include "MeshWelder.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+static const uint32 MinFacesPerThread = 16 * 1024;
+
+// ====================================================================================================================
+// Welds on position only: normals, tangents and texture coordinates may differ across the edges of the surface.
+static WeldSettings PositionOnlyWeld()
+{
+    WeldSettings settings;
+    settings.normalTolerance  = FLT_MAX;
+    settings.tangentTolerance = FLT_MAX;
+    settings.texCTolerance    = FLT_MAX;
+    return settings;
+}
+
+// ====================================================================================================================
+void MeshAdjacency::Build(
+    const MeshData& meshData,
+    uint32          maxThreads)
+{
+    uint32                    positionCount = 0;
+    const std::vector<uint32> remap         = MeshWelder::BuildWeldRemap(meshData, PositionOnlyWeld(), maxThreads, &positionCount);
+
+    std::vector<XMFLOAT3> positions(positionCount);
+    for (uint32 i = 0; i < meshData.VertexCount(); ++i)
+    {
+        positions[remap[i]] = meshData.m_vertices[i].m_position;
+    }
+
+    Build(positions, remap, meshData.m_indices32.data(), meshData.IndexCount(), maxThreads);
+}
+
+// ====================================================================================================================
+void MeshAdjacency::Build(
+    const MeshDataSoA& meshData,
+    uint32             maxThreads)
+{
+    uint32                    positionCount = 0;
+    const std::vector<uint32> remap         = MeshWelder::BuildWeldRemap(meshData, PositionOnlyWeld(), maxThreads, &positionCount);
+
+    std::vector<XMFLOAT3> positions(positionCount);
+    for (uint32 i = 0; i < meshData.VertexCount(); ++i)
+    {
+        positions[remap[i]] = meshData.m_positions[i];
+    }
+
+    Build(positions, remap, meshData.m_indices32.data(), meshData.IndexCount(), maxThreads);
+}
+
+// ====================================================================================================================
+void MeshAdjacency::Build(
+    const std::vector<XMFLOAT3>& positions,
+    const std::vector<uint32>&   remap,
+    const uint32*                pIndices,
+    uint32                       indexCount,
+    uint32                       maxThreads)
+{
+    m_positions = positions;
+    m_faces.clear();
+    m_faces.reserve(indexCount);
+    m_edges.clear();
+    m_openEdgeCount = 0;
+
+    // Faces that welding collapsed to a line or a point have no plane and would only add open edges.
+    for (uint32 i = 0; i + 2 < indexCount; i += 3)
+    {
+        const uint32 a = remap[pIndices[i]];
+        const uint32 b = remap[pIndices[i + 1]];
+        const uint32 c = remap[pIndices[i + 2]];
+        if ((a != b) && (b != c) && (c != a))
+        {
+            m_faces.push_back(a);
+            m_faces.push_back(b);
+            m_faces.push_back(c);
+        }
+    }
+
+    const uint32 faceCount   = FaceCount();
+    const uint32 paddedCount = (faceCount + 3) & ~3u;
+    for (auto& plane : m_planes)
+    {
+        plane.assign(paddedCount, 0.0f);
+    }
+
+    ParallelFor(faceCount, MinFacesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 f = begin; f < end; ++f)
+        {
+            const XMVECTOR a = XMLoadFloat3(&m_positions[m_faces[3 * f]]);
+            const XMVECTOR b = XMLoadFloat3(&m_positions[m_faces[3 * f + 1]]);
+            const XMVECTOR c = XMLoadFloat3(&m_positions[m_faces[3 * f + 2]]);
+
+            // Points to the side the vertex normals of the generated meshes point to.
+            XMFLOAT3 n;
+            XMStoreFloat3(&n, XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)));
+            m_planes[0][f] = n.x;
+            m_planes[1][f] = n.y;
+            m_planes[2][f] = n.z;
+            m_planes[3][f] = -XMVectorGetX(XMVector3Dot(XMLoadFloat3(&n), a));
+        }
+    });
+
+    // Sorted position pair -> newest edge with those positions.
+    std::unordered_map<uint64_t, uint32> edgeMap;
+    edgeMap.reserve(size_t(faceCount) * 3 / 2);
+    m_edges.reserve(size_t(faceCount) * 3 / 2);
+
+    for (uint32 f = 0; f < faceCount; ++f)
+    {
+        for (uint32 k = 0; k < 3; ++k)
+        {
+            const uint32   a   = m_faces[3 * f + k];
+            const uint32   b   = m_faces[3 * f + (k + 1) % 3];
+            const uint64_t key = (static_cast<uint64_t>(std::min<uint32>(a, b)) << 32) | std::max<uint32>(a, b);
+
+            auto it = edgeMap.find(key);
+            if (it != edgeMap.end())
+            {
+                AdjacencyEdge& edge = m_edges[it->second];
+                if ((edge.face1 == InvalidFace) && (edge.v0 == b) && (edge.v1 == a))
+                {
+                    edge.face1 = f;
+                    m_openEdgeCount--;
+                    continue;
+                }
+            }
+
+            edgeMap[key] = EdgeCount();
+            m_edges.push_back({ a, b, f, InvalidFace });
+            m_openEdgeCount++;
+        }
+    }
+}
+
+// ====================================================================================================================
+uint32 ShadowVolume::ComputeFacing(
+    const MeshAdjacency& adjacency,
+    const XMFLOAT4&      light,
+    uint8_t*             pFacing)
+{
+    const float* pX = adjacency.PlaneComponents(0);
+    const float* pY = adjacency.PlaneComponents(1);
+    const float* pZ = adjacency.PlaneComponents(2);
+    const float* pW = adjacency.PlaneComponents(3);
+
+    const __m128 lx   = _mm_set1_ps(light.x);
+    const __m128 ly   = _mm_set1_ps(light.y);
+    const __m128 lz   = _mm_set1_ps(light.z);
+    const __m128 lw   = _mm_set1_ps(light.w);
+    const __m128 zero = _mm_setzero_ps();
+
+    const uint32 faceCount = adjacency.FaceCount();
+    uint32       litCount  = 0;
+
+    for (uint32 f = 0; f < faceCount; f += 4)
+    {
+        const __m128 d    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(pX + f), lx), _mm_mul_ps(_mm_load_ps(pY + f), ly)),
+                                       _mm_add_ps(_mm_mul_ps(_mm_load_ps(pZ + f), lz), _mm_mul_ps(_mm_load_ps(pW + f), lw)));
+        const int    mask = _mm_movemask_ps(_mm_cmpgt_ps(d, zero));
+
+        const uint32 count = std::min<uint32>(4, faceCount - f);
+        for (uint32 k = 0; k < count; ++k)
+        {
+            const uint8_t lit = static_cast<uint8_t>((mask >> k) & 1);
+            pFacing[f + k] = lit;
+            litCount      += lit;
+        }
+    }
+
+    return litCount;
+}
+
+// ====================================================================================================================
+uint32 ShadowVolume::FindSilhouette(
+    const MeshAdjacency& adjacency,
+    const uint8_t*       pFacing,
+    std::vector<uint32>& silhouette)
+{
+    silhouette.clear();
+
+    for (const AdjacencyEdge& edge : adjacency.Edges())
+    {
+        const uint8_t lit0 = pFacing[edge.face0];
+        const uint8_t lit1 = (edge.face1 != MeshAdjacency::InvalidFace) ? pFacing[edge.face1] : 0;
+        if (lit0 != lit1)
+        {
+            silhouette.push_back(lit0 ? edge.v0 : edge.v1);
+            silhouette.push_back(lit0 ? edge.v1 : edge.v0);
+        }
+    }
+
+    return static_cast<uint32>(silhouette.size() / 2);
+}
+
+// ====================================================================================================================
+void ShadowVolume::FindSilhouette(
+    ShadowCaster& caster)
+{
+    assert(caster.pAdjacency != nullptr);
+
+    caster.facing.resize(caster.pAdjacency->FaceCount());
+    caster.litFaceCount = ComputeFacing(*caster.pAdjacency, caster.light, caster.facing.data());
+    FindSilhouette(*caster.pAdjacency, caster.facing.data(), caster.silhouette);
+}
+
+// ====================================================================================================================
+// A directional light extrudes every vertex to the same point at infinity, so the back cap has no area.
+static bool HasBackCap(
+    const ShadowCaster&         caster,
+    const ShadowVolumeSettings& settings)
+{
+    return settings.caps && ((settings.extrusion > 0.0f) || (caster.light.w != 0.0f));
+}
+
+// ====================================================================================================================
+uint32 ShadowVolume::VertexCount(
+    const ShadowCaster&         caster,
+    const ShadowVolumeSettings& settings)
+{
+    const uint32 capCount = (settings.caps ? 1 : 0) + (HasBackCap(caster, settings) ? 1 : 0);
+    return static_cast<uint32>(caster.silhouette.size() / 2) * 6 + caster.litFaceCount * 3 * capCount;
+}
+
+// ====================================================================================================================
+void ShadowVolume::Extrude(
+    const ShadowCaster&         caster,
+    const ShadowVolumeSettings& settings,
+    XMFLOAT4*                   pOut)
+{
+    const MeshAdjacency& adjacency = *caster.pAdjacency;
+    const XMFLOAT3*      pPosition = adjacency.Positions().data();
+    const XMVECTOR       light     = XMLoadFloat4(&caster.light);
+    const XMVECTOR       lightW    = XMVectorSplatW(light);
+    const float          extrusion = settings.extrusion;
+
+    auto Near = [&](uint32 v)
+    {
+        return XMVectorSetW(XMLoadFloat3(&pPosition[v]), 1.0f);
+    };
+
+    auto Far = [&](uint32 v)
+    {
+        const XMVECTOR p   = XMLoadFloat3(&pPosition[v]);
+        const XMVECTOR dir = XMVectorSetW(XMVectorSubtract(XMVectorMultiply(p, lightW), light), 0.0f);
+        if (extrusion == 0.0f)
+        {
+            return dir;
+        }
+        return XMVectorSetW(XMVectorMultiplyAdd(XMVector3Normalize(dir), XMVectorReplicate(extrusion), p), 1.0f);
+    };
+
+    // Sides: one quad per edge, running through the edge against the winding of its lit face like the front cap face
+    // on the other side of the edge.
+    const std::vector<uint32>& silhouette = caster.silhouette;
+    for (size_t i = 0; i < silhouette.size(); i += 2)
+    {
+        const XMVECTOR a    = Near(silhouette[i]);
+        const XMVECTOR b    = Near(silhouette[i + 1]);
+        const XMVECTOR aFar = Far(silhouette[i]);
+        const XMVECTOR bFar = Far(silhouette[i + 1]);
+
+        XMStoreFloat4(pOut++, b);
+        XMStoreFloat4(pOut++, a);
+        XMStoreFloat4(pOut++, aFar);
+        XMStoreFloat4(pOut++, b);
+        XMStoreFloat4(pOut++, aFar);
+        XMStoreFloat4(pOut++, bFar);
+    }
+
+    if (settings.caps == false)
+    {
+        return;
+    }
+
+    // The lit faces close the volume towards the light, the same faces pushed away and flipped close it at the far end.
+    const bool     backCap = HasBackCap(caster, settings);
+    const uint32*  pFace   = adjacency.Faces().data();
+    const uint8_t* pFacing = caster.facing.data();
+    for (uint32 f = 0; f < adjacency.FaceCount(); ++f, pFace += 3)
+    {
+        if (pFacing[f] == 0)
+        {
+            continue;
+        }
+
+        XMStoreFloat4(pOut++, Near(pFace[0]));
+        XMStoreFloat4(pOut++, Near(pFace[1]));
+        XMStoreFloat4(pOut++, Near(pFace[2]));
+
+        if (backCap)
+        {
+            XMStoreFloat4(pOut++, Far(pFace[0]));
+            XMStoreFloat4(pOut++, Far(pFace[2]));
+            XMStoreFloat4(pOut++, Far(pFace[1]));
+        }
+    }
+}
+
+// ====================================================================================================================
+bool ShadowVolume::Build(
+    ShadowCaster*               pCasters,
+    uint32                      casterCount,
+    const ShadowVolumeSettings& settings,
+    RingAllocator&              ring,
+    void*                       pRingData,
+    uint32                      maxThreads)
+{
+    // The casters are split over the threads twice, once to find the silhouettes and once to extrude them into the
+    // range allocated in between.
+    auto ForEachCaster = [&](const std::function<void(ShadowCaster&)>& func)
+    {
+        ParallelFor(casterCount, 1, maxThreads, [&](uint32 begin, uint32 end)
+        {
+            for (uint32 i = begin; i < end; ++i)
+            {
+                func(pCasters[i]);
+            }
+        });
+    };
+
+    ForEachCaster([](ShadowCaster& caster) { FindSilhouette(caster); });
+
+    uint32 vertexCount = 0;
+    for (uint32 i = 0; i < casterCount; ++i)
+    {
+        pCasters[i].firstVertex = vertexCount;
+        pCasters[i].vertexCount = VertexCount(pCasters[i], settings);
+        vertexCount            += pCasters[i].vertexCount;
+    }
+
+    if (vertexCount == 0)
+    {
+        return true;
+    }
+
+    const uint64_t offset = ring.Allocate(uint64_t(vertexCount) * sizeof(XMFLOAT4), sizeof(XMFLOAT4));
+    if (offset == RingAllocator::InvalidOffset)
+    {
+        for (uint32 i = 0; i < casterCount; ++i)
+        {
+            pCasters[i].firstVertex = 0;
+            pCasters[i].vertexCount = 0;
+        }
+        return false;
+    }
+
+    const uint32 baseVertex = static_cast<uint32>(offset / sizeof(XMFLOAT4));
+    for (uint32 i = 0; i < casterCount; ++i)
+    {
+        pCasters[i].firstVertex += baseVertex;
+    }
+
+    XMFLOAT4* pVertices = static_cast<XMFLOAT4*>(pRingData);
+    ForEachCaster([&](ShadowCaster& caster) { Extrude(caster, settings, pVertices + caster.firstVertex); });
+
+    return true;
+}
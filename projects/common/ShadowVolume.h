@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "GeometryGenerator.h"
+#include "RingAllocator.h"
+
+// ====================================================================================================================
+// An edge of a MeshAdjacency and the one or two faces sharing it.
+struct AdjacencyEdge
+{
+    uint32 v0;    // Positions of the edge, in the winding order of face0
+    uint32 v1;
+    uint32 face0;
+    uint32 face1; // MeshAdjacency::InvalidFace on open edges
+};
+
+// ====================================================================================================================
+// Face and edge connectivity of a triangle mesh for silhouette extraction. Vertices at the same position are welded
+// first, so hard edges and texture seams do not split the surface. Edges are found through a hash of their sorted
+// position pairs; the second face of an edge has to run through it in the opposite direction, faces that would be a
+// third one or are wound the other way get an open edge of their own. The face planes are kept in SoA form, padded to
+// a multiple of 4 faces, for ShadowVolume::ComputeFacing().
+class MeshAdjacency
+{
+public:
+    static const uint32 InvalidFace = UINT32_MAX;
+
+    void Build(const MeshData& meshData, uint32 maxThreads = 0);
+    void Build(const MeshDataSoA& meshData, uint32 maxThreads = 0);
+
+    uint32 PositionCount() const { return static_cast<uint32>(m_positions.size()); }
+    uint32 FaceCount() const { return static_cast<uint32>(m_faces.size() / 3); }
+    uint32 EdgeCount() const { return static_cast<uint32>(m_edges.size()); }
+    uint32 OpenEdgeCount() const { return m_openEdgeCount; }
+    bool   IsClosed() const { return m_openEdgeCount == 0; }
+
+    const std::vector<DirectX::XMFLOAT3>& Positions() const { return m_positions; }
+    const std::vector<uint32>&            Faces() const { return m_faces; }
+    const std::vector<AdjacencyEdge>&     Edges() const { return m_edges; }
+
+    // x, y, z and w of the plane of every face, w = -dot(normal, position).
+    const float* PlaneComponents(uint32 component) const { return m_planes[component].data(); }
+
+private:
+    void Build(const std::vector<DirectX::XMFLOAT3>& positions,
+               const std::vector<uint32>&            remap,
+               const uint32*                         pIndices,
+               uint32                                indexCount,
+               uint32                                maxThreads);
+
+    std::vector<DirectX::XMFLOAT3>                  m_positions;
+    std::vector<uint32>                             m_faces; // 3 positions per face
+    std::vector<AdjacencyEdge>                      m_edges;
+    std::vector<float, AlignedAllocator<float, 16>> m_planes[4];
+    uint32                                          m_openEdgeCount = 0;
+};
+
+// ====================================================================================================================
+struct ShadowVolumeSettings
+{
+    // Front and back caps are needed for depth fail ("Carmack's reverse") stenciling, which keeps working with the
+    // camera inside a volume. Depth pass stenciling only needs the sides.
+    bool  caps      = true;
+
+    // Distance the silhouette is pushed away from the light. 0 extrudes to infinity with w = 0 vertices, which needs
+    // depth clamping (DepthClipEnable = false) or a projection without far plane.
+    float extrusion = 0.0f;
+};
+
+// One object casting a shadow volume. The facing and silhouette vectors are scratch space kept between frames.
+struct ShadowCaster
+{
+    const MeshAdjacency* pAdjacency   = nullptr;
+    DirectX::XMFLOAT4    light        = { 0.0f, 1.0f, 0.0f, 0.0f }; // Object space, see ShadowVolume
+
+    // Written by ShadowVolume::Build(): the caster's range of the vertex ring, in vertices.
+    uint32               firstVertex  = 0;
+    uint32               vertexCount  = 0;
+
+    std::vector<uint8_t> facing;
+    std::vector<uint32>  silhouette;
+    uint32               litFaceCount = 0;
+};
+
+// ====================================================================================================================
+// Stencil shadow volumes from the silhouette of a mesh as seen from the light. The light is a homogeneous position in
+// the object space of the mesh: (position, 1) for a point light, (-direction, 0) for a directional light, so a face is
+// lit if dot(plane, light) > 0 and a vertex p is extruded along p * light.w - light.xyz.
+//
+// Volumes are non-indexed triangle lists of float4 positions (DXGI_FORMAT_R32G32B32A32_FLOAT) with the winding of the
+// source mesh, so they are closed and consistently oriented for closed meshes. Open meshes only cast from the side
+// their faces point to.
+class ShadowVolume
+{
+public:
+    // One byte per face, 1 if the face is lit; 4 faces per SSE step. Returns the lit face count.
+    static uint32 ComputeFacing(const MeshAdjacency& adjacency, const DirectX::XMFLOAT4& light, uint8_t* pFacing);
+
+    // Edges between a lit and an unlit face (or open edges of a lit face) as position pairs, in the winding order of the
+    // lit face. Returns the edge count.
+    static uint32 FindSilhouette(const MeshAdjacency& adjacency, const uint8_t* pFacing, std::vector<uint32>& silhouette);
+
+    // Sizes the scratch vectors of the caster and fills them with ComputeFacing() and FindSilhouette() above.
+    static void FindSilhouette(ShadowCaster& caster);
+
+    static uint32 VertexCount(const ShadowCaster& caster, const ShadowVolumeSettings& settings);
+
+    // Writes VertexCount() vertices for the facing and silhouette of the caster.
+    static void Extrude(const ShadowCaster& caster, const ShadowVolumeSettings& settings, DirectX::XMFLOAT4* pOut);
+
+    // Finds the silhouettes of all casters, allocates one range of the ring for all of them and extrudes into pRingData
+    // (the mapped ring buffer), spread over up to maxThreads threads (0 = all hardware threads). Returns false and
+    // leaves every vertexCount 0 if the ring is full.
+    static bool Build(ShadowCaster*               pCasters,
+                      uint32                      casterCount,
+                      const ShadowVolumeSettings& settings,
+                      RingAllocator&              ring,
+                      void*                       pRingData,
+                      uint32                      maxThreads = 0);
+};
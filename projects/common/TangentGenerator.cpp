@@ -0,0 +1,240 @@
+#include "TangentGenerator.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+static const uint32 MinTrianglesPerThread = 16 * 1024;
+static const uint32 MinVerticesPerThread  = 16 * 1024;
+
+// ====================================================================================================================
+// Normalized v, or any unit vector orthogonal to normal if v is zero.
+static XMVECTOR NormalizeOrOrthogonal(
+    FXMVECTOR v,
+    FXMVECTOR normal)
+{
+    const float lengthSq = XMVectorGetX(XMVector3LengthSq(v));
+    if (lengthSq > 1e-20f)
+    {
+        return XMVectorScale(v, 1.0f / sqrtf(lengthSq));
+    }
+
+    // Cross with the axis least aligned with the normal.
+    XMFLOAT3 n;
+    XMStoreFloat3(&n, XMVectorAbs(normal));
+    const XMVECTOR axis = ((n.x <= n.y) && (n.x <= n.z)) ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f)
+                        : ((n.y <= n.z) ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f));
+    return XMVector3Normalize(XMVector3Cross(normal, axis));
+}
+
+// ====================================================================================================================
+// Angle weighted tangent of every corner, projected into the corner's tangent plane, and the handedness of every
+// triangle's texture mapping (0 for triangles without one).
+static void ComputeCornerTangents(
+    const MeshData&        meshData,
+    uint32                 maxThreads,
+    std::vector<XMFLOAT3>& cornerTangents,
+    std::vector<int8_t>&   triangleSigns)
+{
+    const uint32  triangleCount = meshData.IndexCount() / 3;
+    const uint32* pIndices      = meshData.m_indices32.data();
+    const Vertex* pVertices     = meshData.m_vertices.data();
+
+    cornerTangents.resize(size_t(triangleCount) * 3);
+    triangleSigns.resize(triangleCount);
+
+    ParallelFor(triangleCount, MinTrianglesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 t = begin; t < end; ++t)
+        {
+            const Vertex* v[3] = { &pVertices[pIndices[3 * t]], &pVertices[pIndices[3 * t + 1]], &pVertices[pIndices[3 * t + 2]] };
+
+            const XMVECTOR p[3] = { XMLoadFloat3(&v[0]->m_position), XMLoadFloat3(&v[1]->m_position), XMLoadFloat3(&v[2]->m_position) };
+            const XMVECTOR d1   = XMVectorSubtract(p[1], p[0]);
+            const XMVECTOR d2   = XMVectorSubtract(p[2], p[0]);
+
+            const float t21x = v[1]->m_texC.x - v[0]->m_texC.x;
+            const float t21y = v[1]->m_texC.y - v[0]->m_texC.y;
+            const float t31x = v[2]->m_texC.x - v[0]->m_texC.x;
+            const float t31y = v[2]->m_texC.y - v[0]->m_texC.y;
+
+            // Direction of dP/du, up to the sign of the UV area.
+            const float    uvArea = t21x * t31y - t21y * t31x;
+            const XMVECTOR os     = XMVectorSubtract(XMVectorScale(d1, t31y), XMVectorScale(d2, t21y));
+            const float    osLen  = XMVectorGetX(XMVector3Length(os));
+
+            if ((fabsf(uvArea) <= FLT_MIN) || (osLen <= FLT_MIN))
+            {
+                triangleSigns[t] = 0;
+                for (uint32 k = 0; k < 3; ++k)
+                {
+                    cornerTangents[3 * t + k] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+                }
+                continue;
+            }
+
+            const float    sign    = (uvArea > 0.0f) ? 1.0f : -1.0f;
+            const XMVECTOR tangent = XMVectorScale(os, sign / osLen);
+            triangleSigns[t]       = (uvArea > 0.0f) ? 1 : -1;
+
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                const XMVECTOR normal = XMLoadFloat3(&v[k]->m_normal);
+
+                // Corner angle between the edges projected into the tangent plane.
+                XMVECTOR e1 = XMVectorSubtract(p[(k + 1) % 3], p[k]);
+                XMVECTOR e2 = XMVectorSubtract(p[(k + 2) % 3], p[k]);
+                e1 = XMVector3Normalize(XMVectorSubtract(e1, XMVectorMultiply(normal, XMVector3Dot(normal, e1))));
+                e2 = XMVector3Normalize(XMVectorSubtract(e2, XMVectorMultiply(normal, XMVector3Dot(normal, e2))));
+
+                const float cosAngle = std::min<float>(1.0f, std::max<float>(-1.0f, XMVectorGetX(XMVector3Dot(e1, e2))));
+                const float angle    = XMScalarACos(cosAngle);
+
+                const XMVECTOR projected = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+                const float    length    = XMVectorGetX(XMVector3Length(projected));
+                const float    weight    = (length > FLT_MIN) ? angle / length : 0.0f;
+
+                XMStoreFloat3(&cornerTangents[3 * t + k], XMVectorScale(projected, weight));
+            }
+        }
+    });
+}
+
+// ====================================================================================================================
+uint32 TangentGenerator::Generate(
+    MeshData&           meshData,
+    std::vector<float>* pBitangentSigns,
+    uint32              maxThreads)
+{
+    const uint32 vertexCount   = meshData.VertexCount();
+    const uint32 triangleCount = meshData.IndexCount() / 3;
+    uint32*      pIndices      = meshData.m_indices32.data();
+
+    std::vector<XMFLOAT3> cornerTangents;
+    std::vector<int8_t>   triangleSigns;
+    ComputeCornerTangents(meshData, maxThreads, cornerTangents, triangleSigns);
+
+    // Corners of every vertex, in corner order.
+    std::vector<uint32> cornerStart(vertexCount + 1, 0);
+    for (uint32 c = 0; c < triangleCount * 3; ++c)
+    {
+        cornerStart[pIndices[c] + 1]++;
+    }
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        cornerStart[v + 1] += cornerStart[v];
+    }
+
+    std::vector<uint32> vertexCorners(size_t(triangleCount) * 3);
+    {
+        std::vector<uint32> cursor(cornerStart.begin(), cornerStart.end() - 1);
+        for (uint32 c = 0; c < triangleCount * 3; ++c)
+        {
+            vertexCorners[cursor[pIndices[c]]++] = c;
+        }
+    }
+
+    // Sum the corners per vertex and handedness. A vertex keeps the handedness of its first textured corner; corners
+    // of the other handedness go to a copy.
+    std::vector<XMFLOAT3> mirroredTangents(vertexCount);
+    std::vector<int8_t>   vertexSigns(vertexCount);
+    std::vector<uint8_t>  split(vertexCount);
+
+    ParallelFor(vertexCount, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 v = begin; v < end; ++v)
+        {
+            int8_t   sign     = 0;
+            XMVECTOR sum      = XMVectorZero();
+            XMVECTOR mirrored = XMVectorZero();
+            bool     hasOther = false;
+
+            for (uint32 k = cornerStart[v]; k < cornerStart[v + 1]; ++k)
+            {
+                const uint32   c          = vertexCorners[k];
+                const int8_t   cornerSign = triangleSigns[c / 3];
+                const XMVECTOR tangent    = XMLoadFloat3(&cornerTangents[c]);
+
+                if (cornerSign == 0)
+                {
+                    continue;
+                }
+                if (sign == 0)
+                {
+                    sign = cornerSign;
+                }
+
+                if (cornerSign == sign)
+                {
+                    sum = XMVectorAdd(sum, tangent);
+                }
+                else
+                {
+                    mirrored = XMVectorAdd(mirrored, tangent);
+                    hasOther = true;
+                }
+            }
+
+            Vertex&        vertex = meshData.m_vertices[v];
+            const XMVECTOR normal = XMLoadFloat3(&vertex.m_normal);
+
+            XMStoreFloat3(&vertex.m_tangentU, NormalizeOrOrthogonal(sum, normal));
+            XMStoreFloat3(&mirroredTangents[v], NormalizeOrOrthogonal(mirrored, normal));
+            vertexSigns[v] = (sign == 0) ? 1 : sign;
+            split[v]       = hasOther ? 1 : 0;
+        }
+    });
+
+    // Copies of the split vertices go to the end, in vertex order.
+    std::vector<uint32> splitIndex(vertexCount);
+    uint32              newVertexCount = vertexCount;
+    for (uint32 v = 0; v < vertexCount; ++v)
+    {
+        splitIndex[v] = split[v] ? newVertexCount++ : v;
+    }
+
+    meshData.ResizeVertices(newVertexCount);
+    if (pBitangentSigns != nullptr)
+    {
+        pBitangentSigns->resize(newVertexCount);
+    }
+
+    ParallelFor(vertexCount, MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 v = begin; v < end; ++v)
+        {
+            if (split[v])
+            {
+                Vertex& copy    = meshData.m_vertices[splitIndex[v]];
+                copy            = meshData.m_vertices[v];
+                copy.m_tangentU = mirroredTangents[v];
+            }
+
+            if (pBitangentSigns != nullptr)
+            {
+                (*pBitangentSigns)[v] = float(vertexSigns[v]);
+                if (split[v])
+                {
+                    (*pBitangentSigns)[splitIndex[v]] = -float(vertexSigns[v]);
+                }
+            }
+        }
+    });
+
+    ParallelFor(triangleCount, MinTrianglesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 c = begin * 3; c < end * 3; ++c)
+        {
+            const uint32 v          = pIndices[c];
+            const int8_t cornerSign = triangleSigns[c / 3];
+            if (split[v] && (cornerSign != 0) && (cornerSign != vertexSigns[v]))
+            {
+                pIndices[c] = splitIndex[v];
+            }
+        }
+    });
+
+    return newVertexCount;
+}
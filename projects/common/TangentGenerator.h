@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Computes m_tangentU for indexed triangle meshes from their positions, normals and texture coordinates, following
+// MikkTSpace (Mikkelsen 2008, with its default 180 degree angular threshold):
+// - Every triangle's tangent is projected into the tangent plane of each of its corners and averaged per vertex,
+//   weighted by the corner angle, so the result does not depend on how a surface is triangulated.
+// - A vertex is only split where its triangles disagree on the handedness of the texture mapping (mirrored UVs); the
+//   split off copy is appended and the indices of the mirrored corners are rewritten.
+// - The bitangent is sign * cross(normal, tangent), with the sign per vertex in pBitangentSigns if given.
+//
+// Triangles and vertices are processed on up to maxThreads threads (0 = all hardware threads). The normals should be
+// normalized; vertices whose triangles have no texture mapping (zero UV area) get any tangent orthogonal to the normal.
+class TangentGenerator
+{
+public:
+    // Returns the vertex count after splitting.
+    static uint32 Generate(MeshData& meshData, std::vector<float>* pBitangentSigns = nullptr, uint32 maxThreads = 0);
+};
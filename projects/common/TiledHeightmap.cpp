@@ -0,0 +1,223 @@
+#include "TiledHeightmap.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <fstream>
+
+// ====================================================================================================================
+// Mip layout for a map of the given size; the chain ends at the first mip that fits in one tile.
+static std::vector<TiledHeightmapMip> ComputeMips(
+    uint32 width,
+    uint32 height,
+    uint32 tileSize)
+{
+    std::vector<TiledHeightmapMip> mips;
+
+    uint32 firstTile = 0;
+    for (uint32 mip = 0; ; ++mip)
+    {
+        TiledHeightmapMip m;
+        m.width     = ((width - 1) >> mip) + 1;
+        m.height    = ((height - 1) >> mip) + 1;
+        m.tilesX    = std::max<uint32>(1, (m.width - 1 + tileSize - 1) / tileSize);
+        m.tilesZ    = std::max<uint32>(1, (m.height - 1 + tileSize - 1) / tileSize);
+        m.firstTile = firstTile;
+        mips.push_back(m);
+
+        firstTile += m.tilesX * m.tilesZ;
+        if ((m.tilesX == 1) && (m.tilesZ == 1))
+        {
+            break;
+        }
+    }
+
+    return mips;
+}
+
+// ====================================================================================================================
+bool TiledHeightmap::Write(
+    const std::string&                         path,
+    const Desc&                                desc,
+    const std::function<float(float, float)>& heightAt)
+{
+    assert((desc.width >= 2) && (desc.height >= 2) && (desc.tileSize >= 1) && (desc.maxHeight > desc.minHeight));
+
+    const std::vector<TiledHeightmapMip> mips = ComputeMips(desc.width, desc.height, desc.tileSize);
+
+    TiledHeightmapHeader header;
+    header.width         = desc.width;
+    header.height        = desc.height;
+    header.tileSize      = desc.tileSize;
+    header.mipCount      = static_cast<uint32>(mips.size());
+    header.sampleSpacing = desc.sampleSpacing;
+    header.heightOffset  = desc.minHeight;
+    header.heightScale   = (desc.maxHeight - desc.minHeight) / 65535.0f;
+
+    const uint32 tileCount       = mips.back().firstTile + 1;
+    const uint32 tileSampleCount = (desc.tileSize + 1) * (desc.tileSize + 1);
+    const uint64 tableOffset     = sizeof(header) + mips.size() * sizeof(TiledHeightmapMip);
+    const uint64 samplesOffset   = tableOffset + uint64(tileCount) * sizeof(TiledHeightmapTile);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (file.is_open() == false)
+    {
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(mips.data()), mips.size() * sizeof(TiledHeightmapMip));
+
+    // The table is written once all min / max values are known; reserve its space for now.
+    std::vector<TiledHeightmapTile> tiles(tileCount);
+    file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(TiledHeightmapTile));
+
+    const float minX = -0.5f * (desc.width - 1) * desc.sampleSpacing;
+    const float minZ = -0.5f * (desc.height - 1) * desc.sampleSpacing;
+
+    std::vector<uint16> samples(tileSampleCount);
+
+    for (uint32 mip = 0; mip < mips.size(); ++mip)
+    {
+        const TiledHeightmapMip& m       = mips[mip];
+        const float              spacing = desc.sampleSpacing * static_cast<float>(1u << mip);
+
+        for (uint32 tileZ = 0; tileZ < m.tilesZ; ++tileZ)
+        {
+            for (uint32 tileX = 0; tileX < m.tilesX; ++tileX)
+            {
+                TiledHeightmapTile& tile = tiles[m.firstTile + tileZ * m.tilesX + tileX];
+                tile.offset    = samplesOffset + uint64(m.firstTile + tileZ * m.tilesX + tileX) * tileSampleCount * sizeof(uint16);
+                tile.minHeight = FLT_MAX;
+                tile.maxHeight = -FLT_MAX;
+
+                // Samples past the edge of the map repeat the last row or column.
+                for (uint32 i = 0; i <= desc.tileSize; ++i)
+                {
+                    const uint32 z = std::min<uint32>(tileZ * desc.tileSize + i, m.height - 1);
+                    for (uint32 j = 0; j <= desc.tileSize; ++j)
+                    {
+                        const uint32 x = std::min<uint32>(tileX * desc.tileSize + j, m.width - 1);
+                        const float  h = heightAt(minX + x * spacing, minZ + z * spacing);
+                        const float  q = (h - header.heightOffset) / header.heightScale;
+
+                        const uint16 sample = static_cast<uint16>(std::min<float>(std::max<float>(q + 0.5f, 0.0f), 65535.0f));
+                        const float  stored = header.heightOffset + header.heightScale * sample;
+
+                        samples[i * (desc.tileSize + 1) + j] = sample;
+                        tile.minHeight = std::min<float>(tile.minHeight, stored);
+                        tile.maxHeight = std::max<float>(tile.maxHeight, stored);
+                    }
+                }
+
+                file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(uint16));
+            }
+        }
+    }
+
+    file.seekp(static_cast<std::streamoff>(tableOffset));
+    file.write(reinterpret_cast<const char*>(tiles.data()), tiles.size() * sizeof(TiledHeightmapTile));
+
+    return file.good();
+}
+
+// ====================================================================================================================
+TiledHeightmap::~TiledHeightmap()
+{
+    Close();
+}
+
+// ====================================================================================================================
+bool TiledHeightmap::Open(
+    const std::string& path)
+{
+    Close();
+
+    // Tiles are read in whatever order the camera asks for them.
+    if (m_file.Open(path, MappedFile::Access::Random) == false)
+    {
+        return false;
+    }
+
+    m_pData = m_file.Data();
+
+    const uint64 fileSize = m_file.Size();
+    if (fileSize < sizeof(TiledHeightmapHeader))
+    {
+        Close();
+        return false;
+    }
+
+    // Validate everything the accessors rely on, so a truncated or foreign file is rejected here.
+    const TiledHeightmapHeader& header = Header();
+    if ((header.magic != TiledHeightmapHeader::Magic) || (header.version != TiledHeightmapHeader::Version) ||
+        (header.mipCount == 0) || (header.mipCount > 32) || (header.tileSize == 0) ||
+        (fileSize < sizeof(header) + uint64(header.mipCount) * sizeof(TiledHeightmapMip)))
+    {
+        Close();
+        return false;
+    }
+
+    m_pMips = reinterpret_cast<const TiledHeightmapMip*>(m_pData + sizeof(header));
+
+    const std::vector<TiledHeightmapMip> expected = ComputeMips(header.width, header.height, header.tileSize);
+    const uint32                         tileCount = expected.back().firstTile + 1;
+    const uint64                         tableEnd  = sizeof(header) + uint64(header.mipCount) * sizeof(TiledHeightmapMip) +
+                                                     uint64(tileCount) * sizeof(TiledHeightmapTile);
+
+    if ((expected.size() != header.mipCount) ||
+        (std::equal(expected.begin(), expected.end(), m_pMips, [](const TiledHeightmapMip& a, const TiledHeightmapMip& b)
+         {
+             return (a.width == b.width) && (a.height == b.height) && (a.tilesX == b.tilesX) &&
+                    (a.tilesZ == b.tilesZ) && (a.firstTile == b.firstTile);
+         }) == false) ||
+        (fileSize < tableEnd + uint64(tileCount) * TileSampleCount() * sizeof(uint16)))
+    {
+        Close();
+        return false;
+    }
+
+    m_pTiles = reinterpret_cast<const TiledHeightmapTile*>(m_pData + sizeof(header) + header.mipCount * sizeof(TiledHeightmapMip));
+
+    for (uint32 i = 0; i < tileCount; ++i)
+    {
+        if (m_pTiles[i].offset + uint64(TileSampleCount()) * sizeof(uint16) > fileSize)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ====================================================================================================================
+void TiledHeightmap::Close()
+{
+    m_file.Close();
+
+    m_pData  = nullptr;
+    m_pMips  = nullptr;
+    m_pTiles = nullptr;
+}
+
+// ====================================================================================================================
+const TiledHeightmapTile& TiledHeightmap::Tile(
+    uint32 mip,
+    uint32 tileX,
+    uint32 tileZ) const
+{
+    const TiledHeightmapMip& m = m_pMips[mip];
+    assert((tileX < m.tilesX) && (tileZ < m.tilesZ));
+
+    return m_pTiles[m.firstTile + tileZ * m.tilesX + tileX];
+}
+
+// ====================================================================================================================
+const uint16* TiledHeightmap::TileSamples(
+    uint32 mip,
+    uint32 tileX,
+    uint32 tileZ) const
+{
+    return reinterpret_cast<const uint16*>(m_pData + Tile(mip, tileX, tileZ).offset);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+using uint16 = std::uint16_t;
+using uint32 = std::uint32_t;
+using uint64 = std::uint64_t;
+
+// ====================================================================================================================
+// Layout of a tiled heightmap file:
+//     TiledHeightmapHeader
+//     TiledHeightmapMip[mipCount]
+//     TiledHeightmapTile[sum of tile counts], mip 0 first, tiles row major
+//     tile samples, (tileSize + 1)^2 uint16 per tile, rows along z
+// Each tile repeats the first row and column of its +x and +z neighbours, so any bilinear sample needs one tile only.
+// Heights are stored as height = heightOffset + heightScale * sample. The map is centered on the origin in x and z.
+struct TiledHeightmapHeader
+{
+    static const uint32 Magic   = 0x31544d48; // "HMT1"
+    static const uint32 Version = 1;
+
+    uint32 magic         = Magic;
+    uint32 version       = Version;
+    uint32 width         = 0; // Samples in x at mip 0
+    uint32 height        = 0; // Samples in z at mip 0
+    uint32 tileSize      = 0; // Sample intervals per tile side
+    uint32 mipCount      = 0; // Mip m has its samples 2^m * sampleSpacing apart; the last mip is a single tile
+    float  sampleSpacing = 1.0f;
+    float  heightOffset  = 0.0f;
+    float  heightScale   = 1.0f;
+    uint32 reserved      = 0;
+};
+
+struct TiledHeightmapMip
+{
+    uint32 width     = 0; // Samples
+    uint32 height    = 0;
+    uint32 tilesX    = 0;
+    uint32 tilesZ    = 0;
+    uint32 firstTile = 0; // Index of the mip's first TiledHeightmapTile
+    uint32 reserved  = 0;
+};
+
+struct TiledHeightmapTile
+{
+    uint64 offset    = 0; // Byte offset of the samples in the file
+    float  minHeight = 0.0f;
+    float  maxHeight = 0.0f;
+};
+
+// ====================================================================================================================
+// Read only view of a tiled heightmap file. The file is memory mapped, so opening it costs nothing up front and maps
+// larger than RAM work; pages are only read when tile samples are touched (see HeightmapStreamer).
+class TiledHeightmap
+{
+public:
+    struct Desc
+    {
+        uint32 width         = 0;
+        uint32 height        = 0;
+        uint32 tileSize      = 256;
+        float  sampleSpacing = 1.0f;
+        float  minHeight     = 0.0f; // Range the 16 bit samples cover
+        float  maxHeight     = 1.0f;
+    };
+
+    // Writes a heightmap sampled from heightAt(x, z) in world space, one tile at a time, so the source can be larger
+    // than memory too. Coarser mips point sample heightAt at their own spacing. Returns false if the file can not be
+    // written.
+    static bool Write(const std::string& path, const Desc& desc, const std::function<float(float x, float z)>& heightAt);
+
+    TiledHeightmap() {}
+    ~TiledHeightmap();
+
+    TiledHeightmap(const TiledHeightmap&) = delete;
+    TiledHeightmap& operator=(const TiledHeightmap&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool                        IsOpen() const { return m_file.IsOpen(); }
+    const TiledHeightmapHeader& Header() const { return *reinterpret_cast<const TiledHeightmapHeader*>(m_pData); }
+    const TiledHeightmapMip&    Mip(uint32 mip) const { return m_pMips[mip]; }
+    const TiledHeightmapTile&   Tile(uint32 mip, uint32 tileX, uint32 tileZ) const;
+    const uint16*               TileSamples(uint32 mip, uint32 tileX, uint32 tileZ) const;
+    uint64                      FileSize() const { return m_file.Size(); }
+
+    uint32 TileSampleCount() const { return (Header().tileSize + 1) * (Header().tileSize + 1); }
+    float  MipSpacing(uint32 mip) const { return Header().sampleSpacing * static_cast<float>(1u << mip); }
+    float  MinX() const { return -0.5f * (Header().width - 1) * Header().sampleSpacing; }
+    float  MinZ() const { return -0.5f * (Header().height - 1) * Header().sampleSpacing; }
+
+private:
+    MappedFile                m_file;
+    const uint8_t*            m_pData  = nullptr;
+    const TiledHeightmapMip*  m_pMips  = nullptr;
+    const TiledHeightmapTile* m_pTiles = nullptr;
+};
@@ -23,6 +23,12 @@ public:
         memcpy(&mMappedData[elementIndex * mElementByteSize], &data, sizeof(T));
     }
 
+    // The persistently mapped buffer, for filling many elements at once.
+    BYTE* MappedData() const
+    {
+        return mMappedData;
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
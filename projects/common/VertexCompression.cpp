@@ -0,0 +1,274 @@
+#include "VertexCompression.h"
+#include "MathHelper.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+static const uint32 MinVerticesPerThread = 16 * 1024;
+
+// Bounds thinner than this (e.g. the y extent of a flat grid) are widened so the division stays finite.
+static const float MinQuantizationExtent = 1e-6f;
+
+// ====================================================================================================================
+template<typename MeshT>
+static VertexQuantization ComputeBounds(
+    const MeshT& meshData)
+{
+    VertexQuantization quantization;
+
+    const uint32 vertexCount = meshData.VertexCount();
+    if (vertexCount == 0)
+    {
+        return quantization;
+    }
+
+    XMVECTOR minPos = XMVectorReplicate(FLT_MAX);
+    XMVECTOR maxPos = XMVectorReplicate(-FLT_MAX);
+    for (uint32 i = 0; i < vertexCount; ++i)
+    {
+        const Vertex   v = meshData.GetVertex(i);
+        const XMVECTOR p = XMLoadFloat3(&v.m_position);
+        minPos = XMVectorMin(minPos, p);
+        maxPos = XMVectorMax(maxPos, p);
+    }
+
+    XMStoreFloat3(&quantization.positionOffset, minPos);
+    XMStoreFloat3(&quantization.positionScale, XMVectorMax(maxPos - minPos, XMVectorReplicate(MinQuantizationExtent)));
+
+    return quantization;
+}
+
+// ====================================================================================================================
+static void StoreVertex(
+    const Vertex&             v,
+    const VertexQuantization& quantization,
+    PackedVertex&             packed)
+{
+    const XMVECTOR position = VertexCompression::NormalizePosition(XMLoadFloat3(&v.m_position), quantization);
+
+    XMStoreUShortN4(&packed.position, XMVectorSetW(position, 0.0f));
+    XMStoreShortN2(&packed.normal, VertexCompression::OctEncode(XMLoadFloat3(&v.m_normal)));
+    XMStoreShortN2(&packed.tangentU, VertexCompression::OctEncode(XMLoadFloat3(&v.m_tangentU)));
+    XMStoreHalf2(&packed.texC, XMLoadFloat2(&v.m_texC));
+}
+
+// ====================================================================================================================
+static void StoreVertex(
+    const Vertex&             v,
+    const VertexQuantization& quantization,
+    PackedVertexCompact&      packed)
+{
+    const XMVECTOR position = VertexCompression::NormalizePosition(XMLoadFloat3(&v.m_position), quantization);
+    const XMVECTOR normal   = VertexCompression::OctEncode(XMLoadFloat3(&v.m_normal));
+    const XMVECTOR tangent  = VertexCompression::OctEncode(XMLoadFloat3(&v.m_tangentU));
+
+    XMStoreUShortN4(&packed.position, XMVectorSetW(position, 0.0f));
+    XMStoreByteN4(&packed.normalTangentU, XMVectorPermute<0, 1, 4, 5>(normal, tangent));
+    XMStoreHalf2(&packed.texC, XMLoadFloat2(&v.m_texC));
+}
+
+// ====================================================================================================================
+template<typename MeshT, typename PackedT>
+static void EncodeVertices(
+    const MeshT&              meshData,
+    const VertexQuantization& quantization,
+    std::vector<PackedT>&     packed)
+{
+    packed.resize(meshData.VertexCount());
+
+    ParallelFor(meshData.VertexCount(), MinVerticesPerThread, [&](uint32 begin, uint32 end)
+    {
+        for (uint32 i = begin; i < end; ++i)
+        {
+            StoreVertex(meshData.GetVertex(i), quantization, packed[i]);
+        }
+    });
+}
+
+// ====================================================================================================================
+// Angle between two unit vectors in degrees. Vectors the source mesh leaves at zero are not compared.
+static float AngleDegrees(
+    const XMFLOAT3& source,
+    const XMFLOAT3& decoded)
+{
+    const XMVECTOR s = XMLoadFloat3(&source);
+    if (XMVectorGetX(XMVector3LengthSq(s)) == 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // atan2 of sine and cosine stays accurate for the tiny angles acos() can not resolve in float.
+    const XMVECTOR d        = XMLoadFloat3(&decoded);
+    const float    sinAngle = XMVectorGetX(XMVector3Length(XMVector3Cross(XMVector3Normalize(s), d)));
+    const float    cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(s), d));
+    return XMConvertToDegrees(atan2f(sinAngle, cosAngle));
+}
+
+// ====================================================================================================================
+template<typename PackedT>
+static VertexCompressionError MeasureVertexError(
+    const MeshData&             meshData,
+    const std::vector<PackedT>& packed,
+    const VertexQuantization&   quantization)
+{
+    VertexCompressionError error;
+
+    for (uint32 i = 0; i < meshData.VertexCount(); ++i)
+    {
+        const Vertex& source  = meshData.m_vertices[i];
+        const Vertex  decoded = VertexCompression::Decode(packed[i], quantization);
+
+        const XMVECTOR positionDelta = XMLoadFloat3(&source.m_position) - XMLoadFloat3(&decoded.m_position);
+        const XMVECTOR texCDelta     = XMLoadFloat2(&source.m_texC) - XMLoadFloat2(&decoded.m_texC);
+
+        error.maxPositionError = std::max(error.maxPositionError, XMVectorGetX(XMVector3Length(positionDelta)));
+        error.maxNormalAngle   = std::max(error.maxNormalAngle, AngleDegrees(source.m_normal, decoded.m_normal));
+        error.maxTangentAngle  = std::max(error.maxTangentAngle, AngleDegrees(source.m_tangentU, decoded.m_tangentU));
+        error.maxTexCError     = std::max(error.maxTexCError, XMVectorGetX(XMVector2Length(texCDelta)));
+    }
+
+    return error;
+}
+
+// ====================================================================================================================
+VertexQuantization VertexCompression::ComputeQuantization(
+    const MeshData& meshData)
+{
+    return ComputeBounds(meshData);
+}
+
+// ====================================================================================================================
+VertexQuantization VertexCompression::ComputeQuantization(
+    const MeshDataSoA& meshData)
+{
+    return ComputeBounds(meshData);
+}
+
+// ====================================================================================================================
+XMVECTOR XM_CALLCONV VertexCompression::NormalizePosition(
+    FXMVECTOR                 position,
+    const VertexQuantization& quantization)
+{
+    const XMVECTOR offset = XMLoadFloat3(&quantization.positionOffset);
+    const XMVECTOR scale  = XMLoadFloat3(&quantization.positionScale);
+
+    return XMVectorSaturate(XMVectorDivide(position - offset, XMVectorSetW(scale, 1.0f)));
+}
+
+// ====================================================================================================================
+XMVECTOR XM_CALLCONV VertexCompression::OctEncode(
+    FXMVECTOR n)
+{
+    // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals.
+    const XMVECTOR l1 = XMVectorMax(XMVector3Dot(XMVectorAbs(n), XMVectorSplatOne()), XMVectorReplicate(FLT_MIN));
+    const XMVECTOR p  = XMVectorDivide(n, l1);
+
+    const XMVECTOR signs  = XMVectorSelect(XMVectorReplicate(-1.0f), XMVectorSplatOne(), XMVectorGreaterOrEqual(p, XMVectorZero()));
+    const XMVECTOR folded = (XMVectorSplatOne() - XMVectorAbs(XMVectorSwizzle<1, 0, 2, 3>(p))) * signs;
+
+    const XMVECTOR lowerHalf = XMVectorLess(XMVectorSplatZ(p), XMVectorZero());
+    return XMVectorSelect(XMVectorSetZ(p, 0.0f), XMVectorSetZ(folded, 0.0f), lowerHalf);
+}
+
+// ====================================================================================================================
+XMVECTOR XM_CALLCONV VertexCompression::OctDecode(
+    FXMVECTOR e)
+{
+    const XMVECTOR absE = XMVectorAbs(e);
+    const float    z    = 1.0f - XMVectorGetX(absE) - XMVectorGetY(absE);
+    const XMVECTOR t    = XMVectorReplicate(MathHelper::Clamp(-z, 0.0f, 1.0f));
+
+    const XMVECTOR xy = e + XMVectorSelect(t, -t, XMVectorGreaterOrEqual(e, XMVectorZero()));
+    return XMVector3Normalize(XMVectorSetW(XMVectorSetZ(xy, z), 0.0f));
+}
+
+// ====================================================================================================================
+void VertexCompression::Encode(
+    const MeshData&            meshData,
+    const VertexQuantization&  quantization,
+    std::vector<PackedVertex>& packed)
+{
+    EncodeVertices(meshData, quantization, packed);
+}
+
+// ====================================================================================================================
+void VertexCompression::Encode(
+    const MeshDataSoA&         meshData,
+    const VertexQuantization&  quantization,
+    std::vector<PackedVertex>& packed)
+{
+    EncodeVertices(meshData, quantization, packed);
+}
+
+// ====================================================================================================================
+void VertexCompression::Encode(
+    const MeshData&                   meshData,
+    const VertexQuantization&         quantization,
+    std::vector<PackedVertexCompact>& packed)
+{
+    EncodeVertices(meshData, quantization, packed);
+}
+
+// ====================================================================================================================
+void VertexCompression::Encode(
+    const MeshDataSoA&                meshData,
+    const VertexQuantization&         quantization,
+    std::vector<PackedVertexCompact>& packed)
+{
+    EncodeVertices(meshData, quantization, packed);
+}
+
+// ====================================================================================================================
+Vertex VertexCompression::Decode(
+    const PackedVertex&       packed,
+    const VertexQuantization& quantization)
+{
+    Vertex v;
+
+    const XMVECTOR position = XMLoadUShortN4(&packed.position);
+    XMStoreFloat3(&v.m_position, XMLoadFloat3(&quantization.positionOffset) + position * XMLoadFloat3(&quantization.positionScale));
+    XMStoreFloat3(&v.m_normal, OctDecode(XMLoadShortN2(&packed.normal)));
+    XMStoreFloat3(&v.m_tangentU, OctDecode(XMLoadShortN2(&packed.tangentU)));
+    XMStoreFloat2(&v.m_texC, XMLoadHalf2(&packed.texC));
+
+    return v;
+}
+
+// ====================================================================================================================
+Vertex VertexCompression::Decode(
+    const PackedVertexCompact& packed,
+    const VertexQuantization&  quantization)
+{
+    Vertex v;
+
+    const XMVECTOR position       = XMLoadUShortN4(&packed.position);
+    const XMVECTOR normalTangentU = XMLoadByteN4(&packed.normalTangentU);
+    XMStoreFloat3(&v.m_position, XMLoadFloat3(&quantization.positionOffset) + position * XMLoadFloat3(&quantization.positionScale));
+    XMStoreFloat3(&v.m_normal, OctDecode(normalTangentU));
+    XMStoreFloat3(&v.m_tangentU, OctDecode(XMVectorSwizzle<2, 3, 0, 1>(normalTangentU)));
+    XMStoreFloat2(&v.m_texC, XMLoadHalf2(&packed.texC));
+
+    return v;
+}
+
+// ====================================================================================================================
+VertexCompressionError VertexCompression::MeasureError(
+    const MeshData&                  meshData,
+    const std::vector<PackedVertex>& packed,
+    const VertexQuantization&        quantization)
+{
+    return MeasureVertexError(meshData, packed, quantization);
+}
+
+// ====================================================================================================================
+VertexCompressionError VertexCompression::MeasureError(
+    const MeshData&                         meshData,
+    const std::vector<PackedVertexCompact>& packed,
+    const VertexQuantization&               quantization)
+{
+    return MeasureVertexError(meshData, packed, quantization);
+}
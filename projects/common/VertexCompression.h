@@ -0,0 +1,76 @@
+#pragma once
+
+#include <DirectXPackedVector.h>
+#include <vector>
+
+#include "GeometryGenerator.h"
+
+// ====================================================================================================================
+// Maps quantized positions back to object space: position = positionOffset + unorm16 position * positionScale. Pass
+// both to the vertex shader, e.g. in the per object constants.
+struct VertexQuantization
+{
+    DirectX::XMFLOAT3 positionOffset = { 0.0f, 0.0f, 0.0f }; // Minimum of the bounds
+    DirectX::XMFLOAT3 positionScale  = { 1.0f, 1.0f, 1.0f }; // Extent of the bounds
+};
+
+// 20 bytes instead of the 44 of Vertex.
+struct PackedVertex
+{
+    DirectX::PackedVector::XMUSHORTN4 position; // DXGI_FORMAT_R16G16B16A16_UNORM, w unused
+    DirectX::PackedVector::XMSHORTN2  normal;   // DXGI_FORMAT_R16G16_SNORM, octahedral
+    DirectX::PackedVector::XMSHORTN2  tangentU; // DXGI_FORMAT_R16G16_SNORM, octahedral
+    DirectX::PackedVector::XMHALF2    texC;     // DXGI_FORMAT_R16G16_FLOAT
+};
+
+// 16 bytes, with up to about one degree of normal and tangent error.
+struct PackedVertexCompact
+{
+    DirectX::PackedVector::XMUSHORTN4 position;       // DXGI_FORMAT_R16G16B16A16_UNORM, w unused
+    DirectX::PackedVector::XMBYTEN4   normalTangentU; // DXGI_FORMAT_R8G8B8A8_SNORM, octahedral normal in xy, tangent in zw
+    DirectX::PackedVector::XMHALF2    texC;           // DXGI_FORMAT_R16G16_FLOAT
+};
+
+// Largest difference between the source vertices and their decoded packed form.
+struct VertexCompressionError
+{
+    float maxPositionError = 0.0f; // Object space units
+    float maxNormalAngle   = 0.0f; // Degrees
+    float maxTangentAngle  = 0.0f; // Degrees
+    float maxTexCError     = 0.0f;
+};
+
+// ====================================================================================================================
+// Encodes vertices into the packed formats above and decodes them with the same math the shaders have to use.
+// Unit vectors use the octahedral mapping (Meyer et al. 2010); decoding is
+//     n = float3(e.xy, 1 - |e.x| - |e.y|); t = saturate(-n.z); n.xy += (n.xy >= 0) ? -t : t; n = normalize(n).
+// Encoding works on DirectXMath vectors and is split over threads for large meshes.
+class VertexCompression
+{
+public:
+    static VertexQuantization ComputeQuantization(const MeshData& meshData);
+    static VertexQuantization ComputeQuantization(const MeshDataSoA& meshData);
+
+    // Position in [0, 1] relative to the quantization bounds, ready for XMStoreUShortN4().
+    static DirectX::XMVECTOR XM_CALLCONV NormalizePosition(DirectX::FXMVECTOR position, const VertexQuantization& quantization);
+
+    // Unit vector -> octahedral coordinates in [-1, 1] (x and y) and back.
+    static DirectX::XMVECTOR XM_CALLCONV OctEncode(DirectX::FXMVECTOR n);
+    static DirectX::XMVECTOR XM_CALLCONV OctDecode(DirectX::FXMVECTOR e);
+
+    static void Encode(const MeshData& meshData, const VertexQuantization& quantization, std::vector<PackedVertex>& packed);
+    static void Encode(const MeshDataSoA& meshData, const VertexQuantization& quantization, std::vector<PackedVertex>& packed);
+    static void Encode(const MeshData& meshData, const VertexQuantization& quantization, std::vector<PackedVertexCompact>& packed);
+    static void Encode(const MeshDataSoA& meshData, const VertexQuantization& quantization, std::vector<PackedVertexCompact>& packed);
+
+    static Vertex Decode(const PackedVertex& packed, const VertexQuantization& quantization);
+    static Vertex Decode(const PackedVertexCompact& packed, const VertexQuantization& quantization);
+
+    static VertexCompressionError MeasureError(const MeshData&                  meshData,
+                                               const std::vector<PackedVertex>& packed,
+                                               const VertexQuantization&        quantization);
+
+    static VertexCompressionError MeasureError(const MeshData&                         meshData,
+                                               const std::vector<PackedVertexCompact>& packed,
+                                               const VertexQuantization&               quantization);
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <d3d12.h>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include "GeometryGenerator.h"
+#include "ParallelFor.h"
+#include "VertexCompression.h"
+
+// ====================================================================================================================
+// Where the value of a vertex element comes from.
+enum class VertexSource : uint32
+{
+    Position, // Vertex::m_position, stored relative to VertexConversion::quantization
+    Normal,
+    Tangent,
+    TexC,
+    Color,    // VertexConversion::color, the same for every vertex
+    Count
+};
+
+// ====================================================================================================================
+// Storage formats of vertex elements: the CPU type, its DXGI format and the DirectXMath store. Stores take the full
+// vector; formats with fewer components drop the rest, normalized formats saturate.
+struct VertexFormat
+{
+#define VERTEX_FORMAT(Name, CpuType, DxgiFormat, StoreFunc)                                     \
+    struct Name                                                                                 \
+    {                                                                                           \
+        using Type = CpuType;                                                                   \
+        static const DXGI_FORMAT Format = DxgiFormat;                                           \
+        static const uint32      Size   = sizeof(CpuType);                                      \
+        static void XM_CALLCONV Store(Type* pOut, DirectX::FXMVECTOR v) { StoreFunc(pOut, v); } \
+    };
+
+    VERTEX_FORMAT(Float2,   DirectX::XMFLOAT2,                 DXGI_FORMAT_R32G32_FLOAT,       DirectX::XMStoreFloat2)
+    VERTEX_FORMAT(Float3,   DirectX::XMFLOAT3,                 DXGI_FORMAT_R32G32B32_FLOAT,    DirectX::XMStoreFloat3)
+    VERTEX_FORMAT(Float4,   DirectX::XMFLOAT4,                 DXGI_FORMAT_R32G32B32A32_FLOAT, DirectX::XMStoreFloat4)
+    VERTEX_FORMAT(Half2,    DirectX::PackedVector::XMHALF2,    DXGI_FORMAT_R16G16_FLOAT,       DirectX::PackedVector::XMStoreHalf2)
+    VERTEX_FORMAT(Half4,    DirectX::PackedVector::XMHALF4,    DXGI_FORMAT_R16G16B16A16_FLOAT, DirectX::PackedVector::XMStoreHalf4)
+    VERTEX_FORMAT(ShortN2,  DirectX::PackedVector::XMSHORTN2,  DXGI_FORMAT_R16G16_SNORM,       DirectX::PackedVector::XMStoreShortN2)
+    VERTEX_FORMAT(ShortN4,  DirectX::PackedVector::XMSHORTN4,  DXGI_FORMAT_R16G16B16A16_SNORM, DirectX::PackedVector::XMStoreShortN4)
+    VERTEX_FORMAT(UShortN4, DirectX::PackedVector::XMUSHORTN4, DXGI_FORMAT_R16G16B16A16_UNORM, DirectX::PackedVector::XMStoreUShortN4)
+    VERTEX_FORMAT(ByteN4,   DirectX::PackedVector::XMBYTEN4,   DXGI_FORMAT_R8G8B8A8_SNORM,     DirectX::PackedVector::XMStoreByteN4)
+    VERTEX_FORMAT(UByteN4,  DirectX::PackedVector::XMUBYTEN4,  DXGI_FORMAT_R8G8B8A8_UNORM,     DirectX::PackedVector::XMStoreUByteN4)
+
+#undef VERTEX_FORMAT
+};
+
+// ====================================================================================================================
+// One element of a VertexLayout: its source, storage format and HLSL semantic index.
+template<VertexSource SourceT, typename FormatT, uint32 SemanticIndexT = 0>
+struct VertexElement
+{
+    using Format = FormatT;
+
+    static const VertexSource Source        = SourceT;
+    static const uint32       SemanticIndex = SemanticIndexT;
+
+    static const char* SemanticName()
+    {
+        switch (SourceT)
+        {
+        case VertexSource::Position: return "POSITION";
+        case VertexSource::Normal:   return "NORMAL";
+        case VertexSource::Tangent:  return "TANGENT";
+        case VertexSource::TexC:     return "TEXCOORD";
+        default:                     return "COLOR";
+        }
+    }
+};
+
+// ====================================================================================================================
+// Per call parameters of VertexLayout conversions.
+struct VertexConversion
+{
+    VertexQuantization quantization; // Positions are stored as (position - positionOffset) / positionScale
+    DirectX::XMFLOAT4  color = { 1.0f, 1.0f, 1.0f, 1.0f };
+};
+
+// Values of all sources for one vertex, in VertexSource order.
+struct VertexSourceValues
+{
+    DirectX::XMVECTOR values[static_cast<uint32>(VertexSource::Count)];
+};
+
+// ====================================================================================================================
+// Compile time recursion over the elements of a layout, Offset being the byte offset of the first one.
+template<uint32 Offset, typename... Elements>
+struct VertexElementList;
+
+template<uint32 Offset, typename First, typename... Rest>
+struct VertexElementList<Offset, First, Rest...>
+{
+    using Next = VertexElementList<Offset + First::Format::Size, Rest...>;
+
+    static const uint32 Stride = Next::Stride;
+
+    template<uint32 Index>
+    static constexpr uint32 OffsetOf() { return (Index == 0) ? Offset : Next::template OffsetOf<Index - 1>(); }
+
+    static constexpr bool UsesSource(VertexSource source) { return (First::Source == source) || Next::UsesSource(source); }
+
+    static void XM_CALLCONV Store(const VertexSourceValues& v, uint8_t* pOut)
+    {
+        First::Format::Store(reinterpret_cast<typename First::Format::Type*>(pOut + Offset),
+                             v.values[static_cast<uint32>(First::Source)]);
+        Next::Store(v, pOut);
+    }
+
+    template<size_t N>
+    static void Describe(std::array<D3D12_INPUT_ELEMENT_DESC, N>& elements, uint32 index, uint32 inputSlot)
+    {
+        elements[index] = { First::SemanticName(), First::SemanticIndex, First::Format::Format, inputSlot, Offset,
+                            D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 };
+        Next::Describe(elements, index + 1, inputSlot);
+    }
+};
+
+template<uint32 Offset>
+struct VertexElementList<Offset>
+{
+    static const uint32 Stride = Offset;
+
+    template<uint32 Index>
+    static constexpr uint32 OffsetOf() { return Offset; }
+
+    static constexpr bool UsesSource(VertexSource) { return false; }
+
+    static void XM_CALLCONV Store(const VertexSourceValues&, uint8_t*) {}
+
+    template<size_t N>
+    static void Describe(std::array<D3D12_INPUT_ELEMENT_DESC, N>&, uint32, uint32) {}
+};
+
+// ====================================================================================================================
+// A tightly packed interleaved vertex format described once at compile time, e.g.
+//     using ShaderLayout = VertexLayout<VertexElement<VertexSource::Position, VertexFormat::UShortN4>,
+//                                       VertexElement<VertexSource::Color,    VertexFormat::UByteN4>,
+//                                       VertexElement<VertexSource::TexC,     VertexFormat::Half2>>;
+// Stride, Offset<I>() and InputElements() all come from the same description, so the input layout can not drift from
+// the data; static_assert them against a hand written CPU struct if there is one. Convert() writes MeshData, MeshDataSoA
+// or plain vertices in the layout: the element loop is unrolled at compile time, sources the layout does not use are
+// never loaded, and each element is one DirectXMath store. The destination is only written, so mapped upload buffers
+// are fine.
+template<typename... Elements>
+class VertexLayout
+{
+    using List = VertexElementList<0, Elements...>;
+
+public:
+    static const uint32 ElementCount = sizeof...(Elements);
+    static const uint32 Stride       = List::Stride;
+
+    template<uint32 Index>
+    static constexpr uint32 Offset()
+    {
+        static_assert(Index < sizeof...(Elements), "Element index out of range");
+        return List::template OffsetOf<Index>();
+    }
+
+    // For D3D12_INPUT_LAYOUT_DESC; the semantic names are string literals, so the array can be copied freely.
+    static std::array<D3D12_INPUT_ELEMENT_DESC, sizeof...(Elements)> InputElements(uint32 inputSlot = 0)
+    {
+        std::array<D3D12_INPUT_ELEMENT_DESC, sizeof...(Elements)> elements = {};
+        List::Describe(elements, 0, inputSlot);
+        return elements;
+    }
+
+    static void Convert(const Vertex* pVertices, uint32 count, void* pOut, const VertexConversion& conversion = VertexConversion())
+    {
+        VertexSourceValues v;
+        const Constants    c(conversion);
+        uint8_t*           pDst = static_cast<uint8_t*>(pOut);
+
+        for (uint32 i = 0; i < count; ++i, pDst += Stride)
+        {
+            const Vertex& vertex = pVertices[i];
+            Load(v, c, &vertex.m_position, &vertex.m_normal, &vertex.m_tangentU, &vertex.m_texC);
+            List::Store(v, pDst);
+        }
+    }
+
+    static void Convert(const MeshData& meshData, void* pOut, const VertexConversion& conversion = VertexConversion(), uint32 maxThreads = 0)
+    {
+        ParallelFor(meshData.VertexCount(), MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+        {
+            Convert(meshData.m_vertices.data() + begin, end - begin, static_cast<uint8_t*>(pOut) + size_t(begin) * Stride, conversion);
+        });
+    }
+
+    static void Convert(const MeshDataSoA& meshData, void* pOut, const VertexConversion& conversion = VertexConversion(), uint32 maxThreads = 0)
+    {
+        ParallelFor(meshData.VertexCount(), MinVerticesPerThread, maxThreads, [&](uint32 begin, uint32 end)
+        {
+            VertexSourceValues v;
+            const Constants    c(conversion);
+            uint8_t*           pDst = static_cast<uint8_t*>(pOut) + size_t(begin) * Stride;
+
+            for (uint32 i = begin; i < end; ++i, pDst += Stride)
+            {
+                Load(v, c, &meshData.m_positions[i], &meshData.m_normals[i], &meshData.m_tangentUs[i], &meshData.m_texCs[i]);
+                List::Store(v, pDst);
+            }
+        });
+    }
+
+private:
+    static const uint32 MinVerticesPerThread = 16 * 1024;
+
+    struct Constants
+    {
+        explicit Constants(const VertexConversion& conversion)
+        {
+            const VertexQuantization& q = conversion.quantization;
+            positionOffset = DirectX::XMLoadFloat3(&q.positionOffset);
+            positionScale  = DirectX::XMVectorSet((q.positionScale.x != 0.0f) ? 1.0f / q.positionScale.x : 0.0f,
+                                                  (q.positionScale.y != 0.0f) ? 1.0f / q.positionScale.y : 0.0f,
+                                                  (q.positionScale.z != 0.0f) ? 1.0f / q.positionScale.z : 0.0f,
+                                                  1.0f);
+            color          = DirectX::XMLoadFloat4(&conversion.color);
+        }
+
+        DirectX::XMVECTOR positionOffset;
+        DirectX::XMVECTOR positionScale;
+        DirectX::XMVECTOR color;
+    };
+
+    // The conditions are constant for the layout, so the compiler drops the loads of unused sources.
+    static void Load(VertexSourceValues&      v,
+                     const Constants&         c,
+                     const DirectX::XMFLOAT3* pPosition,
+                     const DirectX::XMFLOAT3* pNormal,
+                     const DirectX::XMFLOAT3* pTangent,
+                     const DirectX::XMFLOAT2* pTexC)
+    {
+        using namespace DirectX;
+
+        if (List::UsesSource(VertexSource::Position))
+        {
+            v.values[uint32(VertexSource::Position)] = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(pPosition), c.positionOffset), c.positionScale);
+        }
+        if (List::UsesSource(VertexSource::Normal))
+        {
+            v.values[uint32(VertexSource::Normal)] = XMLoadFloat3(pNormal);
+        }
+        if (List::UsesSource(VertexSource::Tangent))
+        {
+            v.values[uint32(VertexSource::Tangent)] = XMLoadFloat3(pTangent);
+        }
+        if (List::UsesSource(VertexSource::TexC))
+        {
+            v.values[uint32(VertexSource::TexC)] = XMLoadFloat2(pTexC);
+        }
+        v.values[uint32(VertexSource::Color)] = c.color;
+    }
+};
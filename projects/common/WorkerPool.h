@@ -0,0 +1,126 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ParallelFor.h"
+
+// ====================================================================================================================
+// Worker threads that stay alive between calls, for per frame work where ParallelFor() would spend a good part of the
+// frame's budget starting and joining threads. Run(n, func) calls func(thread) once on each of n threads, the calling
+// thread being the last one, and returns when all calls have returned; the threads split the work between them
+// themselves, e.g. by claiming items from an atomic counter. Run() must not be called from two threads at once or
+// from inside func.
+class WorkerPool
+{
+public:
+    // threadCount includes the calling thread; 0 = all hardware threads.
+    explicit WorkerPool(uint32_t threadCount = 0)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = DefaultThreadCount();
+        }
+
+        m_workers.reserve(threadCount - 1);
+        for (uint32_t i = 0; i + 1 < threadCount; ++i)
+        {
+            m_workers.emplace_back([this, i]() { WorkerLoop(i); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_exit = true;
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            worker.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool&)            = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t ThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    // threadCount 0 or above ThreadCount() uses all threads of the pool.
+    void Run(
+        uint32_t                              threadCount,
+        const std::function<void(uint32_t)>& func)
+    {
+        threadCount = ((threadCount == 0) || (threadCount > ThreadCount())) ? ThreadCount() : threadCount;
+        if (threadCount == 1)
+        {
+            func(0);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pJob          = &func;
+            m_activeWorkers = threadCount - 1;
+            m_pending       = threadCount - 1;
+            ++m_generation;
+        }
+        m_wake.notify_all();
+
+        func(threadCount - 1);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+        m_pJob = nullptr;
+    }
+
+private:
+    void WorkerLoop(
+        uint32_t index)
+    {
+        uint64_t generation = 0;
+        for (;;)
+        {
+            const std::function<void(uint32_t)>* pJob = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_generation != generation; });
+                generation = m_generation;
+                if (m_exit)
+                {
+                    return;
+                }
+                if (index >= m_activeWorkers)
+                {
+                    continue;
+                }
+                pJob = m_pJob;
+            }
+
+            (*pJob)(index);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_pending == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread>             m_workers;
+    std::mutex                           m_mutex;
+    std::condition_variable              m_wake;
+    std::condition_variable              m_done;
+    const std::function<void(uint32_t)>* m_pJob          = nullptr;
+    uint64_t                             m_generation    = 0;
+    uint32_t                             m_activeWorkers = 0;
+    uint32_t                             m_pending       = 0;
+    bool                                 m_exit          = false;
+};
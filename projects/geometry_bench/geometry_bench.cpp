@@ -0,0 +1,3153 @@
+/*
+Console benchmarks for the CPU side geometry code in projects/common.
+- Runs without a D3D12 device, timings are printed to stdout.
+*/
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <map>
+
+#include "../common/BoundingVolumes.h"
+#include "../common/CdlodTerrain.h"
+#include "../common/CoherentCulling.h"
+#include "../common/FrustumCulling.h"
+#include "../common/GeometryGenerator.h"
+#include "../common/Heightfield.h"
+#include "../common/HeightmapStreamer.h"
+#include "../common/IndexCodec.h"
+#include "../common/InstanceBvh.h"
+#include "../common/MathHelper.h"
+#include "../common/MeshBatcher.h"
+#include "../common/MeshFile.h"
+#include "../common/MeshOptimizer.h"
+#include "../common/MeshPartitioner.h"
+#include "../common/MeshletBuilder.h"
+#include "../common/MeshSimplifier.h"
+#include "../common/MeshWelder.h"
+#include "../common/OcclusionCulling.h"
+#include "../common/ParallelFor.h"
+#include "../common/RingAllocator.h"
+#include "../common/ShadowVolume.h"
+#include "../common/TangentGenerator.h"
+#include "../common/VertexCompression.h"
+#include "../common/VertexLayout.h"
+#include "../common/WorkerPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+// ====================================================================================================================
+// Runs func numRuns times and returns the fastest run in milliseconds.
+static double TimeMs(
+    uint32                 numRuns,
+    const function<void()>& func)
+{
+    double best = 1e30;
+    for (uint32 i = 0; i < numRuns; ++i)
+    {
+        const auto start = chrono::high_resolution_clock::now();
+        func();
+        const auto end   = chrono::high_resolution_clock::now();
+        best = min(best, chrono::duration<double, milli>(end - start).count());
+    }
+    return best;
+}
+
+// ====================================================================================================================
+// Compares generation on one thread against all hardware threads, and reports the vertex savings of sharing edge
+// midpoints in the geosphere subdivision.
+static void BenchGeometryGenerator()
+{
+    printf("== GeometryGenerator (%u hardware threads)\n", DefaultThreadCount());
+
+    GeometryGenerator serialGen(1);
+    GeometryGenerator parallelGen;
+
+    for (uint32 level = 4; level <= 8; ++level)
+    {
+        MeshData mesh;
+        const double serialMs   = TimeMs(3, [&]() { mesh = serialGen.CreateGeoSphere(1.0f, level); });
+        const double parallelMs = TimeMs(3, [&]() { mesh = parallelGen.CreateGeoSphere(1.0f, level); });
+
+        // Without shared midpoints every triangle of the previous level emitted six vertices of its own.
+        const uint64_t prevTris          = 20ull << (2 * (level - 1));
+        const uint64_t duplicateVertices = 6 * prevTris;
+
+        printf("GeoSphere  level %u: %8u verts (was %8llu, %5.1f%% of memory) serial %8.2f ms  parallel %8.2f ms  x%.2f\n",
+               level,
+               mesh.VertexCount(),
+               static_cast<unsigned long long>(duplicateVertices),
+               100.0 * mesh.VertexCount() / duplicateVertices,
+               serialMs,
+               parallelMs,
+               serialMs / parallelMs);
+    }
+
+    const uint32 sizes[] = { 256, 1024, 2048 };
+    for (uint32 size : sizes)
+    {
+        MeshData mesh;
+        const double serialMs   = TimeMs(3, [&]() { mesh = serialGen.CreateGrid(100.0f, 100.0f, size, size); });
+        const double parallelMs = TimeMs(3, [&]() { mesh = parallelGen.CreateGrid(100.0f, 100.0f, size, size); });
+        printf("Grid     %4ux%-4u: %8u verts serial %8.2f ms  parallel %8.2f ms  x%.2f\n",
+               size, size, mesh.VertexCount(), serialMs, parallelMs, serialMs / parallelMs);
+    }
+
+    for (uint32 size : sizes)
+    {
+        MeshData mesh;
+        const double serialMs   = TimeMs(3, [&]() { mesh = serialGen.CreateSphere(1.0f, size, size); });
+        const double parallelMs = TimeMs(3, [&]() { mesh = parallelGen.CreateSphere(1.0f, size, size); });
+        printf("Sphere   %4ux%-4u: %8u verts serial %8.2f ms  parallel %8.2f ms  x%.2f\n",
+               size, size, mesh.VertexCount(), serialMs, parallelMs, serialMs / parallelMs);
+    }
+
+    for (uint32 size : sizes)
+    {
+        MeshData mesh;
+        const double serialMs   = TimeMs(3, [&]() { mesh = serialGen.CreateCylinder(1.0f, 0.5f, 2.0f, size, size); });
+        const double parallelMs = TimeMs(3, [&]() { mesh = parallelGen.CreateCylinder(1.0f, 0.5f, 2.0f, size, size); });
+        printf("Cylinder %4ux%-4u: %8u verts serial %8.2f ms  parallel %8.2f ms  x%.2f\n",
+               size, size, mesh.VertexCount(), serialMs, parallelMs, serialMs / parallelMs);
+    }
+}
+
+// ====================================================================================================================
+// Appends mesh to scene with its positions transformed by world.
+static void AppendTransformed(
+    MeshData&       scene,
+    const MeshData& mesh,
+    FXMMATRIX       world)
+{
+    const uint32 baseVertex = scene.VertexCount();
+
+    for (const Vertex& v : mesh.m_vertices)
+    {
+        Vertex worldVertex = v;
+        XMStoreFloat3(&worldVertex.m_position, XMVector3TransformCoord(XMLoadFloat3(&v.m_position), world));
+        scene.PushVertex(worldVertex);
+    }
+
+    for (uint32 index : mesh.m_indices32)
+    {
+        scene.m_indices32.push_back(baseVertex + index);
+    }
+}
+
+// ====================================================================================================================
+// The shapes scene packed into one mesh: a ground grid, a box and two rows of columns with spheres on top. The
+// individual shapes are convex, so this is where overdraw actually comes from.
+static MeshData BuildShapesScene()
+{
+    GeometryGenerator geoGen;
+    MeshData box    = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 3);
+    MeshData grid   = geoGen.CreateGrid(20.0f, 30.0f, 60, 40);
+    MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
+    MeshData cyl    = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
+
+    MeshData scene;
+    AppendTransformed(scene, grid, XMMatrixIdentity());
+    AppendTransformed(scene, box, XMMatrixScaling(2.0f, 2.0f, 2.0f) * XMMatrixTranslation(0.0f, 0.5f, 0.0f));
+
+    for (int i = 0; i < 5; ++i)
+    {
+        AppendTransformed(scene, cyl, XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i * 5.0f));
+        AppendTransformed(scene, cyl, XMMatrixTranslation(+5.0f, 1.5f, -10.0f + i * 5.0f));
+        AppendTransformed(scene, sphere, XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i * 5.0f));
+        AppendTransformed(scene, sphere, XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i * 5.0f));
+    }
+
+    return scene;
+}
+
+// ====================================================================================================================
+// Reports post-transform cache efficiency and overdraw of the generated meshes before and after MeshOptimizer.
+static void BenchMeshOptimizer()
+{
+    printf("== MeshOptimizer (FIFO cache of %u entries, overdraw over 16 views)\n", MeshOptimizer::DefaultCacheSize);
+
+    GeometryGenerator geoGen;
+
+    struct NamedMesh
+    {
+        const char* pName;
+        MeshData    mesh;
+    };
+
+    NamedMesh meshes[] =
+    {
+        { "Box (5 subdivisions)",  geoGen.CreateBox(1.5f, 0.5f, 1.5f, 5) },
+        { "Grid 256x256",          geoGen.CreateGrid(100.0f, 100.0f, 256, 256) },
+        { "Grid 1024x1024",        geoGen.CreateGrid(100.0f, 100.0f, 1024, 1024) },
+        { "Sphere 256x256",        geoGen.CreateSphere(1.0f, 256, 256) },
+        { "GeoSphere level 6",     geoGen.CreateGeoSphere(1.0f, 6) },
+        { "Cylinder 256x256",      geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, 256, 256) },
+        { "Shapes scene",          BuildShapesScene() },
+    };
+
+    for (auto& entry : meshes)
+    {
+        const OverdrawStats overdrawBefore = MeshOptimizer::AnalyzeOverdraw(entry.mesh);
+
+        VertexCacheStats before;
+        VertexCacheStats after;
+        const double ms = TimeMs(1, [&]() { MeshOptimizer::Optimize(entry.mesh, &before, &after); });
+
+        const OverdrawStats overdrawAfter = MeshOptimizer::AnalyzeOverdraw(entry.mesh);
+
+        printf("%-22s %8u tris  ACMR %.3f -> %.3f  ATVR %.3f -> %.3f  overdraw %.3f -> %.3f  (%.2f ms)\n",
+               entry.pName,
+               static_cast<uint32>(entry.mesh.m_indices32.size() / 3),
+               before.acmr,
+               after.acmr,
+               before.atvr,
+               after.atvr,
+               overdrawBefore.overdraw,
+               overdrawAfter.overdraw,
+               ms);
+    }
+}
+
+// ====================================================================================================================
+// Splits cache optimized meshes into meshlets and culls them with the packed sphere and normal cone bounds from a few
+// cameras. The rejection rates are what a mesh shader or a CPU cluster culling pass would save.
+static void BenchMeshlets()
+{
+    printf("== MeshletBuilder (%u verts / %u tris per meshlet)\n", MeshletBuilder::DefaultMaxVertices, MeshletBuilder::DefaultMaxTriangles);
+
+    GeometryGenerator geoGen;
+
+    struct NamedMesh
+    {
+        const char* pName;
+        MeshData    mesh;
+        float       viewDistance;
+    };
+
+    NamedMesh meshes[] =
+    {
+        { "Grid 1024x1024",    geoGen.CreateGrid(100.0f, 100.0f, 1024, 1024), 20.0f },
+        { "Sphere 256x256",    geoGen.CreateSphere(1.0f, 256, 256),           3.0f },
+        { "GeoSphere level 7", geoGen.CreateGeoSphere(1.0f, 7),               3.0f },
+        { "Shapes scene",      BuildShapesScene(),                            15.0f },
+    };
+
+    for (auto& entry : meshes)
+    {
+        MeshOptimizer::OptimizeVertexCache(entry.mesh.m_indices32.data(), entry.mesh.m_indices32.size(), entry.mesh.VertexCount());
+
+        MeshletData meshlets;
+        const double buildMs = TimeMs(1, [&]() { meshlets = MeshletBuilder::Build(entry.mesh); });
+
+        const uint32 triangleCount = static_cast<uint32>(entry.mesh.m_indices32.size() / 3);
+        printf("%-18s %8u tris -> %6u meshlets (%.1f tris, %.1f verts avg)  build %.2f ms\n",
+               entry.pName,
+               triangleCount,
+               static_cast<uint32>(meshlets.m_meshlets.size()),
+               static_cast<float>(triangleCount) / meshlets.m_meshlets.size(),
+               static_cast<float>(meshlets.m_vertexIndices.size()) / meshlets.m_meshlets.size(),
+               buildMs);
+
+        // Cameras circle the mesh, looking at it from above.
+        const uint32 numViews = 4;
+        for (uint32 view = 0; view < numViews; ++view)
+        {
+            const float angle = XM_2PI * view / numViews;
+            const float dist  = entry.viewDistance;
+
+            const XMFLOAT3 eye(dist * cosf(angle), 0.5f * dist, dist * sinf(angle));
+            const XMMATRIX viewMatrix = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            const XMMATRIX projMatrix = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+            XMFLOAT4 planes[6];
+            MathHelper::ExtractFrustumPlanes(viewMatrix * projMatrix, planes);
+
+            MeshletCullStats    stats;
+            std::vector<uint32> visible;
+            visible.reserve(meshlets.m_meshlets.size());
+            const double cullMs = TimeMs(5, [&]() { stats = MeshletBuilder::Cull(meshlets, planes, eye, &visible); });
+
+            printf("    view %u: frustum rejected %5.1f%%  backface rejected %5.1f%%  triangles kept %5.1f%%  cull %.3f ms\n",
+                   view,
+                   100.0f * stats.frustumRejected / stats.meshletCount,
+                   100.0f * stats.backfaceRejected / stats.meshletCount,
+                   100.0f * stats.visibleTriangles / triangleCount,
+                   cullMs);
+        }
+    }
+}
+
+// ====================================================================================================================
+// Builds LOD chains for the meshes the samples draw and for a ~1.3M triangle geosphere, on one thread and on all
+// hardware threads, and prints the triangle count and error of every level.
+static void BenchMeshSimplifier()
+{
+    printf("== MeshSimplifier (LOD chain, 0.5 reduction per level)\n");
+
+    GeometryGenerator geoGen;
+
+    struct NamedMesh
+    {
+        const char* pName;
+        MeshData    mesh;
+    };
+
+    NamedMesh meshes[] =
+    {
+        { "Sphere 20x20",      geoGen.CreateSphere(0.5f, 20, 20) },
+        { "Grid 50x50",        geoGen.CreateGrid(20.0f, 30.0f, 50, 50) },
+        { "Shapes scene",      BuildShapesScene() },
+        { "GeoSphere level 8", geoGen.CreateGeoSphere(1.0f, 8) },
+    };
+
+    for (auto& entry : meshes)
+    {
+        std::vector<MeshLod> lods;
+        const double serialMs   = TimeMs(1, [&]() { lods = MeshSimplifier::GenerateLodChain(entry.mesh, 8, 0.5f, MeshSimplifier::DefaultAttributeWeight, 1); });
+        const double parallelMs = TimeMs(1, [&]() { lods = MeshSimplifier::GenerateLodChain(entry.mesh, 8); });
+
+        printf("%-18s serial %8.2f ms  parallel %8.2f ms\n", entry.pName, serialMs, parallelMs);
+
+        for (uint32 i = 0; i < lods.size(); ++i)
+        {
+            printf("    LOD %u: %8u tris  error %.5f\n", i, static_cast<uint32>(lods[i].m_indices32.size() / 3), lods[i].error);
+        }
+    }
+}
+
+// ====================================================================================================================
+// Vertex buffer size, encode time and decode error of the packed vertex formats.
+static void BenchVertexCompression()
+{
+    printf("== VertexCompression (%u bytes per Vertex, %u PackedVertex, %u PackedVertexCompact)\n",
+           static_cast<uint32>(sizeof(Vertex)),
+           static_cast<uint32>(sizeof(PackedVertex)),
+           static_cast<uint32>(sizeof(PackedVertexCompact)));
+
+    GeometryGenerator geoGen;
+
+    struct NamedMesh
+    {
+        const char* pName;
+        MeshData    mesh;
+    };
+
+    NamedMesh meshes[] =
+    {
+        { "Grid 1024x1024",    geoGen.CreateGrid(160.0f, 160.0f, 1024, 1024) },
+        { "GeoSphere level 7", geoGen.CreateGeoSphere(1.0f, 7) },
+        { "Shapes scene",      BuildShapesScene() },
+    };
+
+    for (auto& entry : meshes)
+    {
+        const VertexQuantization quantization = VertexCompression::ComputeQuantization(entry.mesh);
+
+        std::vector<PackedVertex>        packed;
+        std::vector<PackedVertexCompact> compact;
+        const double packedMs  = TimeMs(3, [&]() { VertexCompression::Encode(entry.mesh, quantization, packed); });
+        const double compactMs = TimeMs(3, [&]() { VertexCompression::Encode(entry.mesh, quantization, compact); });
+
+        const VertexCompressionError packedError  = VertexCompression::MeasureError(entry.mesh, packed, quantization);
+        const VertexCompressionError compactError = VertexCompression::MeasureError(entry.mesh, compact, quantization);
+
+        const double sourceMB = entry.mesh.VertexCount() * sizeof(Vertex) / (1024.0 * 1024.0);
+        printf("%-18s %8u verts %7.2f MB\n", entry.pName, entry.mesh.VertexCount(), sourceMB);
+        printf("    PackedVertex        %7.2f MB  encode %7.2f ms  pos %.5f  normal %.3f deg  tangent %.3f deg  uv %.5f\n",
+               packed.size() * sizeof(PackedVertex) / (1024.0 * 1024.0),
+               packedMs,
+               packedError.maxPositionError,
+               packedError.maxNormalAngle,
+               packedError.maxTangentAngle,
+               packedError.maxTexCError);
+        printf("    PackedVertexCompact %7.2f MB  encode %7.2f ms  pos %.5f  normal %.3f deg  tangent %.3f deg  uv %.5f\n",
+               compact.size() * sizeof(PackedVertexCompact) / (1024.0 * 1024.0),
+               compactMs,
+               compactError.maxPositionError,
+               compactError.maxNormalAngle,
+               compactError.maxTangentAngle,
+               compactError.maxTexCError);
+    }
+}
+
+// ====================================================================================================================
+// True if decoded holds the triangles of source in the same order, allowing each triangle to be rotated.
+static bool SameTriangles(
+    const std::vector<uint32>& source,
+    const std::vector<uint32>& decoded)
+{
+    if (source.size() != decoded.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < source.size(); i += 3)
+    {
+        bool match = false;
+        for (uint32 r = 0; (r < 3) && (match == false); ++r)
+        {
+            match = (decoded[i + 0] == source[i + r]) &&
+                    (decoded[i + 1] == source[i + (r + 1) % 3]) &&
+                    (decoded[i + 2] == source[i + (r + 2) % 3]);
+        }
+
+        if (match == false)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// ====================================================================================================================
+// Compression ratio, round trip check and decode throughput of the index codec, before and after MeshOptimizer.
+static void BenchIndexCodec()
+{
+    printf("== IndexCodec\n");
+
+    GeometryGenerator geoGen;
+
+    struct NamedMesh
+    {
+        const char* pName;
+        MeshData    mesh;
+    };
+
+    NamedMesh meshes[] =
+    {
+        { "Grid 1024x1024",    geoGen.CreateGrid(100.0f, 100.0f, 1024, 1024) },
+        { "Sphere 256x256",    geoGen.CreateSphere(1.0f, 256, 256) },
+        { "GeoSphere level 7", geoGen.CreateGeoSphere(1.0f, 7) },
+        { "Shapes scene",      BuildShapesScene() },
+    };
+
+    bool allPassed = true;
+
+    for (auto& entry : meshes)
+    {
+        for (uint32 optimized = 0; optimized < 2; ++optimized)
+        {
+            if (optimized != 0)
+            {
+                MeshOptimizer::Optimize(entry.mesh);
+            }
+
+            const std::vector<uint32>& indices = entry.mesh.m_indices32;
+
+            std::vector<uint8_t> encoded;
+            const double encodeMs = TimeMs(1, [&]() { encoded = IndexCodec::Encode(entry.mesh); });
+
+            // Stands in for a mapped upload buffer.
+            std::vector<uint32> decoded(indices.size());
+            bool                ok       = true;
+            const double        decodeMs = TimeMs(5, [&]()
+            {
+                ok = IndexCodec::Decode(decoded.data(), decoded.size(), encoded.data(), encoded.size());
+            });
+
+            ok        = ok && SameTriangles(indices, decoded);
+            allPassed = allPassed && ok;
+
+            const double rawBytes = static_cast<double>(indices.size() * sizeof(uint32));
+            printf("%-18s %-9s %8u tris  %5.2f bytes/tri  x%5.2f  encode %7.2f ms  decode %6.2f ms (%5.2f GB/s)  round trip %s\n",
+                   entry.pName,
+                   (optimized != 0) ? "optimized" : "generated",
+                   static_cast<uint32>(indices.size() / 3),
+                   3.0 * encoded.size() / indices.size(),
+                   rawBytes / encoded.size(),
+                   encodeMs,
+                   decodeMs,
+                   rawBytes / (decodeMs * 1e6),
+                   ok ? "ok" : "FAILED");
+        }
+    }
+
+    // 16 bit destination and rejection of damaged input.
+    MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
+    MeshOptimizer::Optimize(sphere);
+
+    const std::vector<uint8_t> encoded = IndexCodec::Encode(sphere);
+    std::vector<uint16>        decoded16(sphere.m_indices32.size());
+    std::vector<uint32>        widened(decoded16.size());
+
+    const bool decoded16Ok = IndexCodec::Decode(decoded16.data(), decoded16.size(), encoded.data(), encoded.size());
+    widened.assign(decoded16.begin(), decoded16.end());
+
+    const bool truncatedRejected = IndexCodec::Decode(widened.data(), widened.size(), encoded.data(), encoded.size() - 1) == false;
+
+    // Indices above 0xFFFF do not fit a 16 bit destination.
+    const uint32               wideIndices[] = { 0, 1, 0x10000 };
+    const std::vector<uint8_t> wideEncoded   = IndexCodec::Encode(wideIndices, 3);
+    uint16                     wideDecoded[3];
+    const bool                 wideRejected  = IndexCodec::Decode(wideDecoded, 3, wideEncoded.data(), wideEncoded.size()) == false;
+
+    const bool ok = decoded16Ok && SameTriangles(sphere.m_indices32, std::vector<uint32>(decoded16.begin(), decoded16.end())) &&
+                    truncatedRejected && wideRejected;
+    allPassed     = allPassed && ok;
+
+    printf("16 bit decode, wide index and truncated input check: %s\n", ok ? "ok" : "FAILED");
+    printf("IndexCodec round trip: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Writes every shape into caller memory with the full Vertex layout and checks it matches Create*() byte for byte,
+// then compares the usual create, copy to vector, copy to upload buffer path against writing straight into the
+// upload buffer, and streams a large grid in chunks.
+static void BenchWriteInPlace()
+{
+    printf("== Write-in-place generation\n");
+
+    GeometryGenerator geoGen;
+
+    InterleavedLayout fullLayout;
+    fullLayout.stride         = sizeof(Vertex);
+    fullLayout.positionOffset = offsetof(Vertex, m_position);
+    fullLayout.normalOffset   = offsetof(Vertex, m_normal);
+    fullLayout.tangentOffset  = offsetof(Vertex, m_tangentU);
+    fullLayout.texCOffset     = offsetof(Vertex, m_texC);
+
+    struct Shape
+    {
+        const char*                                          name;
+        MeshSize                                             size;
+        function<MeshData()>                                 create;
+        function<MeshSize(const MeshWriteTarget& target)>    write;
+    };
+
+    const Shape shapes[] =
+    {
+        { "Box (4 subdivisions)", GeometryGenerator::BoxSize(4),
+          [&]() { return geoGen.CreateBox(1.5f, 0.5f, 1.5f, 4); },
+          [&](const MeshWriteTarget& t) { return geoGen.CreateBox(1.5f, 0.5f, 1.5f, 4, t); } },
+        { "Sphere 40x30", GeometryGenerator::SphereSize(40, 30),
+          [&]() { return geoGen.CreateSphere(0.5f, 40, 30); },
+          [&](const MeshWriteTarget& t) { return geoGen.CreateSphere(0.5f, 40, 30, t); } },
+        { "GeoSphere level 5", GeometryGenerator::GeoSphereSize(5),
+          [&]() { return geoGen.CreateGeoSphere(1.0f, 5); },
+          [&](const MeshWriteTarget& t) { return geoGen.CreateGeoSphere(1.0f, 5, t); } },
+        { "Cylinder 30x20", GeometryGenerator::CylinderSize(30, 20),
+          [&]() { return geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 30, 20); },
+          [&](const MeshWriteTarget& t) { return geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 30, 20, t); } },
+        { "Grid 60x40", GeometryGenerator::GridSize(60, 40),
+          [&]() { return geoGen.CreateGrid(20.0f, 30.0f, 60, 40); },
+          [&](const MeshWriteTarget& t) { return geoGen.CreateGrid(20.0f, 30.0f, 60, 40, t); } },
+        { "Quad", GeometryGenerator::QuadSize(),
+          [&]() { return geoGen.CreateQuad(-1.0f, 1.0f, 2.0f, 2.0f, 0.0f); },
+          [&](const MeshWriteTarget& t) { return geoGen.CreateQuad(-1.0f, 1.0f, 2.0f, 2.0f, 0.0f, t); } },
+    };
+
+    bool allPassed = true;
+    for (const Shape& shape : shapes)
+    {
+        const MeshData mesh = shape.create();
+
+        std::vector<Vertex> vertices(shape.size.vertexCount);
+        std::vector<uint32> indices32(shape.size.indexCount);
+        std::vector<uint16> indices16(shape.size.indexCount);
+
+        MeshWriteTarget target;
+        target.pVertices      = vertices.data();
+        target.layout         = fullLayout;
+        target.vertexCapacity = shape.size.vertexCount;
+        target.pIndices       = indices32.data();
+        target.indexCapacity  = shape.size.indexCount;
+
+        const MeshSize written32 = shape.write(target);
+
+        target.pIndices  = indices16.data();
+        target.indexSize = 2;
+        const MeshSize written16 = shape.write(target);
+
+        target.indexCapacity--;
+        const MeshSize tooSmall = shape.write(target);
+
+        const bool ok = (written32.vertexCount == mesh.VertexCount()) &&
+                        (written32.indexCount == mesh.IndexCount()) &&
+                        (written16.indexCount == mesh.IndexCount()) &&
+                        (tooSmall.vertexCount == 0) &&
+                        (memcmp(vertices.data(), mesh.m_vertices.data(), vertices.size() * sizeof(Vertex)) == 0) &&
+                        (indices32 == mesh.m_indices32) &&
+                        equal(indices16.begin(), indices16.end(), mesh.m_indices32.begin());
+        allPassed = allPassed && ok;
+
+        printf("%-22s %7u vertices %8u indices: %s\n", shape.name, mesh.VertexCount(), mesh.IndexCount(), ok ? "ok" : "FAILED");
+    }
+
+    // Chunks put back together with their vertex offsets (dropping the shared boundary rows) give the whole grid.
+    {
+        const uint32 m = 301;
+        const uint32 n = 200;
+        const uint32 chunkRows = 64;
+
+        const MeshData        grid      = geoGen.CreateGrid(50.0f, 70.0f, m, n);
+        const MeshSize        chunkSize = GeometryGenerator::GridChunkSize(n, chunkRows);
+        std::vector<Vertex>   chunkVertices(chunkSize.vertexCount);
+        std::vector<uint32>   chunkIndices(chunkSize.indexCount);
+        std::vector<Vertex>   vertices;
+        std::vector<uint32>   indices;
+
+        MeshWriteTarget target;
+        target.pVertices      = chunkVertices.data();
+        target.layout         = fullLayout;
+        target.vertexCapacity = chunkSize.vertexCount;
+        target.pIndices       = chunkIndices.data();
+        target.indexCapacity  = chunkSize.indexCount;
+
+        for (uint32 firstRow = 0; firstRow < m - 1; firstRow += chunkRows)
+        {
+            const uint32   rowCount = min(chunkRows, m - 1 - firstRow);
+            const MeshSize written  = geoGen.CreateGridChunk(50.0f, 70.0f, m, n, firstRow, rowCount, target);
+
+            const uint32 skip = (firstRow == 0) ? 0 : n;
+            vertices.insert(vertices.end(), chunkVertices.begin() + skip, chunkVertices.begin() + written.vertexCount);
+            for (uint32 i = 0; i < written.indexCount; ++i)
+            {
+                indices.push_back(chunkIndices[i] + firstRow * n);
+            }
+        }
+
+        const bool ok = (vertices.size() == grid.m_vertices.size()) &&
+                        (memcmp(vertices.data(), grid.m_vertices.data(), vertices.size() * sizeof(Vertex)) == 0) &&
+                        (indices == grid.m_indices32);
+        allPassed = allPassed && ok;
+
+        printf("Grid %ux%u in %u row chunks: %s\n", m, n, chunkRows, ok ? "ok" : "FAILED");
+    }
+
+    printf("Write-in-place matches Create*: %s\n", allPassed ? "all passed" : "FAILED");
+
+    // Position + normal, as in shapes_shaded. The "upload buffer" is plain memory here.
+    struct ShaderVertex
+    {
+        XMFLOAT3 pos;
+        XMFLOAT3 normal;
+    };
+
+    InterleavedLayout shaderLayout;
+    shaderLayout.stride         = sizeof(ShaderVertex);
+    shaderLayout.positionOffset = offsetof(ShaderVertex, pos);
+    shaderLayout.normalOffset   = offsetof(ShaderVertex, normal);
+
+    for (uint32 size : { 256u, 1024u, 2048u })
+    {
+        const MeshSize     gridSize = GeometryGenerator::GridSize(size, size);
+        std::vector<uint8_t> upload(size_t(gridSize.vertexCount) * sizeof(ShaderVertex) + size_t(gridSize.indexCount) * sizeof(uint32));
+
+        const double copyMs = TimeMs(3, [&]()
+        {
+            MeshData                  grid = geoGen.CreateGrid(100.0f, 100.0f, size, size);
+            std::vector<ShaderVertex> vertices(grid.VertexCount());
+            for (uint32 i = 0; i < grid.VertexCount(); ++i)
+            {
+                vertices[i].pos    = grid.m_vertices[i].m_position;
+                vertices[i].normal = grid.m_vertices[i].m_normal;
+            }
+            memcpy(upload.data(), vertices.data(), vertices.size() * sizeof(ShaderVertex));
+            memcpy(upload.data() + vertices.size() * sizeof(ShaderVertex), grid.m_indices32.data(), grid.m_indices32.size() * sizeof(uint32));
+        });
+
+        const double inPlaceMs = TimeMs(3, [&]()
+        {
+            MeshWriteTarget target;
+            target.pVertices      = upload.data();
+            target.layout         = shaderLayout;
+            target.vertexCapacity = gridSize.vertexCount;
+            target.pIndices       = upload.data() + size_t(gridSize.vertexCount) * sizeof(ShaderVertex);
+            target.indexCapacity  = gridSize.indexCount;
+            geoGen.CreateGrid(100.0f, 100.0f, size, size, target);
+        });
+
+        // The copy path holds the MeshData and the vertex vector at the same time on top of the upload buffer.
+        const double tempMb = (double(gridSize.vertexCount) * (sizeof(Vertex) + sizeof(ShaderVertex)) +
+                               double(gridSize.indexCount) * sizeof(uint32)) / (1024.0 * 1024.0);
+
+        printf("Grid %4ux%-4u create + copies %8.2f ms, in place %8.2f ms (%.2fx), %7.1f MB temporary memory avoided\n",
+               size, size, copyMs, inPlaceMs, copyMs / inPlaceMs, tempMb);
+    }
+}
+
+// ====================================================================================================================
+// Hills terrain of the blending and compute shader demos: the scalar per vertex functions against the batch paths,
+// on one thread and on all of them.
+static void BenchHeightfield()
+{
+    printf("== Heightfield (%s, %u hardware threads)\n", Heightfield::UsesAvx2() ? "AVX2" : "SSE2", DefaultThreadCount());
+
+    struct TerrainVertex
+    {
+        XMFLOAT3 pos;
+        XMFLOAT3 normal;
+        XMFLOAT2 texC;
+    };
+
+    GeometryGenerator geoGen;
+
+    for (uint32 size : { 256u, 1024u, 2048u })
+    {
+        const MeshData grid = geoGen.CreateGrid(2000.0f, 2000.0f, size, size);
+
+        std::vector<TerrainVertex> reference(grid.VertexCount());
+        std::vector<TerrainVertex> vertices(grid.VertexCount());
+        for (uint32 i = 0; i < grid.VertexCount(); ++i)
+        {
+            reference[i].pos  = grid.m_vertices[i].m_position;
+            reference[i].texC = grid.m_vertices[i].m_texC;
+        }
+        vertices = reference;
+
+        const double scalarMs = TimeMs(3, [&]()
+        {
+            for (TerrainVertex& v : reference)
+            {
+                v.pos.y  = Heightfield::HillsHeight(v.pos.x, v.pos.z);
+                v.normal = Heightfield::HillsNormal(v.pos.x, v.pos.z);
+            }
+        });
+
+        HeightfieldStreams streams;
+        streams.pX           = &vertices[0].pos.x;
+        streams.pZ           = &vertices[0].pos.z;
+        streams.inputStride  = sizeof(TerrainVertex);
+        streams.pHeights     = &vertices[0].pos.y;
+        streams.heightStride = sizeof(TerrainVertex);
+        streams.pNormals     = &vertices[0].normal;
+        streams.normalStride = sizeof(TerrainVertex);
+
+        const uint32 count    = grid.VertexCount();
+        const double sseMs    = TimeMs(3, [&]() { Heightfield::EvaluateHills(streams, count, 1, false); });
+        const double avx2Ms   = TimeMs(3, [&]() { Heightfield::EvaluateHills(streams, count, 1, true); });
+        const double threadMs = TimeMs(3, [&]() { Heightfield::EvaluateHills(streams, count, 0); });
+
+        // Heights are compared relative to the size of the terms (|x| + |z|), normals by their difference.
+        float maxHeightError = 0.0f;
+        float maxNormalError = 0.0f;
+        for (uint32 i = 0; i < count; ++i)
+        {
+            const TerrainVertex& r = reference[i];
+            const TerrainVertex& v = vertices[i];
+            const float scale = 0.3f * max(1.0f, fabsf(r.pos.x) + fabsf(r.pos.z));
+
+            maxHeightError = max(maxHeightError, fabsf(r.pos.y - v.pos.y) / scale);
+            maxNormalError = max(maxNormalError, XMVectorGetX(XMVector3Length(XMLoadFloat3(&r.normal) - XMLoadFloat3(&v.normal))));
+        }
+
+        printf("Grid %4ux%-4u scalar %8.2f ms  SSE2 %7.2f ms (%5.2fx)  AVX2 %7.2f ms (%5.2fx)  threaded %7.2f ms (%5.2fx)"
+               "  height error %.1e  normal error %.1e\n",
+               size, size, scalarMs, sseMs, scalarMs / sseMs, avx2Ms, scalarMs / avx2Ms, threadMs, scalarMs / threadMs,
+               maxHeightError, maxNormalError);
+    }
+}
+
+// ====================================================================================================================
+// CDLOD selection along a fly-through over a 16 km terrain: nodes, draws and triangles per frame against a uniform
+// grid at the finest LOD. Also checks that the selection covers the terrain exactly once and neighbouring areas never
+// differ by more than one LOD.
+static void BenchCdlodTerrain()
+{
+    printf("== CdlodTerrain\n");
+
+    auto heightAt = [](float x, float z)
+    {
+        return 120.0f * sinf(0.0021f * x) * cosf(0.0017f * z) + 25.0f * sinf(0.013f * z + 0.4f) * cosf(0.011f * x);
+    };
+
+    CdlodSettings settings;
+    settings.terrainSize     = 16384.0f;
+    settings.lodCount        = 9;
+    settings.patchResolution = 33;
+
+    CdlodTerrain terrain;
+    const double buildMs = TimeMs(1, [&]() { terrain.Build(settings, heightAt); });
+
+    const uint32 leafCount       = 1u << (settings.lodCount - 1);
+    const double uniformTriangles = double(leafCount) * leafCount * 2.0 * (settings.patchResolution - 1) * (settings.patchResolution - 1);
+
+    printf("%.0f m terrain, %u LODs, %ux%u patches: min / max tree built in %.2f ms, uniform grid would be %.0f M triangles\n",
+           settings.terrainSize, settings.lodCount, settings.patchResolution, settings.patchResolution, buildMs,
+           uniformTriangles / 1e6);
+
+    // Coverage and LOD continuity without culling, from a few camera positions.
+    bool allPassed = true;
+    for (const XMFLOAT3& eye : { XMFLOAT3(0.0f, 200.0f, 0.0f), XMFLOAT3(-7000.0f, 50.0f, 3000.0f), XMFLOAT3(8000.0f, 2000.0f, 8000.0f) })
+    {
+        std::vector<CdlodNode> nodes;
+        terrain.Select(eye, nullptr, nodes);
+
+        // LOD of every sample point on a grid at half the leaf size, -1 where nothing covers it.
+        const float  leafSize    = settings.terrainSize / leafCount;
+        const uint32 samples     = leafCount * 2;
+        std::vector<int> lods(samples * samples, -1);
+        bool         overlapFree = true;
+
+        for (const CdlodNode& node : nodes)
+        {
+            const float quadrantSize = node.size * 0.5f;
+            for (uint32 q = 0; q < 4; ++q)
+            {
+                if ((node.quadrantMask & (1u << q)) == 0)
+                {
+                    continue;
+                }
+
+                const float  x0    = node.offset.x + (q & 1) * quadrantSize + 0.5f * settings.terrainSize;
+                const float  z0    = node.offset.y + (q >> 1) * quadrantSize + 0.5f * settings.terrainSize;
+                const uint32 sx    = static_cast<uint32>(x0 / (0.5f * leafSize) + 0.5f);
+                const uint32 sz    = static_cast<uint32>(z0 / (0.5f * leafSize) + 0.5f);
+                const uint32 count = static_cast<uint32>(quadrantSize / (0.5f * leafSize) + 0.5f);
+
+                for (uint32 z = sz; z < sz + count; ++z)
+                {
+                    for (uint32 x = sx; x < sx + count; ++x)
+                    {
+                        overlapFree = overlapFree && (lods[z * samples + x] == -1);
+                        lods[z * samples + x] = static_cast<int>(node.lod);
+                    }
+                }
+            }
+        }
+
+        bool covered    = true;
+        bool continuous = true;
+        for (uint32 z = 0; z < samples; ++z)
+        {
+            for (uint32 x = 0; x < samples; ++x)
+            {
+                const int lod = lods[z * samples + x];
+                covered = covered && (lod >= 0);
+                if (x + 1 < samples)
+                {
+                    continuous = continuous && (abs(lod - lods[z * samples + x + 1]) <= 1);
+                }
+                if (z + 1 < samples)
+                {
+                    continuous = continuous && (abs(lod - lods[(z + 1) * samples + x]) <= 1);
+                }
+            }
+        }
+
+        const bool ok = covered && overlapFree && continuous;
+        allPassed     = allPassed && ok;
+        printf("Camera (%6.0f, %5.0f, %6.0f): %4u nodes, covered once %s, neighbours within one LOD %s\n",
+               eye.x, eye.y, eye.z, static_cast<uint32>(nodes.size()), (covered && overlapFree) ? "yes" : "NO", continuous ? "yes" : "NO");
+    }
+
+    // Fly-through with frustum culling at 1080p.
+    const uint32 frameCount = 600;
+    const float  fovY       = 0.25f * XM_PI;
+    const XMMATRIX proj     = XMMatrixPerspectiveFovLH(fovY, 16.0f / 9.0f, 1.0f, 20000.0f);
+
+    for (float pixelError : { 2.0f, 4.0f, 8.0f })
+    {
+        terrain.SetLodRanges(fovY, 1080.0f, pixelError);
+
+        std::vector<CdlodNode> nodes;
+        uint64_t               totalNodes     = 0;
+        uint64_t               totalDraws     = 0;
+        uint64_t               totalTriangles = 0;
+        uint32                 maxTriangles   = 0;
+        double                 totalMs        = 0.0;
+
+        for (uint32 frame = 0; frame < frameCount; ++frame)
+        {
+            const float t     = frame / float(frameCount) * XM_2PI;
+            const float x     = 6000.0f * cosf(t);
+            const float z     = 6000.0f * sinf(t);
+            XMFLOAT3    eye(x, heightAt(x, z) + 60.0f, z);
+            XMFLOAT3    target(x - 500.0f * sinf(t), heightAt(x, z), z + 500.0f * cosf(t));
+
+            const XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&target), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+            XMFLOAT4       planes[6];
+            MathHelper::ExtractFrustumPlanes(view * proj, planes);
+
+            nodes.clear();
+            CdlodSelectionStats stats;
+            totalMs += TimeMs(1, [&]() { stats = terrain.Select(eye, planes, nodes); });
+
+            totalNodes     += stats.nodeCount;
+            totalDraws     += stats.drawCount;
+            totalTriangles += stats.triangleCount;
+            maxTriangles    = max(maxTriangles, stats.triangleCount);
+        }
+
+        printf("Max error %.0f px: %6.1f nodes  %6.1f draws  %8.0f triangles (max %u, %.3f%% of uniform) per frame, select %.1f us\n",
+               pixelError, double(totalNodes) / frameCount, double(totalDraws) / frameCount, double(totalTriangles) / frameCount,
+               maxTriangles, 100.0 * maxTriangles / uniformTriangles, 1000.0 * totalMs / frameCount);
+    }
+
+    printf("CdlodTerrain selection checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Streams a 4097x4097 tiled heightmap (8 km at 2 m) with a budget of a fraction of the file while the camera flies
+// over it: query cost and residency per frame, then the height error around the camera once streaming has caught up.
+// Also checks that a truncated file is rejected.
+static void BenchHeightmapStreaming()
+{
+    printf("== HeightmapStreamer\n");
+
+    auto heightAt = [](float x, float z)
+    {
+        return 120.0f * sinf(0.0021f * x) * cosf(0.0017f * z) + 25.0f * sinf(0.013f * z + 0.4f) * cosf(0.011f * x);
+    };
+
+    const std::string path          = "geometry_bench_heightmap.bin";
+    const std::string truncatedPath = "geometry_bench_heightmap_truncated.bin";
+
+    TiledHeightmap::Desc desc;
+    desc.width         = 4097;
+    desc.height        = 4097;
+    desc.tileSize      = 128;
+    desc.sampleSpacing = 2.0f;
+    desc.minHeight     = -150.0f;
+    desc.maxHeight     = 150.0f;
+
+    bool         written = false;
+    const double writeMs = TimeMs(1, [&]() { written = TiledHeightmap::Write(path, desc, heightAt); });
+
+    bool allPassed = written;
+
+    // Drop the last tile's samples.
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(truncatedPath, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 1000);
+    }
+
+    TiledHeightmap truncated;
+    const bool     truncatedRejected = (truncated.Open(truncatedPath) == false);
+    allPassed = allPassed && truncatedRejected;
+    remove(truncatedPath.c_str());
+
+    const uint64 budget       = 8 * 1024 * 1024;
+    const float  detailRadius = 600.0f;
+
+    HeightmapStreamer streamer;
+    const bool        opened = streamer.Open(path, budget, detailRadius);
+    allPassed = allPassed && opened;
+
+    if (opened)
+    {
+        printf("%ux%u samples, %u mips: written in %.0f ms, %.1f MB file, %.1f MB budget, truncated file rejected %s\n",
+               desc.width, desc.height, streamer.Map().Header().mipCount, writeMs, streamer.Map().FileSize() / (1024.0 * 1024.0),
+               budget / (1024.0 * 1024.0), truncatedRejected ? "yes" : "NO");
+
+        // Each frame queries a 64x64 patch of vertices around the camera, like a terrain mesh following it.
+        const uint32          gridSize = 64;
+        std::vector<XMFLOAT3> positions(gridSize * gridSize);
+        std::vector<XMFLOAT3> normals(gridSize * gridSize);
+
+        HeightfieldStreams streams;
+        streams.pX           = &positions[0].x;
+        streams.pZ           = &positions[0].z;
+        streams.inputStride  = sizeof(XMFLOAT3);
+        streams.pHeights     = &positions[0].y;
+        streams.heightStride = sizeof(XMFLOAT3);
+        streams.pNormals     = &normals[0];
+        streams.normalStride = sizeof(XMFLOAT3);
+
+        const uint32 frameCount       = 600;
+        double       totalMs          = 0.0;
+        double       maxMs            = 0.0;
+        uint64       maxResidentBytes = 0;
+        uint32       coarseFrames     = 0;
+
+        for (uint32 frame = 0; frame < frameCount; ++frame)
+        {
+            // 20 m per frame, i.e. 1200 m/s at 60 frames per second.
+            const float t = frame / float(frameCount) * XM_2PI;
+            const float x = 2500.0f * cosf(t);
+            const float z = 2500.0f * sinf(t);
+            streamer.Update(XMFLOAT3(x, heightAt(x, z) + 50.0f, z));
+
+            for (uint32 i = 0; i < gridSize; ++i)
+            {
+                for (uint32 j = 0; j < gridSize; ++j)
+                {
+                    positions[i * gridSize + j] = XMFLOAT3(x + (j - 0.5f * gridSize) * 4.0f, 0.0f, z + (i - 0.5f * gridSize) * 4.0f);
+                }
+            }
+
+            const double ms = TimeMs(1, [&]() { streamer.Evaluate(streams, gridSize * gridSize, 1); });
+            totalMs += ms;
+            maxMs    = max(maxMs, ms);
+
+            maxResidentBytes = max(maxResidentBytes, streamer.Stats().residentBytes);
+            coarseFrames    += (streamer.ResidentMip(x, z) > 0) ? 1 : 0;
+        }
+
+        const HeightmapStreamerStats flightStats = streamer.Stats();
+        const bool                   withinBudget = (maxResidentBytes <= budget);
+        allPassed = allPassed && withinBudget;
+
+        printf("Fly-through: %u vertices per frame in %.3f ms average, %.3f ms max; %u of %u frames on a coarser mip under "
+               "the camera\n",
+               gridSize * gridSize, totalMs / frameCount, maxMs, coarseFrames, frameCount);
+        printf("Max resident %.1f MB (within budget %s), %llu loads, %llu evictions\n", maxResidentBytes / (1024.0 * 1024.0),
+               withinBudget ? "yes" : "NO", static_cast<unsigned long long>(flightStats.loadCount),
+               static_cast<unsigned long long>(flightStats.evictionCount));
+
+        // Once idle, everything within the detail radius comes from mip 0: bilinear plus 16 bit quantization error.
+        const XMFLOAT3 camera(1000.0f, 100.0f, -700.0f);
+        streamer.Update(camera);
+        const double waitMs = TimeMs(1, [&]() { streamer.WaitIdle(); });
+
+        float  maxError    = 0.0f;
+        uint32 coarseCount = 0;
+        for (uint32 i = 0; i < 101; ++i)
+        {
+            for (uint32 j = 0; j < 101; ++j)
+            {
+                const float x = camera.x + (j - 50.0f) * 5.5f;
+                const float z = camera.z + (i - 50.0f) * 5.5f;
+                maxError     = max(maxError, fabsf(streamer.Height(x, z) - heightAt(x, z)));
+                coarseCount += (streamer.ResidentMip(x, z) > 0) ? 1 : 0;
+            }
+        }
+
+        const bool accurate = (coarseCount == 0) && (maxError < 0.05f);
+        allPassed = allPassed && accurate;
+
+        printf("Jump to (%.0f, %.0f): idle after %.2f ms, max height error %.4f m within %.0f m, %u points on coarser mips\n",
+               camera.x, camera.z, waitMs, maxError, 0.5f * detailRadius, coarseCount);
+    }
+
+    streamer.Close();
+    remove(path.c_str());
+
+    printf("HeightmapStreamer checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Packs thousands of small meshes into one vertex and one index buffer, the hand written way the demos did it
+// (concatenate vertices and indices into vectors, then copy them to the upload buffer) against MeshBatcher writing
+// every submesh once, straight into the destination, from existing meshes and generated in place.
+static void BenchMeshBatcher()
+{
+    printf("== MeshBatcher (%u hardware threads)\n", DefaultThreadCount());
+
+    struct ShaderVertex
+    {
+        XMFLOAT3 pos;
+        XMFLOAT3 normal;
+        XMFLOAT2 texC;
+    };
+
+    InterleavedLayout layout;
+    layout.stride         = sizeof(ShaderVertex);
+    layout.positionOffset = offsetof(ShaderVertex, pos);
+    layout.normalOffset   = offsetof(ShaderVertex, normal);
+    layout.texCOffset     = offsetof(ShaderVertex, texC);
+
+    GeometryGenerator geoGen(1);
+
+    // A mix of shapes and sizes; shape k of a batch is always the same, so the meshes and the generated batch agree.
+    auto ShapeSize = [](uint32 k)
+    {
+        switch (k % 4)
+        {
+        case 0:  return GeometryGenerator::BoxSize(k % 3);
+        case 1:  return GeometryGenerator::SphereSize(8 + k % 24, 6 + k % 16);
+        case 2:  return GeometryGenerator::CylinderSize(8 + k % 20, 1 + k % 8);
+        default: return GeometryGenerator::GridSize(2 + k % 30, 2 + k % 20);
+        }
+    };
+    auto CreateShape = [](GeometryGenerator& generator, uint32 k, const MeshWriteTarget& target)
+    {
+        switch (k % 4)
+        {
+        case 0:  generator.CreateBox(1.0f, 2.0f, 3.0f, k % 3, target); break;
+        case 1:  generator.CreateSphere(1.0f, 8 + k % 24, 6 + k % 16, target); break;
+        case 2:  generator.CreateCylinder(1.0f, 0.5f, 2.0f, 8 + k % 20, 1 + k % 8, target); break;
+        default: generator.CreateGrid(4.0f, 4.0f, 2 + k % 30, 2 + k % 20, target); break;
+        }
+    };
+
+    bool allPassed = true;
+
+    for (uint32 meshCount : { 1000u, 4000u, 16000u })
+    {
+        std::vector<MeshData> meshes(meshCount);
+        for (uint32 k = 0; k < meshCount; ++k)
+        {
+            const MeshSize size = ShapeSize(k);
+            meshes[k].ResizeVertices(size.vertexCount);
+            meshes[k].ResizeIndices(size.indexCount);
+
+            MeshWriteTarget target;
+            target.pVertices             = meshes[k].m_vertices.data();
+            target.layout.stride         = sizeof(Vertex);
+            target.layout.positionOffset = offsetof(Vertex, m_position);
+            target.layout.normalOffset   = offsetof(Vertex, m_normal);
+            target.layout.tangentOffset  = offsetof(Vertex, m_tangentU);
+            target.layout.texCOffset     = offsetof(Vertex, m_texC);
+            target.vertexCapacity        = size.vertexCount;
+            target.pIndices              = meshes[k].m_indices32.data();
+            target.indexCapacity         = size.indexCount;
+            CreateShape(geoGen, k, target);
+        }
+
+        MeshBatcher batcher;
+        MeshBatcher generated;
+        for (uint32 k = 0; k < meshCount; ++k)
+        {
+            const std::string name = "mesh" + std::to_string(k);
+            batcher.Add(name, meshes[k]);
+            generated.Add(name, ShapeSize(k), [&CreateShape, k](const MeshWriteTarget& target)
+            {
+                GeometryGenerator generator(1);
+                CreateShape(generator, k, target);
+            });
+        }
+
+        const uint32 vertexCount = batcher.VertexCount();
+        const uint32 indexCount  = batcher.IndexCount();
+
+        // Stands in for the mapped upload buffers.
+        std::vector<ShaderVertex> uploadVertices(vertexCount);
+        std::vector<uint8_t>      uploadIndices(size_t(indexCount) * 4);
+
+        // The hand written packing: offsets, vertex conversion and index concatenation, then the copy to the buffer.
+        std::vector<uint32> reference;
+        const double handMs = TimeMs(3, [&]()
+        {
+            std::vector<ShaderVertex> vertices;
+            std::vector<uint32>       indices;
+            for (const MeshData& mesh : meshes)
+            {
+                for (const Vertex& v : mesh.m_vertices)
+                {
+                    vertices.push_back({ v.m_position, v.m_normal, v.m_texC });
+                }
+                indices.insert(indices.end(), mesh.m_indices32.begin(), mesh.m_indices32.end());
+            }
+            memcpy(uploadVertices.data(), vertices.data(), vertices.size() * sizeof(ShaderVertex));
+            memcpy(uploadIndices.data(), indices.data(), indices.size() * sizeof(uint32));
+            reference.swap(indices);
+        });
+        const std::vector<ShaderVertex> referenceVertices = uploadVertices;
+
+        std::fill(uploadVertices.begin(), uploadVertices.end(), ShaderVertex());
+        const double batchOneMs = TimeMs(3, [&]() { batcher.Write(uploadVertices.data(), layout, uploadIndices.data(), 1); });
+        const double batchAllMs = TimeMs(3, [&]() { batcher.Write(uploadVertices.data(), layout, uploadIndices.data()); });
+
+        auto Matches = [&](const MeshBatcher& b)
+        {
+            bool ok = (memcmp(uploadVertices.data(), referenceVertices.data(), uploadVertices.size() * sizeof(ShaderVertex)) == 0);
+            for (uint32 i = 0; ok && (i < indexCount); ++i)
+            {
+                const uint32 index = (b.IndexSize() == 2) ? reinterpret_cast<const uint16*>(uploadIndices.data())[i]
+                                                           : reinterpret_cast<const uint32*>(uploadIndices.data())[i];
+                ok = (index == reference[i]);
+            }
+            return ok;
+        };
+
+        const bool batchMatches = Matches(batcher);
+
+        std::fill(uploadVertices.begin(), uploadVertices.end(), ShaderVertex());
+        const double generatedMs = TimeMs(3, [&]() { generated.Write(uploadVertices.data(), layout, uploadIndices.data()); });
+        const double createMs    = TimeMs(1, [&]()
+        {
+            for (uint32 k = 0; k < meshCount; ++k)
+            {
+                MeshData mesh;
+                switch (k % 4)
+                {
+                case 0:  mesh = geoGen.CreateBox(1.0f, 2.0f, 3.0f, k % 3); break;
+                case 1:  mesh = geoGen.CreateSphere(1.0f, 8 + k % 24, 6 + k % 16); break;
+                case 2:  mesh = geoGen.CreateCylinder(1.0f, 0.5f, 2.0f, 8 + k % 20, 1 + k % 8); break;
+                default: mesh = geoGen.CreateGrid(4.0f, 4.0f, 2 + k % 30, 2 + k % 20); break;
+                }
+            }
+        });
+
+        // The generated batch takes its AABBs from the positions the generators keep aside, the other from the meshes.
+        bool sameBounds = true;
+        for (uint32 k = 0; k < meshCount; ++k)
+        {
+            const BoundingBox& fromMesh      = batcher.Submeshes()[k].bounds.aabb;
+            const BoundingBox& fromGenerated = generated.Submeshes()[k].bounds.aabb;
+            sameBounds = sameBounds && (memcmp(&fromMesh, &fromGenerated, sizeof(BoundingBox)) == 0);
+        }
+
+        const bool generatedMatches = Matches(generated) && sameBounds;
+        const bool ok               = batchMatches && generatedMatches && (batcher.IndexSize() == 2);
+        allPassed                   = allPassed && ok;
+
+        printf("%5u submeshes, %7u vertices, %8u indices (%u bit): hand packed %7.2f ms, batcher %7.2f ms (%5.2fx), "
+               "%u threads %7.2f ms (%5.2fx), generated in place %7.2f ms (create, then pack %7.2f ms), identical %s\n",
+               meshCount, vertexCount, indexCount, batcher.IndexSize() * 8, handMs, batchOneMs, handMs / batchOneMs,
+               DefaultThreadCount(), batchAllMs, handMs / batchAllMs, generatedMs, createMs + batchOneMs,
+               (batchMatches && generatedMatches) ? "yes" : "NO");
+    }
+
+    // 16 bit indices only depend on the largest submesh.
+    const MeshData small = geoGen.CreateGrid(1.0f, 1.0f, 200, 200);
+    const MeshData large = geoGen.CreateGrid(1.0f, 1.0f, 300, 300);
+
+    MeshBatcher smallBatch;
+    for (uint32 i = 0; i < 4; ++i)
+    {
+        smallBatch.Add("small" + std::to_string(i), small);
+    }
+    MeshBatcher largeBatch;
+    largeBatch.Add("small", small);
+    largeBatch.Add("large", large);
+
+    const bool indexSizes = (smallBatch.IndexSize() == 2) && (largeBatch.IndexSize() == 4);
+    allPassed = allPassed && indexSizes;
+    printf("4 x %u vertices use %u bit indices, a %u vertex submesh needs %u bit\n", small.VertexCount(),
+           smallBatch.IndexSize() * 8, large.VertexCount(), largeBatch.IndexSize() * 8);
+
+    printf("MeshBatcher checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Welds the duplicates the generators leave behind, and meshes split into one vertex per corner (as loaded from
+// formats without an index buffer) back together, exactly and with jittered positions.
+static void BenchMeshWelder()
+{
+    printf("== MeshWelder (%u hardware threads)\n", DefaultThreadCount());
+
+    GeometryGenerator geoGen;
+    bool              allPassed = true;
+
+    // Every corner of the welded mesh within tolerance of the corner it replaced.
+    auto WithinTolerance = [](const MeshData& original, const MeshData& welded, const WeldSettings& settings)
+    {
+        auto Distance3 = [](const XMFLOAT3& a, const XMFLOAT3& b) { return XMVectorGetX(XMVector3Length(XMLoadFloat3(&a) - XMLoadFloat3(&b))); };
+        auto Distance2 = [](const XMFLOAT2& a, const XMFLOAT2& b) { return XMVectorGetX(XMVector2Length(XMLoadFloat2(&a) - XMLoadFloat2(&b))); };
+
+        if (welded.IndexCount() != original.IndexCount())
+        {
+            return false;
+        }
+        for (uint32 i = 0; i < original.IndexCount(); ++i)
+        {
+            const Vertex& a = original.m_vertices[original.m_indices32[i]];
+            const Vertex& b = welded.m_vertices[welded.m_indices32[i]];
+            if ((Distance3(a.m_position, b.m_position) > settings.positionTolerance) ||
+                (Distance3(a.m_normal, b.m_normal) > settings.normalTolerance) ||
+                (Distance3(a.m_tangentU, b.m_tangentU) > settings.tangentTolerance) ||
+                (Distance2(a.m_texC, b.m_texC) > settings.texCTolerance))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    auto Identical = [](const MeshData& a, const MeshData& b)
+    {
+        return (a.m_indices32 == b.m_indices32) && (a.VertexCount() == b.VertexCount()) &&
+               (memcmp(a.m_vertices.data(), b.m_vertices.data(), a.VertexCount() * sizeof(Vertex)) == 0);
+    };
+
+    // One vertex per corner, positions optionally moved by up to jitter along each axis.
+    auto Split = [](const MeshData& mesh, float jitter)
+    {
+        uint32   seed = 12345;
+        MeshData split;
+        split.ResizeVertices(mesh.IndexCount());
+        split.ResizeIndices(mesh.IndexCount());
+        for (uint32 i = 0; i < mesh.IndexCount(); ++i)
+        {
+            split.m_vertices[i]  = mesh.m_vertices[mesh.m_indices32[i]];
+            split.m_indices32[i] = i;
+
+            float* p = &split.m_vertices[i].m_position.x;
+            for (uint32 c = 0; c < 3; ++c)
+            {
+                seed  = seed * 1664525u + 1013904223u;
+                p[c] += jitter * (float(seed >> 8) / float(1 << 24) * 2.0f - 1.0f);
+            }
+        }
+        return split;
+    };
+
+    // The generators share vertices already; what is left are texture seams (welded with texC ignored, positions
+    // differ by rounding there) and hard edges (welded for position only streams, e.g. depth passes).
+    struct Shape
+    {
+        const char* name;
+        MeshData    mesh;
+    };
+    const Shape shapes[] = {
+        { "box (5 subdivisions)", geoGen.CreateBox(1.5f, 0.5f, 1.5f, 5) },
+        { "geosphere (5 subdivisions)", geoGen.CreateGeoSphere(1.0f, 5) },
+        { "sphere 64x32", geoGen.CreateSphere(1.0f, 64, 32) },
+        { "cylinder 64x16", geoGen.CreateCylinder(1.0f, 0.5f, 3.0f, 64, 16) },
+        { "grid 512x512", geoGen.CreateGrid(10.0f, 10.0f, 512, 512) },
+    };
+
+    WeldSettings seams;
+    seams.positionTolerance = 1e-5f;
+    seams.normalTolerance   = 1e-5f;
+    seams.tangentTolerance  = 1e-5f;
+    seams.texCTolerance     = FLT_MAX;
+
+    WeldSettings positionOnly;
+    positionOnly.positionTolerance = 1e-5f;
+    positionOnly.normalTolerance   = FLT_MAX;
+    positionOnly.tangentTolerance  = FLT_MAX;
+    positionOnly.texCTolerance     = FLT_MAX;
+
+    for (const Shape& shape : shapes)
+    {
+        MeshData exactMesh    = shape.mesh;
+        MeshData seamMesh     = shape.mesh;
+        MeshData positionMesh = shape.mesh;
+        MeshWelder::Weld(exactMesh);
+        MeshWelder::Weld(seamMesh, seams);
+        MeshWelder::Weld(positionMesh, positionOnly);
+
+        const bool ok = WithinTolerance(shape.mesh, exactMesh, WeldSettings()) && WithinTolerance(shape.mesh, seamMesh, seams) &&
+                        WithinTolerance(shape.mesh, positionMesh, positionOnly) &&
+                        (exactMesh.VertexCount() <= shape.mesh.VertexCount()) &&
+                        (seamMesh.VertexCount() <= exactMesh.VertexCount()) &&
+                        (positionMesh.VertexCount() <= seamMesh.VertexCount());
+        allPassed = allPassed && ok;
+
+        printf("%-28s %7u vertices, exact %7u, texC ignored %7u, position only %7u, %s\n", shape.name,
+               shape.mesh.VertexCount(), exactMesh.VertexCount(), seamMesh.VertexCount(), positionMesh.VertexCount(),
+               ok ? "ok" : "FAILED");
+    }
+
+    // Split meshes welded back together.
+    const MeshData indexed = geoGen.CreateGeoSphere(1.0f, 7);
+    const float    jitter  = 1e-5f;
+
+    WeldSettings epsilon;
+    epsilon.positionTolerance = 4.0f * jitter;
+
+    struct Case
+    {
+        const char*  name;
+        MeshData     split;
+        WeldSettings settings;
+    };
+    const Case cases[] = {
+        { "exact", Split(indexed, 0.0f), WeldSettings() },
+        { "epsilon", Split(indexed, jitter), epsilon },
+    };
+
+    for (const Case& c : cases)
+    {
+        MeshData     one = c.split;
+        MeshData     all = c.split;
+        const double oneMs = TimeMs(1, [&]() { MeshWelder::Weld(one, c.settings, 1); });
+        const double allMs = TimeMs(1, [&]() { MeshWelder::Weld(all, c.settings); });
+
+        const bool sameResult = Identical(one, all);
+        const bool ok         = sameResult && WithinTolerance(c.split, all, c.settings) &&
+                                (all.VertexCount() == indexed.VertexCount());
+        allPassed = allPassed && ok;
+
+        const VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(c.split.m_indices32.data(), c.split.IndexCount(), c.split.VertexCount());
+        MeshOptimizer::Optimize(all);
+        const VertexCacheStats after = MeshOptimizer::AnalyzeVertexCache(all.m_indices32.data(), all.IndexCount(), all.VertexCount());
+
+        printf("%-7s weld of %7u split vertices -> %7u (indexed mesh %7u): 1 thread %7.2f ms, %u threads %7.2f ms (%5.2fx), "
+               "same result %s, ACMR %.3f -> %.3f after Optimize(), ATVR %.3f -> %.3f, %s\n",
+               c.name, c.split.VertexCount(), all.VertexCount(), indexed.VertexCount(), oneMs, DefaultThreadCount(), allMs,
+               oneMs / allMs, sameResult ? "yes" : "NO", before.acmr, after.acmr, before.atvr, after.atvr,
+               ok ? "ok" : "FAILED");
+    }
+
+    printf("MeshWelder checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Regenerates the tangents of the generated shapes and compares them with the analytic ones, checks the split along a
+// mirrored UV seam and times large meshes.
+static void BenchTangentGenerator()
+{
+    printf("== TangentGenerator (%u hardware threads)\n", DefaultThreadCount());
+
+    GeometryGenerator geoGen;
+    bool              allPassed = true;
+
+    auto AngleDegrees = [](const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        const float cosAngle = XMVectorGetX(XMVector3Dot(XMVector3Normalize(XMLoadFloat3(&a)), XMVector3Normalize(XMLoadFloat3(&b))));
+        return XMConvertToDegrees(acosf(std::min<float>(1.0f, std::max<float>(-1.0f, cosAngle))));
+    };
+
+    // Unit length and orthogonal to the normal.
+    auto Orthonormal = [](const MeshData& mesh)
+    {
+        for (const Vertex& v : mesh.m_vertices)
+        {
+            const XMVECTOR t = XMLoadFloat3(&v.m_tangentU);
+            if ((fabsf(XMVectorGetX(XMVector3Length(t)) - 1.0f) > 1e-4f) ||
+                (fabsf(XMVectorGetX(XMVector3Dot(t, XMLoadFloat3(&v.m_normal)))) > 1e-4f))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    struct Shape
+    {
+        const char* name;
+        MeshData    mesh;
+    };
+    const Shape shapes[] = {
+        { "box", geoGen.CreateBox(1.5f, 0.5f, 1.5f, 2) },
+        { "grid 64x64", geoGen.CreateGrid(10.0f, 10.0f, 64, 64) },
+        { "sphere 64x32", geoGen.CreateSphere(1.0f, 64, 32) },
+        { "cylinder 64x16", geoGen.CreateCylinder(1.0f, 0.5f, 3.0f, 64, 16) },
+    };
+
+    for (const Shape& shape : shapes)
+    {
+        MeshData mesh = shape.mesh;
+        for (Vertex& v : mesh.m_vertices)
+        {
+            v.m_tangentU = XMFLOAT3(0.0f, 0.0f, 0.0f);
+        }
+
+        std::vector<float> signs;
+        TangentGenerator::Generate(mesh, &signs);
+
+        float  maxAngle  = 0.0f;
+        double meanAngle = 0.0;
+        for (uint32 v = 0; v < shape.mesh.VertexCount(); ++v)
+        {
+            const float angle = AngleDegrees(mesh.m_vertices[v].m_tangentU, shape.mesh.m_vertices[v].m_tangentU);
+            maxAngle   = std::max<float>(maxAngle, angle);
+            meanAngle += angle / shape.mesh.VertexCount();
+        }
+
+        const bool ok = (mesh.VertexCount() == shape.mesh.VertexCount()) && Orthonormal(mesh) && (meanAngle < 1.0);
+        allPassed = allPassed && ok;
+
+        printf("%-16s %6u vertices -> %6u, angle to the analytic tangents mean %6.3f max %7.3f degrees, %s\n", shape.name,
+               shape.mesh.VertexCount(), mesh.VertexCount(), meanAngle, maxAngle, ok ? "ok" : "FAILED");
+    }
+
+    // A grid with the texture mirrored at x = 0: the center column is split, the mirrored half has flipped signs.
+    {
+        const uint32 columns = 65;
+        const uint32 rows    = 33;
+        MeshData     mesh    = geoGen.CreateGrid(2.0f, 1.0f, rows, columns);
+        for (Vertex& v : mesh.m_vertices)
+        {
+            v.m_texC.x = fabsf(v.m_position.x);
+        }
+
+        std::vector<float> signs;
+        TangentGenerator::Generate(mesh, &signs);
+
+        // The tangent follows +u, so it points away from the mirror line, and sign * cross(N, T) has to follow +v.
+        bool consistent = true;
+        for (uint32 i = 0; i < mesh.IndexCount(); ++i)
+        {
+            const uint32  index = mesh.m_indices32[i];
+            const Vertex& v     = mesh.m_vertices[index];
+            const Vertex& a     = mesh.m_vertices[mesh.m_indices32[i - i % 3]];
+            const Vertex& b     = mesh.m_vertices[mesh.m_indices32[i - i % 3 + 1]];
+            const Vertex& c     = mesh.m_vertices[mesh.m_indices32[i - i % 3 + 2]];
+            const float   side  = (a.m_position.x + b.m_position.x + c.m_position.x > 0.0f) ? 1.0f : -1.0f;
+
+            const XMVECTOR bitangent = XMVectorScale(XMVector3Cross(XMLoadFloat3(&v.m_normal), XMLoadFloat3(&v.m_tangentU)), signs[index]);
+            consistent = consistent && (v.m_tangentU.x * side > 0.99f) && (XMVectorGetZ(bitangent) < -0.99f);
+        }
+
+        const bool ok = (mesh.VertexCount() == rows * columns + rows) && consistent && Orthonormal(mesh);
+        allPassed = allPassed && ok;
+
+        printf("mirrored grid    %6u vertices -> %6u (%u on the mirror line), tangents and bitangents follow the UVs %s, %s\n",
+               rows * columns, mesh.VertexCount(), rows, consistent ? "yes" : "NO", ok ? "ok" : "FAILED");
+    }
+
+    for (uint32 size : { 500u, 1200u })
+    {
+        const MeshData source = geoGen.CreateGrid(100.0f, 100.0f, size, size);
+        MeshData       one;
+        MeshData       all;
+
+        const double oneMs = TimeMs(3, [&]() { one = source; TangentGenerator::Generate(one, nullptr, 1); });
+        const double allMs = TimeMs(3, [&]() { all = source; TangentGenerator::Generate(all); });
+
+        const bool same = (memcmp(one.m_vertices.data(), all.m_vertices.data(), one.VertexCount() * sizeof(Vertex)) == 0);
+        allPassed = allPassed && same;
+
+        printf("grid %4ux%-4u   %7u triangles: 1 thread %7.2f ms, %u threads %7.2f ms (%5.2fx), same result %s\n", size, size,
+               source.IndexCount() / 3, oneMs, DefaultThreadCount(), allMs, oneMs / allMs, same ? "yes" : "NO");
+    }
+
+    printf("TangentGenerator checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Startup of a geometry heavy scene: generating, welding, optimizing and packing the meshes against opening the cache
+// file written on the first run and copying it to the upload buffers. Also checks that stale and truncated cache files
+// are rejected.
+static void BenchMeshFile()
+{
+    printf("== MeshFile\n");
+
+    const std::string path          = "geometry_bench_meshes.mesh";
+    const std::string truncatedPath = "geometry_bench_meshes_truncated.mesh";
+
+    struct ShaderVertex
+    {
+        XMFLOAT3 pos;
+        XMFLOAT3 normal;
+        XMFLOAT2 texC;
+    };
+
+    InterleavedLayout layout;
+    layout.stride         = sizeof(ShaderVertex);
+    layout.positionOffset = offsetof(ShaderVertex, pos);
+    layout.normalOffset   = offsetof(ShaderVertex, normal);
+    layout.texCOffset     = offsetof(ShaderVertex, texC);
+
+    const uint64 key = MeshFileKey("geometry_bench").Add(uint32(1000)).Add(uint32(7)).Add(layout.stride).Value();
+
+    // What a sample does on a cache miss.
+    std::vector<MeshData> meshes;
+    MeshFile              built;
+    const double          buildMs = TimeMs(1, [&]()
+    {
+        GeometryGenerator geoGen;
+        meshes.clear();
+        meshes.push_back(geoGen.CreateGrid(100.0f, 100.0f, 1000, 1000));
+        meshes.push_back(geoGen.CreateGeoSphere(5.0f, 7));
+        meshes.push_back(geoGen.CreateSphere(5.0f, 512, 256));
+        meshes.push_back(geoGen.CreateCylinder(3.0f, 2.0f, 10.0f, 512, 64));
+        meshes.push_back(geoGen.CreateBox(2.0f, 2.0f, 2.0f, 6));
+
+        // The file is built once, so it stores the tight spheres and OBBs too.
+        MeshBatcher batcher;
+        batcher.SetFullBounds(true);
+        for (uint32 i = 0; i < meshes.size(); ++i)
+        {
+            MeshWelder::Weld(meshes[i]);
+            MeshOptimizer::Optimize(meshes[i]);
+            batcher.Add("mesh" + std::to_string(i), meshes[i]);
+        }
+
+        built.Build(key, batcher, layout.stride, [&](void* pVertices, void* pIndices)
+        {
+            batcher.Write(pVertices, layout, pIndices);
+        });
+    });
+
+    const bool saved     = built.Save(path);
+    bool       allPassed = saved;
+
+    // Stands in for the mapped upload buffers.
+    std::vector<uint8_t> uploadVertices(size_t(built.VertexCount()) * built.VertexStride());
+    std::vector<uint8_t> uploadIndices(size_t(built.IndexCount()) * built.IndexSize());
+
+    MeshFile     cached;
+    bool         opened = false;
+    const double openMs = TimeMs(5, [&]()
+    {
+        opened = cached.Open(path, key);
+        if (opened)
+        {
+            memcpy(uploadVertices.data(), cached.Vertices(), uploadVertices.size());
+            memcpy(uploadIndices.data(), cached.Indices(), uploadIndices.size());
+        }
+    });
+
+    const bool identical = opened && cached.IsMapped() && (cached.Size() == built.Size()) &&
+                           (memcmp(cached.Data(), built.Data(), size_t(built.Size())) == 0) &&
+                           (reinterpret_cast<uintptr_t>(cached.Vertices()) % MeshFileHeader::SectionAlignment == 0) &&
+                           (reinterpret_cast<uintptr_t>(cached.Indices()) % MeshFileHeader::SectionAlignment == 0);
+    allPassed = allPassed && identical;
+
+    // Submesh bounds against the source meshes.
+    bool boundsMatch = opened && (cached.SubmeshCount() == meshes.size());
+    for (uint32 i = 0; boundsMatch && (i < cached.SubmeshCount()); ++i)
+    {
+        XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+        XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+        for (const Vertex& v : meshes[i].m_vertices)
+        {
+            boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&v.m_position));
+            boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&v.m_position));
+        }
+
+        // The AABB is stored as center and extents, which rounds.
+        const MeshFileSubmesh& submesh = cached.Submesh(i);
+        const XMVECTOR         center  = XMLoadFloat3(&submesh.aabbCenter);
+        const XMVECTOR         extents = XMLoadFloat3(&submesh.aabbExtents);
+        const XMVECTOR         error   = XMVectorMax(XMVectorAbs(XMVectorSubtract(XMVectorSubtract(center, extents), boundsMin)),
+                                                     XMVectorAbs(XMVectorSubtract(XMVectorAdd(center, extents), boundsMax)));
+        boundsMatch = (std::string(submesh.name) == "mesh" + std::to_string(i)) &&
+                      (XMVectorGetX(XMVector3Length(error)) <= 1e-5f * (1.0f + XMVectorGetX(XMVector3Length(extents))));
+    }
+    allPassed = allPassed && boundsMatch;
+
+    // A changed key (other generator parameters) and a cut off file are both rejected.
+    MeshFile   stale;
+    const bool staleRejected = (stale.Open(path, MeshFileKey("geometry_bench").Add(uint32(999)).Value()) == false);
+    {
+        std::ifstream     in(path, std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream     out(truncatedPath, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), bytes.size() - 4096);
+    }
+    MeshFile   truncated;
+    const bool truncatedRejected = (truncated.Open(truncatedPath, key) == false);
+    allPassed = allPassed && staleRejected && truncatedRejected;
+
+    printf("%u submeshes, %u vertices, %u indices, %.1f MB file: generate, weld, optimize and pack %8.2f ms, "
+           "open cache and copy to upload %6.2f ms (%.0fx)\n",
+           built.SubmeshCount(), built.VertexCount(), built.IndexCount(), built.Size() / (1024.0 * 1024.0), buildMs, openMs,
+           buildMs / openMs);
+    printf("cached file identical %s, 64 byte aligned sections %s, bounds %s, stale key rejected %s, truncated file rejected %s\n",
+           identical ? "yes" : "NO", identical ? "yes" : "NO", boundsMatch ? "ok" : "WRONG", staleRejected ? "yes" : "NO",
+           truncatedRejected ? "yes" : "NO");
+
+    cached.Close();
+    remove(path.c_str());
+    remove(truncatedPath.c_str());
+
+    printf("MeshFile checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Bounding volume tightness against brute force optima: the minimal sphere of small random clouds against the best of
+// all spheres through 2, 3 or 4 of their points, and the PCA OBB against the best of many random orientations. Also
+// checks that every volume holds every point and times the passes on a large mesh.
+static void BenchBoundingVolumes()
+{
+    printf("== BoundingVolumes\n");
+
+    GeometryGenerator geoGen;
+    bool              allPassed = true;
+    uint32            seed      = 4711;
+
+    auto Random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1 << 24);
+    };
+
+    auto Contained = [](const std::vector<XMFLOAT3>& points, const MeshBounds& bounds)
+    {
+        const XMVECTOR aabbCenter   = XMLoadFloat3(&bounds.aabb.Center);
+        const XMVECTOR aabbExtents  = XMLoadFloat3(&bounds.aabb.Extents);
+        const XMVECTOR sphereCenter = XMLoadFloat3(&bounds.sphere.Center);
+        const XMVECTOR obbCenter    = XMLoadFloat3(&bounds.obb.Center);
+        const XMVECTOR obbExtents   = XMLoadFloat3(&bounds.obb.Extents);
+        const XMVECTOR orientation  = XMLoadFloat4(&bounds.obb.Orientation);
+        const float    tolerance    = 1e-5f * (1.0f + bounds.sphere.Radius);
+
+        for (const XMFLOAT3& point : points)
+        {
+            const XMVECTOR p        = XMLoadFloat3(&point);
+            const XMVECTOR aabbOut  = XMVectorSubtract(XMVectorAbs(XMVectorSubtract(p, aabbCenter)), aabbExtents);
+            const XMVECTOR local    = XMVector3InverseRotate(XMVectorSubtract(p, obbCenter), orientation);
+            const XMVECTOR obbOut   = XMVectorSubtract(XMVectorAbs(local), obbExtents);
+            const float    sphereOut = XMVectorGetX(XMVector3Length(XMVectorSubtract(p, sphereCenter))) - bounds.sphere.Radius;
+
+            XMFLOAT3 a;
+            XMFLOAT3 o;
+            XMStoreFloat3(&a, aabbOut);
+            XMStoreFloat3(&o, obbOut);
+            if ((std::max<float>(std::max<float>(a.x, a.y), a.z) > tolerance) ||
+                (std::max<float>(std::max<float>(o.x, o.y), o.z) > tolerance) || (sphereOut > tolerance))
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    // Minimal sphere by brute force: the smallest sphere through 2, 3 or 4 of the points that holds all of them.
+    auto BruteForceRadius = [](const std::vector<XMFLOAT3>& points)
+    {
+        const size_t count = points.size();
+        double       best  = 1e30;
+
+        auto Consider = [&](const double* c, double radiusSq)
+        {
+            if (radiusSq >= best * best)
+            {
+                return;
+            }
+            for (const XMFLOAT3& p : points)
+            {
+                const double dx = p.x - c[0];
+                const double dy = p.y - c[1];
+                const double dz = p.z - c[2];
+                if (dx * dx + dy * dy + dz * dz > radiusSq * (1.0 + 1e-9))
+                {
+                    return;
+                }
+            }
+            best = sqrt(radiusSq);
+        };
+
+        auto Sub = [](const XMFLOAT3& a, const XMFLOAT3& b, double* d) { d[0] = a.x - b.x; d[1] = a.y - b.y; d[2] = a.z - b.z; };
+        auto Dot = [](const double* a, const double* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; };
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            for (size_t j = i + 1; j < count; ++j)
+            {
+                double d[3];
+                Sub(points[j], points[i], d);
+                const double c[3] = { points[i].x + 0.5 * d[0], points[i].y + 0.5 * d[1], points[i].z + 0.5 * d[2] };
+                Consider(c, 0.25 * Dot(d, d));
+
+                for (size_t k = j + 1; k < count; ++k)
+                {
+                    // Circumcenter in the triangle's plane: solve for c = p_i + s a + t b.
+                    double b[3];
+                    Sub(points[k], points[i], b);
+                    const double aa = Dot(d, d), ab = Dot(d, b), bb = Dot(b, b);
+                    const double det = 2.0 * (aa * bb - ab * ab);
+                    if (fabs(det) > 1e-12)
+                    {
+                        const double s  = (bb * aa - ab * bb) / det;
+                        const double t  = (aa * bb - ab * aa) / det;
+                        const double o[3] = { s * d[0] + t * b[0], s * d[1] + t * b[1], s * d[2] + t * b[2] };
+                        const double c3[3] = { points[i].x + o[0], points[i].y + o[1], points[i].z + o[2] };
+                        Consider(c3, Dot(o, o));
+                    }
+
+                    for (size_t l = k + 1; l < count; ++l)
+                    {
+                        // Circumcenter of the tetrahedron: 2 M o = |rows|^2.
+                        double e[3];
+                        Sub(points[l], points[i], e);
+                        const double* m[3] = { d, b, e };
+                        const double  r[3] = { 0.5 * Dot(d, d), 0.5 * Dot(b, b), 0.5 * Dot(e, e) };
+                        const double  det4 = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                                             m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                                             m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+                        if (fabs(det4) <= 1e-12)
+                        {
+                            continue;
+                        }
+                        double o[3];
+                        for (uint32 axis = 0; axis < 3; ++axis)
+                        {
+                            double mk[3][3];
+                            for (uint32 row = 0; row < 3; ++row)
+                            {
+                                for (uint32 col = 0; col < 3; ++col)
+                                {
+                                    mk[row][col] = (col == axis) ? r[row] : m[row][col];
+                                }
+                            }
+                            o[axis] = (mk[0][0] * (mk[1][1] * mk[2][2] - mk[1][2] * mk[2][1]) -
+                                       mk[0][1] * (mk[1][0] * mk[2][2] - mk[1][2] * mk[2][0]) +
+                                       mk[0][2] * (mk[1][0] * mk[2][1] - mk[1][1] * mk[2][0])) / det4;
+                        }
+                        const double c4[3] = { points[i].x + o[0], points[i].y + o[1], points[i].z + o[2] };
+                        Consider(c4, Dot(o, o));
+                    }
+                }
+            }
+        }
+        return best;
+    };
+
+    // Random clouds of different shapes: in a box, on a sphere, in a flat disc, on a line.
+    double worstWelzlError = 0.0;
+    double worstRitter     = 1.0;
+    double sumRitter       = 0.0;
+    bool   cloudsContained = true;
+    uint32 cloudCount      = 0;
+    for (uint32 shape = 0; shape < 4; ++shape)
+    {
+        for (uint32 run = 0; run < 12; ++run)
+        {
+            std::vector<XMFLOAT3> points(20);
+            for (XMFLOAT3& p : points)
+            {
+                p = XMFLOAT3(Random() * 2.0f - 1.0f, Random() * 2.0f - 1.0f, Random() * 2.0f - 1.0f);
+                if (shape == 1)
+                {
+                    XMStoreFloat3(&p, XMVector3Normalize(XMLoadFloat3(&p)));
+                }
+                else if (shape == 2)
+                {
+                    p.y = 0.0f;
+                }
+                else if (shape == 3)
+                {
+                    p = XMFLOAT3(p.x, 0.5f * p.x, -p.x);
+                }
+            }
+            // Duplicates must not break the support set logic.
+            points[7] = points[3];
+
+            const MeshBounds     bounds  = BoundingVolumes::Compute(points.data(), sizeof(XMFLOAT3), uint32(points.size()));
+            const BoundingSphere ritter  = BoundingVolumes::ComputeSphere(points.data(), sizeof(XMFLOAT3), uint32(points.size()));
+            const double         optimum = BruteForceRadius(points);
+
+            MeshBounds ritterBounds = bounds;
+            ritterBounds.sphere     = ritter;
+
+            worstWelzlError = std::max<double>(worstWelzlError, fabs(bounds.sphere.Radius - optimum) / optimum);
+            worstRitter     = std::max<double>(worstRitter, ritter.Radius / optimum);
+            sumRitter      += ritter.Radius / optimum;
+            cloudsContained = cloudsContained && Contained(points, bounds) && Contained(points, ritterBounds);
+            cloudCount++;
+        }
+    }
+    allPassed = allPassed && (worstWelzlError < 1e-4) && (worstRitter >= 1.0 - 1e-4) && cloudsContained;
+
+    printf("%u random clouds of 20 points: minimal sphere off the brute force optimum by %.2e at most, "
+           "refined Ritter sphere %.3fx the optimum on average, %.3fx at worst, contained %s\n",
+           cloudCount, worstWelzlError, sumRitter / cloudCount, worstRitter, cloudsContained ? "yes" : "NO");
+
+    // OBBs of rotated, non uniformly scaled meshes against the best of random orientations and the true box.
+    struct Shape
+    {
+        const char* name;
+        MeshData    mesh;
+        XMFLOAT3    scale;
+        float       trueVolume; // Of the box, 0 if not known
+    };
+    std::vector<Shape> shapes;
+    shapes.push_back({ "box", geoGen.CreateBox(4.0f, 1.0f, 2.0f, 2), XMFLOAT3(1.0f, 1.0f, 1.0f), 8.0f });
+    shapes.push_back({ "cylinder", geoGen.CreateCylinder(0.5f, 1.5f, 5.0f, 24, 6), XMFLOAT3(1.0f, 1.0f, 1.0f), 0.0f });
+    shapes.push_back({ "geosphere", geoGen.CreateGeoSphere(1.0f, 3), XMFLOAT3(1.0f, 1.0f, 1.0f), 0.0f });
+    shapes.push_back({ "ellipsoid", geoGen.CreateGeoSphere(1.0f, 3), XMFLOAT3(3.0f, 1.0f, 0.5f), 0.0f });
+
+    const XMVECTOR meshRotation = XMQuaternionNormalize(XMVectorSet(0.3f, -0.5f, 0.7f, 0.9f));
+    for (Shape& shape : shapes)
+    {
+        std::vector<XMFLOAT3> points(shape.mesh.VertexCount());
+        for (uint32 i = 0; i < shape.mesh.VertexCount(); ++i)
+        {
+            const XMVECTOR p = XMVectorMultiply(XMLoadFloat3(&shape.mesh.m_vertices[i].m_position), XMLoadFloat3(&shape.scale));
+            XMStoreFloat3(&points[i], XMVectorAdd(XMVector3Rotate(p, meshRotation), XMVectorSet(3.0f, -1.0f, 2.0f, 0.0f)));
+        }
+
+        const MeshBounds     bounds = BoundingVolumes::Compute(points.data(), sizeof(XMFLOAT3), uint32(points.size()));
+        const BoundingSphere ritter = BoundingVolumes::ComputeSphere(points.data(), sizeof(XMFLOAT3), uint32(points.size()));
+
+        // Best box over random orientations.
+        double bestVolume = 1e30;
+        for (uint32 o = 0; o < 2000; ++o)
+        {
+            const XMVECTOR q    = XMQuaternionNormalize(XMVectorSet(Random() - 0.5f, Random() - 0.5f, Random() - 0.5f, Random() - 0.5f));
+            const XMVECTOR axes[3] = { XMVector3Rotate(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), q),
+                                       XMVector3Rotate(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), q),
+                                       XMVector3Rotate(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), q) };
+            double volume = 1.0;
+            for (uint32 axis = 0; axis < 3; ++axis)
+            {
+                float lo = FLT_MAX;
+                float hi = -FLT_MAX;
+                for (const XMFLOAT3& point : points)
+                {
+                    const float d = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&point), axes[axis]));
+                    lo = std::min<float>(lo, d);
+                    hi = std::max<float>(hi, d);
+                }
+                volume *= hi - lo;
+            }
+            bestVolume = std::min<double>(bestVolume, volume);
+        }
+
+        const double obbVolume  = 8.0 * bounds.obb.Extents.x * bounds.obb.Extents.y * bounds.obb.Extents.z;
+        const double aabbVolume = 8.0 * bounds.aabb.Extents.x * bounds.aabb.Extents.y * bounds.aabb.Extents.z;
+        const bool   contained  = Contained(points, bounds);
+        const bool   exactBox   = (shape.trueVolume == 0.0f) || (obbVolume <= shape.trueVolume * 1.001);
+        allPassed = allPassed && contained && exactBox && (obbVolume <= aabbVolume) && (obbVolume <= bestVolume * 1.05) &&
+                    (ritter.Radius >= bounds.sphere.Radius * (1.0f - 1e-5f));
+
+        printf("%-9s %5u vertices: OBB volume %.3fx the best random orientation, %.3fx the AABB; Ritter sphere %.3fx the "
+               "minimal sphere; contained %s\n",
+               shape.name, uint32(points.size()), obbVolume / bestVolume, obbVolume / aabbVolume,
+               ritter.Radius / bounds.sphere.Radius, contained ? "yes" : "NO");
+    }
+
+    // Timings on a large mesh.
+    MeshData     large  = geoGen.CreateGeoSphere(1.0f, 8);
+    const uint32 count  = large.VertexCount();
+    const void*  pFirst = large.m_vertices.data();
+    for (Vertex& v : large.m_vertices)
+    {
+        v.m_position.x *= 2.0f;
+    }
+
+    BoundingBox         aabb;
+    BoundingSphere      sphere;
+    BoundingSphere      minimal;
+    BoundingOrientedBox obb;
+    const double aabbMs    = TimeMs(3, [&]() { aabb = BoundingVolumes::ComputeAabb(pFirst, sizeof(Vertex), count); });
+    const double sphereMs  = TimeMs(3, [&]() { sphere = BoundingVolumes::ComputeSphere(pFirst, sizeof(Vertex), count); });
+    const double minimalMs = TimeMs(3, [&]() { minimal = BoundingVolumes::ComputeMinimalSphere(pFirst, sizeof(Vertex), count); });
+    const double obbMs     = TimeMs(3, [&]() { obb = BoundingVolumes::ComputeObb(pFirst, sizeof(Vertex), count); });
+
+    allPassed = allPassed && (fabsf(minimal.Radius - 2.0f) < 1e-3f) && (sphere.Radius >= minimal.Radius * (1.0f - 1e-5f));
+
+    printf("%u vertices: AABB %7.2f ms, Ritter sphere %7.2f ms (radius %.4f), minimal sphere %7.2f ms (radius %.4f), "
+           "OBB %7.2f ms\n",
+           count, aabbMs, sphereMs, sphere.Radius, minimalMs, minimal.Radius, obbMs);
+
+    printf("BoundingVolumes checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Splits meshes too large for 16 bit indices and checks that the parts draw the same triangles, fit 16 bit indices and
+// keep the cache locality of the optimized mesh; compares the index buffer of a batch with and without splitting.
+static void BenchMeshPartitioner()
+{
+    printf("== MeshPartitioner\n");
+
+    GeometryGenerator geoGen;
+    bool              allPassed = true;
+
+    // Every corner of the parts, in order, at the position of the original corner.
+    auto SameTriangles = [](const MeshData& mesh, const std::vector<MeshData>& parts)
+    {
+        uint32 corner = 0;
+        for (const MeshData& part : parts)
+        {
+            for (uint32 index : part.m_indices32)
+            {
+                if ((corner >= mesh.IndexCount()) || (index >= part.VertexCount()) ||
+                    (memcmp(&part.m_vertices[index], &mesh.m_vertices[mesh.m_indices32[corner]], sizeof(Vertex)) != 0))
+                {
+                    return false;
+                }
+                corner++;
+            }
+        }
+        return corner == mesh.IndexCount();
+    };
+
+    struct Entry
+    {
+        const char* name;
+        MeshData    mesh;
+    };
+    std::vector<Entry> entries;
+    entries.push_back({ "grid 400x400", geoGen.CreateGrid(10.0f, 10.0f, 400, 400) });
+    entries.push_back({ "grid 1000x1000", geoGen.CreateGrid(10.0f, 10.0f, 1000, 1000) });
+    entries.push_back({ "geosphere 7", geoGen.CreateGeoSphere(1.0f, 7) });
+    entries.push_back({ "sphere 64x32", geoGen.CreateSphere(1.0f, 64, 32) });
+
+    for (Entry& entry : entries)
+    {
+        MeshOptimizer::Optimize(entry.mesh);
+
+        std::vector<MeshData> parts;
+        const double splitMs = TimeMs(3, [&]() { parts = MeshPartitioner::Split(entry.mesh); });
+
+        uint32 partVertices = 0;
+        uint32 transformed  = 0;
+        bool   fits         = true;
+        for (const MeshData& part : parts)
+        {
+            const VertexCacheStats stats = MeshOptimizer::AnalyzeVertexCache(part.m_indices32.data(), part.IndexCount(), part.VertexCount());
+            partVertices += part.VertexCount();
+            transformed  += stats.transformedVertices;
+            fits          = fits && (part.VertexCount() <= MeshPartitioner::MaxVertices16);
+        }
+
+        std::vector<uint16> indices16;
+        const bool          has16 = entry.mesh.GetIndices16(indices16);
+
+        const VertexCacheStats whole = MeshOptimizer::AnalyzeVertexCache(entry.mesh.m_indices32.data(), entry.mesh.IndexCount(), entry.mesh.VertexCount());
+        const float            acmr  = float(transformed) / float(entry.mesh.IndexCount() / 3);
+        const bool             same  = SameTriangles(entry.mesh, parts) &&
+                                       (MeshPartitioner::CountParts(entry.mesh) == parts.size());
+        const bool             ok    = fits && same && (acmr <= whole.acmr * 1.01f) &&
+                                       (has16 == (entry.mesh.VertexCount() <= 0x10000)) && (indices16.empty() == (has16 == false));
+        allPassed = allPassed && ok;
+
+        printf("%-15s %8u vertices -> %2u parts, %8u vertices (+%.2f%%), ACMR %.3f -> %.3f, split %7.2f ms, %s\n",
+               entry.name, entry.mesh.VertexCount(), uint32(parts.size()), partVertices,
+               100.0 * (partVertices - entry.mesh.VertexCount()) / entry.mesh.VertexCount(), whole.acmr, acmr, splitMs,
+               ok ? "ok" : "WRONG");
+    }
+
+    // A whole scene with one large mesh: without splitting the whole batch needs 32 bit indices.
+    MeshBatcher whole;
+    MeshBatcher split;
+    for (uint32 i = 0; i < entries.size(); ++i)
+    {
+        whole.Add(entries[i].name, entries[i].mesh);
+        split.AddSplit(entries[i].name, entries[i].mesh);
+    }
+
+    InterleavedLayout layout;
+    layout.stride         = sizeof(Vertex);
+    layout.positionOffset = offsetof(Vertex, m_position);
+
+    std::vector<uint8_t> vertices(size_t(split.VertexCount()) * layout.stride);
+    std::vector<uint8_t> indices(size_t(split.IndexCount()) * split.IndexSize());
+    split.Write(vertices.data(), layout, indices.data());
+
+    // Resolve every corner of the split batch back to a position and compare with the source meshes.
+    bool     batchMatches = (split.IndexSize() == 2) && (whole.IndexSize() == 4) && (split.IndexCount() == whole.IndexCount());
+    uint32   submesh      = 0;
+    for (uint32 i = 0; batchMatches && (i < entries.size()); ++i)
+    {
+        const MeshData& mesh   = entries[i].mesh;
+        uint32          corner = 0;
+        for (uint32 part = 0; part < MeshPartitioner::CountParts(mesh); ++part, ++submesh)
+        {
+            const MeshBatchSubmesh& s = split.Submeshes()[submesh];
+            batchMatches = batchMatches && (s.name == MeshBatcher::PartName(entries[i].name, part));
+            for (uint32 k = 0; batchMatches && (k < s.indexCount); ++k, ++corner)
+            {
+                uint16 index;
+                memcpy(&index, indices.data() + (size_t(s.startIndexLocation) + k) * sizeof(uint16), sizeof(index));
+                const uint8_t* pVertex = vertices.data() + (size_t(s.baseVertexLocation) + index) * layout.stride;
+                batchMatches = (index < s.vertexCount) &&
+                               (memcmp(pVertex, &mesh.m_vertices[mesh.m_indices32[corner]].m_position, sizeof(XMFLOAT3)) == 0);
+            }
+        }
+        batchMatches = batchMatches && (corner == mesh.IndexCount());
+    }
+    allPassed = allPassed && batchMatches;
+
+    printf("scene of %u meshes: %u submeshes after splitting, index buffer %.1f MB with 32 bit indices, %.1f MB split "
+           "with 16 bit indices, %u -> %u vertices, draws match %s\n",
+           uint32(entries.size()), split.SubmeshCount(), whole.IndexCount() * 4.0 / (1024.0 * 1024.0),
+           split.IndexCount() * 2.0 / (1024.0 * 1024.0), whole.VertexCount(), split.VertexCount(), batchMatches ? "yes" : "NO");
+
+    printf("MeshPartitioner checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Checks VertexLayout against hand written per vertex stores and its input elements against the offsets, and compares
+// the per vertex VertexFunc path of the batcher with a per submesh VertexLayout conversion.
+static void BenchVertexLayout()
+{
+    printf("== VertexLayout\n");
+
+    using PackedLayout = VertexLayout<VertexElement<VertexSource::Position, VertexFormat::UShortN4>,
+                                      VertexElement<VertexSource::Color,    VertexFormat::UByteN4>,
+                                      VertexElement<VertexSource::TexC,     VertexFormat::Half2>>;
+    using FloatLayout  = VertexLayout<VertexElement<VertexSource::Position, VertexFormat::Float3>,
+                                      VertexElement<VertexSource::Normal,   VertexFormat::Float3>,
+                                      VertexElement<VertexSource::TexC,     VertexFormat::Float2>>;
+
+    struct PackedVertex16
+    {
+        PackedVector::XMUSHORTN4 pos;
+        PackedVector::XMUBYTEN4  color;
+        PackedVector::XMHALF2    tex;
+    };
+    static_assert(PackedLayout::Stride == sizeof(PackedVertex16), "Stride does not match the struct");
+    static_assert(PackedLayout::Offset<1>() == offsetof(PackedVertex16, color), "Offset does not match the struct");
+    static_assert(PackedLayout::Offset<2>() == offsetof(PackedVertex16, tex), "Offset does not match the struct");
+
+    bool allPassed = true;
+
+    const auto elements = PackedLayout::InputElements(1);
+    const bool elementsOk = (strcmp(elements[0].SemanticName, "POSITION") == 0) &&
+                            (elements[0].Format == DXGI_FORMAT_R16G16B16A16_UNORM) && (elements[0].AlignedByteOffset == 0) &&
+                            (strcmp(elements[1].SemanticName, "COLOR") == 0) &&
+                            (elements[1].Format == DXGI_FORMAT_R8G8B8A8_UNORM) && (elements[1].AlignedByteOffset == 8) &&
+                            (strcmp(elements[2].SemanticName, "TEXCOORD") == 0) &&
+                            (elements[2].Format == DXGI_FORMAT_R16G16_FLOAT) && (elements[2].AlignedByteOffset == 12) &&
+                            (elements[2].InputSlot == 1) && (FloatLayout::Stride == 32) && (FloatLayout::Offset<2>() == 24);
+    allPassed = allPassed && elementsOk;
+    printf("input elements and offsets: %s\n", elementsOk ? "ok" : "WRONG");
+
+    GeometryGenerator geoGen;
+    const MeshData    sphere    = geoGen.CreateGeoSphere(2.0f, 8);
+    const MeshData    grid      = geoGen.CreateGrid(20.0f, 20.0f, 500, 500);
+    const MeshDataSoA sphereSoA = MeshDataSoA::FromAoS(sphere);
+    const uint32      count     = sphere.VertexCount();
+
+    VertexConversion conversion;
+    conversion.quantization = VertexCompression::ComputeQuantization(sphere);
+    conversion.color        = XMFLOAT4(0.5f, 0.25f, 1.0f, 1.0f);
+
+    // Hand written reference, the way the samples wrote their vertices before.
+    std::vector<PackedVertex16> reference(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        const Vertex& v = sphere.m_vertices[i];
+        PackedVector::XMStoreUShortN4(&reference[i].pos, VertexCompression::NormalizePosition(XMLoadFloat3(&v.m_position), conversion.quantization));
+        PackedVector::XMStoreUByteN4(&reference[i].color, XMLoadFloat4(&conversion.color));
+        PackedVector::XMStoreHalf2(&reference[i].tex, XMLoadFloat2(&v.m_texC));
+    }
+
+    std::vector<PackedVertex16> packed(count);
+    std::vector<PackedVertex16> packedSoA(count);
+    const double packedMs    = TimeMs(5, [&]() { PackedLayout::Convert(sphere, packed.data(), conversion); });
+    const double packedSoAMs = TimeMs(5, [&]() { PackedLayout::Convert(sphereSoA, packedSoA.data(), conversion); });
+
+    // The layout multiplies by the reciprocal scale where NormalizePosition() divides, which may round the last unorm16
+    // step differently; everything else has to be bit identical.
+    bool packedOk = (memcmp(packed.data(), packedSoA.data(), count * sizeof(PackedVertex16)) == 0);
+    for (uint32 i = 0; packedOk && (i < count); ++i)
+    {
+        const PackedVertex16& a = packed[i];
+        const PackedVertex16& b = reference[i];
+        packedOk = (abs(int(a.pos.x) - int(b.pos.x)) <= 1) && (abs(int(a.pos.y) - int(b.pos.y)) <= 1) &&
+                   (abs(int(a.pos.z) - int(b.pos.z)) <= 1) && (a.pos.w == b.pos.w) && (memcmp(&a.color, &b.color, sizeof(a.color)) == 0) &&
+                   (a.tex.x == b.tex.x) && (a.tex.y == b.tex.y);
+    }
+    allPassed = allPassed && packedOk;
+
+    std::vector<uint8_t> floats(size_t(count) * FloatLayout::Stride);
+    const double floatMs = TimeMs(5, [&]() { FloatLayout::Convert(sphere, floats.data()); });
+    bool floatOk = true;
+    for (uint32 i = 0; floatOk && (i < count); ++i)
+    {
+        const Vertex&  v       = sphere.m_vertices[i];
+        const uint8_t* pVertex = floats.data() + size_t(i) * FloatLayout::Stride;
+        floatOk = (memcmp(pVertex, &v.m_position, sizeof(XMFLOAT3)) == 0) &&
+                  (memcmp(pVertex + FloatLayout::Offset<1>(), &v.m_normal, sizeof(XMFLOAT3)) == 0) &&
+                  (memcmp(pVertex + FloatLayout::Offset<2>(), &v.m_texC, sizeof(XMFLOAT2)) == 0);
+    }
+    allPassed = allPassed && floatOk;
+
+    printf("geosphere 8, %u vertices: 16 byte layout AoS %6.2f ms, SoA %6.2f ms, %s; 32 byte float layout %6.2f ms, %s\n",
+           count, packedMs, packedSoAMs, packedOk ? "ok" : "WRONG", floatMs, floatOk ? "ok" : "WRONG");
+
+    // The batcher with a std::function call per vertex against one VertexLayout conversion per submesh.
+    MeshBatcher batcher;
+    batcher.Add("sphere", sphere);
+    batcher.Add("grid", grid);
+
+    VertexConversion conversions[2] = { conversion, conversion };
+    conversions[1].quantization = VertexCompression::ComputeQuantization(grid);
+
+    std::vector<PackedVertex16> perVertex(batcher.VertexCount());
+    std::vector<PackedVertex16> perSubmesh(batcher.VertexCount());
+    std::vector<uint8_t>        indices(size_t(batcher.IndexCount()) * batcher.IndexSize());
+
+    const MeshBatcher::VertexFunc writeVertex = [&](uint32 submesh, const Vertex& v, void* pOut) {
+        PackedLayout::Convert(&v, 1, pOut, conversions[submesh]);
+    };
+    const MeshBatcher::ConvertFunc convert = [&](uint32 submesh, const Vertex* pVertices, uint32 vertexCount, void* pOut) {
+        PackedLayout::Convert(pVertices, vertexCount, pOut, conversions[submesh]);
+    };
+
+    const double perVertexMs  = TimeMs(5, [&]() { batcher.Write(perVertex.data(), sizeof(PackedVertex16), writeVertex, indices.data(), 1); });
+    const double perSubmeshMs = TimeMs(5, [&]() { batcher.Write(perSubmesh.data(), PackedLayout::Stride, convert, indices.data(), 1); });
+
+    const bool batchOk = (memcmp(perVertex.data(), perSubmesh.data(), perVertex.size() * sizeof(PackedVertex16)) == 0);
+    allPassed = allPassed && batchOk;
+
+    // The conversion alone, without the indices and the AABBs Write() also writes and computes.
+    const MeshData* sources[2] = { &sphere, &grid };
+    const double    vertexOnlyMs = TimeMs(5, [&]()
+    {
+        for (uint32 submesh = 0; submesh < 2; ++submesh)
+        {
+            const MeshBatchSubmesh& s = batcher.Submeshes()[submesh];
+            for (uint32 i = 0; i < s.vertexCount; ++i)
+            {
+                writeVertex(submesh, sources[submesh]->m_vertices[i], &perVertex[s.baseVertexLocation + i]);
+            }
+        }
+    });
+    const double convertOnlyMs = TimeMs(5, [&]()
+    {
+        for (uint32 submesh = 0; submesh < 2; ++submesh)
+        {
+            const MeshBatchSubmesh& s = batcher.Submeshes()[submesh];
+            convert(submesh, sources[submesh]->m_vertices.data(), s.vertexCount, &perSubmesh[s.baseVertexLocation]);
+        }
+    });
+
+    printf("batch of %u vertices on one thread: VertexFunc %6.2f ms, ConvertFunc %6.2f ms (%.2fx), conversion alone "
+           "%6.2f ms vs %6.2f ms (%.2fx), %s\n",
+           batcher.VertexCount(), perVertexMs, perSubmeshMs, perVertexMs / perSubmeshMs, vertexOnlyMs, convertOnlyMs,
+           vertexOnlyMs / convertOnlyMs, batchOk ? "ok" : "WRONG");
+
+    printf("VertexLayout checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Checks the adjacency of closed and open meshes, the SSE facing test against a scalar one, that the extruded volumes
+// are closed and outward facing, and the ring allocator; then times the shadow volumes of many casters.
+static void BenchShadowVolume()
+{
+    printf("== ShadowVolume\n");
+
+    GeometryGenerator geoGen;
+    bool              allPassed = true;
+
+    MeshAdjacency box;
+    MeshAdjacency sphere;
+    MeshAdjacency grid;
+    box.Build(geoGen.CreateBox(1.0f, 1.0f, 1.0f, 0));
+    sphere.Build(geoGen.CreateGeoSphere(1.0f, 4));
+    grid.Build(MeshDataSoA::FromAoS(geoGen.CreateGrid(4.0f, 4.0f, 10, 10)));
+
+    const bool adjacencyOk = (box.PositionCount() == 8) && (box.FaceCount() == 12) && (box.EdgeCount() == 18) && box.IsClosed() &&
+                             sphere.IsClosed() &&
+                             (sphere.PositionCount() + sphere.FaceCount() == sphere.EdgeCount() + 2) &&
+                             (grid.OpenEdgeCount() == 4 * 9) && (grid.FaceCount() == 2 * 9 * 9);
+    allPassed = allPassed && adjacencyOk;
+    printf("adjacency: box %u positions / %u edges, geosphere 4 %u positions / %u faces / %u edges, grid %u open edges, %s\n",
+           box.PositionCount(), box.EdgeCount(), sphere.PositionCount(), sphere.FaceCount(), sphere.EdgeCount(),
+           grid.OpenEdgeCount(), adjacencyOk ? "ok" : "WRONG");
+
+    // Every directed edge of the volume has to be matched by the reverse edge, and a finite volume has to have a
+    // positive signed volume like the source meshes.
+    auto CheckVolume = [](const std::vector<XMFLOAT4>& vertices, bool finite)
+    {
+        std::map<std::array<uint32, 4>, uint32> ids;
+        auto Id = [&](const XMFLOAT4& v)
+        {
+            std::array<uint32, 4> key;
+            memcpy(key.data(), &v, sizeof(v));
+            return ids.insert(std::make_pair(key, uint32(ids.size()))).first->second;
+        };
+
+        std::map<std::pair<uint32, uint32>, int> edges;
+        double                                   volume = 0.0;
+        for (size_t i = 0; i < vertices.size(); i += 3)
+        {
+            const uint32 t[3] = { Id(vertices[i]), Id(vertices[i + 1]), Id(vertices[i + 2]) };
+            for (uint32 k = 0; k < 3; ++k)
+            {
+                const uint32 a = t[k];
+                const uint32 b = t[(k + 1) % 3];
+                if (a != b)
+                {
+                    edges[std::make_pair(std::min<uint32>(a, b), std::max<uint32>(a, b))] += (a < b) ? 1 : -1;
+                }
+            }
+
+            const XMVECTOR p0 = XMLoadFloat4(&vertices[i]);
+            const XMVECTOR p1 = XMLoadFloat4(&vertices[i + 1]);
+            const XMVECTOR p2 = XMLoadFloat4(&vertices[i + 2]);
+            volume += XMVectorGetX(XMVector3Dot(p0, XMVector3Cross(p1, p2))) / 6.0;
+        }
+
+        bool closed = true;
+        for (const auto& edge : edges)
+        {
+            closed = closed && (edge.second == 0);
+        }
+        return closed && ((finite == false) || (volume > 0.0));
+    };
+
+    struct VolumeCase
+    {
+        const char*          name;
+        const MeshAdjacency* pAdjacency;
+        XMFLOAT4             light;
+        float                extrusion;
+    };
+    const VolumeCase volumeCases[] =
+    {
+        { "box, point light",                &box,    XMFLOAT4(0.7f, 3.0f, -0.4f, 1.0f), 5.0f },
+        { "box, directional light",          &box,    XMFLOAT4(0.3f, 1.0f, 0.2f, 0.0f),  5.0f },
+        { "geosphere, point light",          &sphere, XMFLOAT4(2.0f, 1.5f, -1.0f, 1.0f), 4.0f },
+        { "geosphere, directional light",    &sphere, XMFLOAT4(-0.5f, 1.0f, 0.1f, 0.0f), 4.0f },
+        { "geosphere, point light infinite", &sphere, XMFLOAT4(2.0f, 1.5f, -1.0f, 1.0f), 0.0f },
+        { "grid, point light",               &grid,   XMFLOAT4(0.5f, 2.0f, 0.5f, 1.0f),  3.0f },
+    };
+
+    for (const VolumeCase& volumeCase : volumeCases)
+    {
+        ShadowCaster caster;
+        caster.pAdjacency = volumeCase.pAdjacency;
+        caster.light      = volumeCase.light;
+        ShadowVolume::FindSilhouette(caster);
+
+        // Scalar reference of the SSE facing test.
+        bool facingOk = true;
+        for (uint32 f = 0; f < caster.pAdjacency->FaceCount(); ++f)
+        {
+            float d = 0.0f;
+            for (uint32 c = 0; c < 4; ++c)
+            {
+                d += caster.pAdjacency->PlaneComponents(c)[f] * (&caster.light.x)[c];
+            }
+            facingOk = facingOk && (caster.facing[f] == ((d > 0.0f) ? 1 : 0));
+        }
+
+        ShadowVolumeSettings settings;
+        settings.extrusion = volumeCase.extrusion;
+
+        std::vector<XMFLOAT4> vertices(ShadowVolume::VertexCount(caster, settings));
+        ShadowVolume::Extrude(caster, settings, vertices.data());
+
+        const bool ok = facingOk && (caster.silhouette.empty() == false) && CheckVolume(vertices, settings.extrusion > 0.0f);
+        allPassed = allPassed && ok;
+        printf("%-32s %4u lit faces, %4u silhouette edges, %6u vertices, %s\n", volumeCase.name, caster.litFaceCount,
+               uint32(caster.silhouette.size() / 2), uint32(vertices.size()), ok ? "ok" : "WRONG");
+    }
+
+    // Three frames in flight with random sizes: no allocation may overlap one of a frame that has not retired.
+    {
+        const uint64_t ringSize = 4096;
+        RingAllocator  ring(ringSize);
+        std::deque<std::vector<std::pair<uint64_t, uint64_t>>> inFlight;
+        uint32         seed     = 1;
+        uint32         failures = 0;
+        bool           ringOk   = true;
+
+        for (uint64_t frame = 1; frame <= 10000; ++frame)
+        {
+            std::vector<std::pair<uint64_t, uint64_t>> ranges;
+            const uint32 allocations = 1 + frame % 4;
+            for (uint32 i = 0; i < allocations; ++i)
+            {
+                seed = seed * 1664525u + 1013904223u;
+                const uint64_t size   = 16 + (seed >> 8) % 700;
+                const uint64_t offset = ring.Allocate(size, 16);
+                if (offset == RingAllocator::InvalidOffset)
+                {
+                    failures++;
+                    continue;
+                }
+
+                ringOk = ringOk && (offset % 16 == 0) && (offset + size <= ringSize);
+                for (const auto& previous : inFlight)
+                {
+                    for (const auto& range : previous)
+                    {
+                        ringOk = ringOk && ((offset + size <= range.first) || (range.first + range.second <= offset));
+                    }
+                }
+                for (const auto& range : ranges)
+                {
+                    ringOk = ringOk && ((offset + size <= range.first) || (range.first + range.second <= offset));
+                }
+                ranges.push_back(std::make_pair(offset, size));
+            }
+
+            ring.EndFrame(frame);
+            inFlight.push_back(ranges);
+            if (inFlight.size() > 2)
+            {
+                ring.Retire(frame - 2);
+                inFlight.pop_front();
+            }
+        }
+
+        ring.Retire(UINT64_MAX);
+        ringOk = ringOk && (ring.UsedSize() == 0) && (failures < 10000);
+        allPassed = allPassed && ringOk;
+        printf("ring allocator: 10000 frames, %u allocations did not fit, %s\n", failures, ringOk ? "ok" : "WRONG");
+    }
+
+    // Many casters lit by a point light, as a scene would extrude them every frame. Only the sides, as for depth pass
+    // stenciling: the caps of this many faces would be about ten times the vertices.
+    MeshAdjacency sphere5;
+    sphere5.Build(geoGen.CreateGeoSphere(1.0f, 5));
+
+    const uint32              casterCount = 256;
+    std::vector<ShadowCaster> casters(casterCount);
+    for (uint32 i = 0; i < casterCount; ++i)
+    {
+        casters[i].pAdjacency = (i % 2 == 0) ? &sphere5 : &sphere;
+        casters[i].light      = XMFLOAT4(3.0f * cosf(0.1f * i), 4.0f, 3.0f * sinf(0.1f * i), 1.0f);
+    }
+
+    ShadowVolumeSettings settings;
+    settings.caps      = false;
+    settings.extrusion = 50.0f;
+
+    const uint64_t        ringSize = 64ull * 1024 * 1024;
+    std::vector<XMFLOAT4> ringData(size_t(ringSize / sizeof(XMFLOAT4)));
+    RingAllocator         ring(ringSize);
+    uint64_t              frame    = 0;
+    bool                  fits     = true;
+
+    auto BuildFrame = [&](uint32 maxThreads)
+    {
+        fits = ShadowVolume::Build(casters.data(), casterCount, settings, ring, ringData.data(), maxThreads) && fits;
+        ring.EndFrame(++frame);
+        ring.Retire(frame);
+    };
+
+    const double oneThreadMs  = TimeMs(5, [&]() { BuildFrame(1); });
+    const double allThreadsMs = TimeMs(5, [&]() { BuildFrame(0); });
+
+    uint32 silhouetteEdges = 0;
+    uint32 vertexCount     = 0;
+    uint32 faceCount       = 0;
+    for (const ShadowCaster& caster : casters)
+    {
+        silhouetteEdges += uint32(caster.silhouette.size() / 2);
+        vertexCount     += caster.vertexCount;
+        faceCount       += caster.pAdjacency->FaceCount();
+    }
+
+    // The facing test alone, SSE against a plain loop over the same planes.
+    std::vector<uint8_t> facing(sphere5.FaceCount());
+    const float*         pPlanes[4] = { sphere5.PlaneComponents(0), sphere5.PlaneComponents(1),
+                                        sphere5.PlaneComponents(2), sphere5.PlaneComponents(3) };
+    const XMFLOAT4       light(3.0f, 4.0f, 1.0f, 1.0f);
+    uint32               litCount = 0;
+    const double simdMs   = TimeMs(20, [&]() { litCount = ShadowVolume::ComputeFacing(sphere5, light, facing.data()); });
+    const double scalarMs = TimeMs(20, [&]()
+    {
+        for (uint32 f = 0; f < sphere5.FaceCount(); ++f)
+        {
+            facing[f] = (pPlanes[0][f] * light.x + pPlanes[1][f] * light.y + pPlanes[2][f] * light.z + pPlanes[3][f] * light.w > 0.0f) ? 1 : 0;
+        }
+    });
+
+    allPassed = allPassed && fits && (litCount > 0);
+    printf("%u casters, %u faces: %u silhouette edges, %u vertices (%.1f MB), 1 thread %6.2f ms, %u threads %6.2f ms (%.2fx)\n",
+           casterCount, faceCount, silhouetteEdges, vertexCount, vertexCount * sizeof(XMFLOAT4) / (1024.0 * 1024.0),
+           oneThreadMs, DefaultThreadCount(), allThreadsMs, oneThreadMs / allThreadsMs);
+    printf("facing of %u faces: SSE %.3f ms, scalar %.3f ms (%.2fx)\n", sphere5.FaceCount(), simdMs, scalarMs, scalarMs / simdMs);
+
+    printf("ShadowVolume checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Frustum culling of a million instance spheres scattered around the camera: the SSE2 and AVX2 paths against a scalar
+// reference, with and without gathering the visible instance data the way a draw would. Also checks the extracted
+// planes against the clip space test of points and that culling in ranges gives the same list.
+static void BenchFrustumCulling()
+{
+    printf("== FrustumCulling (%s)\n", FrustumCuller::UsesAvx2() ? "AVX2" : "SSE2");
+
+    bool   allPassed = true;
+    uint32 seed      = 1701;
+
+    auto Random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1 << 24);
+    };
+
+    const XMMATRIX view     = XMMatrixLookAtLH(XMVectorSet(10.0f, 20.0f, -30.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+                                               XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX viewProj = view * XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+    const Frustum  frustum  = Frustum::FromMatrix(viewProj);
+
+    // Points are inside if their clip space position is; the ones too close to a plane to decide are skipped.
+    uint32 planeErrors = 0;
+    for (uint32 i = 0; i < 100000; ++i)
+    {
+        const XMFLOAT3 p(2000.0f * Random() - 1000.0f, 2000.0f * Random() - 1000.0f, 2000.0f * Random() - 1000.0f);
+        XMFLOAT4       clip;
+        XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(p.x, p.y, p.z, 1.0f), viewProj));
+
+        const float margin = 1e-3f * fabsf(clip.w);
+        const float minDistance = min(min(clip.w - fabsf(clip.x), clip.w - fabsf(clip.y)), min(clip.z, clip.w - clip.z));
+        if (fabsf(minDistance) > margin)
+        {
+            planeErrors += (FrustumCuller::IsVisible(frustum, p, 0.0f) != (minDistance > 0.0f)) ? 1 : 0;
+        }
+    }
+    allPassed = allPassed && (planeErrors == 0);
+    printf("planes against clip space: %u of 100000 points wrong\n", planeErrors);
+
+    const uint32   count = 1 << 20;
+    InstanceBounds bounds;
+    bounds.Resize(count + 3);
+    bounds.Resize(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        bounds.Set(i, XMFLOAT3(2000.0f * Random() - 1000.0f, 2000.0f * Random() - 1000.0f, 2000.0f * Random() - 1000.0f),
+                   0.5f + 4.5f * Random());
+    }
+
+    std::vector<uint32> reference;
+    const double scalarMs = TimeMs(5, [&]()
+    {
+        reference.clear();
+        for (uint32 i = 0; i < count; ++i)
+        {
+            if (FrustumCuller::IsVisible(frustum, bounds.Center(i), bounds.Radius(i)))
+            {
+                reference.push_back(i);
+            }
+        }
+    });
+
+    std::vector<uint32> sseVisible(bounds.PaddedCount());
+    std::vector<uint32> avx2Visible(bounds.PaddedCount());
+    uint32 sseCount  = 0;
+    uint32 avx2Count = 0;
+    const double sseMs  = TimeMs(10, [&]() { sseCount = FrustumCuller::Cull(frustum, bounds, 0, count, sseVisible.data(), false); });
+    const double avx2Ms = TimeMs(10, [&]() { avx2Count = FrustumCuller::Cull(frustum, bounds, 0, count, avx2Visible.data(), true); });
+    sseVisible.resize(sseCount);
+    avx2Visible.resize(avx2Count);
+
+    // SSE2 rounds like the reference; FMA may only differ on spheres touching a plane.
+    std::vector<uint32> differences;
+    std::set_symmetric_difference(reference.begin(), reference.end(), avx2Visible.begin(), avx2Visible.end(), std::back_inserter(differences));
+    uint32 avx2Errors = 0;
+    for (uint32 i : differences)
+    {
+        const XMFLOAT3 c = bounds.Center(i);
+        float          d = FLT_MAX;
+        for (const XMFLOAT4& plane : frustum.planes)
+        {
+            d = min(d, plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w + bounds.Radius(i));
+        }
+        avx2Errors += (fabsf(d) > 1e-3f) ? 1 : 0;
+    }
+    const bool cullOk = (sseVisible == reference) && (avx2Errors == 0);
+    allPassed = allPassed && cullOk;
+
+    // Ranges of whole blocks and a partial last one give the same list as one call.
+    std::vector<uint32> ranged(bounds.PaddedCount());
+    uint32 rangedCount = 0;
+    for (uint32 begin = 0; begin < count; begin += 40000)
+    {
+        rangedCount += FrustumCuller::Cull(frustum, bounds, begin, min(begin + 40000, count), ranged.data() + rangedCount, true);
+    }
+    ranged.resize(rangedCount);
+    const bool rangesOk = (ranged == avx2Visible);
+    allPassed = allPassed && rangesOk;
+
+    // The visible instances' data gathered into a buffer, as InstancingCulling does into its upload buffer.
+    struct Instance
+    {
+        XMFLOAT4X4 world;
+        uint32     data[4];
+    };
+    std::vector<Instance> instances(count);
+    std::vector<Instance> gathered(count);
+    std::vector<uint32>   visible(bounds.PaddedCount());
+    const double gatherMs = TimeMs(10, [&]()
+    {
+        const uint32 visibleCount = FrustumCuller::Cull(frustum, bounds, visible.data());
+        for (uint32 i = 0; i < visibleCount; ++i)
+        {
+            gathered[i] = instances[visible[i]];
+        }
+    });
+
+    printf("%u instances, %u visible: scalar %6.2f ms, SSE2 %6.2f ms (%.2fx), AVX2 %6.2f ms (%.2fx, %.1f M instances per ms), %s\n",
+           count, uint32(reference.size()), scalarMs, sseMs, scalarMs / sseMs, avx2Ms, scalarMs / avx2Ms, count / avx2Ms / 1e6,
+           cullOk ? "same as scalar" : "DIFFERENT");
+    printf("culling in ranges %s, cull + gather of %u byte instances %.2f ms\n", rangesOk ? "matches" : "DIFFERS",
+           uint32(sizeof(Instance)), gatherMs);
+
+    printf("FrustumCulling checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// PartitionedCuller on 1 to 16 threads of one pool over 2M instances, each run copying the visible instance data to
+// its final place. Scaling efficiency is the 1 thread time over n times the n thread time; it can not exceed what the
+// hardware threads and the memory bandwidth allow. The merged output has to match the single threaded list.
+static void BenchPartitionedCulling()
+{
+    printf("== PartitionedCulling (%u hardware threads)\n", DefaultThreadCount());
+
+    bool   allPassed = true;
+    uint32 seed      = 2024;
+
+    auto Random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1 << 24);
+    };
+
+    const XMMATRIX view     = XMMatrixLookAtLH(XMVectorSet(10.0f, 20.0f, -30.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+                                               XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const Frustum  frustum  = Frustum::FromMatrix(view * XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f));
+
+    const uint32   count = 2 << 20;
+    InstanceBounds bounds;
+    bounds.Resize(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        bounds.Set(i, XMFLOAT3(2000.0f * Random() - 1000.0f, 2000.0f * Random() - 1000.0f, 2000.0f * Random() - 1000.0f),
+                   0.5f + 4.5f * Random());
+    }
+
+    std::vector<uint32> reference(bounds.PaddedCount());
+    reference.resize(FrustumCuller::Cull(frustum, bounds, reference.data()));
+
+    struct Instance
+    {
+        XMFLOAT4X4 world;
+        uint32     index;
+        uint32     padding[3];
+    };
+    std::vector<Instance> instances(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        instances[i].index = i;
+    }
+
+    WorkerPool            pool(16);
+    PartitionedCuller     culler;
+    std::vector<Instance> output(count);
+    uint32                visibleCount = 0;
+    double                oneThreadMs  = 0.0;
+
+    for (uint32 threads : { 1u, 2u, 4u, 8u, 16u })
+    {
+        const double ms = TimeMs(10, [&]()
+        {
+            visibleCount = culler.Cull(frustum, bounds, pool, threads, [&](const uint32* pIndices, uint32 n, uint32 offset)
+            {
+                for (uint32 i = 0; i < n; ++i)
+                {
+                    output[offset + i] = instances[pIndices[i]];
+                }
+            });
+        });
+        oneThreadMs = (threads == 1) ? ms : oneThreadMs;
+
+        bool same = (visibleCount == reference.size());
+        for (uint32 i = 0; same && (i < visibleCount); ++i)
+        {
+            same = (output[i].index == reference[i]);
+        }
+        allPassed = allPassed && same;
+
+        printf("%2u threads: %6.2f ms, %5.1f M instances per ms, %.2fx, efficiency %3.0f%%, %u visible %s\n",
+               threads, ms, count / ms / 1e6, oneThreadMs / ms, 100.0 * oneThreadMs / (threads * ms), visibleCount,
+               same ? "(same as 1 thread list)" : "(DIFFERENT)");
+    }
+
+    printf("PartitionedCulling checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Hierarchical against flat culling of a static city like scene (instances spread over a 4 km square, 50 m high) for
+// a street level camera that sees a small part of it and a high camera that sees a large part. The BVH has to find the
+// same visible set as the flat SIMD cull; the order differs, so both are sorted before comparing.
+static void BenchInstanceBvh()
+{
+    printf("== InstanceBvh (%u hardware threads)\n", DefaultThreadCount());
+
+    bool   allPassed = true;
+    uint32 seed      = 31337;
+
+    auto Random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1 << 24);
+    };
+
+    const XMMATRIX proj      = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+    const XMMATRIX streetCam = XMMatrixLookAtLH(XMVectorSet(0.0f, 20.0f, 0.0f, 1.0f), XMVectorSet(100.0f, 10.0f, 30.0f, 1.0f),
+                                                XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX highCam   = XMMatrixLookAtLH(XMVectorSet(-2500.0f, 1500.0f, -2500.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+                                                XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX highProj  = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 5000.0f);
+    const Frustum  frustums[2] = { Frustum::FromMatrix(streetCam * proj), Frustum::FromMatrix(highCam * highProj) };
+    const char*    names[2]    = { "street", "high" };
+
+    for (uint32 count : { 100000u, 1000000u })
+    {
+        InstanceBounds bounds;
+        bounds.Resize(count);
+        for (uint32 i = 0; i < count; ++i)
+        {
+            bounds.Set(i, XMFLOAT3(4000.0f * Random() - 2000.0f, 50.0f * Random(), 4000.0f * Random() - 2000.0f), 1.0f + 4.0f * Random());
+        }
+
+        InstanceBvh bvh;
+        const double buildMs         = TimeMs(3, [&]() { bvh.Build(bounds, 1); });
+        const double threadedBuildMs = TimeMs(3, [&]() { bvh.Build(bounds, 0); });
+
+        // Every instance exactly once, and every node's box around its instances.
+        std::vector<uint32> sortedInstances = bvh.Instances();
+        std::sort(sortedInstances.begin(), sortedInstances.end());
+        bool treeOk = (bvh.Nodes()[0].instanceCount == count);
+        for (uint32 i = 0; treeOk && (i < count); ++i)
+        {
+            treeOk = (sortedInstances[i] == i);
+        }
+
+        std::vector<std::pair<uint32, uint32>> stack(1, std::make_pair(0u, 0u));
+        while (treeOk && (stack.empty() == false))
+        {
+            const uint32           n     = stack.back().first;
+            const uint32           first = stack.back().second;
+            const InstanceBvhNode& node  = bvh.Nodes()[n];
+            stack.pop_back();
+
+            for (uint32 i = first; treeOk && (i < first + node.instanceCount); ++i)
+            {
+                const uint32   instance = bvh.Instances()[i];
+                const XMFLOAT3 c        = bounds.Center(instance);
+                const float    r        = bounds.Radius(instance) - 1e-3f;
+                treeOk = (fabsf(c.x - node.center.x) + r <= node.extents.x) && (fabsf(c.y - node.center.y) + r <= node.extents.y) &&
+                         (fabsf(c.z - node.center.z) + r <= node.extents.z);
+            }
+            if (node.rightChild != 0)
+            {
+                treeOk = treeOk && (bvh.Nodes()[n + 1].instanceCount + bvh.Nodes()[n + node.rightChild].instanceCount == node.instanceCount);
+                stack.push_back(std::make_pair(n + 1, first));
+                stack.push_back(std::make_pair(n + node.rightChild, first + bvh.Nodes()[n + 1].instanceCount));
+            }
+        }
+        allPassed = allPassed && treeOk;
+        printf("%7u instances: %u nodes (%.1f MB), build 1 thread %6.2f ms, %u threads %6.2f ms, tree %s\n", count,
+               bvh.NodeCount(), bvh.NodeCount() * sizeof(InstanceBvhNode) / (1024.0 * 1024.0), buildMs, DefaultThreadCount(),
+               threadedBuildMs, treeOk ? "ok" : "WRONG");
+
+        std::vector<uint32> flat(bounds.PaddedCount());
+        std::vector<uint32> hierarchical(count);
+        for (uint32 f = 0; f < 2; ++f)
+        {
+            uint32 flatCount = 0;
+            uint32 bvhCount  = 0;
+            const double flatMs = TimeMs(10, [&]() { flatCount = FrustumCuller::Cull(frustums[f], bounds, flat.data()); });
+            const double bvhMs  = TimeMs(10, [&]() { bvhCount = bvh.Cull(frustums[f], hierarchical.data()); });
+
+            // Spheres may only differ where they touch a plane, as the two round differently.
+            std::vector<uint32> a(flat.begin(), flat.begin() + flatCount);
+            std::vector<uint32> b(hierarchical.begin(), hierarchical.begin() + bvhCount);
+            std::sort(b.begin(), b.end());
+            std::vector<uint32> differences;
+            std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(differences));
+
+            uint32 errors = (std::adjacent_find(b.begin(), b.end()) != b.end()) ? 1 : 0;
+            for (uint32 i : differences)
+            {
+                const XMFLOAT3 c = bounds.Center(i);
+                float          d = FLT_MAX;
+                for (const XMFLOAT4& plane : frustums[f].planes)
+                {
+                    d = min(d, plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w + bounds.Radius(i));
+                }
+                errors += (fabsf(d) > 1e-3f) ? 1 : 0;
+            }
+            allPassed = allPassed && (errors == 0);
+
+            printf("  %-6s camera: %7u visible, flat %s %6.3f ms, BVH %6.3f ms (%5.2fx), %s\n", names[f], bvhCount,
+                   FrustumCuller::UsesAvx2() ? "AVX2" : "SSE2", flatMs, bvhMs, flatMs / bvhMs,
+                   (errors == 0) ? "same set" : "DIFFERENT");
+        }
+    }
+
+    printf("InstanceBvh checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Masked occlusion culling of a lattice of boxes behind a wall over a terrain grid:
+// - the buffer against a per pixel reference rasterizer: it may only be farther (conservative) and should be close;
+// - box tests against the reference: a culled box has to be hidden at every pixel it covers;
+// - rasterization and culling times on 1 to all threads of a pool, and the same result on every thread count.
+static void BenchOcclusionCulling()
+{
+    printf("== OcclusionCulling (%u hardware threads)\n", DefaultThreadCount());
+
+    GeometryGenerator geoGen;
+    bool              allPassed = true;
+    const uint32      width     = 320;
+    const uint32      height    = 192;
+
+    const MeshData boxMesh     = geoGen.CreateBox(2.0f, 2.0f, 2.0f, 0);
+    const MeshData wallMesh    = geoGen.CreateBox(60.0f, 12.0f, 1.0f, 0);
+    const MeshData terrainMesh = geoGen.CreateGrid(400.0f, 400.0f, 256, 256);
+
+    // Terrain, a wall in front of the camera and a 20 x 5 x 20 lattice of boxes behind it.
+    std::vector<XMFLOAT4X4> boxWorlds;
+    std::vector<BoundingBox> boxBounds;
+    for (uint32 x = 0; x < 20; ++x)
+    {
+        for (uint32 y = 0; y < 5; ++y)
+        {
+            for (uint32 z = 0; z < 20; ++z)
+            {
+                const XMFLOAT3 center(-47.5f + 5.0f * x, 1.0f + 5.0f * y, 20.0f + 5.0f * z);
+                XMFLOAT4X4     world;
+                XMStoreFloat4x4(&world, XMMatrixTranslation(center.x, center.y, center.z));
+                boxWorlds.push_back(world);
+                boxBounds.push_back(BoundingBox(center, XMFLOAT3(1.0f, 1.0f, 1.0f)));
+            }
+        }
+    }
+    const uint32 boxCount = uint32(boxBounds.size());
+
+    const XMMATRIX view     = XMMatrixLookAtLH(XMVectorSet(0.0f, 4.0f, -40.0f, 1.0f), XMVectorSet(0.0f, 4.0f, 0.0f, 1.0f),
+                                               XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+    const XMMATRIX viewProj = view * XMMatrixPerspectiveFovLH(0.25f * XM_PI, float(width) / float(height), 1.0f, 1000.0f);
+    const XMMATRIX wallWorld    = XMMatrixTranslation(0.0f, 6.0f, 5.0f);
+    const XMMATRIX terrainWorld = XMMatrixTranslation(0.0f, -0.5f, 100.0f);
+
+    auto AddOccluders = [&](OcclusionCuller& culler, bool boxes)
+    {
+        culler.BeginFrame();
+        culler.AddOccluder(&terrainMesh.m_vertices[0].m_position, sizeof(Vertex), terrainMesh.m_indices32.data(),
+                           uint32(terrainMesh.m_indices32.size()), terrainWorld);
+        culler.AddOccluder(&wallMesh.m_vertices[0].m_position, sizeof(Vertex), wallMesh.m_indices32.data(),
+                           uint32(wallMesh.m_indices32.size()), wallWorld);
+        for (uint32 i = 0; boxes && (i < boxCount); ++i)
+        {
+            culler.AddOccluder(&boxMesh.m_vertices[0].m_position, sizeof(Vertex), boxMesh.m_indices32.data(),
+                               uint32(boxMesh.m_indices32.size()), XMLoadFloat4x4(&boxWorlds[i]));
+        }
+    };
+
+    // Reference: nearest depth at every pixel center over all front facing triangles, none of which crosses the near
+    // plane here.
+    std::vector<float> reference(width * height, 1.0f);
+    auto Reference = [&](const MeshData& mesh, FXMMATRIX world)
+    {
+        const XMMATRIX m = world * viewProj;
+        for (size_t t = 0; t < mesh.m_indices32.size(); t += 3)
+        {
+            float x[3];
+            float y[3];
+            float z[3];
+            for (uint32 i = 0; i < 3; ++i)
+            {
+                XMFLOAT4 clip;
+                XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&mesh.m_vertices[mesh.m_indices32[t + i]].m_position), m));
+                x[i] = (clip.x / clip.w * 0.5f + 0.5f) * width;
+                y[i] = (0.5f - clip.y / clip.w * 0.5f) * height;
+                z[i] = clip.z / clip.w;
+            }
+            const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+            if (area <= 0.0f)
+            {
+                continue;
+            }
+            const int x0 = max(0, int(floorf(min(x[0], min(x[1], x[2])))));
+            const int x1 = min(int(width) - 1, int(ceilf(max(x[0], max(x[1], x[2])))));
+            const int y0 = max(0, int(floorf(min(y[0], min(y[1], y[2])))));
+            const int y1 = min(int(height) - 1, int(ceilf(max(y[0], max(y[1], y[2])))));
+            for (int py = y0; py <= y1; ++py)
+            {
+                for (int px = x0; px <= x1; ++px)
+                {
+                    const float cx = px + 0.5f;
+                    const float cy = py + 0.5f;
+                    const float w0 = (x[2] - x[1]) * (cy - y[1]) - (y[2] - y[1]) * (cx - x[1]);
+                    const float w1 = (x[0] - x[2]) * (cy - y[2]) - (y[0] - y[2]) * (cx - x[2]);
+                    const float w2 = (x[1] - x[0]) * (cy - y[0]) - (y[1] - y[0]) * (cx - x[0]);
+                    if ((w0 >= 0.0f) && (w1 >= 0.0f) && (w2 >= 0.0f))
+                    {
+                        float& depth = reference[py * width + px];
+                        depth = min(depth, (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area);
+                    }
+                }
+            }
+        }
+    };
+    Reference(terrainMesh, terrainWorld);
+    Reference(wallMesh, wallWorld);
+    for (uint32 i = 0; i < boxCount; ++i)
+    {
+        Reference(boxMesh, XMLoadFloat4x4(&boxWorlds[i]));
+    }
+
+    WorkerPool      pool;
+    OcclusionCuller culler;
+    culler.Resize(width, height);
+    AddOccluders(culler, true);
+    culler.Rasterize(viewProj, pool);
+
+    // Conservative up to the rounding of the depth plane; pixels only the reference covers are edge ties.
+    uint32 violations = 0;
+    uint32 covered    = 0;
+    double slack      = 0.0;
+    for (uint32 y = 0; y < height; ++y)
+    {
+        for (uint32 x = 0; x < width; ++x)
+        {
+            const float depth = culler.PixelDepth(x, y);
+            const float ref   = reference[y * width + x];
+            violations += (depth < ref - 1e-5f) ? 1 : 0;
+            covered    += (depth < 1.0f) ? 1 : 0;
+            slack      += depth - ref;
+        }
+    }
+    allPassed = allPassed && (violations == 0);
+    printf("%ux%u buffer: %.1f%% of pixels covered, mean depth above reference %.2e, %u pixels in front of it\n",
+           width, height, 100.0 * covered / (width * height), slack / (width * height), violations);
+
+    // Every box: culled ones have to be hidden at each pixel they touch.
+    std::vector<uint32> candidates(boxCount);
+    for (uint32 i = 0; i < boxCount; ++i)
+    {
+        candidates[i] = i;
+    }
+    std::vector<uint32> visible(boxCount);
+    const uint32 visibleCount = culler.Cull(boxBounds.data(), candidates.data(), boxCount, visible.data(), pool);
+
+    uint32 wrongCulls  = 0;
+    uint32 hiddenKept  = 0;
+    std::vector<bool> isVisible(boxCount, false);
+    for (uint32 i = 0; i < visibleCount; ++i)
+    {
+        isVisible[visible[i]] = true;
+    }
+    for (uint32 i = 0; i < boxCount; ++i)
+    {
+        // The box's screen rectangle and nearest depth, as IsVisible() computes them.
+        float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, minDepth = FLT_MAX;
+        for (uint32 c = 0; c < 8; ++c)
+        {
+            const BoundingBox& b = boxBounds[i];
+            XMFLOAT4 clip;
+            XMStoreFloat4(&clip, XMVector3Transform(XMVectorSet(b.Center.x + ((c & 1) ? b.Extents.x : -b.Extents.x),
+                                                                b.Center.y + ((c & 2) ? b.Extents.y : -b.Extents.y),
+                                                                b.Center.z + ((c & 4) ? b.Extents.z : -b.Extents.z), 1.0f), viewProj));
+            minX     = min(minX, (clip.x / clip.w * 0.5f + 0.5f) * width);
+            maxX     = max(maxX, (clip.x / clip.w * 0.5f + 0.5f) * width);
+            minY     = min(minY, (0.5f - clip.y / clip.w * 0.5f) * height);
+            maxY     = max(maxY, (0.5f - clip.y / clip.w * 0.5f) * height);
+            minDepth = min(minDepth, clip.z / clip.w);
+        }
+
+        bool hidden = true;
+        for (int y = max(0, int(minY)); hidden && (y < min(int(height), int(ceilf(maxY)))); ++y)
+        {
+            for (int x = max(0, int(minX)); hidden && (x < min(int(width), int(ceilf(maxX)))); ++x)
+            {
+                hidden = (reference[y * width + x] < minDepth - 1e-5f);
+            }
+        }
+        wrongCulls += (isVisible[i] == false) && (hidden == false) ? 1 : 0;
+        hiddenKept += isVisible[i] && hidden ? 1 : 0;
+    }
+    allPassed = allPassed && (wrongCulls == 0) && (visibleCount < boxCount);
+    printf("%u boxes: %u culled (%u wrongly), %u hidden at every pixel but kept\n", boxCount, boxCount - visibleCount,
+           wrongCulls, hiddenKept);
+
+    // The same candidates in ranges of growing length, some empty, crossing the chunk boundaries.
+    std::vector<VisibleRange> ranges;
+    for (uint32 begin = 0, length = 0; begin < boxCount; begin += length, length = (length * 3 + 1) % 700)
+    {
+        ranges.push_back({ candidates.data() + begin, std::min<uint32>(length, boxCount - begin) });
+    }
+    std::vector<uint32> rangeVisible(boxCount);
+    const uint32 rangeCount = culler.Cull(boxBounds.data(), ranges.data(), uint32(ranges.size()), rangeVisible.data(), pool);
+    const bool   rangesSame = (rangeCount == visibleCount) &&
+                              std::equal(visible.begin(), visible.begin() + visibleCount, rangeVisible.begin());
+    allPassed = allPassed && rangesSame;
+    printf("%u candidate ranges: %s\n", uint32(ranges.size()), rangesSame ? "same boxes kept" : "DIFFERENT boxes kept");
+
+    // Timing and thread count independence; the boxes are tested 50 times over to get a measurable load.
+    std::vector<uint32> manyCandidates(boxCount * 50);
+    for (uint32 i = 0; i < manyCandidates.size(); ++i)
+    {
+        manyCandidates[i] = i % boxCount;
+    }
+    std::vector<uint32> manyVisible(manyCandidates.size());
+    std::vector<float>  depths(width * height);
+    for (uint32 y = 0; y < height; ++y)
+    {
+        for (uint32 x = 0; x < width; ++x)
+        {
+            depths[y * width + x] = culler.PixelDepth(x, y);
+        }
+    }
+
+    uint32 oneThreadVisible = 0;
+    for (uint32 threads : { 1u, 2u, 4u, 0u })
+    {
+        OcclusionStats stats;
+        const double rasterizeMs = TimeMs(5, [&]()
+        {
+            AddOccluders(culler, true);
+            culler.Rasterize(viewProj, pool, threads);
+        });
+        uint32 kept = 0;
+        const double cullMs = TimeMs(5, [&]()
+        {
+            kept  = culler.Cull(boxBounds.data(), manyCandidates.data(), uint32(manyCandidates.size()), manyVisible.data(), pool, threads);
+            stats = culler.Stats();
+        });
+
+        bool same = (threads == 1) || (kept == oneThreadVisible);
+        for (uint32 y = 0; same && (y < height); ++y)
+        {
+            for (uint32 x = 0; same && (x < width); ++x)
+            {
+                same = (culler.PixelDepth(x, y) == depths[y * width + x]);
+            }
+        }
+        oneThreadVisible = (threads == 1) ? kept : oneThreadVisible;
+        allPassed        = allPassed && same;
+
+        printf("%2u threads: rasterize %u of %u triangles %6.2f ms, test %u boxes %6.2f ms (%u occluded), %s\n",
+               (threads == 0) ? pool.ThreadCount() : threads, stats.rasterizedTriangles, stats.occluderTriangles, rasterizeMs,
+               stats.testedBoxes, cullMs, stats.occludedBoxes, same ? "same result" : "DIFFERENT RESULT");
+    }
+
+    printf("OcclusionCulling checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+// Coherent BVH culling along camera paths: every frame against a fresh InstanceBvh::Cull() (same set up to spheres
+// touching a plane), and the average cost per frame of both, refreshes included. The walk moves at about the speed of
+// the samples' camera at 60 fps, the turn also yaws by a quarter degree a frame, the jumps place the camera anywhere
+// every frame.
+static void BenchCoherentCulling()
+{
+    printf("== CoherentCulling\n");
+
+    bool   allPassed = true;
+    uint32 seed      = 4242;
+
+    auto Random = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return float(seed >> 8) / float(1 << 24);
+    };
+
+    const uint32   count  = 1000000;
+    const uint32   frames = 256;
+    InstanceBounds bounds;
+    bounds.Resize(count);
+    for (uint32 i = 0; i < count; ++i)
+    {
+        bounds.Set(i, XMFLOAT3(4000.0f * Random() - 2000.0f, 50.0f * Random(), 4000.0f * Random() - 2000.0f), 1.0f + 4.0f * Random());
+    }
+    InstanceBvh bvh;
+    bvh.Build(bounds);
+
+    const XMMATRIX          proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 1000.0f);
+    const XMVECTOR          up   = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+    std::vector<XMFLOAT4X4> walk(frames);
+    std::vector<XMFLOAT4X4> turn(frames);
+    std::vector<XMFLOAT4X4> jumps(frames);
+    for (uint32 f = 0; f < frames; ++f)
+    {
+        const XMVECTOR eye = XMVectorSet(0.17f * f * cosf(0.5f), 20.0f, 0.17f * f * sinf(0.5f), 1.0f);
+        const float    yaw = 0.5f + 0.004f * f;
+        XMStoreFloat4x4(&walk[f], XMMatrixLookAtLH(eye, eye + XMVectorSet(cosf(0.5f), -0.1f, sinf(0.5f), 0.0f), up) * proj);
+        XMStoreFloat4x4(&turn[f], XMMatrixLookAtLH(eye, eye + XMVectorSet(cosf(yaw), -0.1f, sinf(yaw), 0.0f), up) * proj);
+
+        const XMVECTOR jumpEye = XMVectorSet(4000.0f * Random() - 2000.0f, 20.0f, 4000.0f * Random() - 2000.0f, 1.0f);
+        const float    jumpYaw = 2.0f * XM_PI * Random();
+        XMStoreFloat4x4(&jumps[f], XMMatrixLookAtLH(jumpEye, jumpEye + XMVectorSet(cosf(jumpYaw), -0.1f, sinf(jumpYaw), 0.0f), up) * proj);
+    }
+
+    std::vector<uint32> fresh(count);
+    for (const auto& path : { std::make_pair("walk", &walk), std::make_pair("turn", &turn), std::make_pair("jumps", &jumps) })
+    {
+        const std::vector<XMFLOAT4X4>& cameras = *path.second;
+
+        // Correctness and reuse over the whole path.
+        CoherentCuller culler;
+        culler.Reset(bvh);
+        uint64_t testedNodes = 0;
+        uint64_t reusedNodes = 0;
+        uint64_t frontier    = 0;
+        uint32   fullFrames  = 0;
+        uint32   fallbacks   = 0;
+        uint64_t ranges      = 0;
+        uint64_t visible     = 0;
+        uint32   errors      = 0;
+        for (uint32 f = 0; f < frames; ++f)
+        {
+            const XMMATRIX viewProj     = XMLoadFloat4x4(&cameras[f]);
+            const Frustum  frustum      = Frustum::FromMatrix(viewProj);
+            const uint32   coherentCount = culler.Cull(viewProj);
+            const uint32   freshCount    = bvh.Cull(frustum, fresh.data());
+            testedNodes += culler.Stats().testedNodes;
+            reusedNodes += culler.Stats().reusedNodes;
+            frontier    += culler.Stats().frontierNodes;
+            fullFrames  += culler.Stats().fullRefresh ? 1 : 0;
+            fallbacks   += culler.Stats().fallback ? 1 : 0;
+            ranges      += culler.Stats().ranges;
+            visible     += coherentCount;
+
+            std::vector<uint32> a(fresh.begin(), fresh.begin() + freshCount);
+            std::vector<uint32> b(coherentCount);
+            culler.CopyVisible(b.data());
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            std::vector<uint32> differences;
+            std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(differences));
+
+            errors += (std::adjacent_find(b.begin(), b.end()) != b.end()) ? 1 : 0;
+            for (uint32 i : differences)
+            {
+                const XMFLOAT3 c = bounds.Center(i);
+                float          d = FLT_MAX;
+                for (const XMFLOAT4& plane : frustum.planes)
+                {
+                    d = min(d, plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w + bounds.Radius(i));
+                }
+                errors += (fabsf(d) > 1e-3f) ? 1 : 0;
+            }
+        }
+        allPassed = allPassed && (errors == 0);
+
+        // The three timings take turns, so that changes of the machine's clock affect them alike. Invalidate() starts
+        // each coherent run from the root like Reset(), without timing the allocations.
+        double fullMs     = 1e30;
+        double coherentMs = 1e30;
+        double copiedMs   = 1e30;
+        for (uint32 run = 0; run < 7; ++run)
+        {
+            fullMs = min(fullMs, TimeMs(1, [&]()
+            {
+                for (uint32 f = 0; f < frames; ++f)
+                {
+                    bvh.Cull(Frustum::FromMatrix(XMLoadFloat4x4(&cameras[f])), fresh.data());
+                }
+            }) / frames);
+            coherentMs = min(coherentMs, TimeMs(1, [&]()
+            {
+                culler.Invalidate();
+                for (uint32 f = 0; f < frames; ++f)
+                {
+                    culler.Cull(XMLoadFloat4x4(&cameras[f]));
+                }
+            }) / frames);
+
+            // With the ranges copied to one array, as InstanceBvh::Cull() returns them.
+            copiedMs = min(copiedMs, TimeMs(1, [&]()
+            {
+                culler.Invalidate();
+                for (uint32 f = 0; f < frames; ++f)
+                {
+                    culler.Cull(XMLoadFloat4x4(&cameras[f]));
+                    culler.CopyVisible(fresh.data());
+                }
+            }) / frames);
+        }
+
+        printf("%-5s %u frames (%3u from the root, %3u without a frontier), %u instances: %6.0f visible in %5.0f ranges, "
+               "frontier %5.0f nodes (%5.0f reused, %5.0f tested) per frame, BVH %6.3f ms, coherent %6.3f ms (%5.1f%%), "
+               "copied to one array %6.3f ms (%5.1f%%), %s\n", path.first, frames, fullFrames, fallbacks, count,
+               double(visible) / frames, double(ranges) / frames, double(frontier) / frames, double(reusedNodes) / frames,
+               double(testedNodes) / frames, fullMs, coherentMs, 100.0 * coherentMs / fullMs, copiedMs,
+               100.0 * copiedMs / fullMs, (errors == 0) ? "same sets" : "DIFFERENT");
+    }
+
+    printf("CoherentCulling checks: %s\n", allPassed ? "all passed" : "FAILED");
+}
+
+// ====================================================================================================================
+int main()
+{
+    BenchGeometryGenerator();
+    BenchMeshOptimizer();
+    BenchMeshlets();
+    BenchMeshSimplifier();
+    BenchVertexCompression();
+    BenchIndexCodec();
+    BenchWriteInPlace();
+    BenchHeightfield();
+    BenchCdlodTerrain();
+    BenchHeightmapStreaming();
+    BenchMeshBatcher();
+    BenchMeshWelder();
+    BenchTangentGenerator();
+    BenchMeshFile();
+    BenchBoundingVolumes();
+    BenchMeshPartitioner();
+    BenchVertexLayout();
+    BenchShadowVolume();
+    BenchFrustumCulling();
+    BenchPartitionedCulling();
+    BenchInstanceBvh();
+    BenchOcclusionCulling();
+    BenchCoherentCulling();
+    return 0;
+}
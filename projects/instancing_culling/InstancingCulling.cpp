@@ -5,6 +5,7 @@ Instancing and frustum culling demo.
 
 */
 #include <array>
+#include <cstdio>
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -14,11 +15,19 @@ Instancing and frustum culling demo.
 #include "BaseUtil.h"
 #include "BaseTimer.h"
 #include "UploadBuffer.h"
+#include "../common/CoherentCulling.h"
+#include "../common/FrustumCulling.h"
 #include "../common/GeometryGenerator.h"
+#include "../common/InstanceBvh.h"
+#include "../common/MeshBatcher.h"
+#include "../common/OcclusionCulling.h"
+#include "../common/VertexCompression.h"
+#include "../common/VertexLayout.h"
 #include "../common/d3dx12.h"
 
 using namespace std;
 using namespace DirectX;
+using namespace DirectX::PackedVector;
 using Microsoft::WRL::ComPtr;
 using uint = UINT;
 
@@ -26,11 +35,10 @@ using uint = UINT;
 #pragma comment (lib, "D3D12.lib")
 
 // ======================================================================
-struct ShaderVertex {
-    DirectX::XMFLOAT3 pos;
-    DirectX::XMFLOAT4 color;
-    DirectX::XMFLOAT2 tex;
-};
+// 16 bytes: position is unorm16 relative to the object's bounds, see ShaderPerObjectData.
+using ShaderVertexLayout = VertexLayout<VertexElement<VertexSource::Position, VertexFormat::UShortN4>,
+                                        VertexElement<VertexSource::Color,    VertexFormat::UByteN4>,
+                                        VertexElement<VertexSource::TexC,     VertexFormat::Half2>>;
 
 struct SceneConstants {
     XMFLOAT4X4 viewMatrix = MathHelper::Identity4x4();
@@ -50,10 +58,10 @@ struct ShaderMaterialData {
 };
 
 struct ShaderPerObjectData {
+    XMFLOAT3 positionOffset; // VertexQuantization of the object's vertices
     uint materialIndex;
+    XMFLOAT3 positionScale;
     uint padding0;
-    uint padding1;
-    uint padding2;
 };
 
 // ======================================================================
@@ -284,7 +292,7 @@ protected:
         uint objCBByteSize = BaseUtil::CalcConstantBufferByteSize(sizeof(ShaderPerObjectData));
         m_commandList->SetGraphicsRootConstantBufferView(1, mObjectBuffer->Resource()->GetGPUVirtualAddress() + objCBByteSize);
         const auto& boxDrawArgs = mGeometries["scene"]->drawArgs["box"];
-        m_commandList->DrawIndexedInstanced(boxDrawArgs.indexCount, static_cast<UINT>(mBoxInstances.size()), boxDrawArgs.startIndexLocation, boxDrawArgs.baseVertexLocation, 0);
+        m_commandList->DrawIndexedInstanced(boxDrawArgs.indexCount, mVisibleInstanceCount, boxDrawArgs.startIndexLocation, boxDrawArgs.baseVertexLocation, 0);
         m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
         ThrowIfFailed(m_commandList->Close());
         ID3D12CommandList* cmdsLists[] = { m_commandList.Get() };
@@ -307,6 +315,8 @@ protected:
         XMStoreFloat4x4(&vpMatrix.viewMatrix, XMMatrixTranspose(view));
         XMStoreFloat4x4(&vpMatrix.projMatrix, XMMatrixTranspose(proj));
         mSceneConstants->CopyData(0, vpMatrix);
+        CullInstances(view * proj);
+        ShowOcclusionStats(gt);
         if ((m_currentFence != 0) && (m_fence->GetCompletedValue() < m_currentFence)) {
             HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
             ThrowIfFailed(m_fence->SetEventOnCompletion(m_currentFence, eventHandle));
@@ -314,6 +324,37 @@ protected:
             CloseHandle(eventHandle);
         }
     }
+    // Only the instances whose sphere intersects the frustum go into the instance buffer, packed at its start. The
+    // boxes never move, so they are culled through a BVH built once, and only the nodes the camera's motion since the
+    // last frames may have moved across a plane are tested again. The boxes are also the occluders: they are drawn
+    // into a small software depth buffer and the frustum culled ones hidden behind others are dropped as well. The
+    // previous frame is complete (Draw() flushes the queue), so the buffer can be rewritten.
+    void CullInstances(FXMMATRIX viewProj) {
+        mCoherentCuller.Cull(viewProj);
+        mOcclusionCuller.BeginFrame();
+        for (uint i = 0; i < mBoxInstances.size(); i++) {
+            mOcclusionCuller.AddOccluder(&mOccluderBox.m_vertices[0].m_position, sizeof(Vertex), mOccluderBox.m_indices32.data(),
+                                         static_cast<uint32>(mOccluderBox.m_indices32.size()), XMMatrixTranspose(XMLoadFloat4x4(&mBoxInstances[i].worldMatrix)));
+        }
+        mOcclusionCuller.Rasterize(viewProj, mWorkerPool);
+        mVisibleInstanceCount = mOcclusionCuller.Cull(mBoxBounds.data(), mCoherentCuller.VisibleRanges().data(),
+                                                      static_cast<uint32>(mCoherentCuller.VisibleRanges().size()), mVisibleInstances.data(), mWorkerPool);
+        for (uint i = 0; i < mVisibleInstanceCount; i++) {
+            mInstDataBuffer->CopyData(i, mBoxInstances[mVisibleInstances[i]]);
+        }
+    }
+    // Occlusion culling statistics in the window title, twice a second.
+    void ShowOcclusionStats(const BaseTimer& gt) {
+        if (gt.TotalTimeInSecs() - mLastStatsTime < 0.5f) {
+            return;
+        }
+        mLastStatsTime = gt.TotalTimeInSecs();
+        const OcclusionStats& stats = mOcclusionCuller.Stats();
+        char title[256];
+        snprintf(title, sizeof(title), "Dx12 examples - occluders: %u of %u triangles %.2f ms, boxes: %u of %u occluded %.2f ms",
+                 stats.rasterizedTriangles, stats.occluderTriangles, stats.rasterizeMs, stats.occludedBoxes, stats.testedBoxes, stats.cullMs);
+        SetWindowTextA(mhMainWnd, title);
+    }
     void OnResize() {
         BaseApp::OnResize();
         mCamera.SetLens(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.f);
@@ -386,7 +427,9 @@ protected:
         mObjectBuffer = make_unique<UploadBuffer<ShaderPerObjectData>>(m_d3dDevice.Get(), NumObjects, true);
         for (uint i = 0; i < NumObjects; i++) {
             ShaderPerObjectData objData = {};
-            objData.materialIndex = i;
+            objData.materialIndex  = i;
+            objData.positionOffset = mObjectQuantization[i].positionOffset;
+            objData.positionScale  = mObjectQuantization[i].positionScale;
             mObjectBuffer->CopyData(i, objData);
         }
         D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
@@ -419,62 +462,32 @@ protected:
         OutputDebugStringA("Building shader - ..\\..\\..\\projects\\instancing_culling\\shaders\\simpleRender.hlsl\n");
         mShaders["simpleVS"] = BaseUtil::CompileShader(L"..\\..\\..\\projects\\instancing_culling\\shaders\\simpleRender.hlsl", nullptr, "SimpleVS", "vs_5_1");
         mShaders["simplePS"] = BaseUtil::CompileShader(L"..\\..\\..\\projects\\instancing_culling\\shaders\\simpleRender.hlsl", nullptr, "SimplePS", "ps_5_1");
-        mInputLayout = {
-            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-            {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
-            {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        };
+        const auto inputElements = ShaderVertexLayout::InputElements();
+        mInputLayout.assign(inputElements.begin(), inputElements.end());
     }
     void BuildGeometry() {
         GeometryGenerator generator;
-        MeshData grid                  = generator.CreateGrid(20.0f, 20.0f, 40, 40);
-        MeshData box                   = generator.CreateBox(2.0f, 2.0f, 2.0f, 1); // box comes after grid.
-        uint gridVertexOffset          = static_cast<uint>(0);
-        uint gridIndexOffset           = static_cast<uint>(0);
-        uint boxVertexOffset           = static_cast<uint>(gridVertexOffset + grid.m_vertices.size());
-        uint boxIndexOffset            = static_cast<uint>(gridIndexOffset + grid.m_indices32.size());
-        SubmeshGeometry gridSubmesh    = {};
-        gridSubmesh.indexCount         = static_cast<uint>(grid.m_indices32.size());
-        gridSubmesh.startIndexLocation = gridIndexOffset;
-        gridSubmesh.baseVertexLocation = gridVertexOffset;
-        SubmeshGeometry boxSubmesh     = {};
-        boxSubmesh.indexCount          = static_cast<uint>(box.m_indices32.size());
-        boxSubmesh.startIndexLocation  = boxIndexOffset;
-        boxSubmesh.baseVertexLocation  = boxVertexOffset;
-        const uint NumVertices         = static_cast<uint>(grid.m_vertices.size() + box.m_vertices.size());
-        const uint NumIndices          = static_cast<uint>(grid.m_indices32.size() + box.m_indices32.size());
-        vector<ShaderVertex> vertices(NumVertices);
-        uint k = 0;
-        for (size_t i = 0; i < grid.m_vertices.size(); ++i, k++) {
-            vertices[k].pos = grid.m_vertices[i].m_position;
-            vertices[k].color = XMFLOAT4(DirectX::Colors::DarkGreen);
-            vertices[k].tex = grid.m_vertices[i].m_texC;
-        }
-        for (size_t i = 0; i < box.m_vertices.size(); ++i, k++) {
-            vertices[k].pos = box.m_vertices[i].m_position;
-            vertices[k].color = XMFLOAT4(DirectX::Colors::Maroon);
-            vertices[k].tex = box.m_vertices[i].m_texC;
+        MeshData grid = generator.CreateGrid(20.0f, 20.0f, 40, 40);
+        MeshData box  = generator.CreateBox(2.0f, 2.0f, 2.0f, 1); // box comes after grid.
+        mOccluderBox  = generator.CreateBox(2.0f, 2.0f, 2.0f, 0); // CPU side copy for the occlusion culler
+        MeshBatcher batcher;
+        batcher.Add("grid", grid);
+        batcher.Add("box", box);
+        mObjectQuantization = { VertexCompression::ComputeQuantization(grid), VertexCompression::ComputeQuantization(box) }; // Same order as the object buffer
+        const XMVECTORF32 colors[] = { DirectX::Colors::DarkGreen, DirectX::Colors::Maroon };
+        VertexConversion conversions[2];
+        for (uint32 i = 0; i < 2; ++i) {
+            conversions[i].quantization = mObjectQuantization[i];
+            XMStoreFloat4(&conversions[i].color, colors[i]);
         }
-        vector<uint32_t> indices;
-        indices.insert(indices.end(), cbegin(grid.m_indices32), cend(grid.m_indices32));
-        indices.insert(indices.end(), cbegin(box.m_indices32), cend(box.m_indices32));
-        const UINT vbNumBytes             = NumVertices * sizeof(ShaderVertex);
-        const UINT ibNumBytes             = NumIndices * sizeof(uint32_t);
         unique_ptr<MeshGeometry> geometry = make_unique<MeshGeometry>();
         geometry->name                    = "scene";
-        ThrowIfFailed(D3DCreateBlob(vbNumBytes, &geometry->vertexBufferCPU));
-        CopyMemory(geometry->vertexBufferCPU->GetBufferPointer(), vertices.data(), vbNumBytes);
-        ThrowIfFailed(D3DCreateBlob(ibNumBytes, &geometry->indexBufferCPU));
-        CopyMemory(geometry->indexBufferCPU->GetBufferPointer(), indices.data(), ibNumBytes);
-        geometry->vertexBufferGPU      = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(), m_commandList.Get(), vertices.data(), vbNumBytes, geometry->vertexBufferUploader);
-        geometry->indexBufferGPU       = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(), m_commandList.Get(), indices.data(), ibNumBytes, geometry->indexBufferUploader);
-        geometry->vertexByteStride     = sizeof(ShaderVertex);
-        geometry->vertexBufferByteSize = vbNumBytes;
-        geometry->indexFormat          = DXGI_FORMAT_R32_UINT;
-        geometry->indexBufferByteSize  = ibNumBytes;
-        geometry->drawArgs["grid"]     = gridSubmesh;
-        geometry->drawArgs["box"]      = boxSubmesh;
-        mGeometries[geometry->name]    = move(geometry);
+        geometry->CreateBuffers(m_d3dDevice.Get(), m_commandList.Get(), batcher, ShaderVertexLayout::Stride, [&](void* pVertices, void* pIndices) {
+            batcher.Write(pVertices, ShaderVertexLayout::Stride, [&](uint32 submesh, const Vertex* pSource, uint32 count, void* pOut) {
+                ShaderVertexLayout::Convert(pSource, count, pOut, conversions[submesh]);
+            }, pIndices);
+        });
+        mGeometries[geometry->name] = move(geometry);
 
         assert(mTextures.size() > 0);
         int matIndex = 0;
@@ -502,9 +515,24 @@ protected:
             }
         }
         mInstDataBuffer = make_unique<UploadBuffer<InstanceData>>(m_d3dDevice.Get(), static_cast<UINT>(mBoxInstances.size()), false);
-        for (int i = 0; i < mBoxInstances.size(); i++) {
-            mInstDataBuffer->CopyData(i, mBoxInstances[i]);
+
+        // World matrices are stored transposed for the shader.
+        const BoundingSphere& boxSphere = mGeometries["scene"]->drawArgs["box"].SphereBounds;
+        InstanceBounds instanceBounds;
+        instanceBounds.Resize(static_cast<uint32>(mBoxInstances.size()));
+        for (uint32 i = 0; i < mBoxInstances.size(); i++) {
+            instanceBounds.Set(i, boxSphere, XMMatrixTranspose(XMLoadFloat4x4(&mBoxInstances[i].worldMatrix)));
+        }
+        mInstanceBvh.Build(instanceBounds);
+        mCoherentCuller.Reset(mInstanceBvh);
+        mVisibleInstances.resize(mBoxInstances.size());
+
+        const BoundingBox& boxBounds = mGeometries["scene"]->drawArgs["box"].Bounds;
+        mBoxBounds.resize(mBoxInstances.size());
+        for (uint32 i = 0; i < mBoxInstances.size(); i++) {
+            boxBounds.Transform(mBoxBounds[i], XMMatrixTranspose(XMLoadFloat4x4(&mBoxInstances[i].worldMatrix)));
         }
+        mOcclusionCuller.Resize(320, 192);
     }
     void BuildMaterials() {
         mMaterials["darkGreen"]              = make_unique<ShaderMaterialData>();
@@ -558,6 +586,16 @@ private:
     unordered_map<string, unique_ptr<ShaderMaterialData>> mMaterials;
     unordered_map<string, unique_ptr<Texture>>            mTextures;
     vector<InstanceData>                                  mBoxInstances;
+    InstanceBvh                                           mInstanceBvh;
+    CoherentCuller                                        mCoherentCuller;
+    vector<uint32>                                        mVisibleInstances;
+    uint                                                  mVisibleInstanceCount = 0;
+    MeshData                                              mOccluderBox;
+    vector<BoundingBox>                                   mBoxBounds;
+    OcclusionCuller                                       mOcclusionCuller;
+    WorkerPool                                            mWorkerPool;
+    float                                                 mLastStatsTime = 0.0f;
+    vector<VertexQuantization>                            mObjectQuantization;
     vector<D3D12_INPUT_ELEMENT_DESC>                      mInputLayout;
     unique_ptr<UploadBuffer<SceneConstants>>              mSceneConstants = nullptr;
     unique_ptr<UploadBuffer<ShaderMaterialData>>          mMatBuffer = nullptr;
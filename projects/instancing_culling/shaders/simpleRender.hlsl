@@ -5,10 +5,10 @@ struct SceneConstants{
 };
 
 struct PerObjectData {
-    uint materialIndex;
-    uint padding0;
-    uint padding1;
-    uint padding2;
+    float3 positionOffset;
+    uint   materialIndex;
+    float3 positionScale;
+    uint   padding0;
 };
 
 struct MaterialData {
@@ -24,7 +24,7 @@ struct InstanceData {
 };
 
 struct VertexIn {
-    float3 PosL  : POSITION;
+    float4 PosL  : POSITION; // unorm16 within the object's bounds
     float4 Color : COLOR;
     float2 texUV : TEXCOORD;
 };
@@ -52,7 +52,8 @@ SamplerState gSamAnisotropicClamp : register(s5);
 
 VertexOut SimpleVS(VertexIn vIn, uint instanceId : SV_InstanceID) {
     VertexOut vOut;
-    float4 posW = mul(float4(vIn.PosL, 1.0f), InstData[instanceId].gWorld);
+    float3 posL = ObjData.positionOffset + vIn.PosL.xyz * ObjData.positionScale;
+    float4 posW = mul(float4(posL, 1.0f), InstData[instanceId].gWorld);
     //posW.x += 5.0f * instanceId;
     float4 posC = mul(posW, SceneConsts.gView);
     vOut.PosH  = mul(posC, SceneConsts.gProj);
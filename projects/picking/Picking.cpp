@@ -2,6 +2,7 @@
 #include "DirectXColors.h"
 #include "windows.h"
 #include "BaseApp.h"
+#include "BoundingVolumes.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
 #include "Camera.cpp"
@@ -321,6 +322,11 @@ void PickingDemo::BuildShapeGeometry()
     boxSubmesh.startIndexLocation = 0;
     boxSubmesh.baseVertexLocation = 0;
 
+    const MeshBounds bounds = BoundingVolumes::Compute(box);
+    boxSubmesh.Bounds         = bounds.aabb;
+    boxSubmesh.SphereBounds   = bounds.sphere;
+    boxSubmesh.OrientedBounds = bounds.obb;
+
     std::vector<FrameResource::Vertex> vertices(box.m_vertices.size());
 
     for (uint32_t i = 0; i < box.m_vertices.size(); ++i)
@@ -330,7 +336,12 @@ void PickingDemo::BuildShapeGeometry()
         vertices[i].texC   = box.m_vertices[i].m_texC;
     }
 
-    std::vector<std::uint16_t> indices = box.GetIndices16();
+    std::vector<std::uint16_t> indices;
+    if (box.GetIndices16(indices) == false)
+    {
+        ::OutputDebugStringA("Error! - the box has too many vertices for 16 bit indices\n");
+        return;
+    }
 
     const UINT vbByteSize = static_cast<UINT>(vertices.size() * sizeof(FrameResource::Vertex));
     const UINT ibBytesSize = static_cast<UINT>(indices.size() * sizeof(std::uint16_t));
@@ -13,6 +13,10 @@
 #include "../common/BaseUtil.h"
 #include "../common/d3dx12.h"
 #include "../common/GeometryGenerator.h"
+#include "../common/MeshBatcher.h"
+#include "../common/MeshFile.h"
+#include "../common/MeshOptimizer.h"
+#include "../common/MeshWelder.h"
 #include "../common/MathHelper.h"
 
 #include "FrameResource.h"
@@ -24,6 +28,9 @@ using namespace DirectX;
 // ====================================================================================================================
 const unsigned int NumFrameResources = 3;
 
+// Generated geometry is cached here, relative to the working directory.
+const char* const ShapesCachePath = "shapes.mesh";
+
 // ====================================================================================================================
 struct RenderItem
 {
@@ -375,113 +382,89 @@ void ShapesDemo::ShapesBuildShadersAndInputLayout()
 // ====================================================================================================================
 void ShapesDemo::ShapesBuildShapeGeometry()
 {
-    GeometryGenerator geoGen;
-    MeshData box    = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 5);
-    MeshData grid   = geoGen.CreateGrid(2.0f, 2.0f, 40, 40);
-    MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-    MeshData cyl    = geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 20, 20);
-
-    UINT boxVertexOffset    = 0;
-    UINT gridVertexOffset   = static_cast<UINT>(box.m_vertices.size());
-    UINT sphereVertexOffset = gridVertexOffset + static_cast<UINT>(grid.m_vertices.size());
-    UINT cylVertexOffset    = sphereVertexOffset + static_cast<UINT>(sphere.m_vertices.size());
-
-    UINT boxIndexOffset    = 0;
-    UINT gridIndexOffset   = static_cast<UINT>(box.m_indices32.size());
-    UINT sphereIndexOffset = gridIndexOffset + static_cast<UINT>(grid.m_indices32.size());
-    UINT cylIndexOffset    = sphereIndexOffset + static_cast<UINT>(sphere.m_indices32.size());
-
-    SubmeshGeometry boxSubmesh    = {};
-    boxSubmesh.indexCount         = static_cast<UINT>(box.m_indices32.size());
-    boxSubmesh.startIndexLocation = boxIndexOffset;
-    boxSubmesh.baseVertexLocation = boxVertexOffset;
-
-    SubmeshGeometry gridSubMesh    = {};
-    gridSubMesh.indexCount         = static_cast<UINT>(grid.m_indices32.size());
-    gridSubMesh.startIndexLocation = gridIndexOffset;
-    gridSubMesh.baseVertexLocation = gridVertexOffset;
-
-    SubmeshGeometry sphereSubMesh    = {};
-    sphereSubMesh.indexCount         = static_cast<UINT>(sphere.m_indices32.size());
-    sphereSubMesh.startIndexLocation = sphereIndexOffset;
-    sphereSubMesh.baseVertexLocation = sphereVertexOffset;
-
-    SubmeshGeometry cylSubMesh    = {};
-    cylSubMesh.indexCount         = static_cast<UINT>(cyl.m_indices32.size());
-    cylSubMesh.startIndexLocation = cylIndexOffset;
-    cylSubMesh.baseVertexLocation = cylVertexOffset;
-
-    auto totalVertexCount = box.m_vertices.size()
-                          + grid.m_vertices.size()
-                          + sphere.m_vertices.size()
-                          + cyl.m_vertices.size();
-
-    std::vector<FrameResource::Vertex> vertices(totalVertexCount);
-
-    UINT k = 0;
-    for (size_t i = 0; i < box.m_vertices.size(); ++i, ++k)
+    // Everything the geometry is generated from goes into the cache key, so changing any of it rebuilds the cache.
+    struct ShapeParams
     {
-        vertices[k].pos   = box.m_vertices[i].m_position;
-        vertices[k].color = XMFLOAT4(DirectX::Colors::DarkGreen);
-    }
+        float  boxWidth        = 1.5f;
+        float  boxHeight       = 0.5f;
+        float  boxDepth        = 1.5f;
+        uint32 boxSubdivisions = 5;
+        float  gridSize        = 2.0f;
+        uint32 gridCells       = 40;
+        float  sphereRadius    = 0.5f;
+        uint32 sphereSlices    = 20;
+        uint32 sphereStacks    = 20;
+        float  cylRadius       = 0.5f;
+        float  cylHeight       = 3.0f;
+        uint32 cylSlices       = 20;
+        uint32 cylStacks       = 20;
+        float  weldTolerance   = 1e-5f;
+        uint32 fullBounds      = 1; // Minimal spheres and PCA OBBs rather than ones derived from the AABBs
+    };
+    const ShapeParams params;
 
-    for (size_t i = 0; i < grid.m_vertices.size(); ++i, ++k)
-    {
-        vertices[k].pos   = grid.m_vertices[i].m_position;
-        vertices[k].color = XMFLOAT4(DirectX::Colors::Chocolate);
-    }
+    // One color per submesh, in the order they are added.
+    const XMFLOAT4 colors[] = { XMFLOAT4(DirectX::Colors::DarkGreen),
+                                XMFLOAT4(DirectX::Colors::Chocolate),
+                                XMFLOAT4(DirectX::Colors::IndianRed),
+                                XMFLOAT4(DirectX::Colors::BlueViolet) };
 
-    for (size_t i = 0; i < sphere.m_vertices.size(); ++i, ++k)
-    {
-        vertices[k].pos   = sphere.m_vertices[i].m_position;
-        vertices[k].color = XMFLOAT4(DirectX::Colors::IndianRed);
-    }
+    const uint64 key = MeshFileKey("shapeGeo").Add(params).Add(colors).Add(uint32(sizeof(FrameResource::Vertex))).Value();
 
-    for (size_t i = 0; i < cyl.m_vertices.size(); ++i, ++k)
+    MeshFile meshFile;
+    if (meshFile.Open(ShapesCachePath, key) == false)
     {
-        vertices[k].pos   = cyl.m_vertices[i].m_position;
-        vertices[k].color = XMFLOAT4(DirectX::Colors::BlueViolet);
+        GeometryGenerator geoGen;
+        MeshData box    = geoGen.CreateBox(params.boxWidth, params.boxHeight, params.boxDepth, params.boxSubdivisions);
+        MeshData grid   = geoGen.CreateGrid(params.gridSize, params.gridSize, params.gridCells, params.gridCells);
+        MeshData sphere = geoGen.CreateSphere(params.sphereRadius, params.sphereSlices, params.sphereStacks);
+        MeshData cyl    = geoGen.CreateCylinder(params.cylRadius, params.cylRadius, params.cylHeight, params.cylSlices, params.cylStacks);
+
+        // The demo only draws positions, so the vertices the generators split for normals and texture seams are merged.
+        WeldSettings positionOnly;
+        positionOnly.positionTolerance = params.weldTolerance;
+        positionOnly.normalTolerance   = FLT_MAX;
+        positionOnly.tangentTolerance  = FLT_MAX;
+        positionOnly.texCTolerance     = FLT_MAX;
+
+        MeshWelder::Weld(box, positionOnly);
+        MeshWelder::Weld(grid, positionOnly);
+        MeshWelder::Weld(sphere, positionOnly);
+        MeshWelder::Weld(cyl, positionOnly);
+
+        // Reorder triangles and vertices for the post-transform cache before packing.
+        MeshOptimizer::Optimize(box);
+        MeshOptimizer::Optimize(grid);
+        MeshOptimizer::Optimize(sphere);
+        MeshOptimizer::Optimize(cyl);
+
+        MeshBatcher batcher;
+        batcher.Add("box", box);
+        batcher.Add("grid", grid);
+        batcher.Add("sphere", sphere);
+        batcher.Add("cyl", cyl);
+        batcher.SetFullBounds(params.fullBounds != 0);
+
+        meshFile.Build(key,
+                       batcher,
+                       sizeof(FrameResource::Vertex),
+                       [&](void* pVertices, void* pIndices)
+        {
+            batcher.Write(pVertices, sizeof(FrameResource::Vertex), [&](uint32 submesh, const Vertex& v, void* pOut)
+            {
+                FrameResource::Vertex* pVertex = static_cast<FrameResource::Vertex*>(pOut);
+                pVertex->pos   = v.m_position;
+                pVertex->color = colors[submesh];
+            }, pIndices);
+        });
+
+        // Without a writable working directory the geometry is simply generated again next time.
+        meshFile.Save(ShapesCachePath);
     }
 
-    std::vector<std::uint32_t> indices;
-    indices.insert(indices.end(), std::cbegin(box.m_indices32), std::cend(box.m_indices32));
-    indices.insert(indices.end(), std::cbegin(grid.m_indices32), std::cend(grid.m_indices32));
-    indices.insert(indices.end(), std::cbegin(sphere.m_indices32), std::cend(sphere.m_indices32));
-    indices.insert(indices.end(), std::cbegin(cyl.m_indices32), std::cend(cyl.m_indices32));
-
-    const UINT vbByteSize = static_cast<UINT>(vertices.size()) * sizeof(FrameResource::Vertex);
-    const UINT ibByteSize = static_cast<UINT>(indices.size())  * sizeof(std::uint32_t);
-
     auto geo  = std::make_unique<MeshGeometry>();
     geo->name = "shapeGeo";
-
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->vertexBufferCPU));
-    CopyMemory(geo->vertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->indexBufferCPU));
-    CopyMemory(geo->indexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-    geo->vertexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
-                                                         m_commandList.Get(),
-                                                         vertices.data(),
-                                                         vbByteSize,
-                                                         geo->vertexBufferUploader);
-
-    geo->indexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
-                                                         m_commandList.Get(),
-                                                         indices.data(),
-                                                         ibByteSize,
-                                                         geo->indexBufferUploader);
-
-    geo->vertexByteStride     = sizeof(FrameResource::Vertex);
-    geo->vertexBufferByteSize = vbByteSize;
-    geo->indexFormat          = DXGI_FORMAT_R32_UINT;
-    geo->indexBufferByteSize  = ibByteSize;
-
-    geo->drawArgs["box"]    = boxSubmesh;
-    geo->drawArgs["grid"]   = gridSubMesh;
-    geo->drawArgs["sphere"] = sphereSubMesh;
-    geo->drawArgs["cyl"]    =  cylSubMesh;
+    geo->CreateBuffers(m_d3dDevice.Get(), m_commandList.Get(), meshFile);
 
     m_geometries[geo->name] = std::move(geo);
 }
@@ -1,4 +1,5 @@
 #include <array>
+#include <cstddef>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -367,103 +368,80 @@ void ShapesDemo::BuildShadersAndInputLayout()
 // ====================================================================================================================
 void ShapesDemo::BuildShapeGeometry()
 {
-    GeometryGenerator geoGen;
-    MeshData box    = geoGen.CreateBox(1.5f, 0.5f, 1.5f, 5);
-    MeshData grid   = geoGen.CreateGrid(2.0f, 2.0f, 40, 40);
-    MeshData sphere = geoGen.CreateSphere(0.5f, 20, 20);
-    MeshData cyl    = geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 20, 20);
-
-    UINT boxVertexOffset    = 0;
-    UINT gridVertexOffset   = static_cast<UINT>(box.m_vertices.size());
-    UINT sphereVertexOffset = gridVertexOffset + static_cast<UINT>(grid.m_vertices.size());
-    UINT cylVertexOffset    = sphereVertexOffset + static_cast<UINT>(sphere.m_vertices.size());
-
-    UINT boxIndexOffset    = 0;
-    UINT gridIndexOffset   = static_cast<UINT>(box.m_indices32.size());
-    UINT sphereIndexOffset = gridIndexOffset + static_cast<UINT>(grid.m_indices32.size());
-    UINT cylIndexOffset    = sphereIndexOffset + static_cast<UINT>(sphere.m_indices32.size());
+    // Sizes are known up front, so the shapes are generated straight into the mapped upload buffers instead of going
+    // through MeshData, a vertex vector and a CPU blob first.
+    const MeshSize boxSize    = GeometryGenerator::BoxSize(5);
+    const MeshSize gridSize   = GeometryGenerator::GridSize(40, 40);
+    const MeshSize sphereSize = GeometryGenerator::SphereSize(20, 20);
+    const MeshSize cylSize    = GeometryGenerator::CylinderSize(20, 20);
 
     SubmeshGeometry boxSubmesh    = {};
-    boxSubmesh.indexCount         = static_cast<UINT>(box.m_indices32.size());
-    boxSubmesh.startIndexLocation = boxIndexOffset;
-    boxSubmesh.baseVertexLocation = boxVertexOffset;
+    boxSubmesh.indexCount         = boxSize.indexCount;
+    boxSubmesh.startIndexLocation = 0;
+    boxSubmesh.baseVertexLocation = 0;
 
     SubmeshGeometry gridSubMesh    = {};
-    gridSubMesh.indexCount         = static_cast<UINT>(grid.m_indices32.size());
-    gridSubMesh.startIndexLocation = gridIndexOffset;
-    gridSubMesh.baseVertexLocation = gridVertexOffset;
+    gridSubMesh.indexCount         = gridSize.indexCount;
+    gridSubMesh.startIndexLocation = boxSubmesh.startIndexLocation + boxSize.indexCount;
+    gridSubMesh.baseVertexLocation = boxSubmesh.baseVertexLocation + boxSize.vertexCount;
 
     SubmeshGeometry sphereSubMesh    = {};
-    sphereSubMesh.indexCount         = static_cast<UINT>(sphere.m_indices32.size());
-    sphereSubMesh.startIndexLocation = sphereIndexOffset;
-    sphereSubMesh.baseVertexLocation = sphereVertexOffset;
+    sphereSubMesh.indexCount         = sphereSize.indexCount;
+    sphereSubMesh.startIndexLocation = gridSubMesh.startIndexLocation + gridSize.indexCount;
+    sphereSubMesh.baseVertexLocation = gridSubMesh.baseVertexLocation + gridSize.vertexCount;
 
     SubmeshGeometry cylSubMesh    = {};
-    cylSubMesh.indexCount         = static_cast<UINT>(cyl.m_indices32.size());
-    cylSubMesh.startIndexLocation = cylIndexOffset;
-    cylSubMesh.baseVertexLocation = cylVertexOffset;
-
-    auto totalVertexCount = box.m_vertices.size()
-                          + grid.m_vertices.size()
-                          + sphere.m_vertices.size()
-                          + cyl.m_vertices.size();
-
-    std::vector<FrameResource::Vertex> vertices(totalVertexCount);
-
-    UINT k = 0;
-    for (size_t i = 0; i < box.m_vertices.size(); ++i, ++k)
-    {
-        vertices[k].pos    = box.m_vertices[i].m_position;
-        vertices[k].normal = box.m_vertices[i].m_normal;
-    }
-
-    for (size_t i = 0; i < grid.m_vertices.size(); ++i, ++k)
-    {
-        vertices[k].pos    = grid.m_vertices[i].m_position;
-        vertices[k].normal = grid.m_vertices[i].m_normal;
-    }
+    cylSubMesh.indexCount         = cylSize.indexCount;
+    cylSubMesh.startIndexLocation = sphereSubMesh.startIndexLocation + sphereSize.indexCount;
+    cylSubMesh.baseVertexLocation = sphereSubMesh.baseVertexLocation + sphereSize.vertexCount;
 
-    for (size_t i = 0; i < sphere.m_vertices.size(); ++i, ++k)
-    {
-        vertices[k].pos    = sphere.m_vertices[i].m_position;
-        vertices[k].normal = sphere.m_vertices[i].m_normal;
-    }
-
-    for (size_t i = 0; i < cyl.m_vertices.size(); ++i, ++k)
-    {
-        vertices[k].pos    = cyl.m_vertices[i].m_position;
-        vertices[k].normal = cyl.m_vertices[i].m_normal;
-    }
+    const UINT totalVertexCount = cylSubMesh.baseVertexLocation + cylSize.vertexCount;
+    const UINT totalIndexCount  = cylSubMesh.startIndexLocation + cylSize.indexCount;
 
-    std::vector<std::uint32_t> indices;
-    indices.insert(indices.end(), std::cbegin(box.m_indices32),    std::cend(box.m_indices32));
-    indices.insert(indices.end(), std::cbegin(grid.m_indices32),   std::cend(grid.m_indices32));
-    indices.insert(indices.end(), std::cbegin(sphere.m_indices32), std::cend(sphere.m_indices32));
-    indices.insert(indices.end(), std::cbegin(cyl.m_indices32),    std::cend(cyl.m_indices32));
+    const UINT vbByteSize = totalVertexCount * sizeof(FrameResource::Vertex);
+    const UINT ibByteSize = totalIndexCount  * sizeof(std::uint32_t);
 
-    const UINT vbByteSize = static_cast<UINT>(vertices.size()) * sizeof(FrameResource::Vertex);
-    const UINT ibByteSize = static_cast<UINT>(indices.size())  * sizeof(std::uint32_t);
+    InterleavedLayout layout = {};
+    layout.stride            = sizeof(FrameResource::Vertex);
+    layout.positionOffset    = offsetof(FrameResource::Vertex, pos);
+    layout.normalOffset      = offsetof(FrameResource::Vertex, normal);
 
     auto geo  = std::make_unique<MeshGeometry>();
     geo->name = "shapeGeo";
 
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->vertexBufferCPU));
-    CopyMemory(geo->vertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->indexBufferCPU));
-    CopyMemory(geo->indexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+    GeometryGenerator geoGen;
 
     geo->vertexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
                                                          m_commandList.Get(),
-                                                         vertices.data(),
                                                          vbByteSize,
-                                                         geo->vertexBufferUploader);
-
-    geo->indexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
-                                                         m_commandList.Get(),
-                                                         indices.data(),
-                                                         ibByteSize,
-                                                         geo->indexBufferUploader);
+                                                         geo->vertexBufferUploader,
+                                                         [&](void* pVertices)
+    {
+        geo->indexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
+                                                            m_commandList.Get(),
+                                                            ibByteSize,
+                                                            geo->indexBufferUploader,
+                                                            [&](void* pIndices)
+        {
+            // Points the target at one submesh's slice of the two buffers.
+            auto Target = [&](const SubmeshGeometry& submesh, const MeshSize& size)
+            {
+                MeshWriteTarget target = {};
+                target.pVertices       = static_cast<FrameResource::Vertex*>(pVertices) + submesh.baseVertexLocation;
+                target.layout          = layout;
+                target.vertexCapacity  = size.vertexCount;
+                target.pIndices        = static_cast<std::uint32_t*>(pIndices) + submesh.startIndexLocation;
+                target.indexSize       = sizeof(std::uint32_t);
+                target.indexCapacity   = size.indexCount;
+                return target;
+            };
+
+            geoGen.CreateBox(1.5f, 0.5f, 1.5f, 5, Target(boxSubmesh, boxSize));
+            geoGen.CreateGrid(2.0f, 2.0f, 40, 40, Target(gridSubMesh, gridSize));
+            geoGen.CreateSphere(0.5f, 20, 20, Target(sphereSubMesh, sphereSize));
+            geoGen.CreateCylinder(0.5f, 0.5f, 3.0f, 20, 20, Target(cylSubMesh, cylSize));
+        });
+    });
 
     geo->vertexByteStride     = sizeof(FrameResource::Vertex);
     geo->vertexBufferByteSize = vbByteSize;
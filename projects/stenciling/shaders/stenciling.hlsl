@@ -50,3 +50,21 @@ float4 PS(VertexOut pin) : SV_TARGET
 {
     return float4(gDiffuseMap.Sample(gsamAnisotropicWrap, pin.texC));
 };
+
+// Shadow volumes are object space float4 positions, see ShadowVolume.
+float4 ShadowVolumeVS(float4 posL : POSITION) : SV_POSITION
+{
+    return mul(mul(posL, worldTransform), viewProjTransform);
+};
+
+// Full screen triangle from the vertex id, no vertex buffer.
+float4 ShadowVS(uint vertexId : SV_VertexID) : SV_POSITION
+{
+    float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+    return float4(uv.x * 2.0f - 1.0f, 1.0f - uv.y * 2.0f, 0.0f, 1.0f);
+};
+
+float4 ShadowPS() : SV_TARGET
+{
+    return float4(0.0f, 0.0f, 0.0f, 0.5f);
+};
@@ -1,10 +1,13 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <cstddef>
 #include "DirectXColors.h"
 #include "../common/BaseUtil.h"
 #include "../common/BaseApp.h"
 #include "../common/GeometryGenerator.h"
+#include "../common/MeshBatcher.h"
+#include "../common/ShadowVolume.h"
 #include "../common/UploadBuffer.h"
 #include "../common/DDSTextureLoader.h"
 
@@ -14,6 +17,12 @@ using namespace DirectX;
 
 const uint32_t NumObjects = 6;
 
+// Shadow volumes are rebuilt every frame into a ring of this many bytes.
+const uint32_t ShadowVolumeRingSize = 1024 * 1024;
+
+// Object space distance the silhouettes are extruded, long enough to reach the floor from the box.
+const float ShadowVolumeExtrusion = 20.0f;
+
 enum class RenderLayer : int
 {
     Opaque = 0,
@@ -210,6 +219,30 @@ public:
 
       UpdatePassCB();
       UpdateObjectCBs();
+      UpdateShadowVolumes();
+  }
+
+  // Extrudes the silhouettes of the casters as seen from the light into the next part of the shadow volume ring.
+  void UpdateShadowVolumes()
+  {
+      // Update() waited for the previous frame, so its volumes are no longer read.
+      m_shadowVolumeRing.Retire(m_fence->GetCompletedValue());
+
+      const vector<RenderObject*>& casterObjects = m_renderLayer[(int)RenderLayer::Shadow];
+      for (size_t i = 0; i < casterObjects.size(); ++i) {
+          // Volumes are built in object space and drawn with the world transform of the caster.
+          XMMATRIX invWorld = XMMatrixInverse(nullptr, XMLoadFloat4x4(&casterObjects[i]->worldTransform));
+          XMVECTOR light    = XMVectorSet(m_lightPos.x, m_lightPos.y, m_lightPos.z, 1.0f);
+          XMStoreFloat4(&m_shadowCasters[i].light, XMVector4Transform(light, invWorld));
+      }
+
+      ShadowVolumeSettings settings;
+      settings.extrusion = ShadowVolumeExtrusion;
+      ShadowVolume::Build(m_shadowCasters.data(), (uint32)m_shadowCasters.size(), settings,
+                          m_shadowVolumeRing, m_shadowVolumeVB->MappedData());
+
+      // Draw() signals this value once the frame's commands are submitted.
+      m_shadowVolumeRing.EndFrame(m_currentFence + 1);
   }
 
   void DrawRenderObjects(ID3D12GraphicsCommandList* pCmdList, vector<RenderObject*>& renderObjects)
@@ -237,6 +270,40 @@ public:
       }
   }
 
+  // Depth fail stenciling: every volume face behind the scene counts up (back faces) or down (front faces), so the
+  // stencil ends up non zero where the scene is inside a volume, wherever the camera is.
+  void DrawShadowVolumes(ID3D12GraphicsCommandList* pCmdList)
+  {
+      const unsigned int objCbByteSize = BaseUtil::CalcConstantBufferByteSize(sizeof(ObjectCb));
+      const vector<RenderObject*>& casterObjects = m_renderLayer[(int)RenderLayer::Shadow];
+
+      D3D12_VERTEX_BUFFER_VIEW vbView = {};
+      vbView.BufferLocation = m_shadowVolumeVB->Resource()->GetGPUVirtualAddress();
+      vbView.SizeInBytes    = ShadowVolumeRingSize;
+      vbView.StrideInBytes  = sizeof(XMFLOAT4);
+
+      pCmdList->SetPipelineState(m_pipelines["shadowVolumes"].Get());
+      pCmdList->IASetVertexBuffers(0, 1, &vbView);
+      pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+      for (size_t i = 0; i < casterObjects.size(); ++i) {
+          const ShadowCaster& caster = m_shadowCasters[i];
+          if (caster.vertexCount == 0) {
+              continue;
+          }
+
+          D3D12_GPU_VIRTUAL_ADDRESS objCbAddr = m_objectCB->Resource()->GetGPUVirtualAddress() +
+                                                (casterObjects[i]->objectCbIndex * objCbByteSize);
+          pCmdList->SetGraphicsRootConstantBufferView(0, objCbAddr);
+          pCmdList->DrawInstanced(caster.vertexCount, 1, caster.firstVertex, 0);
+      }
+
+      // Darken the shadowed pixels and clear their stencil again for the mirror.
+      pCmdList->OMSetStencilRef(0);
+      pCmdList->SetPipelineState(m_pipelines["shadows"].Get());
+      pCmdList->DrawInstanced(3, 1, 0, 0);
+  }
+
   virtual void Draw(const BaseTimer& gt)override
   {
       ThrowIfFailed(m_directCmdListAlloc->Reset());
@@ -276,6 +343,9 @@ public:
       // Draw the regular opaque objects.
       DrawRenderObjects(m_commandList.Get(), m_renderLayer[(int)RenderLayer::Opaque]);
 
+      // Shadows of the opaque objects on each other.
+      DrawShadowVolumes(m_commandList.Get());
+
       // Draw to the stencil buffer.
       m_commandList->OMSetStencilRef(1);
       m_commandList->SetPipelineState(m_pipelines["markStencilMirrors"].Get());
@@ -382,20 +452,6 @@ public:
       mirrorSubmesh.startIndexLocation = 24;
       mirrorSubmesh.baseVertexLocation = 0;
 
-      GeometryGenerator generator;
-      MeshData boxMesh = generator.CreateBox(5, 5, 5, 0);
-      std::vector<ShaderVertex> boxVertices(boxMesh.m_vertices.size());
-
-      for (UINT i = 0; i < boxVertices.size(); i++) {
-          boxVertices[i].Pos = boxMesh.m_vertices[i].m_position;
-          boxVertices[i].Normal = boxMesh.m_vertices[i].m_normal;
-          boxVertices[i].TexC = boxMesh.m_vertices[i].m_texC;
-      }
-
-      std::vector<uint16_t> boxIndices = boxMesh.GetIndices16();
-      const unsigned int boxVbByteSize = static_cast<unsigned int>(boxVertices.size()) * sizeof(ShaderVertex);
-      const unsigned int boxIbByteSize = static_cast<unsigned int>(boxIndices.size()) * sizeof(uint16_t);
-
       const UINT vbByteSize = ((UINT)vertices.size()) * sizeof(ShaderVertex);
       const UINT ibByteSize = ((UINT)indices.size()) * sizeof(std::uint16_t);
 
@@ -423,29 +479,24 @@ public:
       geo->drawArgs["wall"]   = wallSubmesh;
       geo->drawArgs["mirror"] = mirrorSubmesh;
 
-      SubmeshGeometry boxSubmesh;
-      boxSubmesh.indexCount = static_cast<unsigned int>(boxIndices.size());
-      boxSubmesh.baseVertexLocation = 0;
-      boxSubmesh.startIndexLocation = 0;
-
-      unique_ptr<MeshGeometry> boxGeo = make_unique<MeshGeometry>();
-      boxGeo->name = "box";
-      ThrowIfFailed(D3DCreateBlob(boxVbByteSize, &boxGeo->vertexBufferCPU));
-      CopyMemory(boxGeo->vertexBufferCPU->GetBufferPointer(), boxVertices.data(), vbByteSize);
+      GeometryGenerator generator;
+      MeshData boxMesh = generator.CreateBox(5, 5, 5, 0);
+      m_boxAdjacency.Build(boxMesh);
 
-      ThrowIfFailed(D3DCreateBlob(boxIbByteSize, &boxGeo->indexBufferCPU));
-      CopyMemory(boxGeo->indexBufferCPU->GetBufferPointer(), boxIndices.data(), ibByteSize);
+      MeshBatcher boxBatcher;
+      boxBatcher.Add("box", boxMesh);
 
-      boxGeo->vertexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
-          m_commandList.Get(), boxVertices.data(), boxVbByteSize, boxGeo->vertexBufferUploader);
+      InterleavedLayout boxLayout = {};
+      boxLayout.stride = sizeof(ShaderVertex);
+      boxLayout.positionOffset = offsetof(ShaderVertex, Pos);
+      boxLayout.normalOffset = offsetof(ShaderVertex, Normal);
+      boxLayout.texCOffset = offsetof(ShaderVertex, TexC);
 
-      boxGeo->indexBufferGPU = BaseUtil::CreateDefaultBuffer(m_d3dDevice.Get(),
-          m_commandList.Get(), boxIndices.data(), boxIbByteSize, boxGeo->indexBufferUploader);
-      boxGeo->vertexByteStride = sizeof(ShaderVertex);
-      boxGeo->vertexBufferByteSize = boxVbByteSize;
-      boxGeo->indexFormat = DXGI_FORMAT_R16_UINT;
-      boxGeo->indexBufferByteSize = boxIbByteSize;
-      boxGeo->drawArgs["box"] = boxSubmesh;
+      unique_ptr<MeshGeometry> boxGeo = make_unique<MeshGeometry>();
+      boxGeo->name = "box";
+      boxGeo->CreateBuffers(m_d3dDevice.Get(), m_commandList.Get(), boxBatcher, sizeof(ShaderVertex), [&](void* pVertices, void* pIndices) {
+          boxBatcher.Write(pVertices, boxLayout, pIndices);
+      });
 
       m_geometries[boxGeo->name] = std::move(boxGeo); // box
       m_geometries[geo->name] = std::move(geo); // room
@@ -503,6 +554,11 @@ public:
       boxItem->startIndexLocation = boxItem->pGeo->drawArgs["box"].startIndexLocation;
       boxItem->baseVertexLocation = boxItem->pGeo->drawArgs["box"].baseVertexLocation;
       m_renderLayer[(int)RenderLayer::Opaque].push_back(boxItem.get());
+      m_renderLayer[(int)RenderLayer::Shadow].push_back(boxItem.get());
+
+      ShadowCaster boxCaster;
+      boxCaster.pAdjacency = &m_boxAdjacency;
+      m_shadowCasters.push_back(std::move(boxCaster));
 
       unique_ptr<RenderObject> reflectedBox = make_unique<RenderObject>();
       *reflectedBox = *boxItem;
@@ -542,6 +598,9 @@ public:
   {
       m_shaders["standardVS"] = BaseUtil::CompileShader(L"shaders\\stenciling.hlsl", nullptr, "VS", "vs_5_0");
       m_shaders["opaquePS"] = BaseUtil::CompileShader(L"shaders\\stenciling.hlsl", nullptr, "PS", "ps_5_0");
+      m_shaders["shadowVolumeVS"] = BaseUtil::CompileShader(L"shaders\\stenciling.hlsl", nullptr, "ShadowVolumeVS", "vs_5_0");
+      m_shaders["shadowVS"] = BaseUtil::CompileShader(L"shaders\\stenciling.hlsl", nullptr, "ShadowVS", "vs_5_0");
+      m_shaders["shadowPS"] = BaseUtil::CompileShader(L"shaders\\stenciling.hlsl", nullptr, "ShadowPS", "ps_5_0");
 
       m_inputLayout =
       {
@@ -549,6 +608,11 @@ public:
           { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
           { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
       };
+
+      m_shadowVolumeInputLayout =
+      {
+          { "POSITION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+      };
   }
 
   void BuildRootSignature()
@@ -587,6 +651,9 @@ public:
 
       m_objectCB = std::make_unique<UploadBuffer<ObjectCb>>(m_d3dDevice.Get(), NumObjects, true);
       m_passCB   = std::make_unique<UploadBuffer<PassCb>>(m_d3dDevice.Get(), 1, true);
+
+      m_shadowVolumeVB = std::make_unique<UploadBuffer<XMFLOAT4>>(m_d3dDevice.Get(), ShadowVolumeRingSize / sizeof(XMFLOAT4), false);
+      m_shadowVolumeRing.Reset(ShadowVolumeRingSize);
   }
 
   // Build descriptor heaps and shader resource views for our textures.
@@ -706,6 +773,57 @@ public:
     reflectPSODesc.RasterizerState.FrontCounterClockwise = true;
     ThrowIfFailed(m_d3dDevice->CreateGraphicsPipelineState(&reflectPSODesc,
         IID_PPV_ARGS(&m_pipelines["drawReflectedObjects"])));
+
+    // Shadow volumes only touch the stencil: both sides are drawn, and faces behind the scene count up for back
+    // faces and down for front faces.
+    D3D12_DEPTH_STENCIL_DESC shadowVolumeDSS = mirrorDSState;
+    shadowVolumeDSS.FrontFace.StencilPassOp      = D3D12_STENCIL_OP_KEEP;
+    shadowVolumeDSS.FrontFace.StencilDepthFailOp = D3D12_STENCIL_OP_DECR;
+    shadowVolumeDSS.BackFace.StencilPassOp       = D3D12_STENCIL_OP_KEEP;
+    shadowVolumeDSS.BackFace.StencilDepthFailOp  = D3D12_STENCIL_OP_INCR;
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowVolumePsoDesc = markMirrorsPsoDesc;
+    shadowVolumePsoDesc.InputLayout = { m_shadowVolumeInputLayout.data(), (UINT)m_shadowVolumeInputLayout.size() };
+    shadowVolumePsoDesc.VS =
+    {
+        reinterpret_cast<BYTE*>(m_shaders["shadowVolumeVS"]->GetBufferPointer()),
+        m_shaders["shadowVolumeVS"]->GetBufferSize()
+    };
+    shadowVolumePsoDesc.PS = { nullptr, 0 };
+    shadowVolumePsoDesc.DepthStencilState = shadowVolumeDSS;
+    shadowVolumePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    ThrowIfFailed(m_d3dDevice->CreateGraphicsPipelineState(&shadowVolumePsoDesc,
+                                                           IID_PPV_ARGS(&m_pipelines["shadowVolumes"])));
+
+    // Blends a full screen triangle over every pixel with a non zero stencil and zeroes it.
+    D3D12_DEPTH_STENCIL_DESC shadowDSS = mirrorDSState;
+    shadowDSS.DepthEnable = false;
+    shadowDSS.FrontFace.StencilPassOp = D3D12_STENCIL_OP_ZERO;
+    shadowDSS.FrontFace.StencilFunc   = D3D12_COMPARISON_FUNC_NOT_EQUAL;
+    shadowDSS.BackFace                = shadowDSS.FrontFace;
+
+    CD3DX12_BLEND_DESC shadowBlendState(D3D12_DEFAULT);
+    shadowBlendState.RenderTarget[0].BlendEnable = true;
+    shadowBlendState.RenderTarget[0].SrcBlend    = D3D12_BLEND_SRC_ALPHA;
+    shadowBlendState.RenderTarget[0].DestBlend   = D3D12_BLEND_INV_SRC_ALPHA;
+
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = opaquePsoDesc;
+    shadowPsoDesc.InputLayout = { nullptr, 0 };
+    shadowPsoDesc.VS =
+    {
+        reinterpret_cast<BYTE*>(m_shaders["shadowVS"]->GetBufferPointer()),
+        m_shaders["shadowVS"]->GetBufferSize()
+    };
+    shadowPsoDesc.PS =
+    {
+        reinterpret_cast<BYTE*>(m_shaders["shadowPS"]->GetBufferPointer()),
+        m_shaders["shadowPS"]->GetBufferSize()
+    };
+    shadowPsoDesc.BlendState = shadowBlendState;
+    shadowPsoDesc.DepthStencilState = shadowDSS;
+    shadowPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+    ThrowIfFailed(m_d3dDevice->CreateGraphicsPipelineState(&shadowPsoDesc,
+                                                           IID_PPV_ARGS(&m_pipelines["shadows"])));
   }
 
   virtual bool Initialize() override
@@ -747,6 +865,7 @@ public:
   std::unordered_map<std::string, ComPtr<ID3DBlob>>       m_shaders;
   std::unordered_map<std::string, unique_ptr<Texture>>    m_textures;
   std::vector<D3D12_INPUT_ELEMENT_DESC>                   m_inputLayout;
+  std::vector<D3D12_INPUT_ELEMENT_DESC>                   m_shadowVolumeInputLayout;
   std::unordered_map<string, ComPtr<ID3D12PipelineState>> m_pipelines;
   XMFLOAT3                                                m_eyePos = { 0.0f, 0.0f, 0.0f };
   XMFLOAT4X4                                              m_view = MathHelper::Identity4x4();
@@ -757,6 +876,11 @@ public:
   POINT                                                   m_lastMousePos;
   ComPtr<ID3D12DescriptorHeap>                            m_srvDescriptorHeap = nullptr;
   std::unordered_map<string, unique_ptr<MaterialInfo>>    m_materials;
+  MeshAdjacency                                           m_boxAdjacency;
+  std::vector<ShadowCaster>                               m_shadowCasters; // One per RenderLayer::Shadow object
+  std::unique_ptr<UploadBuffer<XMFLOAT4>>                 m_shadowVolumeVB = nullptr;
+  RingAllocator                                           m_shadowVolumeRing;
+  XMFLOAT3                                                m_lightPos = { 2.0f, 8.0f, -7.0f };
 
 
   const std::array<const CD3DX12_STATIC_SAMPLER_DESC, 6>  m_staticSamplers =
@@ -341,7 +341,12 @@ void TextureDemo::BuildShapeGeometry()
         vertices[i].texC   = box.m_vertices[i].m_texC;
     }
 
-    std::vector<std::uint16_t> indices = box.GetIndices16();
+    std::vector<std::uint16_t> indices;
+    if (box.GetIndices16(indices) == false)
+    {
+        ::OutputDebugStringA("Error! - the box has too many vertices for 16 bit indices\n");
+        return;
+    }
 
     const UINT vbByteSize = static_cast<UINT>(vertices.size() * sizeof(FrameResource::Vertex));
     const UINT ibBytesSize = static_cast<UINT>(indices.size() * sizeof(std::uint16_t));